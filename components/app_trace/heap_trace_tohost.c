@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -74,6 +74,26 @@ esp_err_t heap_trace_summary(heap_trace_summary_t *summary)
     return ESP_ERR_NOT_SUPPORTED;
 }
 
+esp_err_t heap_trace_set_sampling(heap_trace_sample_mode_t sample_mode, size_t period)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_init_callsites(heap_trace_callsite_t *callsite_buffer, size_t num_callsites)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+size_t heap_trace_get_callsite_count(void)
+{
+    return 0;
+}
+
+esp_err_t heap_trace_get_callsite(size_t index, heap_trace_callsite_t *callsite)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 void heap_trace_dump(void)
 {
     return;
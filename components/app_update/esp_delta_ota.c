@@ -0,0 +1,476 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_delta_ota.h"
+#include "esp_deflate.h"
+#include "mbedtls/sha256.h"
+
+/*
+ * Patch format, as generated by gen_delta_ota.py. All numbers are little endian.
+ *
+ * The patch starts with delta_ota_header_t, followed by commands. If deflate_bits is set in the
+ * header, the commands are compressed into a raw deflate (RFC 1951) stream with a window of
+ * that size. Compressed patches have version 2, so that they are rejected by the devices which
+ * only know the uncompressed patches of version 1, where deflate_bits was reserved. Each command starts with a varint (LEB128) token: the lowest 2 bits are the opcode,
+ * the rest is the length of data the command outputs.
+ *
+ * - INSERT: followed by the given number of literal bytes.
+ * - COPY_SRC: followed by a zigzag encoded varint, the offset of the data in the source
+ *   image relative to the "expected" source offset. The expected offset is the offset in the
+ *   source image aligned with the current offset in the new image: every command moves it
+ *   forward by the command length, COPY_SRC sets it to the end of the copied data.
+ *   So data which hasn't moved between the images is copied with the offset of 0.
+ * - COPY_DST: followed by a varint distance back from the current offset in the new image,
+ *   at most the window size given in the header. The copied data may overlap the output,
+ *   in which case the output is repeated.
+ *
+ * The patch ends once the whole new image has been output.
+ */
+
+#define DELTA_OTA_MAGIC             0x544C4445  /* "EDLT" */
+#define DELTA_OTA_VERSION           1
+#define DELTA_OTA_VERSION_DEFLATE   2
+#define DELTA_OTA_MAX_WINDOW_BITS   16
+#define DELTA_OTA_MIN_BUF_SIZE      4096
+/* Size of the buffer the compressed commands are decompressed into */
+#define DELTA_OTA_INFLATE_BUF_SIZE  512
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t window_bits;        /* log2 of the COPY_DST window size, 0 if COPY_DST is not used */
+    uint8_t deflate_bits;       /* log2 of the deflate window size, 0 if the commands aren't compressed */
+    uint8_t reserved;
+    uint32_t src_size;
+    uint32_t dst_size;
+    uint8_t src_sha256[32];
+    uint8_t dst_sha256[32];
+} delta_ota_header_t;
+
+_Static_assert(sizeof(delta_ota_header_t) == 80, "delta_ota_header_t should be 80 bytes");
+
+typedef enum {
+    DELTA_OTA_OP_INSERT = 0,
+    DELTA_OTA_OP_COPY_SRC = 1,
+    DELTA_OTA_OP_COPY_DST = 2,
+} delta_ota_op_t;
+
+typedef enum {
+    DELTA_OTA_STATE_HEADER,
+    DELTA_OTA_STATE_TOKEN,
+    DELTA_OTA_STATE_ARG,
+    DELTA_OTA_STATE_INSERT,
+    DELTA_OTA_STATE_DONE,
+} delta_ota_state_t;
+
+struct esp_delta_ota {
+    esp_delta_ota_cfg_t cfg;
+    delta_ota_header_t header;
+    size_t header_len;          /* bytes of the header received so far */
+    delta_ota_state_t state;
+    esp_err_t err;              /* first error, returned by all following calls */
+    mbedtls_sha256_context dst_sha;
+    /* Output ring buffer. Its contents are passed to write_cb when the end of the buffer is
+     * reached, and are kept there afterwards to be referenced by COPY_DST.
+     */
+    uint8_t *buf;
+    size_t buf_size;
+    size_t buf_pos;             /* position of the next output byte in buf */
+    size_t flushed_pos;         /* data in buf before this position was passed to write_cb */
+    uint32_t window_size;
+    uint32_t written;           /* size of the new image output so far */
+    int64_t src_pos;            /* expected offset in the source image */
+    delta_ota_op_t op;          /* current command */
+    uint32_t len;               /* remaining length of the current command */
+    uint32_t varint;            /* varint being decoded */
+    uint8_t varint_shift;
+    esp_inflate_handle_t inflate;    /* decompressor of the commands, NULL if they aren't compressed */
+    uint8_t *inflate_buf;
+};
+
+static const char *TAG = "esp_delta_ota";
+
+static esp_err_t flush_output(esp_delta_ota_handle_t h)
+{
+    if (h->buf_pos > h->flushed_pos) {
+        const uint8_t *data = h->buf + h->flushed_pos;
+        size_t size = h->buf_pos - h->flushed_pos;
+        mbedtls_sha256_update(&h->dst_sha, data, size);
+        h->flushed_pos = h->buf_pos;
+        esp_err_t err = h->cfg.write_cb(data, size, h->cfg.user_data);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (h->buf_pos == h->buf_size) {
+        h->buf_pos = 0;
+        h->flushed_pos = 0;
+    }
+    return ESP_OK;
+}
+
+/* Account for n bytes placed in buf at buf_pos, which must not cross the end of buf */
+static esp_err_t advance_output(esp_delta_ota_handle_t h, size_t n)
+{
+    h->buf_pos += n;
+    h->written += n;
+    h->src_pos += n;
+    if (h->buf_pos == h->buf_size) {
+        return flush_output(h);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t output_insert(esp_delta_ota_handle_t h, const uint8_t *data, size_t size)
+{
+    while (size > 0) {
+        size_t n = MIN(size, h->buf_size - h->buf_pos);
+        memcpy(h->buf + h->buf_pos, data, n);
+        data += n;
+        size -= n;
+        esp_err_t err = advance_output(h, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t output_copy_src(esp_delta_ota_handle_t h, int64_t offset, uint32_t len)
+{
+    if (offset < 0 || offset + len > h->header.src_size) {
+        ESP_LOGE(TAG, "Copy of %" PRIu32 " bytes from source offset %" PRIi64 " is out of bounds", len, offset);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    /* advance_output moves src_pos along, so it ends up after the copied data */
+    h->src_pos = offset;
+    while (len > 0) {
+        size_t n = MIN(len, h->buf_size - h->buf_pos);
+        esp_err_t err = esp_partition_read(h->cfg.src_partition, offset, h->buf + h->buf_pos, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        offset += n;
+        len -= n;
+        err = advance_output(h, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t output_copy_dst(esp_delta_ota_handle_t h, uint32_t distance, uint32_t len)
+{
+    if (distance == 0 || distance > h->window_size || distance > h->written) {
+        ESP_LOGE(TAG, "Copy from distance %" PRIu32 " is out of the window", distance);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    while (len > 0) {
+        size_t from = (h->buf_pos + h->buf_size - distance) & (h->buf_size - 1);
+        /* Limit by the distance, so that overlapping data is copied after it has been output */
+        size_t n = MIN(MIN(len, distance), MIN(h->buf_size - h->buf_pos, h->buf_size - from));
+        memmove(h->buf + h->buf_pos, h->buf + from, n);
+        len -= n;
+        esp_err_t err = advance_output(h, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t check_source(esp_delta_ota_handle_t h)
+{
+    const esp_partition_t *src = h->cfg.src_partition;
+    if (h->header.src_size > src->size) {
+        ESP_LOGE(TAG, "Patch source image size (%" PRIu32 ") exceeds the source partition size (%" PRIu32 ")",
+                 h->header.src_size, src->size);
+        return ESP_ERR_INVALID_STATE;
+    }
+    mbedtls_sha256_context ctx;
+    uint8_t sha[32];
+    esp_err_t err = ESP_OK;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, false);
+    /* The output buffer isn't used yet */
+    for (uint32_t offset = 0; offset < h->header.src_size; ) {
+        size_t n = MIN(h->buf_size, h->header.src_size - offset);
+        err = esp_partition_read(src, offset, h->buf, n);
+        if (err != ESP_OK) {
+            break;
+        }
+        mbedtls_sha256_update(&ctx, h->buf, n);
+        offset += n;
+    }
+    mbedtls_sha256_finish(&ctx, sha);
+    mbedtls_sha256_free(&ctx);
+    if (err == ESP_OK && memcmp(sha, h->header.src_sha256, sizeof(sha)) != 0) {
+        ESP_LOGE(TAG, "Patch was generated for a different source image");
+        err = ESP_ERR_INVALID_STATE;
+    }
+    return err;
+}
+
+static esp_err_t process_header(esp_delta_ota_handle_t h)
+{
+    const delta_ota_header_t *header = &h->header;
+    if (header->magic != DELTA_OTA_MAGIC) {
+        ESP_LOGE(TAG, "Invalid patch magic 0x%08" PRIx32, header->magic);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (header->version != (header->deflate_bits ? DELTA_OTA_VERSION_DEFLATE : DELTA_OTA_VERSION) ||
+            header->window_bits > DELTA_OTA_MAX_WINDOW_BITS ||
+            (header->deflate_bits != 0 && (header->deflate_bits < ESP_DEFLATE_MIN_WINDOW_BITS ||
+                                           header->deflate_bits > ESP_DEFLATE_MAX_WINDOW_BITS))) {
+        ESP_LOGE(TAG, "Unsupported patch version %d, window %d bits, deflate window %d bits",
+                 header->version, header->window_bits, header->deflate_bits);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    h->window_size = header->window_bits ? (1 << header->window_bits) : 0;
+    h->buf_size = MAX(h->window_size, DELTA_OTA_MIN_BUF_SIZE);
+    h->buf = malloc(h->buf_size);
+    if (h->buf == NULL) {
+        ESP_LOGE(TAG, "Cannot allocate %u bytes for the patch window", (unsigned) h->buf_size);
+        return ESP_ERR_NO_MEM;
+    }
+    if (header->deflate_bits) {
+        h->inflate = esp_inflate_create(header->deflate_bits);
+        h->inflate_buf = malloc(DELTA_OTA_INFLATE_BUF_SIZE);
+        if (h->inflate == NULL || h->inflate_buf == NULL) {
+            ESP_LOGE(TAG, "Cannot allocate the decompressor of the patch");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    esp_err_t err = check_source(h);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ESP_LOGD(TAG, "Patching %" PRIu32 " byte image to %" PRIu32 " byte image", header->src_size, header->dst_size);
+    h->state = header->dst_size > 0 ? DELTA_OTA_STATE_TOKEN : DELTA_OTA_STATE_DONE;
+    return ESP_OK;
+}
+
+/* Decode a varint from data, returns true once it's complete */
+static bool read_varint(esp_delta_ota_handle_t h, const uint8_t **data, size_t *size, esp_err_t *err)
+{
+    while (*size > 0) {
+        uint8_t byte = **data;
+        ++*data;
+        --*size;
+        if (h->varint_shift > 28 || (h->varint_shift == 28 && (byte & 0x70) != 0)) {
+            ESP_LOGE(TAG, "Invalid varint");
+            *err = ESP_ERR_INVALID_RESPONSE;
+            return false;
+        }
+        h->varint |= (uint32_t)(byte & 0x7F) << h->varint_shift;
+        h->varint_shift += 7;
+        if ((byte & 0x80) == 0) {
+            h->varint_shift = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t process_token(esp_delta_ota_handle_t h, uint32_t token)
+{
+    h->op = token & 0x3;
+    h->len = token >> 2;
+    if (h->len == 0 || h->len > h->header.dst_size - h->written) {
+        ESP_LOGE(TAG, "Invalid command length %" PRIu32 " at image offset %" PRIu32, h->len, h->written);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    switch (h->op) {
+    case DELTA_OTA_OP_INSERT:
+        h->state = DELTA_OTA_STATE_INSERT;
+        break;
+    case DELTA_OTA_OP_COPY_SRC:
+    case DELTA_OTA_OP_COPY_DST:
+        h->state = DELTA_OTA_STATE_ARG;
+        break;
+    default:
+        ESP_LOGE(TAG, "Invalid command %d", h->op);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t process_arg(esp_delta_ota_handle_t h, uint32_t arg)
+{
+    if (h->op == DELTA_OTA_OP_COPY_SRC) {
+        int32_t delta = (int32_t)(arg >> 1) ^ -(int32_t)(arg & 1);
+        return output_copy_src(h, h->src_pos + delta, h->len);
+    }
+    return output_copy_dst(h, arg, h->len);
+}
+
+static esp_err_t process_commands(esp_delta_ota_handle_t h, const uint8_t *data, size_t size)
+{
+    esp_err_t err = ESP_OK;
+    while (size > 0 && err == ESP_OK) {
+        switch (h->state) {
+        case DELTA_OTA_STATE_HEADER:
+            /* The header is processed by process_data() */
+            return ESP_ERR_INVALID_STATE;
+        case DELTA_OTA_STATE_TOKEN:
+        case DELTA_OTA_STATE_ARG: {
+            if (!read_varint(h, &data, &size, &err)) {
+                continue;
+            }
+            uint32_t value = h->varint;
+            h->varint = 0;
+            if (h->state == DELTA_OTA_STATE_TOKEN) {
+                err = process_token(h, value);
+                continue;
+            }
+            err = process_arg(h, value);
+            break;
+        }
+        case DELTA_OTA_STATE_INSERT: {
+            size_t n = MIN(size, h->len);
+            err = output_insert(h, data, n);
+            data += n;
+            size -= n;
+            h->len -= n;
+            if (h->len > 0) {
+                continue;
+            }
+            break;
+        }
+        case DELTA_OTA_STATE_DONE:
+            ESP_LOGE(TAG, "Unexpected data after the end of the patch");
+            return ESP_ERR_INVALID_SIZE;
+        }
+        /* Command is complete */
+        h->state = h->written == h->header.dst_size ? DELTA_OTA_STATE_DONE : DELTA_OTA_STATE_TOKEN;
+    }
+    return err;
+}
+
+static esp_err_t process_compressed_commands(esp_delta_ota_handle_t h, const uint8_t *data, size_t size)
+{
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK) {
+        uint8_t *out = h->inflate_buf;
+        size_t out_size = DELTA_OTA_INFLATE_BUF_SIZE;
+        /* The stream ends with its last block, the patch isn't split into messages */
+        if (esp_inflate(h->inflate, &data, &size, &out, &out_size, false) == ESP_ERR_INVALID_RESPONSE) {
+            ESP_LOGE(TAG, "Compressed patch data is corrupted");
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        err = process_commands(h, h->inflate_buf, out - h->inflate_buf);
+        if (out_size > 0) {
+            /* The output buffer isn't full, so all the input has been decompressed */
+            break;
+        }
+    }
+    return err;
+}
+
+static esp_err_t process_data(esp_delta_ota_handle_t h, const uint8_t *data, size_t size)
+{
+    if (h->state == DELTA_OTA_STATE_HEADER) {
+        size_t n = MIN(size, sizeof(h->header) - h->header_len);
+        memcpy((uint8_t *)&h->header + h->header_len, data, n);
+        h->header_len += n;
+        data += n;
+        size -= n;
+        if (h->header_len < sizeof(h->header)) {
+            return ESP_OK;
+        }
+        esp_err_t err = process_header(h);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (h->inflate) {
+        return process_compressed_commands(h, data, size);
+    }
+    return process_commands(h, data, size);
+}
+
+esp_err_t esp_delta_ota_begin(const esp_delta_ota_cfg_t *cfg, esp_delta_ota_handle_t *out_handle)
+{
+    if (cfg == NULL || cfg->src_partition == NULL || cfg->write_cb == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_delta_ota_handle_t h = calloc(1, sizeof(*h));
+    if (h == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    h->cfg = *cfg;
+    h->state = DELTA_OTA_STATE_HEADER;
+    mbedtls_sha256_init(&h->dst_sha);
+    mbedtls_sha256_starts(&h->dst_sha, false);
+    *out_handle = h;
+    return ESP_OK;
+}
+
+esp_err_t esp_delta_ota_write(esp_delta_ota_handle_t handle, const void *data, size_t size)
+{
+    if (handle == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->err == ESP_OK) {
+        handle->err = process_data(handle, data, size);
+    }
+    return handle->err;
+}
+
+static void delta_ota_free(esp_delta_ota_handle_t handle)
+{
+    mbedtls_sha256_free(&handle->dst_sha);
+    esp_inflate_destroy(handle->inflate);
+    free(handle->inflate_buf);
+    free(handle->buf);
+    free(handle);
+}
+
+esp_err_t esp_delta_ota_end(esp_delta_ota_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = handle->err;
+    if (err == ESP_OK && handle->state != DELTA_OTA_STATE_DONE) {
+        ESP_LOGE(TAG, "Patch is incomplete, %" PRIu32 " of %" PRIu32 " bytes output",
+                 handle->written, handle->header.dst_size);
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err == ESP_OK) {
+        err = flush_output(handle);
+    }
+    if (err == ESP_OK) {
+        uint8_t sha[32];
+        mbedtls_sha256_finish(&handle->dst_sha, sha);
+        if (memcmp(sha, handle->header.dst_sha256, sizeof(sha)) != 0) {
+            ESP_LOGE(TAG, "SHA-256 of the new image doesn't match");
+            err = ESP_ERR_INVALID_CRC;
+        }
+    }
+    delta_ota_free(handle);
+    return err;
+}
+
+esp_err_t esp_delta_ota_abort(esp_delta_ota_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    delta_ota_free(handle);
+    return ESP_OK;
+}
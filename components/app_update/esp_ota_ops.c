@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -54,9 +54,12 @@ typedef struct ota_ops_entry_ {
     uint32_t handle;
     const esp_partition_t *part;
     bool need_erase;
+    uint32_t erased_size;   /* with need_erase, the partition is erased up to this offset */
     uint32_t wrote_size;
     uint8_t partial_bytes;
     WORD_ALIGNED_ATTR uint8_t partial_data[16];
+    bool stream_verify;                 /* image is verified as it is written, see esp_image_verify_stream_begin() */
+    esp_image_verify_stream_t stream;
     LIST_ENTRY(ota_ops_entry_) entries;
 } ota_ops_entry_t;
 
@@ -116,6 +119,15 @@ static esp_err_t image_validate(const esp_partition_t *partition, esp_image_load
     return ESP_OK;
 }
 
+/* Stop verifying the image as it is written, esp_ota_end() will read it back from flash instead */
+static void stop_stream_verify(ota_ops_entry_t *it)
+{
+    if (it->stream_verify) {
+        esp_image_verify_stream_abort(&it->stream);
+        it->stream_verify = false;
+    }
+}
+
 static esp_ota_img_states_t set_new_state_otadata(void)
 {
 #ifdef CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
@@ -177,6 +189,12 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
         return ESP_ERR_NO_MEM;
     }
 
+    const esp_partition_pos_t part_pos = {
+        .offset = partition->address,
+        .size = partition->size,
+    };
+    new_entry->stream_verify = (esp_image_verify_stream_begin(&new_entry->stream, &part_pos, false) == ESP_OK);
+
     LIST_INSERT_HEAD(&s_ota_ops_entries_head, new_entry, entries);
 
     new_entry->part = partition;
@@ -186,6 +204,20 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     return ESP_OK;
 }
 
+/* Erase the sectors between the end of the erased area and 'offset', which haven't been erased yet */
+static esp_err_t erase_up_to(ota_ops_entry_t *it, size_t offset)
+{
+    size_t erase_end = MIN((offset + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1), it->part->size);
+    if (erase_end <= it->erased_size) {
+        return ESP_OK;
+    }
+    esp_err_t ret = esp_partition_erase_range(it->part, it->erased_size, erase_end - it->erased_size);
+    if (ret == ESP_OK) {
+        it->erased_size = erase_end;
+    }
+    return ret;
+}
+
 esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
 {
     const uint8_t *data_bytes = (const uint8_t *)data;
@@ -202,15 +234,7 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
         if (it->handle == handle) {
             if (it->need_erase) {
                 // must erase the partition before writing to it
-                uint32_t first_sector = it->wrote_size / SPI_FLASH_SEC_SIZE;
-                uint32_t last_sector = (it->wrote_size + size) / SPI_FLASH_SEC_SIZE;
-
-                ret = ESP_OK;
-                if ((it->wrote_size % SPI_FLASH_SEC_SIZE) == 0) {
-                    ret = esp_partition_erase_range(it->part, it->wrote_size, ((last_sector - first_sector) + 1) * SPI_FLASH_SEC_SIZE);
-                } else if (first_sector != last_sector) {
-                    ret = esp_partition_erase_range(it->part, (first_sector + 1) * SPI_FLASH_SEC_SIZE, (last_sector - first_sector) * SPI_FLASH_SEC_SIZE);
-                }
+                ret = erase_up_to(it, it->wrote_size + it->partial_bytes + size);
                 if (ret != ESP_OK) {
                     return ret;
                 }
@@ -221,6 +245,15 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
                 return ESP_ERR_OTA_VALIDATE_FAILED;
             }
 
+            if (it->stream_verify) {
+                ret = esp_image_verify_stream_feed(&it->stream, data_bytes, size);
+                if (ret == ESP_ERR_IMAGE_INVALID) {
+                    return ESP_ERR_OTA_VALIDATE_FAILED;
+                } else if (ret != ESP_OK) {
+                    return ret;
+                }
+            }
+
             if (esp_flash_encryption_enabled()) {
                 /* Can only write 16 byte blocks to flash, so need to cache anything else */
                 size_t copy_len;
@@ -236,6 +269,7 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
                     /* write 16 byte to partition */
                     ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
                     if (ret != ESP_OK) {
+                        stop_stream_verify(it);
                         return ret;
                     }
                     it->partial_bytes = 0;
@@ -256,6 +290,8 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
             ret = esp_partition_write(it->part, it->wrote_size, data_bytes, size);
             if(ret == ESP_OK){
                 it->wrote_size += size;
+            } else {
+                stop_stream_verify(it);
             }
             return ret;
         }
@@ -290,6 +326,8 @@ esp_err_t esp_ota_write_with_offset(esp_ota_handle_t handle, const void *data, s
                 ESP_LOGE(TAG, "Size should be 16byte aligned for flash encryption case");
                 return ESP_ERR_INVALID_ARG;
             }
+            /* Image can arrive in any order, it can't be verified as it is written */
+            stop_stream_verify(it);
             ret = esp_partition_write(it->part, offset, data_bytes, size);
             if (ret == ESP_OK) {
                 it->wrote_size += size;
@@ -314,6 +352,19 @@ static ota_ops_entry_t *get_ota_ops_entry(esp_ota_handle_t handle)
    return it;
 }
 
+esp_err_t esp_ota_erase_ahead(esp_ota_handle_t handle, size_t offset)
+{
+    ota_ops_entry_t *it = get_ota_ops_entry(handle);
+
+    if (it == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!it->need_erase) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return erase_up_to(it, offset);
+}
+
 esp_err_t esp_ota_abort(esp_ota_handle_t handle)
 {
     ota_ops_entry_t *it = get_ota_ops_entry(handle);
@@ -321,6 +372,7 @@ esp_err_t esp_ota_abort(esp_ota_handle_t handle)
     if (it == NULL) {
         return ESP_ERR_NOT_FOUND;
     }
+    stop_stream_verify(it);
     LIST_REMOVE(it, entries);
     free(it);
     return ESP_OK;
@@ -355,17 +407,27 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
     }
 
     esp_image_metadata_t data;
-    const esp_partition_pos_t part_pos = {
-      .offset = it->part->address,
-      .size = it->part->size,
-    };
+    if (it->stream_verify) {
+        /* Image has been parsed and hashed while it was written, no need to read it back */
+        it->stream_verify = false;
+        if (esp_image_verify_stream_end(&it->stream, &data) != ESP_OK) {
+            ret = ESP_ERR_OTA_VALIDATE_FAILED;
+            goto cleanup;
+        }
+    } else {
+        const esp_partition_pos_t part_pos = {
+          .offset = it->part->address,
+          .size = it->part->size,
+        };
 
-    if (esp_image_verify(ESP_IMAGE_VERIFY, &part_pos, &data) != ESP_OK) {
-        ret = ESP_ERR_OTA_VALIDATE_FAILED;
-        goto cleanup;
+        if (esp_image_verify(ESP_IMAGE_VERIFY, &part_pos, &data) != ESP_OK) {
+            ret = ESP_ERR_OTA_VALIDATE_FAILED;
+            goto cleanup;
+        }
     }
 
  cleanup:
+    stop_stream_verify(it);
     LIST_REMOVE(it, entries);
     free(it);
     return ret;
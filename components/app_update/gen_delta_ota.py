@@ -0,0 +1,322 @@
+#!/usr/bin/env python
+#
+# Generates a patch for delta OTA updates, to be applied on the device using esp_delta_ota.h APIs
+#
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+from typing import Dict, List, Optional, Tuple
+
+__version__ = '1.2'
+
+# Patch format, see esp_delta_ota.c for the description
+PATCH_MAGIC = b'EDLT'
+PATCH_VERSION = 1
+# Compressed patches have a different version, which devices supporting only version 1 reject
+PATCH_VERSION_DEFLATE = 2
+PATCH_HEADER = struct.Struct('<4sBBBBII32s32s')
+OP_INSERT = 0
+OP_COPY_SRC = 1
+OP_COPY_DST = 2
+
+DEFAULT_WINDOW_BITS = 15
+MAX_WINDOW_BITS = 16
+# Window of the deflate compression of the commands, 0 to disable it. Most of the redundancy is
+# removed by the copy commands, so larger windows gain little. zlib doesn't support raw deflate
+# windows smaller than 2^9 bytes.
+DEFAULT_DEFLATE_BITS = 12
+MIN_DEFLATE_BITS = 9
+MAX_DEFLATE_BITS = 15
+
+# Length of the hashed blocks used to find matches. Source positions are indexed every INDEX_STEP bytes,
+# so a match in the source image is found if it's at least HASH_LEN + INDEX_STEP - 1 bytes long.
+HASH_LEN = 12
+INDEX_STEP = 4
+# Candidate positions kept per hashed block, limits time spent on repetitive data
+MAX_CANDIDATES = 8
+# Shortest match worth a copy command at the expected source offset, and anywhere else
+MIN_MATCH_EXPECTED = 4
+MIN_MATCH = 10
+
+quiet = False
+
+
+def status(msg: str) -> None:
+    if not quiet:
+        print(msg, file=sys.stderr)
+
+
+class InputError(RuntimeError):
+    def __init__(self, e: str) -> None:
+        super(InputError, self).__init__(e)
+
+
+def _varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _zigzag(value: int) -> int:
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def _read_varint(data: bytes, pos: int) -> Tuple[int, int]:
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise InputError('Patch is truncated')
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def _match_len(a: bytes, a_pos: int, b: bytes, b_pos: int, limit: int) -> int:
+    """ Length of the common prefix of a[a_pos:] and b[b_pos:], at most limit """
+    limit = min(limit, len(a) - a_pos, len(b) - b_pos)
+    n = 0
+    step = 256
+    while step >= 1:
+        while n + step <= limit and a[a_pos + n:a_pos + n + step] == b[b_pos + n:b_pos + n + step]:
+            n += step
+        step //= 4
+    return n
+
+
+class PatchWriter(object):
+    def __init__(self) -> None:
+        self.data = bytearray()
+        self.written = 0
+        self.src_pos = 0
+
+    def insert(self, literal: bytes) -> None:
+        if literal:
+            self.data += _varint(len(literal) << 2 | OP_INSERT) + literal
+            self.written += len(literal)
+            self.src_pos += len(literal)
+
+    def copy_src(self, offset: int, length: int) -> None:
+        self.data += _varint(length << 2 | OP_COPY_SRC) + _varint(_zigzag(offset - self.src_pos))
+        self.written += length
+        self.src_pos = offset + length
+
+    def copy_dst(self, distance: int, length: int) -> None:
+        self.data += _varint(length << 2 | OP_COPY_DST) + _varint(distance)
+        self.written += length
+        self.src_pos += length
+
+
+def generate(src: bytes, dst: bytes, window_bits: int = DEFAULT_WINDOW_BITS, deflate_bits: int = DEFAULT_DEFLATE_BITS) -> bytes:
+    """ Generates a patch which reconstructs dst from src """
+    if not 0 <= window_bits <= MAX_WINDOW_BITS:
+        raise InputError('Window size should be between 0 and {} bits'.format(MAX_WINDOW_BITS))
+    if deflate_bits != 0 and not MIN_DEFLATE_BITS <= deflate_bits <= MAX_DEFLATE_BITS:
+        raise InputError('Deflate window size should be 0 or between {} and {} bits'.format(MIN_DEFLATE_BITS, MAX_DEFLATE_BITS))
+    window = (1 << window_bits) if window_bits else 0
+
+    src_index = {}  # type: Dict[bytes, List[int]]
+    for pos in range(0, len(src) - HASH_LEN + 1, INDEX_STEP):
+        candidates = src_index.setdefault(src[pos:pos + HASH_LEN], [])
+        if len(candidates) < MAX_CANDIDATES:
+            candidates.append(pos)
+    dst_index = {}  # type: Dict[bytes, int]
+    dst_indexed = 0
+
+    patch = PatchWriter()
+    literal_start = 0
+    pos = 0
+    while pos < len(dst):
+        best_len = 0
+        best_op = OP_INSERT
+        best_arg = 0
+        best_back = 0
+        limit = len(dst) - pos
+
+        # Data which hasn't moved relative to the previous command is the cheapest to copy
+        expected = patch.src_pos + (pos - literal_start)
+        if 0 <= expected < len(src):
+            n = _match_len(dst, pos, src, expected, limit)
+            if n >= MIN_MATCH_EXPECTED:
+                best_len, best_op, best_arg = n, OP_COPY_SRC, expected
+
+        if best_len < 64 and pos + HASH_LEN <= len(dst):
+            key = dst[pos:pos + HASH_LEN]
+            for candidate in src_index.get(key, ()):
+                n = _match_len(dst, pos, src, candidate, limit)
+                # Extend the match back into the pending literal
+                back = 0
+                while back < pos - literal_start and back < candidate and \
+                        dst[pos - back - 1] == src[candidate - back - 1]:
+                    back += 1
+                if n + back > best_len + best_back and n + back >= MIN_MATCH:
+                    best_len, best_op, best_arg, best_back = n, OP_COPY_SRC, candidate, back
+            candidate = dst_index.get(key, -1)
+            if candidate >= 0 and pos - candidate <= window:
+                n = _match_len(dst, pos, dst, candidate, limit)
+                if n > best_len + best_back and n >= MIN_MATCH:
+                    best_len, best_op, best_arg, best_back = n, OP_COPY_DST, pos - candidate, 0
+
+        if best_op == OP_INSERT:
+            pos += 1
+        else:
+            start = pos - best_back
+            patch.insert(dst[literal_start:start])
+            if best_op == OP_COPY_SRC:
+                patch.copy_src(best_arg - best_back, best_len + best_back)
+            else:
+                patch.copy_dst(best_arg, best_len)
+            pos += best_len
+            literal_start = pos
+
+        if window:
+            # Positions before pos can be referenced by the following commands
+            for indexed in range(dst_indexed, min(pos, len(dst) - HASH_LEN + 1)):
+                dst_index[dst[indexed:indexed + HASH_LEN]] = indexed
+            dst_indexed = max(dst_indexed, pos)
+    patch.insert(dst[literal_start:])
+    assert patch.written == len(dst)
+
+    commands = bytes(patch.data)
+    if deflate_bits:
+        compressor = zlib.compressobj(9, zlib.DEFLATED, -deflate_bits, 9)
+        compressed = compressor.compress(commands) + compressor.flush()
+        if len(compressed) < len(commands):
+            commands = compressed
+        else:
+            deflate_bits = 0
+    version = PATCH_VERSION_DEFLATE if deflate_bits else PATCH_VERSION
+    header = PATCH_HEADER.pack(PATCH_MAGIC, version, window_bits, deflate_bits, 0, len(src), len(dst),
+                               hashlib.sha256(src).digest(), hashlib.sha256(dst).digest())
+    return header + commands
+
+
+def apply(src: bytes, patch: bytes) -> bytes:
+    """ Reconstructs the new image from src and patch, the same way as the device does """
+    if len(patch) < PATCH_HEADER.size:
+        raise InputError('Patch is truncated')
+    magic, version, window_bits, deflate_bits, _, src_size, dst_size, src_sha, dst_sha = PATCH_HEADER.unpack_from(patch)
+    if magic != PATCH_MAGIC or version != (PATCH_VERSION_DEFLATE if deflate_bits else PATCH_VERSION):
+        raise InputError('Not a delta OTA patch, or unsupported patch version')
+    if src_size > len(src) or hashlib.sha256(src[:src_size]).digest() != src_sha:
+        raise InputError('Patch was generated for a different source image')
+    window = (1 << window_bits) if window_bits else 0
+    if deflate_bits:
+        try:
+            # data following the end of the compressed stream is ignored, as on the device
+            patch = patch[:PATCH_HEADER.size] + zlib.decompressobj(-deflate_bits).decompress(patch[PATCH_HEADER.size:])
+        except zlib.error as e:
+            raise InputError('Compressed patch data is corrupted: {}'.format(e))
+
+    dst = bytearray()
+    src_pos = 0
+    pos = PATCH_HEADER.size
+    while len(dst) < dst_size:
+        token, pos = _read_varint(patch, pos)
+        op, length = token & 0x3, token >> 2
+        if length == 0 or len(dst) + length > dst_size:
+            raise InputError('Invalid command length {} at image offset {}'.format(length, len(dst)))
+        if op == OP_INSERT:
+            if pos + length > len(patch):
+                raise InputError('Patch is truncated')
+            dst += patch[pos:pos + length]
+            pos += length
+            src_pos += length
+        elif op == OP_COPY_SRC:
+            arg, pos = _read_varint(patch, pos)
+            offset = src_pos + ((arg >> 1) ^ -(arg & 1))
+            if offset < 0 or offset + length > src_size:
+                raise InputError('Copy from source offset {} is out of bounds'.format(offset))
+            dst += src[offset:offset + length]
+            src_pos = offset + length
+        elif op == OP_COPY_DST:
+            distance, pos = _read_varint(patch, pos)
+            if distance == 0 or distance > window or distance > len(dst):
+                raise InputError('Copy from distance {} is out of the window'.format(distance))
+            for _ in range(length):
+                dst.append(dst[-distance])
+            src_pos += length
+        else:
+            raise InputError('Invalid command {}'.format(op))
+    if pos != len(patch):
+        raise InputError('Unexpected data after the end of the patch')
+    if hashlib.sha256(dst).digest() != dst_sha:
+        raise InputError('SHA-256 of the new image does not match')
+    return bytes(dst)
+
+
+def _read_file(path: str) -> bytes:
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def _write_file(path: str, data: bytes) -> None:
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+def main() -> Optional[int]:
+    global quiet
+
+    parser = argparse.ArgumentParser(description='ESP-IDF delta OTA patch generator')
+    parser.add_argument('--quiet', '-q', help='suppress stderr messages', action='store_true')
+
+    subparsers = parser.add_subparsers(dest='operation', help='run gen_delta_ota.py {command} -h for additional help')
+
+    generate_parser = subparsers.add_parser('generate', help='generate a patch from the base and the new application image')
+    generate_parser.add_argument('--base', help='application image currently on the device', required=True)
+    generate_parser.add_argument('--new', help='new application image', required=True)
+    generate_parser.add_argument('--output', '-o', help='patch file to write', required=True)
+    generate_parser.add_argument('--window-bits', help='log2 of the size of the window for copies within the new image, '
+                                 'the device allocates a buffer of this size while applying the patch (default %(default)s)',
+                                 type=int, default=DEFAULT_WINDOW_BITS)
+    generate_parser.add_argument('--deflate-bits', help='log2 of the size of the deflate window used to compress the patch, '
+                                 '0 to not compress it. The device allocates a buffer of this size while applying the patch '
+                                 '(default %(default)s)', type=int, default=DEFAULT_DEFLATE_BITS)
+
+    apply_parser = subparsers.add_parser('apply', help='apply a patch to the base image, to check it')
+    apply_parser.add_argument('--base', help='application image the patch was generated against', required=True)
+    apply_parser.add_argument('--patch', help='patch file', required=True)
+    apply_parser.add_argument('--output', '-o', help='new application image to write', required=True)
+
+    args = parser.parse_args()
+    quiet = args.quiet
+
+    if args.operation is None:
+        parser.print_help()
+        return 1
+
+    base = _read_file(args.base)
+    if args.operation == 'generate':
+        new = _read_file(args.new)
+        patch = generate(base, new, args.window_bits, args.deflate_bits)
+        _write_file(args.output, patch)
+        status('Patch of {} bytes written to {} ({:.1f}% of the new image)'.format(
+            len(patch), args.output, 100.0 * len(patch) / max(len(new), 1)))
+    else:
+        new = apply(base, _read_file(args.patch))
+        _write_file(args.output, new)
+        status('New image of {} bytes written to {}'.format(len(new), args.output))
+    return 0
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main())
+    except InputError as e:
+        print(e, file=sys.stderr)
+        sys.exit(2)
@@ -0,0 +1,343 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Linux host delta OTA test
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "esp_delta_ota.h"
+#include "esp_deflate.h"
+#include "mbedtls/sha256.h"
+#include "unity.h"
+#include "unity_fixture.h"
+
+#define SRC_SIZE        (32 * 1024)
+#define PATCH_MAX_SIZE  (16 * 1024)
+#define DST_MAX_SIZE    (64 * 1024)
+#define HEADER_SIZE     80
+
+/* Builds a patch and the image it's expected to produce, following the format in esp_delta_ota.c */
+typedef struct {
+    const uint8_t *src;
+    uint8_t *patch;
+    size_t patch_len;
+    uint8_t *dst;
+    size_t dst_len;
+    int64_t src_pos;
+} patch_builder_t;
+
+typedef struct {
+    const esp_partition_t *partition;
+    size_t offset;
+} write_ctx_t;
+
+static const esp_partition_t *s_src_part;
+static const esp_partition_t *s_dst_part;
+static uint8_t *s_src;
+static patch_builder_t s_builder;
+
+static void put_varint(patch_builder_t *b, uint32_t value)
+{
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        b->patch[b->patch_len++] = byte | (value ? 0x80 : 0);
+    } while (value);
+}
+
+static void op_insert(patch_builder_t *b, const uint8_t *data, uint32_t len)
+{
+    put_varint(b, len << 2 | 0);
+    memcpy(b->patch + b->patch_len, data, len);
+    b->patch_len += len;
+    memcpy(b->dst + b->dst_len, data, len);
+    b->dst_len += len;
+    b->src_pos += len;
+}
+
+static void op_copy_src(patch_builder_t *b, int64_t offset, uint32_t len)
+{
+    int32_t delta = offset - b->src_pos;
+    put_varint(b, len << 2 | 1);
+    put_varint(b, ((uint32_t) delta << 1) ^ (uint32_t)(delta >> 31));
+    // copies out of the source image bounds are built to test that they are rejected
+    memcpy(b->dst + b->dst_len, b->src + offset, MIN(len, SRC_SIZE - offset));
+    b->dst_len += len;
+    b->src_pos = offset + len;
+}
+
+static void op_copy_dst(patch_builder_t *b, uint32_t distance, uint32_t len)
+{
+    put_varint(b, len << 2 | 2);
+    put_varint(b, distance);
+    for (uint32_t i = 0; i < len; ++i) {
+        b->dst[b->dst_len + i] = b->dst[b->dst_len + i - distance];
+    }
+    b->dst_len += len;
+    b->src_pos += len;
+}
+
+static void builder_init(patch_builder_t *b, const uint8_t *src)
+{
+    memset(b->patch, 0, PATCH_MAX_SIZE);
+    *b = (patch_builder_t) {
+        .src = src, .patch = b->patch, .patch_len = HEADER_SIZE, .dst = b->dst,
+    };
+}
+
+static void builder_finish(patch_builder_t *b, uint8_t window_bits)
+{
+    uint8_t *header = b->patch;
+    const uint32_t src_size = SRC_SIZE;
+    const uint32_t dst_size = b->dst_len;
+    memcpy(header, "EDLT", 4);
+    header[4] = 1;
+    header[5] = window_bits;
+    memcpy(header + 8, &src_size, 4);
+    memcpy(header + 12, &dst_size, 4);
+    TEST_ASSERT_EQUAL(0, mbedtls_sha256(b->src, SRC_SIZE, header + 16, 0));
+    TEST_ASSERT_EQUAL(0, mbedtls_sha256(b->dst, b->dst_len, header + 48, 0));
+}
+
+/* Compresses the commands of a finished patch */
+static void builder_compress(patch_builder_t *b, uint8_t deflate_bits)
+{
+    const size_t commands_len = b->patch_len - HEADER_SIZE;
+    uint8_t *commands = malloc(commands_len);
+    TEST_ASSERT_NOT_NULL(commands);
+    memcpy(commands, b->patch + HEADER_SIZE, commands_len);
+    esp_deflate_handle_t deflate = esp_deflate_create(deflate_bits);
+    TEST_ASSERT_NOT_NULL(deflate);
+    size_t len;
+    TEST_ESP_OK(esp_deflate_message(deflate, commands, commands_len, b->patch + HEADER_SIZE,
+                                    PATCH_MAX_SIZE - HEADER_SIZE, &len, true));
+    esp_deflate_destroy(deflate);
+    free(commands);
+    b->patch[4] = 2;
+    b->patch[6] = deflate_bits;
+    b->patch_len = HEADER_SIZE + len;
+}
+
+static esp_err_t write_to_partition(const void *data, size_t size, void *user_data)
+{
+    write_ctx_t *ctx = (write_ctx_t *) user_data;
+    esp_err_t err = esp_partition_write(ctx->partition, ctx->offset, data, size);
+    ctx->offset += size;
+    return err;
+}
+
+/* Feeds the patch in pieces of random size, returns the first error */
+static esp_err_t apply_patch(const uint8_t *patch, size_t patch_len, write_ctx_t *ctx)
+{
+    TEST_ESP_OK(esp_partition_erase_range(s_dst_part, 0, s_dst_part->size));
+    *ctx = (write_ctx_t) { .partition = s_dst_part };
+    esp_delta_ota_cfg_t cfg = {
+        .src_partition = s_src_part,
+        .write_cb = write_to_partition,
+        .user_data = ctx,
+    };
+    esp_delta_ota_handle_t handle;
+    TEST_ESP_OK(esp_delta_ota_begin(&cfg, &handle));
+    for (size_t pos = 0; pos < patch_len; ) {
+        const size_t chunk = 1 + rand() % 97;
+        const size_t n = MIN(chunk, patch_len - pos);
+        esp_err_t err = esp_delta_ota_write(handle, patch + pos, n);
+        if (err != ESP_OK) {
+            TEST_ASSERT_EQUAL(err, esp_delta_ota_write(handle, patch, 1));
+            TEST_ESP_OK(esp_delta_ota_abort(handle));
+            return err;
+        }
+        pos += n;
+    }
+    return esp_delta_ota_end(handle);
+}
+
+TEST_GROUP(delta_ota);
+
+TEST_SETUP(delta_ota)
+{
+    s_src_part = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, NULL);
+    s_dst_part = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, NULL);
+    TEST_ASSERT_NOT_NULL(s_src_part);
+    TEST_ASSERT_NOT_NULL(s_dst_part);
+
+    srand(1);
+    s_src = malloc(SRC_SIZE);
+    s_builder.patch = malloc(PATCH_MAX_SIZE);
+    s_builder.dst = malloc(DST_MAX_SIZE);
+    TEST_ASSERT_NOT_NULL(s_src);
+    TEST_ASSERT_NOT_NULL(s_builder.patch);
+    TEST_ASSERT_NOT_NULL(s_builder.dst);
+    for (size_t i = 0; i < SRC_SIZE; ++i) {
+        s_src[i] = rand();
+    }
+    TEST_ESP_OK(esp_partition_erase_range(s_src_part, 0, s_src_part->size));
+    TEST_ESP_OK(esp_partition_write(s_src_part, 0, s_src, SRC_SIZE));
+    builder_init(&s_builder, s_src);
+}
+
+TEST_TEAR_DOWN(delta_ota)
+{
+    free(s_builder.dst);
+    free(s_builder.patch);
+    free(s_src);
+}
+
+TEST(delta_ota, test_delta_ota_reconstructs_image)
+{
+    patch_builder_t *b = &s_builder;
+    const uint8_t changed[] = { 0xde, 0xad, 0xbe, 0xef };
+    const uint8_t fill = 0xff;
+
+    op_copy_src(b, 0, 5000);
+    op_insert(b, changed, sizeof(changed));
+    // continues at the same position, replacing 4 bytes of the source
+    op_copy_src(b, 5004, 3000);
+    op_copy_src(b, 100, 2000);
+    op_copy_src(b, 20000, SRC_SIZE - 20000);
+    // run of repeated bytes
+    op_insert(b, &fill, 1);
+    op_copy_dst(b, 1, 3000);
+    // copy of earlier data, from the far end of the window
+    op_copy_dst(b, 8192, 6000);
+    op_insert(b, s_src, 1000);
+    builder_finish(b, 13);
+    TEST_ASSERT_LESS_THAN(300 + 1000, b->patch_len);
+
+    write_ctx_t ctx;
+    TEST_ESP_OK(apply_patch(b->patch, b->patch_len, &ctx));
+    TEST_ASSERT_EQUAL(b->dst_len, ctx.offset);
+    uint8_t *out = malloc(b->dst_len);
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ESP_OK(esp_partition_read(s_dst_part, 0, out, b->dst_len));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(b->dst, out, b->dst_len);
+    free(out);
+}
+
+TEST(delta_ota, test_delta_ota_compressed_patch)
+{
+    patch_builder_t *b = &s_builder;
+    char text[1000];
+    for (size_t i = 0; i < sizeof(text); ++i) {
+        text[i] = "delta ota"[i % 9] + i / 100;
+    }
+
+    op_copy_src(b, 0, 5000);
+    op_insert(b, (const uint8_t *) text, sizeof(text));
+    op_copy_src(b, 6000, 3000);
+    op_copy_dst(b, 3000, 500);
+    op_insert(b, s_src, 1000);
+    builder_finish(b, 12);
+    const size_t uncompressed_len = b->patch_len;
+    builder_compress(b, 10);
+    TEST_ASSERT_LESS_THAN(uncompressed_len - 500, b->patch_len);
+
+    write_ctx_t ctx;
+    TEST_ESP_OK(apply_patch(b->patch, b->patch_len, &ctx));
+    TEST_ASSERT_EQUAL(b->dst_len, ctx.offset);
+    uint8_t *out = malloc(b->dst_len);
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ESP_OK(esp_partition_read(s_dst_part, 0, out, b->dst_len));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(b->dst, out, b->dst_len);
+    free(out);
+
+    // compressed data ends before the end of the new image
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, apply_patch(b->patch, b->patch_len - 100, &ctx));
+
+    // deflate window out of range
+    b->patch[6] = 16;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, apply_patch(b->patch, b->patch_len, &ctx));
+
+    // compressed patch with the version of the uncompressed patches
+    b->patch[4] = 1;
+    b->patch[6] = 10;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, apply_patch(b->patch, b->patch_len, &ctx));
+    b->patch[4] = 2;
+
+    // invalid block type
+    b->patch[6] = 10;
+    b->patch[HEADER_SIZE] = 0x07;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, apply_patch(b->patch, b->patch_len, &ctx));
+}
+
+TEST(delta_ota, test_delta_ota_rejects_other_source)
+{
+    patch_builder_t *b = &s_builder;
+    op_copy_src(b, 0, SRC_SIZE);
+    builder_finish(b, 0);
+
+    const uint8_t byte = ~s_src[SRC_SIZE - 1];
+    TEST_ESP_OK(esp_partition_write(s_src_part, SRC_SIZE - 1, &byte, 1));
+    write_ctx_t ctx;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, apply_patch(b->patch, b->patch_len, &ctx));
+    TEST_ASSERT_EQUAL(0, ctx.offset);
+
+    memcpy(b->patch, "ABCD", 4);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, apply_patch(b->patch, b->patch_len, &ctx));
+}
+
+TEST(delta_ota, test_delta_ota_rejects_incomplete_patch)
+{
+    patch_builder_t *b = &s_builder;
+    op_copy_src(b, 0, 1000);
+    op_insert(b, s_src, 1000);
+    builder_finish(b, 0);
+
+    write_ctx_t ctx;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, apply_patch(b->patch, b->patch_len - 1, &ctx));
+    // data following the end of the patch
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, apply_patch(b->patch, b->patch_len + 1, &ctx));
+}
+
+TEST(delta_ota, test_delta_ota_rejects_corrupted_patch)
+{
+    patch_builder_t *b = &s_builder;
+    op_insert(b, s_src, 100);
+    op_copy_src(b, SRC_SIZE - 100, 100);
+    builder_finish(b, 12);
+    write_ctx_t ctx;
+    TEST_ESP_OK(apply_patch(b->patch, b->patch_len, &ctx));
+
+    // flipped bit in the inserted data is caught by the hash check
+    b->patch[HEADER_SIZE + 10] ^= 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, apply_patch(b->patch, b->patch_len, &ctx));
+
+    // copy beyond the end of the source image
+    builder_init(b, s_src);
+    op_copy_src(b, SRC_SIZE - 100, 101);
+    builder_finish(b, 12);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, apply_patch(b->patch, b->patch_len, &ctx));
+
+    // copy from outside of the window
+    builder_init(b, s_src);
+    op_copy_src(b, 0, 8192);
+    op_copy_dst(b, 4097, 10);
+    builder_finish(b, 12);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, apply_patch(b->patch, b->patch_len, &ctx));
+}
+
+TEST_GROUP_RUNNER(delta_ota)
+{
+    RUN_TEST_CASE(delta_ota, test_delta_ota_reconstructs_image);
+    RUN_TEST_CASE(delta_ota, test_delta_ota_compressed_patch);
+    RUN_TEST_CASE(delta_ota, test_delta_ota_rejects_other_source);
+    RUN_TEST_CASE(delta_ota, test_delta_ota_rejects_incomplete_patch);
+    RUN_TEST_CASE(delta_ota, test_delta_ota_rejects_corrupted_patch);
+}
+
+static void run_all_tests(void)
+{
+    RUN_TEST_GROUP(delta_ota);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_MAIN_FUNC(run_all_tests);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Callback receiving the reconstructed image
+ *
+ * Called with consecutive pieces of the new image, in order. To write the image to an OTA
+ * partition, call esp_ota_write() from this callback.
+ *
+ * @param data Image data
+ * @param size Size of data in bytes
+ * @param user_data User data passed in esp_delta_ota_cfg_t
+ *
+ * @return ESP_OK to continue, any other error stops the update and is returned from
+ *         esp_delta_ota_write() or esp_delta_ota_end()
+ */
+typedef esp_err_t (*esp_delta_ota_write_cb_t)(const void *data, size_t size, void *user_data);
+
+/**
+ * @brief Delta OTA configuration
+ */
+typedef struct {
+    const esp_partition_t *src_partition;   /*!< Partition containing the image the patch was generated against, usually esp_ota_get_running_partition() */
+    esp_delta_ota_write_cb_t write_cb;      /*!< Callback receiving the reconstructed image */
+    void *user_data;                        /*!< User data passed to write_cb */
+} esp_delta_ota_cfg_t;
+
+/**
+ * @brief Opaque handle of a delta OTA update
+ */
+typedef struct esp_delta_ota *esp_delta_ota_handle_t;
+
+/**
+ * @brief Start applying a patch generated by gen_delta_ota.py
+ *
+ * The new image is reconstructed from the image in the source partition and the patch data
+ * passed to esp_delta_ota_write(). Typically the reconstructed image is written to the
+ * partition returned by esp_ota_get_next_update_partition(), with esp_ota_begin() called
+ * with OTA_WITH_SEQUENTIAL_WRITES, as the size of the image is not known in advance.
+ *
+ * The patch header is checked when it's received by esp_delta_ota_write(): the image in the
+ * source partition has to match the one the patch was generated against.
+ *
+ * @param cfg Configuration
+ * @param[out] out_handle On success, handle of the update
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: cfg, src_partition, write_cb or out_handle is NULL
+ *    - ESP_ERR_NO_MEM: Cannot allocate memory for the update
+ */
+esp_err_t esp_delta_ota_begin(const esp_delta_ota_cfg_t *cfg, esp_delta_ota_handle_t *out_handle);
+
+/**
+ * @brief Pass patch data to the delta OTA update
+ *
+ * The patch can be passed in pieces of any size, as it arrives. Reconstructed image data
+ * is passed to write_cb in larger pieces, so not every call results in a write.
+ *
+ * Once this function returns an error, the update has failed and the following calls return
+ * the same error. esp_delta_ota_end() or esp_delta_ota_abort() still has to be called to free
+ * the handle.
+ *
+ * @param handle Handle obtained from esp_delta_ota_begin()
+ * @param data Patch data
+ * @param size Size of data in bytes
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: handle or data is NULL
+ *    - ESP_ERR_NOT_SUPPORTED: Data is not a patch, or a patch of an unsupported version
+ *    - ESP_ERR_INVALID_STATE: The patch was generated against a different image than the one in src_partition
+ *    - ESP_ERR_INVALID_SIZE: The patch is longer than indicated by its header
+ *    - ESP_ERR_INVALID_RESPONSE: The patch is corrupted, e.g. refers to data outside of the images
+ *    - ESP_ERR_NO_MEM: Cannot allocate memory for the windows requested by the patch
+ *    - Errors returned by esp_partition_read() or write_cb
+ */
+esp_err_t esp_delta_ota_write(esp_delta_ota_handle_t handle, const void *data, size_t size);
+
+/**
+ * @brief Finish the delta OTA update and free the handle
+ *
+ * Passes the rest of the reconstructed image to write_cb and checks that the whole image
+ * has been reconstructed and that its SHA-256 matches the one recorded in the patch.
+ * The handle is freed, whether the update has succeeded or not.
+ *
+ * @note The image is passed to write_cb before its hash is checked. If this function fails,
+ *       the partition the image was written to has to be discarded, e.g. by esp_ota_abort().
+ *
+ * @param handle Handle obtained from esp_delta_ota_begin()
+ *
+ * @return
+ *    - ESP_OK: The new image has been reconstructed
+ *    - ESP_ERR_INVALID_ARG: handle is NULL
+ *    - ESP_ERR_INVALID_SIZE: The patch is incomplete
+ *    - ESP_ERR_INVALID_CRC: SHA-256 of the reconstructed image doesn't match the one in the patch
+ *    - Error returned by an earlier call to esp_delta_ota_write(), or by write_cb
+ */
+esp_err_t esp_delta_ota_end(esp_delta_ota_handle_t handle);
+
+/**
+ * @brief Abort the delta OTA update and free the handle
+ *
+ * @param handle Handle obtained from esp_delta_ota_begin()
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: handle is NULL
+ */
+esp_err_t esp_delta_ota_abort(esp_delta_ota_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -105,6 +105,9 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * data is received during the OTA operation. Data is written
  * sequentially to the partition.
  *
+ * The image headers, checksum and SHA-256 are verified as the data is written,
+ * so esp_ota_end() doesn't need to read the image back from flash.
+ *
  * @param handle  Handle obtained from esp_ota_begin
  * @param data    Data buffer to write
  * @param size    Size of data buffer in bytes.
@@ -112,7 +115,8 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * @return
  *    - ESP_OK: Data was written to flash successfully.
  *    - ESP_ERR_INVALID_ARG: handle is invalid.
- *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte,
+ *      or the image written so far is not a valid app image.
  *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
  *    - ESP_ERR_OTA_SELECT_INFO_INVALID: OTA data partition has invalid contents
  */
@@ -131,6 +135,7 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
  *
  * @note While performing OTA, if the packets arrive out of order, esp_ota_write_with_offset() can be used to write data in non-contiguous manner.
  *       Use of esp_ota_write_with_offset() in combination with esp_ota_write() is not recommended.
+ *       The image can't be verified as it is written in this case, esp_ota_end() reads it back from flash to verify it.
  *
  * @return
  *    - ESP_OK: Data was written to flash successfully.
@@ -141,6 +146,26 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
  */
 esp_err_t esp_ota_write_with_offset(esp_ota_handle_t handle, const void *data, size_t size, uint32_t offset);
 
+/**
+ * @brief   Erase the partition ahead of the data written by esp_ota_write()
+ *
+ * When the OTA update was started with OTA_WITH_SEQUENTIAL_WRITES, esp_ota_write() erases
+ * the flash sectors it is about to write to. This function lets the caller erase them in advance,
+ * for example in larger blocks or while it is waiting for more data. Sectors which are already
+ * erased are not erased again, neither by this function nor by esp_ota_write().
+ *
+ * @param handle  Handle obtained from esp_ota_begin
+ * @param offset  Offset in the partition up to which it should be erased, rounded up to the flash sector size.
+ *                Offsets beyond the end of the partition are limited to the partition size.
+ *
+ * @return
+ *    - ESP_OK: Partition is erased up to the offset.
+ *    - ESP_ERR_NOT_FOUND: OTA handle was not found.
+ *    - ESP_ERR_INVALID_STATE: OTA update was not started with OTA_WITH_SEQUENTIAL_WRITES.
+ *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash erase failed.
+ */
+esp_err_t esp_ota_erase_ahead(esp_ota_handle_t handle, size_t offset);
+
 /**
  * @brief Finish OTA update and validate newly written app image.
  *
@@ -1,11 +1,12 @@
 /*
- * SPDX-FileCopyrightText: 2021-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
@@ -13,6 +14,9 @@
 #include <unity.h>
 #include <test_utils.h>
 #include <esp_ota_ops.h>
+#include <esp_image_format.h>
+#include <esp_flash_encrypt.h>
+#include <spi_flash_mmap.h>
 
 /* These OTA tests currently don't assume an OTA partition exists
    on the device, so they're a bit limited
@@ -113,3 +117,156 @@ TEST_CASE("esp_ota_get_partition_description", "[ota]")
     };
     TEST_ESP_ERR(ESP_ERR_NOT_FOUND, bootloader_common_get_partition_description(&not_app_pos, &app_desc1));
 }
+
+/* Writes the image in chunks of varying size, so that headers and words of segment data are split between writes */
+static esp_err_t write_image_in_chunks(esp_ota_handle_t handle, const uint8_t *image, size_t size)
+{
+    const size_t chunks[] = { 1, 7, 24, 3, 1000, 4093, 8, 2 };
+    size_t offset = 0;
+    for (int i = 0; offset < size; i = (i + 1) % (sizeof(chunks) / sizeof(chunks[0]))) {
+        size_t len = MIN(chunks[i], size - offset);
+        esp_err_t err = esp_ota_write(handle, image + offset, len);
+        if (err != ESP_OK) {
+            return err;
+        }
+        offset += len;
+    }
+    return ESP_OK;
+}
+
+TEST_CASE("esp_ota_end() verifies the image as it is written", "[ota]")
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_NOT_NULL(running);
+    TEST_ASSERT_NOT_NULL(update);
+
+    esp_image_metadata_t data;
+    const esp_partition_pos_t running_pos = {
+        .offset = running->address,
+        .size = running->size,
+    };
+    TEST_ESP_OK(esp_image_verify(ESP_IMAGE_VERIFY_SILENT, &running_pos, &data));
+
+    const void *image;
+    esp_partition_mmap_handle_t image_map;
+    TEST_ESP_OK(esp_partition_mmap(running, 0, data.image_len, ESP_PARTITION_MMAP_DATA, &image, &image_map));
+    uint8_t *copy = malloc(data.image_len);
+    TEST_ASSERT_NOT_NULL(copy);
+    memcpy(copy, image, data.image_len);
+    esp_partition_munmap(image_map);
+
+    esp_ota_handle_t handle;
+    TEST_ESP_OK(esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ESP_OK(write_image_in_chunks(handle, copy, data.image_len));
+    TEST_ESP_OK(esp_ota_end(handle));
+
+    /* Truncated image */
+    TEST_ESP_OK(esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ESP_OK(write_image_in_chunks(handle, copy, data.image_len - 16));
+    TEST_ESP_ERR(ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_end(handle));
+
+    /* Corrupted segment data is detected by the checksum, or by the hash at the end */
+    copy[data.segment_data[0] - running->address + 4] ^= 0x01;
+    TEST_ESP_OK(esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    esp_err_t err = write_image_in_chunks(handle, copy, data.image_len);
+    if (err == ESP_OK) {
+        err = esp_ota_end(handle);
+    } else {
+        TEST_ESP_OK(esp_ota_abort(handle));
+    }
+    TEST_ESP_ERR(ESP_ERR_OTA_VALIDATE_FAILED, err);
+
+    /* Invalid segment length is detected as soon as the segment header is written */
+    copy[data.segment_data[0] - running->address + 4] ^= 0x01;
+    copy[sizeof(esp_image_header_t) + offsetof(esp_image_segment_header_t, data_len)] |= 0x03;
+    TEST_ESP_OK(esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ESP_ERR(ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_write(handle, copy, sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)));
+    TEST_ESP_OK(esp_ota_abort(handle));
+
+    free(copy);
+}
+
+/* Checks the partition holds 'data' in [0, len), erased flash up to the end of its sector, and 'fill' in [erased_end, end) */
+static void check_ota_partition(const esp_partition_t *part, const uint8_t *data, size_t len, size_t erased_end, size_t end, uint8_t fill)
+{
+    uint8_t buf[256];
+    for (size_t offset = 0; offset < end; offset += sizeof(buf)) {
+        size_t chunk = MIN(sizeof(buf), end - offset);
+        TEST_ESP_OK(esp_partition_read(part, offset, buf, chunk));
+        for (size_t i = 0; i < chunk; i++) {
+            const size_t pos = offset + i;
+            const uint8_t expected = (pos < len) ? data[pos] : (pos < erased_end) ? 0xFF : fill;
+            if (buf[i] != expected) {
+                printf("offset 0x%x: expected 0x%02x, read 0x%02x\n", (unsigned) pos, expected, buf[i]);
+                TEST_FAIL();
+            }
+        }
+    }
+}
+
+TEST_CASE("esp_ota_write() erases the sectors it writes to only once", "[ota]")
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_NOT_NULL(running);
+    TEST_ASSERT_NOT_NULL(update);
+    if (esp_flash_encryption_enabled()) {
+        TEST_IGNORE_MESSAGE("Written data is cached in 16 byte blocks with flash encryption");
+    }
+
+    /* The first sectors of the running image are written, it ends in the middle of a sector */
+    const size_t len = 5 * SPI_FLASH_SEC_SIZE + 100;
+    const size_t end = 8 * SPI_FLASH_SEC_SIZE;
+    uint8_t *image = malloc(len);
+    TEST_ASSERT_NOT_NULL(image);
+    TEST_ESP_OK(esp_partition_read(running, 0, image, len));
+    uint8_t *zeros = calloc(1, SPI_FLASH_SEC_SIZE);
+    TEST_ASSERT_NOT_NULL(zeros);
+
+    /* Fill the partition with zeros, so that writing to sectors which aren't erased is detected */
+    TEST_ESP_OK(esp_partition_erase_range(update, 0, end));
+    for (size_t offset = 0; offset < end; offset += SPI_FLASH_SEC_SIZE) {
+        TEST_ESP_OK(esp_partition_write(update, offset, zeros, SPI_FLASH_SEC_SIZE));
+    }
+
+    /* Unaligned writes crossing sector boundaries erase each sector before the first write to it,
+       the final partial sector is erased to its end and nothing beyond it */
+    esp_ota_handle_t handle;
+    TEST_ESP_OK(esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ESP_OK(write_image_in_chunks(handle, image, len));
+    TEST_ESP_OK(esp_ota_abort(handle));
+    check_ota_partition(update, image, len, 6 * SPI_FLASH_SEC_SIZE, end, 0x00);
+
+    for (size_t offset = 0; offset < end; offset += SPI_FLASH_SEC_SIZE) {
+        TEST_ESP_OK(esp_partition_write(update, offset, zeros, SPI_FLASH_SEC_SIZE));
+    }
+
+    /* Erasing ahead rounds up to a sector, the following writes don't erase the written data again */
+    TEST_ESP_OK(esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ESP_OK(esp_ota_erase_ahead(handle, 2 * SPI_FLASH_SEC_SIZE + 1));
+    check_ota_partition(update, image, 0, 3 * SPI_FLASH_SEC_SIZE, end, 0x00);
+    TEST_ESP_OK(esp_ota_write(handle, image, 3 * SPI_FLASH_SEC_SIZE - 10));
+    TEST_ESP_OK(esp_ota_erase_ahead(handle, SPI_FLASH_SEC_SIZE));
+    TEST_ESP_OK(esp_ota_write(handle, image + 3 * SPI_FLASH_SEC_SIZE - 10, 20));
+    TEST_ESP_OK(esp_ota_erase_ahead(handle, 7 * SPI_FLASH_SEC_SIZE));
+    TEST_ESP_OK(write_image_in_chunks(handle, image + 3 * SPI_FLASH_SEC_SIZE + 10, len - 3 * SPI_FLASH_SEC_SIZE - 10));
+    check_ota_partition(update, image, len, 7 * SPI_FLASH_SEC_SIZE, end, 0x00);
+
+    /* Erasing beyond the end of the partition is limited to its size */
+    TEST_ESP_OK(esp_ota_erase_ahead(handle, update->size + SPI_FLASH_SEC_SIZE));
+    TEST_ESP_OK(esp_ota_abort(handle));
+    check_ota_partition(update, image, len, end, end, 0x00);
+    uint8_t last;
+    TEST_ESP_OK(esp_partition_read(update, update->size - 1, &last, 1));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, last);
+
+    /* Erasing ahead needs sequential writes */
+    TEST_ESP_OK(esp_ota_begin(update, len, &handle));
+    TEST_ESP_ERR(ESP_ERR_INVALID_STATE, esp_ota_erase_ahead(handle, SPI_FLASH_SEC_SIZE));
+    TEST_ESP_OK(esp_ota_abort(handle));
+    TEST_ESP_ERR(ESP_ERR_NOT_FOUND, esp_ota_erase_ahead(handle, SPI_FLASH_SEC_SIZE));
+
+    free(zeros);
+    free(image);
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -44,6 +44,26 @@ typedef enum {
 #endif
 } esp_image_load_mode_t;
 
+/**
+ * @brief State of an image which is verified while it is being received, see esp_image_verify_stream_begin()
+ *
+ * All members are private to esp_image_format.c, the structure is public only to let
+ * the caller keep it wherever it keeps the rest of its update state.
+ */
+typedef struct {
+    esp_image_metadata_t data;  /*!< Metadata parsed so far */
+    uint32_t part_size;         /*!< Size of the partition the image is written to */
+    void *sha_handle;           /*!< SHA-256 of the image, if it is calculated */
+    uint32_t checksum_word;     /*!< XOR of the segment data words received so far */
+    uint32_t offset;            /*!< Number of image bytes received */
+    uint32_t stage_remain;      /*!< Bytes left until the end of the current stage */
+    uint8_t stage;              /*!< What the next received bytes are: header, segment, padding, hash */
+    uint8_t segment;            /*!< Index of the current segment */
+    bool silent;                /*!< Don't print errors */
+    uint8_t read_checksum;      /*!< Checksum byte at the end of the padding */
+    esp_err_t err;              /*!< First error found, returned by every subsequent call */
+} esp_image_verify_stream_t;
+
 typedef struct {
     esp_partition_pos_t partition;  /*!< Partition of application which worked before goes to the deep sleep. */
     uint16_t reboot_counter;        /*!< Reboot counter. Reset only when power is off. */
@@ -105,6 +125,67 @@ ESP_STATIC_ASSERT(sizeof(rtc_retain_mem_t) <= ESP_BOOTLOADER_RESERVE_RTC, "Reser
  */
 esp_err_t esp_image_verify(esp_image_load_mode_t mode, const esp_partition_pos_t *part, esp_image_metadata_t *data);
 
+/**
+ * @brief Start verifying an app image while it is being written to a partition.
+ *
+ * The image is passed to esp_image_verify_stream_feed() in order, in chunks of any size, and
+ * the checks esp_image_verify() does are applied to it as it goes. The header, segment headers,
+ * checksum and SHA-256 are taken from the passed data, so the image doesn't need to be read
+ * back from flash. Only the signature block (if signature verification is enabled) is read
+ * from flash, by esp_image_verify_stream_end().
+ *
+ * The data passed must be the plaintext image, the same data which is written to the partition.
+ *
+ * @param[out] stream Verification state, owned by the caller until esp_image_verify_stream_end() or
+ *                    esp_image_verify_stream_abort() is called.
+ * @param part Partition the image is written to.
+ * @param silent Don't print errors.
+ *
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if an argument is invalid, or the partition is larger than 16MB.
+ */
+esp_err_t esp_image_verify_stream_begin(esp_image_verify_stream_t *stream, const esp_partition_pos_t *part, bool silent);
+
+/**
+ * @brief Pass the next chunk of the image to the verifier.
+ *
+ * Any data following the end of the image (padding to the flash sector, signature block) is ignored.
+ *
+ * @param stream Verification state, initialized by esp_image_verify_stream_begin().
+ * @param data Next chunk of the image.
+ * @param size Size of the chunk.
+ *
+ * @return
+ * - ESP_OK if the image is valid so far
+ * - ESP_ERR_IMAGE_INVALID if the image is already known to be invalid. The same error is
+ *   returned by all subsequent calls, including esp_image_verify_stream_end().
+ * - ESP_ERR_NO_MEM if the SHA-256 can't be started.
+ */
+esp_err_t esp_image_verify_stream_feed(esp_image_verify_stream_t *stream, const void *data, size_t size);
+
+/**
+ * @brief Finish verifying the image, after all of it has been written to flash.
+ *
+ * Releases the resources held by the stream, regardless of the result.
+ *
+ * @param stream Verification state, initialized by esp_image_verify_stream_begin().
+ * @param[out] data Image metadata, same as filled by esp_image_verify(). Can be NULL.
+ *
+ * @return
+ * - ESP_OK if the image is complete and valid
+ * - ESP_ERR_IMAGE_FLASH_FAIL if a SPI flash error occurs
+ * - ESP_ERR_IMAGE_INVALID if the image is invalid or truncated.
+ */
+esp_err_t esp_image_verify_stream_end(esp_image_verify_stream_t *stream, esp_image_metadata_t *data);
+
+/**
+ * @brief Release the resources held by the stream without finishing the verification.
+ *
+ * @param stream Verification state, initialized by esp_image_verify_stream_begin().
+ */
+void esp_image_verify_stream_abort(esp_image_verify_stream_t *stream);
+
 /**
  * @brief Get metadata of app
  *
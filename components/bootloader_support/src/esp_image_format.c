@@ -313,6 +313,244 @@ err:
     return err;
 }
 
+/* Parts of the image, in the order esp_image_verify_stream_feed() receives them */
+enum {
+    STREAM_STAGE_HEADER,
+    STREAM_STAGE_SEGMENT_HEADER,
+    STREAM_STAGE_SEGMENT_DATA,
+    STREAM_STAGE_CHECKSUM,
+    STREAM_STAGE_HASH,
+    STREAM_STAGE_DONE,
+};
+
+esp_err_t esp_image_verify_stream_begin(esp_image_verify_stream_t *stream, const esp_partition_pos_t *part, bool silent)
+{
+    if (stream == NULL || part == NULL || part->size > SIXTEEN_MB) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bzero(stream, sizeof(esp_image_verify_stream_t));
+    stream->data.start_addr = part->offset;
+    stream->part_size = part->size;
+    stream->checksum_word = ESP_ROM_CHECKSUM_INITIAL;
+    stream->stage = STREAM_STAGE_HEADER;
+    stream->stage_remain = sizeof(esp_image_header_t);
+    stream->silent = silent;
+    return ESP_OK;
+}
+
+/* XOR segment data into the checksum word, same as process_segment_data() does.
+   Segment data starts word aligned in the image, so the byte lane is given by the image offset. */
+static void stream_checksum(uint32_t *checksum, uint32_t image_offs, const uint8_t *src, size_t len)
+{
+    size_t i = 0;
+    for (; i < len && ((image_offs + i) & 3) != 0; i++) {
+        *checksum ^= (uint32_t)src[i] << (8 * ((image_offs + i) & 3));
+    }
+    for (; i + 4 <= len; i += 4) {
+        uint32_t w;
+        memcpy(&w, src + i, sizeof(w));
+        *checksum ^= w;
+    }
+    for (; i < len; i++) {
+        *checksum ^= (uint32_t)src[i] << (8 * ((image_offs + i) & 3));
+    }
+}
+
+/* Check the part of the image which has just been received completely, and set up the next one */
+static esp_err_t stream_next_stage(esp_image_verify_stream_t *stream)
+{
+    esp_err_t err = ESP_OK;
+    esp_image_metadata_t *data = &stream->data;
+    bool silent = stream->silent;
+
+    switch (stream->stage) {
+    case STREAM_STAGE_HEADER: {
+        CHECK_ERR(verify_image_header(data->start_addr, &data->image, silent));
+        data->image_len = sizeof(esp_image_header_t);
+        // Same rules as image_load() and process_image_header()
+#if CONFIG_SECURE_BOOT_V2_ENABLED
+        bool verify_sha = true;
+#else
+        bool verify_sha = (data->start_addr != ESP_BOOTLOADER_OFFSET);
+#endif
+        if (verify_sha && (SECURE_BOOT_CHECK_SIGNATURE || data->image.hash_appended)) {
+            stream->sha_handle = bootloader_sha256_start();
+            if (stream->sha_handle == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+            bootloader_sha256_data(stream->sha_handle, &data->image, sizeof(esp_image_header_t));
+        }
+        break;
+    }
+    case STREAM_STAGE_SEGMENT_HEADER: {
+        int index = stream->segment;
+        const esp_image_segment_header_t *header = &data->segments[index];
+        uint32_t data_addr = data->start_addr + stream->offset;
+        CHECK_ERR(verify_segment_header(index, header, data_addr, silent));
+        if (!silent) {
+            ESP_LOGI(TAG, "segment %d: paddr=%08"PRIx32" vaddr=%08"PRIx32" size=%05"PRIx32"h (%6"PRIu32") %s",
+                     index, data_addr, header->load_addr,
+                     header->data_len, header->data_len,
+                     should_map(header->load_addr) ? "map" : "");
+        }
+        data->segment_data[index] = data_addr;
+        if (header->data_len > 0) {
+            stream->stage = STREAM_STAGE_SEGMENT_DATA;
+            stream->stage_remain = header->data_len;
+            return ESP_OK;
+        }
+        stream->segment++;
+        break;
+    }
+    case STREAM_STAGE_SEGMENT_DATA:
+        stream->segment++;
+        break;
+    case STREAM_STAGE_CHECKSUM: {
+        uint32_t checksum_word = stream->checksum_word;
+        uint8_t calc_checksum = (checksum_word >> 24) ^ (checksum_word >> 16) ^ (checksum_word >> 8) ^ (checksum_word >> 0);
+        if (!esp_cpu_dbgr_is_attached() && calc_checksum != stream->read_checksum) {
+            FAIL_LOAD("Checksum failed. Calculated 0x%x read 0x%x", calc_checksum, stream->read_checksum);
+        }
+        data->image_len = stream->offset;
+        if (data->image.hash_appended) {
+            stream->stage = STREAM_STAGE_HASH;
+            stream->stage_remain = HASH_LEN;
+        } else {
+            stream->stage = STREAM_STAGE_DONE;
+        }
+        return ESP_OK;
+    }
+    default:
+        stream->stage = STREAM_STAGE_DONE;
+        return ESP_OK;
+    }
+
+    if (stream->segment < data->image.segment_count) {
+        stream->stage = STREAM_STAGE_SEGMENT_HEADER;
+        stream->stage_remain = sizeof(esp_image_segment_header_t);
+    } else {
+        // Checksum is the last byte of the padding to the next full 16 byte block
+        data->image_len = stream->offset;
+        stream->stage = STREAM_STAGE_CHECKSUM;
+        stream->stage_remain = ALIGN_UP(stream->offset + 1, 16) - stream->offset;
+    }
+    return ESP_OK;
+err:
+    if (err == ESP_OK) {
+        err = ESP_ERR_IMAGE_INVALID;
+    }
+    return err;
+}
+
+esp_err_t esp_image_verify_stream_feed(esp_image_verify_stream_t *stream, const void *data, size_t size)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    esp_image_metadata_t *meta = &stream->data;
+    esp_err_t err = stream->err;
+
+    if (err != ESP_OK) {
+        return err;
+    }
+    while (size > 0 && stream->stage != STREAM_STAGE_DONE) {
+        uint32_t len = MIN(size, stream->stage_remain);
+        switch (stream->stage) {
+        case STREAM_STAGE_HEADER:
+            memcpy((uint8_t *)&meta->image + sizeof(esp_image_header_t) - stream->stage_remain, src, len);
+            break;
+        case STREAM_STAGE_SEGMENT_HEADER:
+            memcpy((uint8_t *)&meta->segments[stream->segment] + sizeof(esp_image_segment_header_t) - stream->stage_remain, src, len);
+            break;
+        case STREAM_STAGE_SEGMENT_DATA:
+            stream_checksum(&stream->checksum_word, stream->offset, src, len);
+            break;
+        case STREAM_STAGE_CHECKSUM:
+            stream->read_checksum = src[len - 1];
+            break;
+        case STREAM_STAGE_HASH:
+            memcpy(meta->image_digest + HASH_LEN - stream->stage_remain, src, len);
+            break;
+        }
+        // The header is hashed once it is known whether the image has a hash appended
+        if (stream->sha_handle != NULL && stream->stage != STREAM_STAGE_HEADER && stream->stage != STREAM_STAGE_HASH) {
+            bootloader_sha256_data(stream->sha_handle, src, len);
+        }
+        stream->offset += len;
+        stream->stage_remain -= len;
+        src += len;
+        size -= len;
+        if (stream->stage_remain == 0) {
+            CHECK_ERR(stream_next_stage(stream));
+        }
+    }
+    return ESP_OK;
+err:
+    esp_image_verify_stream_abort(stream);
+    stream->err = err;
+    return err;
+}
+
+esp_err_t esp_image_verify_stream_end(esp_image_verify_stream_t *stream, esp_image_metadata_t *data)
+{
+    esp_err_t err = stream->err;
+    bool silent = stream->silent;
+    bootloader_sha256_handle_t sha_handle = stream->sha_handle;
+    stream->sha_handle = NULL;
+
+    if (err != ESP_OK) {
+        goto err;
+    }
+    if (stream->stage != STREAM_STAGE_DONE) {
+        FAIL_LOAD("image at 0x%"PRIx32" is truncated (%"PRIu32" bytes)", stream->data.start_addr, stream->offset);
+    }
+    // Appended hash was received already, only the partition size is checked here
+    CHECK_ERR(process_appended_hash_and_sig(&stream->data, stream->data.start_addr, stream->part_size, false, silent));
+    if (sha_handle != NULL) {
+#if (SECURE_BOOT_CHECK_SIGNATURE == 1)
+        uint8_t image_digest[HASH_LEN] = { [ 0 ... 31] = 0xEE };
+        uint8_t verified_digest[HASH_LEN] = { [ 0 ... 31 ] = 0x01 };
+        // Signature block follows the image, it is read back from flash
+        err = verify_secure_boot_signature(sha_handle, &stream->data, image_digest, verified_digest);
+        sha_handle = NULL;
+#else
+        if (!esp_cpu_dbgr_is_attached()) {
+            err = verify_simple_hash(sha_handle, &stream->data);
+            sha_handle = NULL;
+        }
+#endif
+        if (err != ESP_OK) {
+            goto err;
+        }
+    }
+    if (sha_handle != NULL) {
+        bootloader_sha256_finish(sha_handle, NULL);
+    }
+    if (data != NULL) {
+        memcpy(data, &stream->data, sizeof(esp_image_metadata_t));
+    }
+    return ESP_OK;
+
+err:
+    if (err == ESP_OK) {
+        err = ESP_ERR_IMAGE_INVALID;
+    }
+    if (sha_handle != NULL) {
+        bootloader_sha256_finish(sha_handle, NULL);
+    }
+    stream->err = err;
+    if (data != NULL) {
+        bzero(data, sizeof(esp_image_metadata_t));
+    }
+    return err;
+}
+
+void esp_image_verify_stream_abort(esp_image_verify_stream_t *stream)
+{
+    if (stream->sha_handle != NULL) {
+        bootloader_sha256_finish(stream->sha_handle, NULL);
+        stream->sha_handle = NULL;
+    }
+}
+
 static esp_err_t verify_image_header(uint32_t src_addr, const esp_image_header_t *image, bool silent)
 {
     esp_err_t err = ESP_OK;
@@ -0,0 +1,912 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Raw deflate (RFC 1951) compressor and decompressor, used by the permessage-deflate WebSocket
+ * extension (RFC 7692) and by delta OTA patches.
+ *
+ * Each message is compressed into a block using the fixed Huffman codes, followed by the empty
+ * stored block of a sync flush, whose last 4 bytes are removed from the end of the message as
+ * required by the RFC. Messages are short, so dynamic Huffman tables would mostly cost their own
+ * size; the compression comes from matches found in the message and in the previous messages
+ * (context takeover). Matches are found greedily using hash chains, within the window negotiated
+ * for the connection.
+ *
+ * The decompressor handles all block types and keeps its state between calls, so that it can
+ * stop whenever it runs out of input or output space. A message can then be decompressed as it
+ * arrives, into buffers of any size.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/param.h>
+#include "esp_deflate.h"
+
+#define MIN_MATCH       3
+#define MAX_MATCH       258
+/* Candidates checked for each match, limits time spent on repetitive data */
+#define MAX_CHAIN       32
+/* Shortest matches further than this take more bits than the literals they replace */
+#define TOO_FAR         4096
+#define END_OF_BLOCK    256
+/* The compressor's buffer holds a match lookahead besides the window, so it's never smaller than this */
+#define MIN_HIST_BITS   9
+
+/* Codes of up to this length are decoded with a single table lookup */
+#define FAST_BITS       9
+#define MAX_CODE_BITS   15
+#define NUM_LIT_CODES   288
+#define NUM_DIST_CODES  30
+#define NUM_CLEN_CODES  19
+
+static const uint16_t s_len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t s_dist_base[NUM_DIST_CODES] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t s_dist_extra[NUM_DIST_CODES] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+/* Order of the code length code lengths in the header of a dynamic block */
+static const uint8_t s_clen_order[NUM_CLEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+/* End of the sync flush, removed from the end of compressed messages */
+static const uint8_t s_flush_tail[4] = { 0x00, 0x00, 0xff, 0xff };
+
+static uint32_t reverse_bits(uint32_t code, unsigned len)
+{
+    uint32_t reversed = 0;
+    for (unsigned i = 0; i < len; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+static const char *skip_spaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+static size_t token_len(const char *p)
+{
+    size_t len = 0;
+    while (p[len] != '\0' && strchr(",;=\" \t", p[len]) == NULL) {
+        len++;
+    }
+    return len;
+}
+
+static bool token_equals(const char *token, size_t len, const char *name)
+{
+    return len == strlen(name) && strncasecmp(token, name, len) == 0;
+}
+
+static uint8_t parse_window_bits(const char *value, size_t len)
+{
+    if (len == 0 || len > 2 || value[0] == '0') {
+        return 0;
+    }
+    unsigned bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (value[i] < '0' || value[i] > '9') {
+            return 0;
+        }
+        bits = bits * 10 + value[i] - '0';
+    }
+    return (bits >= ESP_DEFLATE_MIN_WINDOW_BITS && bits <= ESP_DEFLATE_MAX_WINDOW_BITS) ? bits : 0;
+}
+
+esp_err_t esp_ws_deflate_parse_extension(const char **ext, esp_ws_deflate_params_t *params)
+{
+    if (!ext || !*ext || !params) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *p = *ext;
+    while (true) {
+        p = skip_spaces(p);
+        while (*p == ',') {
+            p = skip_spaces(p + 1);
+        }
+        if (*p == '\0') {
+            *ext = p;
+            return ESP_ERR_NOT_FOUND;
+        }
+        size_t len = token_len(p);
+        const bool found = token_equals(p, len, "permessage-deflate");
+        p = skip_spaces(p + len);
+        memset(params, 0, sizeof(*params));
+        bool server_bits = false, client_bits = false;
+        esp_err_t err = ESP_OK;
+
+        while (*p == ';') {
+            p = skip_spaces(p + 1);
+            const char *name = p;
+            const size_t name_len = token_len(p);
+            const char *value = NULL;
+            size_t value_len = 0;
+            p = skip_spaces(p + name_len);
+            if (*p == '=') {
+                p = skip_spaces(p + 1);
+                const bool quoted = *p == '"';
+                value = p + quoted;
+                value_len = token_len(value);
+                p = value + value_len;
+                if (quoted) {
+                    if (*p != '"') {
+                        err = ESP_ERR_INVALID_ARG;
+                        break;
+                    }
+                    p++;
+                }
+                p = skip_spaces(p);
+            }
+            if (!found) {
+                continue;
+            }
+            if (token_equals(name, name_len, "server_no_context_takeover") && !value && !params->server_no_context_takeover) {
+                params->server_no_context_takeover = true;
+            } else if (token_equals(name, name_len, "client_no_context_takeover") && !value && !params->client_no_context_takeover) {
+                params->client_no_context_takeover = true;
+            } else if (token_equals(name, name_len, "server_max_window_bits") && value && !server_bits) {
+                params->server_max_window_bits = parse_window_bits(value, value_len);
+                server_bits = true;
+                if (params->server_max_window_bits == 0) {
+                    err = ESP_ERR_INVALID_ARG;
+                }
+            } else if (token_equals(name, name_len, "client_max_window_bits") && !client_bits) {
+                params->client_max_window_bits = value ? parse_window_bits(value, value_len) : ESP_DEFLATE_MAX_WINDOW_BITS;
+                client_bits = true;
+                if (params->client_max_window_bits == 0) {
+                    err = ESP_ERR_INVALID_ARG;
+                }
+            } else {
+                err = ESP_ERR_INVALID_ARG;
+            }
+        }
+        if (*p != ',' && *p != '\0') {
+            // malformed element, skip to the next one
+            err = ESP_ERR_INVALID_ARG;
+            while (*p != ',' && *p != '\0') {
+                p++;
+            }
+        }
+        if (found) {
+            *ext = p;
+            return err;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Compressor
+ * ------------------------------------------------------------------------------------------- */
+
+struct esp_deflate {
+    uint8_t *hist;          /* Window followed by the data being compressed, 2 * hist_size bytes */
+    uint16_t *head;         /* Latest position of each hash, 0 if none */
+    uint16_t *prev;         /* Previous position with the same hash as each position of the window */
+    uint32_t hist_size;
+    uint32_t max_dist;
+    uint32_t pos;           /* Next position to compress */
+    uint32_t end;           /* End of the data in hist */
+    uint8_t hash_bits;
+};
+
+typedef struct {
+    uint8_t *out;
+    size_t len;
+    uint32_t bits;
+    unsigned count;
+} bit_writer_t;
+
+static inline void put_bits(bit_writer_t *w, uint32_t value, unsigned count)
+{
+    w->bits |= value << w->count;
+    w->count += count;
+    while (w->count >= 8) {
+        w->out[w->len++] = w->bits;
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+/* Writes a literal/length symbol using the fixed Huffman code */
+static void put_symbol(bit_writer_t *w, unsigned sym)
+{
+    if (sym < 144) {
+        put_bits(w, reverse_bits(0x30 + sym, 8), 8);
+    } else if (sym < 256) {
+        put_bits(w, reverse_bits(0x190 + sym - 144, 9), 9);
+    } else if (sym < 280) {
+        put_bits(w, reverse_bits(sym - 256, 7), 7);
+    } else {
+        put_bits(w, reverse_bits(0xc0 + sym - 280, 8), 8);
+    }
+}
+
+static void put_match(bit_writer_t *w, unsigned len, unsigned dist)
+{
+    unsigned code = 28;
+    while (s_len_base[code] > len) {
+        code--;
+    }
+    put_symbol(w, 257 + code);
+    put_bits(w, len - s_len_base[code], s_len_extra[code]);
+    code = NUM_DIST_CODES - 1;
+    while (s_dist_base[code] > dist) {
+        code--;
+    }
+    put_bits(w, reverse_bits(code, 5), 5);
+    put_bits(w, dist - s_dist_base[code], s_dist_extra[code]);
+}
+
+static inline uint32_t hash3(const uint8_t *p, uint8_t bits)
+{
+    return (((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]) * 2654435761u >> (32 - bits);
+}
+
+esp_deflate_handle_t esp_deflate_create(uint8_t window_bits)
+{
+    if (window_bits < ESP_DEFLATE_MIN_WINDOW_BITS || window_bits > ESP_DEFLATE_MAX_WINDOW_BITS) {
+        return NULL;
+    }
+    esp_deflate_handle_t d = calloc(1, sizeof(struct esp_deflate));
+    if (!d) {
+        return NULL;
+    }
+    d->hist_size = 1 << MAX(window_bits, MIN_HIST_BITS);
+    d->max_dist = 1 << window_bits;
+    d->hash_bits = MIN(MAX(window_bits - 1, 8), 12);
+    d->hist = malloc(2 * d->hist_size);
+    d->prev = malloc(d->hist_size * sizeof(uint16_t));
+    d->head = calloc(1 << d->hash_bits, sizeof(uint16_t));
+    if (!d->hist || !d->prev || !d->head) {
+        esp_deflate_destroy(d);
+        return NULL;
+    }
+    return d;
+}
+
+size_t esp_deflate_bound(size_t len)
+{
+    // literals take up to 9 bits, plus the block header, end of block and the flush
+    return len + len / 8 + 16;
+}
+
+static void slide_window(esp_deflate_handle_t d)
+{
+    memcpy(d->hist, d->hist + d->hist_size, d->hist_size);
+    d->pos -= d->hist_size;
+    d->end -= d->hist_size;
+    for (uint32_t i = 0; i < (1u << d->hash_bits); i++) {
+        d->head[i] = d->head[i] >= d->hist_size ? d->head[i] - d->hist_size : 0;
+    }
+    for (uint32_t i = 0; i < d->hist_size; i++) {
+        d->prev[i] = d->prev[i] >= d->hist_size ? d->prev[i] - d->hist_size : 0;
+    }
+}
+
+/* Inserts the position, returns the previous position with the same hash */
+static inline uint32_t insert_position(esp_deflate_handle_t d, uint32_t pos)
+{
+    const uint32_t hash = hash3(d->hist + pos, d->hash_bits);
+    const uint32_t prev = d->head[hash];
+    d->prev[pos & (d->hist_size - 1)] = prev;
+    d->head[hash] = pos;
+    return prev;
+}
+
+static unsigned longest_match(esp_deflate_handle_t d, uint32_t candidate, unsigned limit, unsigned *dist)
+{
+    const uint8_t *cur = d->hist + d->pos;
+    unsigned best = MIN_MATCH - 1;
+    // position 0 terminates the chains, so it's never matched
+    for (unsigned chain = MAX_CHAIN; candidate != 0 && chain > 0; chain--) {
+        const uint32_t distance = d->pos - candidate;
+        if (distance > d->max_dist) {
+            break;
+        }
+        const uint8_t *match = d->hist + candidate;
+        if (match[best] == cur[best] && match[0] == cur[0] && match[1] == cur[1]) {
+            unsigned len = 2;
+            while (len < limit && match[len] == cur[len]) {
+                len++;
+            }
+            if (len > best) {
+                best = len;
+                *dist = distance;
+                if (len == limit) {
+                    break;
+                }
+            }
+        }
+        candidate = d->prev[candidate & (d->hist_size - 1)];
+    }
+    return best >= MIN_MATCH ? best : 0;
+}
+
+/* Compresses the data in hist, keeping the last MAX_MATCH - 1 bytes for the next call unless flushing */
+static void compress(esp_deflate_handle_t d, bit_writer_t *w, bool flush)
+{
+    while (d->pos < d->end && (flush || d->end - d->pos >= MAX_MATCH)) {
+        const unsigned avail = d->end - d->pos;
+        unsigned len = 0;
+        unsigned dist = 0;
+        if (avail >= MIN_MATCH) {
+            // search before inserting the position, which may reuse the slot of the oldest one
+            const uint32_t hash = hash3(d->hist + d->pos, d->hash_bits);
+            len = longest_match(d, d->head[hash], MIN(avail, MAX_MATCH), &dist);
+            if (len == MIN_MATCH && dist > TOO_FAR) {
+                len = 0;
+            }
+            insert_position(d, d->pos);
+        }
+        if (len) {
+            put_match(w, len, dist);
+            for (uint32_t p = d->pos + 1; p < d->pos + len && p + MIN_MATCH <= d->end; p++) {
+                insert_position(d, p);
+            }
+            d->pos += len;
+        } else {
+            put_symbol(w, d->hist[d->pos]);
+            d->pos++;
+        }
+    }
+}
+
+esp_err_t esp_deflate_message(esp_deflate_handle_t d, const uint8_t *in, size_t in_len,
+                              uint8_t *out, size_t out_size, size_t *out_len, bool final)
+{
+    if (!d || (!in && in_len) || !out || !out_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (out_size < esp_deflate_bound(in_len)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    bit_writer_t w = { .out = out };
+    if (in_len > 0) {
+        put_bits(&w, 1 << 1, 3);    // not the last block, fixed Huffman codes
+        while (in_len > 0 || d->pos < d->end) {
+            if (in_len > 0 && d->end - d->pos < MAX_MATCH) {
+                if (d->end == 2 * d->hist_size) {
+                    slide_window(d);
+                }
+                const size_t len = MIN(in_len, 2 * d->hist_size - d->end);
+                memcpy(d->hist + d->end, in, len);
+                d->end += len;
+                in += len;
+                in_len -= len;
+            }
+            compress(d, &w, in_len == 0);
+        }
+        put_symbol(&w, END_OF_BLOCK);
+    }
+    // empty stored block, the messages end on a byte boundary
+    put_bits(&w, 0, 3);
+    if (w.count) {
+        put_bits(&w, 0, 8 - w.count);
+    }
+    if (!final) {
+        memcpy(w.out + w.len, s_flush_tail, sizeof(s_flush_tail));
+        w.len += sizeof(s_flush_tail);
+    }
+    *out_len = w.len;
+    return ESP_OK;
+}
+
+void esp_deflate_reset(esp_deflate_handle_t d)
+{
+    if (d) {
+        d->pos = 0;
+        d->end = 0;
+        memset(d->head, 0, (1 << d->hash_bits) * sizeof(uint16_t));
+    }
+}
+
+void esp_deflate_destroy(esp_deflate_handle_t d)
+{
+    if (d) {
+        free(d->hist);
+        free(d->prev);
+        free(d->head);
+        free(d);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Decompressor
+ * ------------------------------------------------------------------------------------------- */
+
+typedef struct {
+    uint16_t fast[1 << FAST_BITS];      /* (symbol << 4) | code length, 0 for longer codes */
+    uint16_t count[MAX_CODE_BITS + 1];  /* Number of codes of each length */
+    uint16_t symbol[NUM_LIT_CODES];     /* Symbols in the order of their codes */
+} huffman_t;
+
+typedef enum {
+    INFLATE_HEADER,         /* Header of the next block */
+    INFLATE_STORED_LEN,     /* Length of a stored block */
+    INFLATE_STORED,         /* Data of a stored block */
+    INFLATE_TABLE_SIZES,    /* Sizes of the code tables of a dynamic block */
+    INFLATE_CLEN,           /* Code length code of a dynamic block */
+    INFLATE_LENS,           /* Code lengths of a dynamic block */
+    INFLATE_CODES,          /* Compressed data */
+    INFLATE_DONE,           /* Last block has ended, waiting for the end of the message */
+    INFLATE_ERROR,
+} inflate_state_t;
+
+struct esp_inflate {
+    inflate_state_t state;
+    bool last_block;
+    uint8_t tail_pos;       /* Bytes of s_flush_tail consumed at the end of the message */
+    unsigned count;         /* Bits in the bit buffer */
+    uint64_t bits;
+    uint32_t copy_len;      /* Bytes left to output from the match or the stored block */
+    uint32_t copy_dist;
+    uint16_t nlen;          /* Table sizes of a dynamic block */
+    uint16_t ndist;
+    uint16_t nclen;
+    uint16_t index;
+    uint8_t lens[NUM_LIT_CODES + NUM_DIST_CODES + 2];
+    huffman_t lencode;
+    huffman_t distcode;     /* Also used for the code length code */
+    uint8_t *window;
+    uint32_t window_mask;
+    uint32_t window_pos;
+    uint32_t have;          /* Bytes in the window, limits the distances */
+};
+
+static bool huffman_build(huffman_t *h, const uint8_t *lens, unsigned num)
+{
+    uint16_t offs[MAX_CODE_BITS + 1];
+    uint32_t next[MAX_CODE_BITS + 1];
+
+    memset(h->count, 0, sizeof(h->count));
+    for (unsigned i = 0; i < num; i++) {
+        h->count[lens[i]]++;
+    }
+    int left = 1;
+    for (unsigned len = 1; len <= MAX_CODE_BITS; len++) {
+        left = (left << 1) - h->count[len];
+        if (left < 0) {
+            return false;   // over-subscribed
+        }
+    }
+    offs[1] = 0;
+    next[1] = 0;
+    for (unsigned len = 1; len < MAX_CODE_BITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+        next[len + 1] = (next[len] + h->count[len]) << 1;
+    }
+    memset(h->fast, 0, sizeof(h->fast));
+    for (unsigned sym = 0; sym < num; sym++) {
+        const unsigned len = lens[sym];
+        if (len == 0) {
+            continue;
+        }
+        h->symbol[offs[len]++] = sym;
+        const uint32_t code = next[len]++;
+        if (len <= FAST_BITS) {
+            for (uint32_t i = reverse_bits(code, len); i < (1 << FAST_BITS); i += 1 << len) {
+                h->fast[i] = (sym << 4) | len;
+            }
+        }
+    }
+    return true;
+}
+
+/* Decodes a symbol from bits, returns -1 if more bits are needed or -2 if the code is invalid */
+static int huffman_decode(const huffman_t *h, uint64_t bits, unsigned count, unsigned *code_len)
+{
+    const unsigned entry = h->fast[bits & ((1 << FAST_BITS) - 1)];
+    if (entry) {
+        *code_len = entry & 0xf;
+        return *code_len <= count ? (int)(entry >> 4) : -1;
+    }
+    int code = 0, first = 0, index = 0;
+    for (unsigned len = 1; len <= MAX_CODE_BITS; len++) {
+        if (len > count) {
+            return -1;
+        }
+        code |= bits & 1;
+        bits >>= 1;
+        const int num = h->count[len];
+        if (code - num < first) {
+            *code_len = len;
+            return h->symbol[index + (code - first)];
+        }
+        index += num;
+        first = (first + num) << 1;
+        code <<= 1;
+    }
+    return -2;
+}
+
+esp_inflate_handle_t esp_inflate_create(uint8_t window_bits)
+{
+    if (window_bits < ESP_DEFLATE_MIN_WINDOW_BITS || window_bits > ESP_DEFLATE_MAX_WINDOW_BITS) {
+        return NULL;
+    }
+    esp_inflate_handle_t h = calloc(1, sizeof(struct esp_inflate));
+    if (!h) {
+        return NULL;
+    }
+    h->window = malloc(1 << window_bits);
+    if (!h->window) {
+        free(h);
+        return NULL;
+    }
+    h->window_mask = (1 << window_bits) - 1;
+    return h;
+}
+
+static void refill(esp_inflate_handle_t h, const uint8_t **in, size_t *in_len, bool end_of_message)
+{
+    while (h->count <= 56) {
+        uint8_t byte;
+        if (*in_len) {
+            byte = *(*in)++;
+            (*in_len)--;
+        } else if (end_of_message && h->tail_pos < sizeof(s_flush_tail)) {
+            byte = s_flush_tail[h->tail_pos++];
+        } else {
+            return;
+        }
+        h->bits |= (uint64_t)byte << h->count;
+        h->count += 8;
+    }
+}
+
+static inline void drop_bits(esp_inflate_handle_t h, unsigned count)
+{
+    h->bits >>= count;
+    h->count -= count;
+}
+
+static inline void put_byte(esp_inflate_handle_t h, uint8_t **out, size_t *out_size, uint8_t byte)
+{
+    h->window[h->window_pos++ & h->window_mask] = byte;
+    if (h->have <= h->window_mask) {
+        h->have++;
+    }
+    *(*out)++ = byte;
+    (*out_size)--;
+}
+
+static void build_fixed_codes(esp_inflate_handle_t h)
+{
+    unsigned i = 0;
+    for (; i < 144; i++) {
+        h->lens[i] = 8;
+    }
+    for (; i < 256; i++) {
+        h->lens[i] = 9;
+    }
+    for (; i < 280; i++) {
+        h->lens[i] = 7;
+    }
+    for (; i < NUM_LIT_CODES; i++) {
+        h->lens[i] = 8;
+    }
+    huffman_build(&h->lencode, h->lens, NUM_LIT_CODES);
+    memset(h->lens, 5, NUM_DIST_CODES);
+    huffman_build(&h->distcode, h->lens, NUM_DIST_CODES);
+}
+
+/* Decodes the compressed data of a block, returns false if the data is invalid. The end of the
+ * block is decoded even if the output is full, so that a message filling the output completes.
+ * Sets starved if it has stopped because the next symbol needs more bits. */
+static bool inflate_codes(esp_inflate_handle_t h, uint8_t **out, size_t *out_size, bool input_done, bool *starved)
+{
+    *starved = false;
+    while (true) {
+        if (h->copy_len) {
+            if (*out_size == 0) {
+                return true;
+            }
+            put_byte(h, out, out_size, h->window[(h->window_pos - h->copy_dist) & h->window_mask]);
+            h->copy_len--;
+            continue;
+        }
+        // a symbol with its extra bits and the distance takes at most 48 bits, they are consumed
+        // together; at the end of the message, missing bits are read as zeros and checked below
+        unsigned len_bits, dist_bits;
+        const unsigned count = input_done ? 64 : h->count;
+        const int sym = huffman_decode(&h->lencode, h->bits, count, &len_bits);
+        if (sym == -1) {
+            *starved = true;
+            return true;
+        } else if (sym < 0) {
+            return false;
+        }
+        if (sym < END_OF_BLOCK) {
+            if (len_bits > h->count) {
+                return false;
+            }
+            if (*out_size == 0) {
+                return true;
+            }
+            drop_bits(h, len_bits);
+            put_byte(h, out, out_size, sym);
+            continue;
+        }
+        if (sym == END_OF_BLOCK) {
+            if (len_bits > h->count) {
+                return false;
+            }
+            drop_bits(h, len_bits);
+            h->state = h->last_block ? INFLATE_DONE : INFLATE_HEADER;
+            return true;
+        }
+        const unsigned len_code = sym - 257;
+        if (len_code >= 29) {
+            return false;
+        }
+        unsigned used = len_bits + s_len_extra[len_code];
+        const unsigned len = s_len_base[len_code] + ((h->bits >> len_bits) & ((1 << s_len_extra[len_code]) - 1));
+        const int dist_code = huffman_decode(&h->distcode, h->bits >> used, count - MIN(count, used), &dist_bits);
+        if (dist_code == -1) {
+            *starved = true;
+            return true;
+        } else if (dist_code < 0 || dist_code >= NUM_DIST_CODES) {
+            return false;
+        }
+        used += dist_bits;
+        const unsigned dist = s_dist_base[dist_code] + ((h->bits >> used) & ((1 << s_dist_extra[dist_code]) - 1));
+        used += s_dist_extra[dist_code];
+        if (used > h->count) {
+            *starved = true;
+            return !input_done;
+        }
+        if (dist > h->have) {
+            return false;
+        }
+        drop_bits(h, used);
+        h->copy_len = len;
+        h->copy_dist = dist;
+    }
+}
+
+esp_err_t esp_inflate(esp_inflate_handle_t h, const uint8_t **in, size_t *in_len,
+                      uint8_t **out, size_t *out_size, bool end_of_message)
+{
+    if (!h || !in || !in_len || (!*in && *in_len) || !out || !out_size || (!*out && *out_size)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (true) {
+        refill(h, in, in_len, end_of_message);
+        const bool input_done = end_of_message && *in_len == 0 && h->tail_pos == sizeof(s_flush_tail);
+        // bits needed to continue, when they aren't available
+        unsigned need = 0;
+
+        switch (h->state) {
+        case INFLATE_HEADER:
+            if (input_done && h->count == 0) {
+                // the message ended with the sync flush
+                h->state = INFLATE_DONE;
+                break;
+            }
+            if (h->count < 3) {
+                need = 3;
+                break;
+            }
+            h->last_block = h->bits & 1;
+            switch ((h->bits >> 1) & 3) {
+            case 0:
+                drop_bits(h, 3 + ((h->count - 3) & 7));
+                h->state = INFLATE_STORED_LEN;
+                break;
+            case 1:
+                drop_bits(h, 3);
+                build_fixed_codes(h);
+                h->state = INFLATE_CODES;
+                break;
+            case 2:
+                drop_bits(h, 3);
+                h->state = INFLATE_TABLE_SIZES;
+                break;
+            default:
+                goto corrupted;
+            }
+            break;
+
+        case INFLATE_STORED_LEN:
+            if (h->count < 32) {
+                need = 32;
+                break;
+            }
+            if ((h->bits & 0xffff) != (~(h->bits >> 16) & 0xffff)) {
+                goto corrupted;
+            }
+            h->copy_len = h->bits & 0xffff;
+            drop_bits(h, 32);
+            h->state = INFLATE_STORED;
+            break;
+
+        case INFLATE_STORED:
+            while (h->copy_len && *out_size) {
+                if (h->count >= 8) {
+                    put_byte(h, out, out_size, h->bits & 0xff);
+                    drop_bits(h, 8);
+                } else if (*in_len) {
+                    // the bit buffer is empty, copy straight from the input
+                    const uint8_t byte = *(*in)++;
+                    (*in_len)--;
+                    put_byte(h, out, out_size, byte);
+                } else {
+                    break;
+                }
+                h->copy_len--;
+            }
+            if (h->copy_len == 0) {
+                h->state = h->last_block ? INFLATE_DONE : INFLATE_HEADER;
+            } else if (*out_size == 0) {
+                return ESP_ERR_NOT_FINISHED;
+            } else {
+                need = 8;
+            }
+            break;
+
+        case INFLATE_TABLE_SIZES:
+            if (h->count < 14) {
+                need = 14;
+                break;
+            }
+            h->nlen = 257 + (h->bits & 0x1f);
+            h->ndist = 1 + ((h->bits >> 5) & 0x1f);
+            h->nclen = 4 + ((h->bits >> 10) & 0xf);
+            drop_bits(h, 14);
+            if (h->nlen > 286 || h->ndist > NUM_DIST_CODES) {
+                goto corrupted;
+            }
+            memset(h->lens, 0, NUM_CLEN_CODES);
+            h->index = 0;
+            h->state = INFLATE_CLEN;
+            break;
+
+        case INFLATE_CLEN:
+            while (h->index < h->nclen && h->count >= 3) {
+                h->lens[s_clen_order[h->index++]] = h->bits & 7;
+                drop_bits(h, 3);
+            }
+            if (h->index < h->nclen) {
+                need = 3;
+                break;
+            }
+            if (!huffman_build(&h->distcode, h->lens, NUM_CLEN_CODES)) {
+                goto corrupted;
+            }
+            h->index = 0;
+            h->state = INFLATE_LENS;
+            break;
+
+        case INFLATE_LENS:
+            while (h->index < h->nlen + h->ndist) {
+                unsigned len_bits;
+                const int sym = huffman_decode(&h->distcode, h->bits, h->count, &len_bits);
+                if (sym == -2) {
+                    goto corrupted;
+                } else if (sym < 0) {
+                    need = MAX_CODE_BITS;
+                    break;
+                }
+                if (sym < 16) {
+                    h->lens[h->index++] = sym;
+                    drop_bits(h, len_bits);
+                    continue;
+                }
+                static const uint8_t extra_bits[3] = { 2, 3, 7 };
+                static const uint8_t repeat_base[3] = { 3, 3, 11 };
+                const unsigned extra = extra_bits[sym - 16];
+                if (h->count < len_bits + extra) {
+                    need = len_bits + extra;
+                    break;
+                }
+                const unsigned repeat = repeat_base[sym - 16] + ((h->bits >> len_bits) & ((1 << extra) - 1));
+                if ((sym == 16 && h->index == 0) || h->index + repeat > h->nlen + h->ndist) {
+                    goto corrupted;
+                }
+                const uint8_t value = sym == 16 ? h->lens[h->index - 1] : 0;
+                memset(h->lens + h->index, value, repeat);
+                h->index += repeat;
+                drop_bits(h, len_bits + extra);
+            }
+            if (need) {
+                break;
+            }
+            if (h->lens[END_OF_BLOCK] == 0 ||
+                    !huffman_build(&h->lencode, h->lens, h->nlen) ||
+                    !huffman_build(&h->distcode, h->lens + h->nlen, h->ndist)) {
+                goto corrupted;
+            }
+            h->state = INFLATE_CODES;
+            break;
+
+        case INFLATE_CODES: {
+            bool starved;
+            if (!inflate_codes(h, out, out_size, input_done, &starved)) {
+                goto corrupted;
+            }
+            if (h->state == INFLATE_CODES) {
+                if (starved) {
+                    // the next symbol needs more input, even if the output is full, as it may be
+                    // the end of the block
+                    need = 64;
+                } else {
+                    return ESP_ERR_NOT_FINISHED;
+                }
+            }
+            break;
+        }
+
+        case INFLATE_DONE:
+            // data following the last block is ignored
+            *in += *in_len;
+            *in_len = 0;
+            h->bits = 0;
+            h->count = 0;
+            if (end_of_message) {
+                h->state = INFLATE_HEADER;
+                h->tail_pos = 0;
+                return ESP_OK;
+            }
+            return ESP_ERR_NOT_FINISHED;
+
+        default:
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+
+        if (need) {
+            if (*in_len || (end_of_message && h->tail_pos < sizeof(s_flush_tail))) {
+                // the bits were used up by a loop of the current state
+                continue;
+            }
+            if (input_done) {
+                goto corrupted;
+            }
+            return ESP_ERR_NOT_FINISHED;
+        }
+    }
+
+corrupted:
+    h->state = INFLATE_ERROR;
+    return ESP_ERR_INVALID_RESPONSE;
+}
+
+void esp_inflate_reset(esp_inflate_handle_t h)
+{
+    if (h) {
+        h->state = INFLATE_HEADER;
+        h->tail_pos = 0;
+        h->bits = 0;
+        h->count = 0;
+        h->copy_len = 0;
+        h->have = 0;
+    }
+}
+
+void esp_inflate_destroy(esp_inflate_handle_t h)
+{
+    if (h) {
+        free(h->window);
+        free(h);
+    }
+}
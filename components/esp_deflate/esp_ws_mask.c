@@ -0,0 +1,40 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "esp_ws_mask.h"
+
+/* Word used by the masking loop, may alias the byte buffers it's read from and written to */
+typedef uintptr_t __attribute__((__may_alias__)) ws_mask_word_t;
+
+void esp_ws_mask(uint8_t *dst, const uint8_t *src, size_t len, const uint8_t mask_key[4], size_t offset)
+{
+    size_t i = 0;
+    /* Bytes up to the first word boundary of dst */
+    for (; i < len && ((uintptr_t)(dst + i) % sizeof(ws_mask_word_t)) != 0; i++) {
+        dst[i] = src[i] ^ mask_key[(offset + i) % 4];
+    }
+
+    if (((uintptr_t)(src + i) % sizeof(ws_mask_word_t)) == 0 && len - i >= sizeof(ws_mask_word_t)) {
+        /* The key repeats every 4 bytes and the word size is a multiple of 4, so the same
+         * word of key applies to every word of data, in memory order regardless of endianness */
+        uint8_t key_bytes[sizeof(ws_mask_word_t)];
+        for (size_t j = 0; j < sizeof(key_bytes); j++) {
+            key_bytes[j] = mask_key[(offset + i + j) % 4];
+        }
+        ws_mask_word_t key;
+        memcpy(&key, key_bytes, sizeof(key));
+
+        for (; len - i >= sizeof(ws_mask_word_t); i += sizeof(ws_mask_word_t)) {
+            *(ws_mask_word_t *)(dst + i) = *(const ws_mask_word_t *)(src + i) ^ key;
+        }
+    }
+
+    /* Tail, or all of the data if src and dst are aligned differently */
+    for (; i < len; i++) {
+        dst[i] = src[i] ^ mask_key[(offset + i) % 4];
+    }
+}
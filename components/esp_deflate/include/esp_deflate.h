@@ -0,0 +1,173 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _ESP_DEFLATE_H
+#define _ESP_DEFLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Range of the LZ77 window sizes (base-2 logarithm), as allowed by the permessage-deflate extension, RFC 7692 */
+#define ESP_DEFLATE_MIN_WINDOW_BITS  8
+#define ESP_DEFLATE_MAX_WINDOW_BITS  15
+
+/**
+ * @brief Parameters of a permessage-deflate extension offer or response
+ */
+typedef struct {
+    bool server_no_context_takeover;    /*!< server_no_context_takeover parameter is present */
+    bool client_no_context_takeover;    /*!< client_no_context_takeover parameter is present */
+    uint8_t server_max_window_bits;     /*!< Value of server_max_window_bits, 0 if not present */
+    uint8_t client_max_window_bits;     /*!< Value of client_max_window_bits, 15 if present without a value, 0 if not present */
+} esp_ws_deflate_params_t;
+
+typedef struct esp_deflate *esp_deflate_handle_t;
+typedef struct esp_inflate *esp_inflate_handle_t;
+
+/**
+ * @brief Find the next permessage-deflate element of a Sec-WebSocket-Extensions header value
+ *
+ * Elements of other extensions are skipped. On return, ext points past the parsed element,
+ * so the function can be called again to get the next offer.
+ *
+ * @param[inout] ext     Header value, advanced past the parsed element
+ * @param[out]   params  Parameters of the element
+ *
+ * @return
+ *      - ESP_OK                if a permessage-deflate element was found
+ *      - ESP_ERR_NOT_FOUND     if there are no more permessage-deflate elements
+ *      - ESP_ERR_INVALID_ARG   if the element has an unknown, duplicated or invalid parameter
+ */
+esp_err_t esp_ws_deflate_parse_extension(const char **ext, esp_ws_deflate_params_t *params);
+
+/**
+ * @brief Create a message compressor
+ *
+ * Compresses messages with matches up to 2^window_bits bytes back, including the previous
+ * messages until esp_deflate_reset() is called. Uses about 2^(window_bits + 2) bytes of heap
+ * (at least 2 KiB).
+ *
+ * @param[in]   window_bits  Base-2 logarithm of the window size, 8 to 15
+ *
+ * @return
+ *      - Compressor handle
+ *      - NULL if window_bits is out of range or the memory cannot be allocated
+ */
+esp_deflate_handle_t esp_deflate_create(uint8_t window_bits);
+
+/**
+ * @brief Maximum length of the compressed data of a message or a fragment
+ *
+ * @param[in]   len  Length of the uncompressed data
+ *
+ * @return
+ *      - Size of the output buffer to pass to esp_deflate_message()
+ */
+size_t esp_deflate_bound(size_t len);
+
+/**
+ * @brief Compress a message, or a fragment of a message
+ *
+ * Outputs the payload of a compressed message as described in RFC 7692, section 7.2.1.
+ * Fragments of a message are compressed by separate calls, with final set for the last one
+ * only, and the outputs sent as the payloads of the frames of the message.
+ *
+ * @param[in]   handle    Compressor handle
+ * @param[in]   in        Data to compress
+ * @param[in]   in_len    Length of the data
+ * @param[out]  out       Output buffer
+ * @param[in]   out_size  Size of the output buffer, at least esp_deflate_bound(in_len)
+ * @param[out]  out_len   Length of the compressed data
+ * @param[in]   final     This is the end of the message
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_INVALID_ARG   if an argument is NULL
+ *      - ESP_ERR_INVALID_SIZE  if the output buffer is too small
+ */
+esp_err_t esp_deflate_message(esp_deflate_handle_t handle, const uint8_t *in, size_t in_len,
+                              uint8_t *out, size_t out_size, size_t *out_len, bool final);
+
+/**
+ * @brief Forget the previous messages, for the no_context_takeover parameters
+ *
+ * @param[in]   handle  Compressor handle
+ */
+void esp_deflate_reset(esp_deflate_handle_t handle);
+
+/**
+ * @brief Free a compressor
+ *
+ * @param[in]   handle  Compressor handle, may be NULL
+ */
+void esp_deflate_destroy(esp_deflate_handle_t handle);
+
+/**
+ * @brief Create a message decompressor
+ *
+ * Uses 2^window_bits bytes for the window, and about 3.5 KiB for the decoding state.
+ *
+ * @param[in]   window_bits  Base-2 logarithm of the window size of the peer's compressor, 8 to 15
+ *
+ * @return
+ *      - Decompressor handle
+ *      - NULL if window_bits is out of range or the memory cannot be allocated
+ */
+esp_inflate_handle_t esp_inflate_create(uint8_t window_bits);
+
+/**
+ * @brief Decompress a part of a compressed message
+ *
+ * The payload of a message can be passed in pieces of any size, and decompressed into
+ * output buffers of any size. The input and output pointers and lengths are advanced past
+ * the consumed input and the produced output. The call returns when the input is consumed,
+ * when the output buffer is full, or when the message ends. Input which doesn't produce any
+ * output, like the end of the message, is consumed even if the output buffer is full, so that
+ * a message which exactly fills the output buffer completes with ESP_OK. If the call returns
+ * ESP_ERR_NOT_FINISHED with input left over, more output space is needed.
+ *
+ * A raw deflate stream which isn't split into messages is decompressed with end_of_message
+ * false. Once its last block has been decompressed, the following input is discarded.
+ *
+ * @param[in]    handle          Decompressor handle
+ * @param[inout] in              Compressed data
+ * @param[inout] in_len          Length of the compressed data
+ * @param[inout] out             Output buffer
+ * @param[inout] out_size        Space in the output buffer
+ * @param[in]    end_of_message  The input ends with the last byte of the message payload
+ *
+ * @return
+ *      - ESP_OK                    if the message has been decompressed completely
+ *      - ESP_ERR_NOT_FINISHED      if more input or output space is needed
+ *      - ESP_ERR_INVALID_ARG       if an argument is NULL
+ *      - ESP_ERR_INVALID_RESPONSE  if the data is corrupted, the decompressor has to be reset
+ */
+esp_err_t esp_inflate(esp_inflate_handle_t handle, const uint8_t **in, size_t *in_len,
+                      uint8_t **out, size_t *out_size, bool end_of_message);
+
+/**
+ * @brief Forget the previous messages, for the no_context_takeover parameters or after an error
+ *
+ * @param[in]   handle  Decompressor handle
+ */
+void esp_inflate_reset(esp_inflate_handle_t handle);
+
+/**
+ * @brief Free a decompressor
+ *
+ * @param[in]   handle  Decompressor handle, may be NULL
+ */
+void esp_inflate_destroy(esp_inflate_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ESP_DEFLATE_H */
@@ -0,0 +1,35 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _ESP_WS_MASK_H
+#define _ESP_WS_MASK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Apply a WebSocket masking key to data
+ *
+ * Masks or unmasks (the operation is the same) a part of a WebSocket payload
+ * as described in RFC 6455, section 5.3. The data is processed a machine word
+ * at a time where the alignment of src and dst allows it.
+ *
+ * @param[out]  dst       Destination buffer, may be the same as src
+ * @param[in]   src       Data to be masked
+ * @param[in]   len       Length of the data
+ * @param[in]   mask_key  4 byte masking key of the frame
+ * @param[in]   offset    Position of src[0] within the payload of the frame,
+ *                        used when the payload is processed in parts
+ */
+void esp_ws_mask(uint8_t *dst, const uint8_t *src, size_t len, const uint8_t mask_key[4], size_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ESP_WS_MASK_H */
@@ -0,0 +1,172 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include "esp_deflate.h"
+#include "unity.h"
+#include "esp_err.h"
+
+/* Decompresses a message, passing one byte of input and output space at a time */
+static size_t inflate_bytewise(esp_inflate_handle_t inflate, const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size)
+{
+    size_t pos = 0;
+    size_t out_len = 0;
+    esp_err_t ret;
+    do {
+        const uint8_t *in_pos = in + pos;
+        size_t in_left = pos < in_len ? 1 : 0;
+        uint8_t *out_pos = out + out_len;
+        size_t out_left = out_len < out_size ? 1 : 0;
+        ret = esp_inflate(inflate, &in_pos, &in_left, &out_pos, &out_left, pos + in_left == in_len);
+        pos = in_pos - in;
+        out_len = out_pos - out;
+    } while (ret == ESP_ERR_NOT_FINISHED);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_EQUAL(in_len, pos);
+    return out_len;
+}
+
+TEST_CASE("deflate compresses and decompresses messages", "[deflate]")
+{
+    // RFC 7692 Section 7.2.3, the second message refers to the first one
+    const uint8_t hello[] = { 0xf2, 0x48, 0xcd, 0xc9, 0xc9, 0x07, 0x00 };
+    const uint8_t hello_again[] = { 0xf2, 0x00, 0x11, 0x00, 0x00 };
+    const uint8_t hello_stored[] = { 0x00, 0x05, 0x00, 0xfa, 0xff, 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x00 };
+    uint8_t compressed[64];
+    uint8_t decompressed[16];
+    size_t len;
+
+    esp_deflate_handle_t deflate = esp_deflate_create(15);
+    esp_inflate_handle_t inflate = esp_inflate_create(15);
+    TEST_ASSERT_NOT_NULL(deflate);
+    TEST_ASSERT_NOT_NULL(inflate);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_deflate_message(deflate, (const uint8_t *)"Hello", 5, compressed, sizeof(compressed), &len, true));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(hello, compressed, sizeof(hello));
+    TEST_ASSERT_EQUAL(sizeof(hello), len);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_deflate_message(deflate, (const uint8_t *)"Hello", 5, compressed, sizeof(compressed), &len, true));
+    TEST_ASSERT_EQUAL(sizeof(hello_again), len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(hello_again, compressed, sizeof(hello_again));
+
+    TEST_ASSERT_EQUAL(5, inflate_bytewise(inflate, hello, sizeof(hello), decompressed, sizeof(decompressed)));
+    TEST_ASSERT_EQUAL(5, inflate_bytewise(inflate, hello_again, sizeof(hello_again), decompressed, sizeof(decompressed)));
+    TEST_ASSERT_EQUAL(5, inflate_bytewise(inflate, hello_stored, sizeof(hello_stored), decompressed, sizeof(decompressed)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY("Hello", decompressed, 5);
+
+    // invalid block type
+    const uint8_t corrupted[] = { 0x07, 0x00 };
+    const uint8_t *in = corrupted;
+    size_t in_len = sizeof(corrupted);
+    uint8_t *out = decompressed;
+    size_t out_size = sizeof(decompressed);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, esp_inflate(inflate, &in, &in_len, &out, &out_size, true));
+    esp_deflate_destroy(deflate);
+    esp_inflate_destroy(inflate);
+
+    // fragmented message longer than the window, with no context takeover
+    const size_t msg_len = 4000;
+    uint8_t *msg = malloc(msg_len);
+    uint8_t *msg_compressed = malloc(esp_deflate_bound(msg_len));
+    uint8_t *msg_decompressed = malloc(msg_len);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_NOT_NULL(msg_compressed);
+    TEST_ASSERT_NOT_NULL(msg_decompressed);
+    for (size_t i = 0; i < msg_len; i++) {
+        msg[i] = "websocket"[(i / 3) % 9] + (i % 1000 == 0);
+    }
+    deflate = esp_deflate_create(9);
+    inflate = esp_inflate_create(9);
+    TEST_ASSERT_NOT_NULL(deflate);
+    TEST_ASSERT_NOT_NULL(inflate);
+    for (int message = 0; message < 2; message++) {
+        size_t pos = 0;
+        out = msg_decompressed;
+        out_size = msg_len;
+        for (size_t fragment_len = 1000; pos < msg_len; pos += fragment_len) {
+            bool final = pos + fragment_len == msg_len;
+            TEST_ASSERT_EQUAL(ESP_OK, esp_deflate_message(deflate, msg + pos, fragment_len, msg_compressed,
+                                                          esp_deflate_bound(msg_len), &len, final));
+            TEST_ASSERT_LESS_THAN(fragment_len / 4, len);
+            in = msg_compressed;
+            in_len = len;
+            TEST_ASSERT_EQUAL(final ? ESP_OK : ESP_ERR_NOT_FINISHED, esp_inflate(inflate, &in, &in_len, &out, &out_size, final));
+            TEST_ASSERT_EQUAL(0, in_len);
+        }
+        TEST_ASSERT_EQUAL(0, out_size);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(msg, msg_decompressed, msg_len);
+        esp_deflate_reset(deflate);
+    }
+    esp_deflate_destroy(deflate);
+    esp_inflate_destroy(inflate);
+    free(msg);
+    free(msg_compressed);
+    free(msg_decompressed);
+}
+
+TEST_CASE("deflate decompresses into buffers of the exact message length", "[deflate]")
+{
+    const size_t max_len = 600;
+    uint8_t *msg = malloc(max_len);
+    uint8_t *msg_compressed = malloc(esp_deflate_bound(max_len));
+    uint8_t *msg_decompressed = malloc(max_len);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_NOT_NULL(msg_compressed);
+    TEST_ASSERT_NOT_NULL(msg_decompressed);
+    esp_deflate_handle_t deflate = esp_deflate_create(15);
+    esp_inflate_handle_t inflate = esp_inflate_create(15);
+    TEST_ASSERT_NOT_NULL(deflate);
+    TEST_ASSERT_NOT_NULL(inflate);
+    srand(3);
+    for (size_t msg_len = 1; msg_len <= max_len; msg_len++) {
+        // text which compresses well, and random bytes which end up in stored blocks
+        for (size_t i = 0; i < msg_len; i++) {
+            msg[i] = msg_len % 2 ? "{\"temp\":23.5}"[(i + rand() % 2) % 13] : rand();
+        }
+        size_t len;
+        TEST_ASSERT_EQUAL(ESP_OK, esp_deflate_message(deflate, msg, msg_len, msg_compressed,
+                                                      esp_deflate_bound(max_len), &len, true));
+        // the end of the message is consumed even though the output is full
+        const uint8_t *in = msg_compressed;
+        size_t in_len = len;
+        uint8_t *out = msg_decompressed;
+        size_t out_size = msg_len;
+        TEST_ASSERT_EQUAL(ESP_OK, esp_inflate(inflate, &in, &in_len, &out, &out_size, true));
+        TEST_ASSERT_EQUAL(0, in_len);
+        TEST_ASSERT_EQUAL(0, out_size);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(msg, msg_decompressed, msg_len);
+
+        // one byte short, the message is not finished
+        esp_deflate_reset(deflate);
+        esp_inflate_reset(inflate);
+        TEST_ASSERT_EQUAL(ESP_OK, esp_deflate_message(deflate, msg, msg_len, msg_compressed,
+                                                      esp_deflate_bound(max_len), &len, true));
+        in = msg_compressed;
+        in_len = len;
+        out = msg_decompressed;
+        out_size = msg_len - 1;
+        TEST_ASSERT_EQUAL(ESP_ERR_NOT_FINISHED, esp_inflate(inflate, &in, &in_len, &out, &out_size, true));
+        TEST_ASSERT_EQUAL(0, out_size);
+        esp_deflate_reset(deflate);
+        esp_inflate_reset(inflate);
+    }
+    esp_deflate_destroy(deflate);
+    esp_inflate_destroy(inflate);
+    free(msg);
+    free(msg_compressed);
+    free(msg_decompressed);
+}
+
+TEST_CASE("ws deflate parses extension offers", "[deflate]")
+{
+    esp_ws_deflate_params_t params;
+    const char *ext = "x-webkit-deflate-frame, permessage-deflate; client_max_window_bits; server_max_window_bits=10, "
+                      "permessage-deflate; server_no_context_takeover; server_max_window_bits=16";
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ws_deflate_parse_extension(&ext, &params));
+    TEST_ASSERT_EQUAL(15, params.client_max_window_bits);
+    TEST_ASSERT_EQUAL(10, params.server_max_window_bits);
+    TEST_ASSERT_FALSE(params.server_no_context_takeover);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_ws_deflate_parse_extension(&ext, &params));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_ws_deflate_parse_extension(&ext, &params));
+}
@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "esp_ws_mask.h"
+#include "unity.h"
+
+TEST_CASE("ws mask masks data of any alignment and position in the payload", "[ws_mask]")
+{
+    const uint8_t mask_key[4] = { 0x12, 0x34, 0x56, 0x78 };
+    uint8_t src[64 + 8];
+    uint8_t dst[64 + 8];
+    uint8_t expected[64 + 8];
+    for (size_t i = 0; i < sizeof(src); i++) {
+        src[i] = i * 7 + 3;
+    }
+
+    // all combinations of alignments, lengths and positions in the payload, in place and to another buffer
+    for (size_t src_align = 0; src_align < 8; src_align++) {
+        for (size_t dst_align = 0; dst_align < 8; dst_align++) {
+            for (size_t len = 0; len <= 64; len++) {
+                for (size_t offset = 0; offset < 4; offset++) {
+                    memset(expected, 0xAA, sizeof(expected));
+                    for (size_t i = 0; i < len; i++) {
+                        expected[dst_align + i] = src[src_align + i] ^ mask_key[(offset + i) % 4];
+                    }
+                    memset(dst, 0xAA, sizeof(dst));
+                    esp_ws_mask(dst + dst_align, src + src_align, len, mask_key, offset);
+                    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, dst, sizeof(dst));
+
+                    memset(dst, 0xAA, sizeof(dst));
+                    memcpy(dst + dst_align, src + src_align, len);
+                    esp_ws_mask(dst + dst_align, dst + dst_align, len, mask_key, offset);
+                    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, dst, sizeof(dst));
+                }
+            }
+        }
+    }
+}
@@ -22,8 +22,8 @@
 /* ---------------------------- Definitions --------------------------------- */
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-// LOOP @<address, name> rx:<recieved events no.> dr:<dropped events no.>
-#define LOOP_DUMP_FORMAT              "LOOP @%p,%s rx:%u dr:%u\n"
+// LOOP @<address, name> rx:<recieved events no.> dr:<dropped events no.> inl:<events with data in queue no.> heap:<events with data on heap no.>
+#define LOOP_DUMP_FORMAT              "LOOP @%p,%s rx:%u dr:%u inl:%u heap:%u\n"
  // handler @<address> ev:<base, id> inv:<times invoked> time:<runtime>
 #define HANDLER_DUMP_FORMAT           "  HANDLER @%p ev:%s,%s inv:%u time:%lld us\n"
 
@@ -34,6 +34,11 @@
                                         } while(0);
 #endif
 
+// Initial number of buckets of the dispatch index of a loop is 2**DISPATCH_INITIAL_BITS.
+#define DISPATCH_INITIAL_BITS         3
+// The dispatch index doubles in size when it holds more nodes than buckets, up to 2**DISPATCH_MAX_BITS buckets.
+#define DISPATCH_MAX_BITS             12
+
 /* ------------------------- Static Variables ------------------------------- */
 
 static const char* TAG = "event";
@@ -89,7 +94,7 @@ static int esp_event_dump_prepare(void)
 
     // Reserve slightly more memory than computed
     int allowance = 3;
-    int size = (((loops + allowance) * (sizeof(LOOP_DUMP_FORMAT) + 10 + 20 + 2 * 11)) +
+    int size = (((loops + allowance) * (sizeof(LOOP_DUMP_FORMAT) + 10 + 20 + 4 * 11)) +
                         ((handlers + allowance) * (sizeof(HANDLER_DUMP_FORMAT) + 10 + 2 * 20 + 11 + 20)));
 
     return size;
@@ -114,40 +119,41 @@ static void esp_event_loop_run_task(void* args)
     vTaskSuspend(NULL);
 }
 
-static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
+static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t *post)
 {
-    ESP_LOGD(TAG, "running post %s:%"PRIu32" with handler %p and context %p on loop %p", post.base, post.id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
+    ESP_LOGD(TAG, "running post %s:%"PRIu32" with handler %p and context %p on loop %p", post->base, post->id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     int64_t start, diff;
     start = esp_timer_get_time();
+    loop->running_handler = handler;
 #endif
     // Execute the handler
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
     void* data_ptr = NULL;
 
-    if (post.data_set) {
-        if (post.data_allocated) {
-            data_ptr = post.data.ptr;
+    if (post->data_set) {
+        if (post->data_allocated) {
+            data_ptr = post->data.ptr;
         } else {
-            data_ptr = &post.data.val;
+            data_ptr = post->data.buf;
         }
     }
 
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, data_ptr);
-#else
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, post.data);
-#endif
+    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post->base, post->id, data_ptr);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     diff = esp_timer_get_time() - start;
 
-    xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
+    // The handler may have unregistered itself, in which case it has been freed
+    if (loop->running_handler == handler) {
+        xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
 
-    handler->invoked++;
-    handler->time += diff;
+        handler->invoked++;
+        handler->time += diff;
 
-    xSemaphoreGive(loop->profiling_mutex);
+        xSemaphoreGive(loop->profiling_mutex);
+    }
+    loop->running_handler = NULL;
 #endif
 }
 
@@ -199,7 +205,149 @@ static esp_err_t handler_instances_add(esp_event_handler_nodes_t* handlers, esp_
     return ESP_OK;
 }
 
-static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
+static inline uint32_t dispatch_hash(esp_event_base_t base, int32_t id, uint32_t bits)
+{
+    // Fibonacci hashing of the base pointer mixed with the id. Base nodes are indexed with ESP_EVENT_ANY_ID.
+    uintptr_t ptr = (uintptr_t) base;
+    uint32_t key = (uint32_t) (ptr ^ (ptr >> 16)) ^ ((uint32_t) id * 0x85ebca6bu);
+    return (key * 2654435769u) >> (32 - bits);
+}
+
+static inline esp_event_base_node_t* dispatch_find_base_node(esp_event_base_node_t* it, esp_event_base_t base)
+{
+    while (it && it->base != base) {
+        it = SLIST_NEXT(it, dispatch_next);
+    }
+    return it;
+}
+
+static inline esp_event_id_node_t* dispatch_find_id_node(esp_event_id_node_t* it, esp_event_base_t base, int32_t id)
+{
+    while (it && (it->id != id || it->base_node->base != base)) {
+        it = SLIST_NEXT(it, dispatch_next);
+    }
+    return it;
+}
+
+static esp_event_base_node_t* dispatch_find_loop_base_node(esp_event_loop_instance_t* loop, esp_event_loop_node_t* loop_node, esp_event_base_t base)
+{
+    esp_event_base_node_t* it = SLIST_FIRST(&(loop->dispatch_buckets[dispatch_hash(base, ESP_EVENT_ANY_ID, loop->dispatch_bits)].base_nodes));
+    it = dispatch_find_base_node(it, base);
+    while (it && it->loop_node != loop_node) {
+        it = dispatch_find_base_node(SLIST_NEXT(it, dispatch_next), base);
+    }
+    return it;
+}
+
+static esp_event_id_node_t* dispatch_find_base_id_node(esp_event_loop_instance_t* loop, esp_event_base_node_t* base_node, int32_t id)
+{
+    esp_event_id_node_t* it = SLIST_FIRST(&(loop->dispatch_buckets[dispatch_hash(base_node->base, id, loop->dispatch_bits)].id_nodes));
+    while (it && (it->id != id || it->base_node != base_node)) {
+        it = SLIST_NEXT(it, dispatch_next);
+    }
+    return it;
+}
+
+// New nodes are always dispatched after the existing nodes with the same base and id, so appending them
+// to the bucket keeps the nodes with the same key in dispatch order.
+static void dispatch_bucket_append_base_node(esp_event_base_nodes_t* bucket, esp_event_base_node_t* base_node)
+{
+    esp_event_base_node_t *it = NULL, *last = NULL;
+
+    SLIST_FOREACH(it, bucket, dispatch_next) {
+        last = it;
+    }
+
+    if (!last) {
+        SLIST_INSERT_HEAD(bucket, base_node, dispatch_next);
+    } else {
+        SLIST_INSERT_AFTER(last, base_node, dispatch_next);
+    }
+}
+
+static void dispatch_bucket_append_id_node(esp_event_id_nodes_t* bucket, esp_event_id_node_t* id_node)
+{
+    esp_event_id_node_t *it = NULL, *last = NULL;
+
+    SLIST_FOREACH(it, bucket, dispatch_next) {
+        last = it;
+    }
+
+    if (!last) {
+        SLIST_INSERT_HEAD(bucket, id_node, dispatch_next);
+    } else {
+        SLIST_INSERT_AFTER(last, id_node, dispatch_next);
+    }
+}
+
+static void dispatch_index_grow(esp_event_loop_instance_t* loop)
+{
+    if (loop->dispatch_nodes <= (1 << loop->dispatch_bits) || loop->dispatch_bits >= DISPATCH_MAX_BITS) {
+        return;
+    }
+
+    uint32_t bits = loop->dispatch_bits + 1;
+    esp_event_dispatch_bucket_t* buckets = calloc(1 << bits, sizeof(*buckets));
+
+    if (!buckets) {
+        // Not an error, lookups are only slower with longer bucket chains
+        ESP_LOGD(TAG, "alloc for dispatch index of loop %p failed", loop);
+        return;
+    }
+
+    for (int i = 0; i < (1 << loop->dispatch_bits); i++) {
+        esp_event_dispatch_bucket_t* bucket = &(loop->dispatch_buckets[i]);
+        esp_event_base_node_t* base_node;
+        esp_event_id_node_t* id_node;
+
+        while ((base_node = SLIST_FIRST(&(bucket->base_nodes))) != NULL) {
+            SLIST_REMOVE_HEAD(&(bucket->base_nodes), dispatch_next);
+            dispatch_bucket_append_base_node(&(buckets[dispatch_hash(base_node->base, ESP_EVENT_ANY_ID, bits)].base_nodes), base_node);
+        }
+
+        while ((id_node = SLIST_FIRST(&(bucket->id_nodes))) != NULL) {
+            SLIST_REMOVE_HEAD(&(bucket->id_nodes), dispatch_next);
+            dispatch_bucket_append_id_node(&(buckets[dispatch_hash(id_node->base_node->base, id_node->id, bits)].id_nodes), id_node);
+        }
+    }
+
+    free(loop->dispatch_buckets);
+    loop->dispatch_buckets = buckets;
+    loop->dispatch_bits = bits;
+}
+
+static void dispatch_index_add_base_node(esp_event_loop_instance_t* loop, esp_event_base_node_t* base_node)
+{
+    uint32_t index = dispatch_hash(base_node->base, ESP_EVENT_ANY_ID, loop->dispatch_bits);
+    dispatch_bucket_append_base_node(&(loop->dispatch_buckets[index].base_nodes), base_node);
+    loop->dispatch_nodes++;
+    dispatch_index_grow(loop);
+}
+
+static void dispatch_index_add_id_node(esp_event_loop_instance_t* loop, esp_event_id_node_t* id_node)
+{
+    uint32_t index = dispatch_hash(id_node->base_node->base, id_node->id, loop->dispatch_bits);
+    dispatch_bucket_append_id_node(&(loop->dispatch_buckets[index].id_nodes), id_node);
+    loop->dispatch_nodes++;
+    dispatch_index_grow(loop);
+}
+
+static void dispatch_index_remove_base_node(esp_event_loop_instance_t* loop, esp_event_base_node_t* base_node)
+{
+    uint32_t index = dispatch_hash(base_node->base, ESP_EVENT_ANY_ID, loop->dispatch_bits);
+    SLIST_REMOVE(&(loop->dispatch_buckets[index].base_nodes), base_node, esp_event_base_node, dispatch_next);
+    loop->dispatch_nodes--;
+}
+
+static void dispatch_index_remove_id_node(esp_event_loop_instance_t* loop, esp_event_id_node_t* id_node)
+{
+    uint32_t index = dispatch_hash(id_node->base_node->base, id_node->id, loop->dispatch_bits);
+    SLIST_REMOVE(&(loop->dispatch_buckets[index].id_nodes), id_node, esp_event_id_node, dispatch_next);
+    loop->dispatch_nodes--;
+}
+
+static esp_err_t base_node_add_handler(esp_event_loop_instance_t* loop,
+        esp_event_base_node_t* base_node,
         int32_t id,
         esp_event_handler_t event_handler,
         void *event_handler_arg,
@@ -229,6 +377,7 @@ static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
             }
 
             id_node->id = id;
+            id_node->base_node = base_node;
 
             SLIST_INIT(&(id_node->handlers));
 
@@ -241,6 +390,7 @@ static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
                 else {
                     SLIST_INSERT_AFTER(last_id_node, id_node, next);
                 }
+                dispatch_index_add_id_node(loop, id_node);
             } else {
                 free(id_node);
             }
@@ -253,7 +403,8 @@ static esp_err_t base_node_add_handler(esp_event_base_node_t* base_node,
     }
 }
 
-static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
+static esp_err_t loop_node_add_handler(esp_event_loop_instance_t* loop,
+        esp_event_loop_node_t* loop_node,
         esp_event_base_t base,
         int32_t id,
         esp_event_handler_t event_handler,
@@ -287,11 +438,12 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
             }
 
             base_node->base = base;
+            base_node->loop_node = loop_node;
 
             SLIST_INIT(&(base_node->handlers));
             SLIST_INIT(&(base_node->id_nodes));
 
-            err = base_node_add_handler(base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
+            err = base_node_add_handler(loop, base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
 
             if (err == ESP_OK) {
                 if (!last_base_node) {
@@ -300,34 +452,43 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
                 else {
                     SLIST_INSERT_AFTER(last_base_node, base_node, next);
                 }
+                dispatch_index_add_base_node(loop, base_node);
             } else {
                 free(base_node);
             }
 
             return err;
         } else {
-            return base_node_add_handler(base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
+            return base_node_add_handler(loop, base_node, id, event_handler, event_handler_arg, handler_ctx, legacy);
         }
     }
 }
 
-static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static inline void handler_instance_delete(esp_event_loop_instance_t* loop, esp_event_handler_nodes_t* handlers, esp_event_handler_node_t* handler)
+{
+    SLIST_REMOVE(handlers, handler, esp_event_handler_node, next);
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    if (loop->running_handler == handler) {
+        loop->running_handler = NULL;
+    }
+#endif
+    free(handler->handler_ctx);
+    free(handler);
+}
+
+static esp_err_t handler_instances_remove(esp_event_loop_instance_t* loop, esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     esp_event_handler_node_t *it, *temp;
 
     SLIST_FOREACH_SAFE(it, handlers, next, temp) {
         if (legacy) {
             if (it->handler_ctx->handler == handler_ctx->handler) {
-                SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
-                free(it);
+                handler_instance_delete(loop, handlers, it);
                 return ESP_OK;
             }
         } else {
             if (it->handler_ctx == handler_ctx) {
-                SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
-                free(it);
+                handler_instance_delete(loop, handlers, it);
                 return ESP_OK;
             }
         }
@@ -337,20 +498,21 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
 }
 
 
-static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t base_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(base_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(base_node->handlers), handler_ctx, legacy);
     }
     else {
         esp_event_id_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
             if (it->id == id) {
-                esp_err_t res = handler_instances_remove(&(it->handlers), handler_ctx, legacy);
+                esp_err_t res = handler_instances_remove(loop, &(it->handlers), handler_ctx, legacy);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers))) {
                         SLIST_REMOVE(&(base_node->id_nodes), it, esp_event_id_node, next);
+                        dispatch_index_remove_id_node(loop, it);
                         free(it);
                         return ESP_OK;
                     }
@@ -362,20 +524,22 @@ static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int3
     return ESP_ERR_NOT_FOUND;
 }
 
-static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t loop_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(loop_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(loop_node->handlers), handler_ctx, legacy);
     }
     else {
         esp_event_base_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
             if (it->base == base) {
-                esp_err_t res = base_node_remove_handler(it, id, handler_ctx, legacy);
+                esp_err_t res = base_node_remove_handler(loop, it, id, handler_ctx, legacy);
 
                 if (res == ESP_OK) {
-                    if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes))) {
+                    // The base node being dispatched is freed by esp_event_loop_run() once its handlers have returned
+                    if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes)) && it != loop->dispatch_base_node) {
                         SLIST_REMOVE(&(loop_node->base_nodes), it, esp_event_base_node, next);
+                        dispatch_index_remove_base_node(loop, it);
                         free(it);
                         return ESP_OK;
                     }
@@ -423,15 +587,9 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
 
 static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
 {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
     if (post->data_allocated && post->data.ptr) {
         free(post->data.ptr);
     }
-#else
-    if (post->data) {
-        free(post->data);
-    }
-#endif
     memset(post, 0, sizeof(*post));
 }
 
@@ -480,6 +638,13 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
 
     SLIST_INIT(&(loop->loop_nodes));
 
+    loop->dispatch_buckets = calloc(1 << DISPATCH_INITIAL_BITS, sizeof(*(loop->dispatch_buckets)));
+    if (loop->dispatch_buckets == NULL) {
+        ESP_LOGE(TAG, "alloc for dispatch index failed");
+        goto on_err;
+    }
+    loop->dispatch_bits = DISPATCH_INITIAL_BITS;
+
     // Create the loop task if requested
     if (event_loop_args->task_name != NULL) {
         BaseType_t task_created = xTaskCreatePinnedToCore(esp_event_loop_run_task, event_loop_args->task_name,
@@ -529,17 +694,16 @@ on_err:
     }
 #endif
 
+    free(loop->dispatch_buckets);
     free(loop);
 
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
+// On event lookup performance: Handlers are kept in linked lists of loop nodes, base nodes and event (id) nodes,
+// in the order in which they are executed. Base nodes and event nodes are also indexed by base and id in a hash
+// table (the dispatch index) which is updated when they are created and freed. Dispatching an event only visits
+// the loop nodes (usually just one) and the base and event nodes matching the event, instead of all of them.
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
 {
     assert(event_loop);
@@ -566,36 +730,59 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
         esp_event_handler_node_t *handler, *temp_handler;
         esp_event_loop_node_t *loop_node, *temp_node;
         esp_event_base_node_t *base_node, *temp_base;
-        esp_event_id_node_t *id_node, *temp_id_node;
+        esp_event_id_node_t *id_node;
+
+        loop_node = SLIST_FIRST(&(loop->loop_nodes));
+        while (loop_node) {
+            loop->dispatch_loop_node = loop_node;
 
-        SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
             // Execute loop level handlers
             SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
-                handler_execute(loop, handler, post);
+                handler_execute(loop, handler, &post);
                 exec |= true;
             }
 
-            SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
-                        handler_execute(loop, handler, post);
+            // Matching base nodes are looked up once the loop level handlers have been executed, and the event node
+            // once the base level handlers have been executed, as handlers may unregister handlers and free nodes,
+            // or register handlers and grow the dispatch index. The loop node and base node being dispatched are
+            // pinned, so that the next ones can be found from them.
+            base_node = dispatch_find_loop_base_node(loop, loop_node, post.base);
+            while (base_node && base_node->loop_node == loop_node) {
+                loop->dispatch_base_node = base_node;
+
+                // Execute base level handlers
+                SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
+                    handler_execute(loop, handler, &post);
+                    exec |= true;
+                }
+
+                id_node = dispatch_find_base_id_node(loop, base_node, post.id);
+                if (id_node) {
+                    // Execute id level handlers
+                    SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
+                        handler_execute(loop, handler, &post);
                         exec |= true;
                     }
+                }
 
-                    SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
+                loop->dispatch_base_node = NULL;
+                temp_base = dispatch_find_base_node(SLIST_NEXT(base_node, dispatch_next), post.base);
+                if (SLIST_EMPTY(&(base_node->handlers)) && SLIST_EMPTY(&(base_node->id_nodes))) {
+                    // All handlers of the base node have been unregistered while it was pinned
+                    SLIST_REMOVE(&(loop_node->base_nodes), base_node, esp_event_base_node, next);
+                    dispatch_index_remove_base_node(loop, base_node);
+                    free(base_node);
                 }
+                base_node = temp_base;
+            }
+
+            loop->dispatch_loop_node = NULL;
+            temp_node = SLIST_NEXT(loop_node, next);
+            if (SLIST_EMPTY(&(loop_node->handlers)) && SLIST_EMPTY(&(loop_node->base_nodes))) {
+                SLIST_REMOVE(&(loop->loop_nodes), loop_node, esp_event_loop_node, next);
+                free(loop_node);
             }
+            loop_node = temp_node;
         }
 
         esp_event_base_t base = post.base;
@@ -669,6 +856,7 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
 
     // Cleanup loop
     vQueueDelete(loop->queue);
+    free(loop->dispatch_buckets);
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
@@ -724,7 +912,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         SLIST_INIT(&(loop_node->handlers));
         SLIST_INIT(&(loop_node->base_nodes));
 
-        err = loop_node_add_handler(loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(loop, loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
 
         if (err == ESP_OK) {
             if (!last_loop_node) {
@@ -738,7 +926,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         }
     }
     else {
-        err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(loop, last_loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
     }
 
 on_err:
@@ -781,9 +969,10 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
     esp_event_loop_node_t *it, *temp;
 
     SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
-        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, handler_ctx, legacy);
+        esp_err_t res = loop_node_remove_handler(loop, it, event_base, event_id, handler_ctx, legacy);
 
-        if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
+        // The loop node being dispatched is freed by esp_event_loop_run() once its handlers have returned
+        if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers)) && it != loop->dispatch_loop_node) {
             SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
             free(it);
             break;
@@ -828,21 +1017,22 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     memset((void*)(&post), 0, sizeof(post));
 
     if (event_data != NULL && event_data_size != 0) {
-        // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        if (event_data_size <= sizeof(post.data.buf)) {
+            // Small event data is copied into the queue item, no need to allocate memory
+            memcpy(post.data.buf, event_data, event_data_size);
+        } else {
+            // Make persistent copy of event data on heap.
+            void* event_data_copy = calloc(1, event_data_size);
 
-        if (event_data_copy == NULL) {
-            return ESP_ERR_NO_MEM;
-        }
+            if (event_data_copy == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
 
-        memcpy(event_data_copy, event_data, event_data_size);
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-        post.data.ptr = event_data_copy;
-        post.data_allocated = true;
+            memcpy(event_data_copy, event_data, event_data_size);
+            post.data.ptr = event_data_copy;
+            post.data_allocated = true;
+        }
         post.data_set = true;
-#else
-        post.data = event_data_copy;
-#endif
     }
     post.base = event_base;
     post.id = event_id;
@@ -884,6 +1074,11 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_fetch_add(&loop->events_recieved, 1);
+    if (post.data_allocated) {
+        atomic_fetch_add(&loop->data_allocated, 1);
+    } else if (post.data_set) {
+        atomic_fetch_add(&loop->data_inline, 1);
+    }
 #endif
 
     return ESP_OK;
@@ -932,6 +1127,9 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_fetch_add(&loop->events_recieved, 1);
+    if (post.data_set) {
+        atomic_fetch_add(&loop->data_inline, 1);
+    }
 #endif
 
     return ESP_OK;
@@ -960,13 +1158,15 @@ esp_err_t esp_event_dump(FILE* file)
     portENTER_CRITICAL(&s_event_loops_spinlock);
 
     SLIST_FOREACH(loop_it, &s_event_loops, next) {
-        uint32_t events_recieved, events_dropped;
+        uint32_t events_recieved, events_dropped, data_inline, data_allocated;
 
         events_recieved = atomic_load(&loop_it->events_recieved);
         events_dropped = atomic_load(&loop_it->events_dropped);
+        data_inline = atomic_load(&loop_it->data_inline);
+        data_allocated = atomic_load(&loop_it->data_allocated);
 
         PRINT_DUMP_INFO(dst, sz, LOOP_DUMP_FORMAT, loop_it, loop_it->task != NULL ? loop_it->name : "none" ,
-                        events_recieved, events_dropped);
+                        events_recieved, events_dropped, data_inline, data_allocated);
 
         int sz_bak = sz;
 
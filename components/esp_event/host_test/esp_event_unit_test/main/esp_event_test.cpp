@@ -10,6 +10,11 @@
 #define CATCH_CONFIG_MAIN
 
 #include <stdio.h>
+#include <inttypes.h>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <vector>
 #include "esp_event.h"
 
 #include "catch.hpp"
@@ -43,6 +48,38 @@ static esp_event_loop_args_t test_event_get_default_loop_args(void)
 
 void dummy_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data) { }
 
+void counting_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    (*static_cast<uint32_t*>(event_handler_arg))++;
+}
+
+/* Event queue replacing the mocked FreeRTOS queue, so that events can be posted and dispatched */
+std::deque<std::vector<uint8_t> > s_queue;
+UBaseType_t s_queue_item_size;
+
+QueueHandle_t queue_create_callback(const UBaseType_t length, const UBaseType_t item_size, const uint8_t type, int num_calls)
+{
+    s_queue_item_size = item_size;
+    return reinterpret_cast<QueueHandle_t>(0xdeadbeef);
+}
+
+BaseType_t queue_send_callback(QueueHandle_t queue, const void *item, TickType_t ticks, const BaseType_t position, int num_calls)
+{
+    const uint8_t *bytes = static_cast<const uint8_t*>(item);
+    s_queue.emplace_back(bytes, bytes + s_queue_item_size);
+    return pdTRUE;
+}
+
+BaseType_t queue_receive_callback(QueueHandle_t queue, void * const item, TickType_t ticks, int num_calls)
+{
+    if (s_queue.empty()) {
+        return pdFALSE;
+    }
+    memcpy(item, s_queue.front().data(), s_queue_item_size);
+    s_queue.pop_front();
+    return pdTRUE;
+}
+
 }
 
 // TODO: IDF-2693, function definition just to satisfy linker, implement esp_common instead
@@ -150,3 +187,66 @@ TEST_CASE("registering with ANY_BASE but specific ID fails") {
             dummy_handler,
             nullptr) == ESP_ERR_INVALID_ARG);
 }
+
+TEST_CASE("dispatch events to many registered handlers")
+{
+    const int NUM_BASES = 20;
+    const int NUM_IDS = 8;
+    const int NUM_EVENTS = 100000;
+    MockMutex sem(CreateAnd::IGNORE);
+    xQueueGenericCreate_Stub(queue_create_callback);
+    xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xTaskGetCurrentTaskHandle_IgnoreAndReturn(nullptr);
+    xQueueGenericSend_Stub(queue_send_callback);
+    xQueueReceive_Stub(queue_receive_callback);
+    esp_event_loop_handle_t loop = nullptr;
+
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+    // Bases are identified by their address, like the ones declared with ESP_EVENT_DECLARE_BASE
+    static const char bases[NUM_BASES][8] = { };
+    std::vector<uint32_t> id_calls(NUM_BASES * NUM_IDS, 0);
+    std::vector<uint32_t> base_calls(NUM_BASES, 0);
+    uint32_t loop_calls = 0;
+
+    for (int b = 0; b < NUM_BASES; b++) {
+        for (int id = 0; id < NUM_IDS; id++) {
+            CHECK(ESP_OK == esp_event_handler_instance_register_with(loop, bases[b], id, counting_handler,
+                    &id_calls[b * NUM_IDS + id], nullptr));
+        }
+        CHECK(ESP_OK == esp_event_handler_instance_register_with(loop, bases[b], ESP_EVENT_ANY_ID, counting_handler,
+                &base_calls[b], nullptr));
+    }
+    CHECK(ESP_OK == esp_event_handler_instance_register_with(loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, counting_handler,
+            &loop_calls, nullptr));
+
+    int failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        failed += esp_event_post_to(loop, bases[i % NUM_BASES], (i / NUM_BASES) % NUM_IDS, nullptr, 0, 0) != ESP_OK;
+        failed += esp_event_loop_run(loop, portMAX_DELAY) != ESP_OK;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    printf("%d handlers, %" PRId64 " ns per event\n", NUM_BASES * (NUM_IDS + 1) + 1, static_cast<int64_t>(elapsed.count() / NUM_EVENTS));
+
+    CHECK(failed == 0);
+    CHECK(loop_calls == NUM_EVENTS);
+    for (int b = 0; b < NUM_BASES; b++) {
+        CHECK(base_calls[b] == NUM_EVENTS / NUM_BASES);
+        for (int id = 0; id < NUM_IDS; id++) {
+            CHECK(id_calls[b * NUM_IDS + id] == NUM_EVENTS / NUM_BASES / NUM_IDS);
+        }
+    }
+
+    CHECK(ESP_OK == esp_event_loop_delete(loop));
+
+    xQueueReceive_Stub(nullptr);
+    xQueueGenericSend_Stub(nullptr);
+    xQueueGenericCreate_Stub(nullptr);
+    xTaskGetCurrentTaskHandle_StopIgnore();
+    xQueueGiveMutexRecursive_StopIgnore();
+    xQueueTakeMutexRecursive_StopIgnore();
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -340,7 +340,8 @@ esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base,
 /**
  * @brief Posts an event to the system default event loop. The event loop library keeps a copy of event_data and manages
  * the copy's lifetime automatically (allocation + deletion); this ensures that the data the
- * handler receives is always valid.
+ * handler receives is always valid. Data up to CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes is copied
+ * into the event queue, larger data is copied to memory allocated from the heap.
  *
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event ID that identifies the event
@@ -364,7 +365,8 @@ esp_err_t esp_event_post(esp_event_base_t event_base,
 /**
  * @brief Posts an event to the specified event loop. The event loop library keeps a copy of event_data and manages
  * the copy's lifetime automatically (allocation + deletion); this ensures that the data the
- * handler receives is always valid.
+ * handler receives is always valid. Data up to CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE bytes is copied
+ * into the event queue, larger data is copied to memory allocated from the heap.
  *
  * This function behaves in the same manner as esp_event_post_to, except the additional specification of the event loop
  * to post the event to.
@@ -468,12 +470,15 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
   where:
 
    event loop
-       format: address,name rx:total_received dr:total_dropped
+       format: address,name rx:total_received dr:total_dropped inl:total_data_inline heap:total_data_allocated
        where:
            address - memory address of the event loop
            name - name of the event loop, 'none' if no dedicated task
            total_received - number of successfully posted events
            total_dropped - number of events unsuccessfully posted due to queue being full
+           total_data_inline - number of successfully posted events whose data was stored in the event queue
+           total_data_allocated - number of successfully posted events whose data was larger than
+                                  CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE and was copied to the heap
 
    handler
        format: address ev:base,id inv:total_invoked run:total_runtime
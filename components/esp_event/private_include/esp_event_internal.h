@@ -43,12 +43,18 @@ typedef struct esp_event_handler_node {
 
 typedef SLIST_HEAD(esp_event_handler_instances, esp_event_handler_node) esp_event_handler_nodes_t;
 
+struct esp_event_base_node;
+struct esp_event_loop_node;
+
 /// Event
 typedef struct esp_event_id_node {
     int32_t id;                                                     /**< id number of the event */
     esp_event_handler_nodes_t handlers;                             /**< list of handlers to be executed when
                                                                             this event is raised */
+    struct esp_event_base_node* base_node;                          /**< base node this event node belongs to */
     SLIST_ENTRY(esp_event_id_node) next;                            /**< pointer to the next event node on the linked list */
+    SLIST_ENTRY(esp_event_id_node) dispatch_next;                   /**< pointer to the next event node in the same
+                                                                            dispatch index bucket */
 } esp_event_id_node_t;
 
 typedef SLIST_HEAD(esp_event_id_nodes, esp_event_id_node) esp_event_id_nodes_t;
@@ -58,7 +64,10 @@ typedef struct esp_event_base_node {
     esp_event_handler_nodes_t handlers;                             /**< event base level handlers, handlers for
                                                                             all events with this base */
     esp_event_id_nodes_t id_nodes;                                  /**< list of event ids with this base */
+    struct esp_event_loop_node* loop_node;                          /**< loop node this base node belongs to */
     SLIST_ENTRY(esp_event_base_node) next;                          /**< pointer to the next base node on the linked list */
+    SLIST_ENTRY(esp_event_base_node) dispatch_next;                 /**< pointer to the next base node in the same
+                                                                            dispatch index bucket */
 } esp_event_base_node_t;
 
 typedef SLIST_HEAD(esp_event_base_nodes, esp_event_base_node) esp_event_base_nodes_t;
@@ -73,6 +82,12 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+/// Bucket of the dispatch index. Nodes of the same base and id are kept in the order in which they are dispatched.
+typedef struct esp_event_dispatch_bucket {
+    esp_event_base_nodes_t base_nodes;                              /**< base nodes whose base hashes to this bucket */
+    esp_event_id_nodes_t id_nodes;                                  /**< event nodes whose base and id hash to this bucket */
+} esp_event_dispatch_bucket_t;
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
@@ -83,29 +98,38 @@ typedef struct esp_event_loop_instance {
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+    esp_event_dispatch_bucket_t* dispatch_buckets;                  /**< hash table indexing base and event nodes
+                                                                            by base and id */
+    uint32_t dispatch_bits;                                         /**< log2 of the number of buckets */
+    uint32_t dispatch_nodes;                                        /**< number of nodes in the hash table */
+    esp_event_loop_node_t* dispatch_loop_node;                      /**< loop node being dispatched, it isn't freed
+                                                                            until its handlers have returned */
+    esp_event_base_node_t* dispatch_base_node;                      /**< base node being dispatched, it isn't freed
+                                                                            until its handlers have returned */
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
+    atomic_uint_least32_t data_inline;                              /**< number of events posted with data stored in the queue */
+    atomic_uint_least32_t data_allocated;                           /**< number of events posted with data allocated from heap */
     SemaphoreHandle_t profiling_mutex;                              /**< mutex used for profiliing */
+    esp_event_handler_node_t* running_handler;                      /**< handler being executed, cleared if it
+                                                                            unregisters itself */
     SLIST_ENTRY(esp_event_loop_instance) next;                      /**< next event loop in the list */
 #endif
 } esp_event_loop_instance_t;
 
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
+/// Event data, stored in the event queue item if it is small enough
 typedef union esp_event_post_data {
-    uint32_t val;
-    void *ptr;
+    void *ptr;                                                       /**< data allocated from heap */
+    uint32_t val;                                                    /**< data posted from ISR */
+    uint8_t buf[CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE];             /**< data stored in the event queue item */
+    uint64_t align;                                                  /**< aligns data stored in the queue item for any type */
 } esp_event_post_data_t;
-#else
-typedef void* esp_event_post_data_t;
-#endif
 
 /// Event posted to the event queue
 typedef struct esp_event_post_instance {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
     bool data_allocated;                                             /**< indicates whether data is allocated from heap */
     bool data_set;                                                   /**< indicates if data is null */
-#endif
     esp_event_base_t base;                                           /**< the event base */
     int32_t id;                                                      /**< the event id */
     esp_event_post_data_t data;                                      /**< data associated with the event */
@@ -295,6 +295,18 @@ static void test_handler_instance_unregister_itself(void* event_handler_arg, esp
     TEST_ESP_OK(esp_event_handler_instance_unregister_with(*loop, event_base, event_id, *context));
 }
 
+static void test_handler_unregister_event_handlers(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    esp_event_loop_handle_t* loop = (esp_event_loop_handle_t*) event_data;
+    int* count = (int*) event_handler_arg;
+
+    (*count)++;
+
+    // Unregister the handler for this specific event, which would be executed after this one, and this handler
+    TEST_ESP_OK(esp_event_handler_unregister_with(*loop, event_base, event_id, test_handler_unregister_itself));
+    TEST_ESP_OK(esp_event_handler_unregister_with(*loop, event_base, ESP_EVENT_ANY_ID, test_handler_unregister_event_handlers));
+}
+
 static void test_post_from_handler_loop_task(void* args)
 {
     esp_event_loop_handle_t event_loop = (esp_event_loop_handle_t) args;
@@ -1029,6 +1041,49 @@ TEST_CASE("handler instance can unregister itself", "[event]")
     TEST_TEARDOWN();
 }
 
+TEST_CASE("base handler can unregister event handlers", "[event]")
+{
+    /* this test aims to verify that a handler for all events of a base can unregister the handler
+       for the specific event being dispatched, which is executed after it */
+
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_name = NULL;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    int unregistered = 0;
+    int count = 0;
+
+    // Handlers for all events of a base are executed before the handlers for specific events registered after them.
+    // The handlers of s_test_base1 are kept by the handler of TEST_EVENT_BASE1_EV2, the ones of s_test_base2 are all
+    // unregistered while they are being executed.
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, ESP_EVENT_ANY_ID, test_handler_unregister_event_handlers, &count));
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_unregister_itself, &unregistered));
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV2, test_handler_unregister_itself, &unregistered));
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base2, ESP_EVENT_ANY_ID, test_handler_unregister_event_handlers, &count));
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base2, TEST_EVENT_BASE2_EV1, test_handler_unregister_itself, &unregistered));
+
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &loop, sizeof(loop), portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base2, TEST_EVENT_BASE2_EV1, &loop, sizeof(loop), portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(0, unregistered);
+
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &loop, sizeof(loop), portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV2, &loop, sizeof(loop), portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base2, TEST_EVENT_BASE2_EV1, &loop, sizeof(loop), portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(TEST_EVENT_BASE1_EV2 + 1, unregistered); // base1, ev2
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
 TEST_CASE("can exit running loop at approximately the set amount of time", "[event]")
 {
     /* this test aims to verify that running loop does not block indefinitely in cases where
@@ -1957,6 +2012,42 @@ TEST_CASE("events are dispatched in the order they are registered", "[event]")
     TEST_TEARDOWN();
 }
 
+TEST_CASE("small event data is stored in the event queue", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_name = NULL;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    esp_event_post_instance_t post;
+    esp_event_loop_instance_t* loop_def = (esp_event_loop_instance_t*) loop;
+    uint8_t data[CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE + 1];
+
+    for (int i = 0; i < sizeof(data); i++) {
+        data[i] = i;
+    }
+
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, data, CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(true, post.data_set);
+    TEST_ASSERT_EQUAL(false, post.data_allocated);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, post.data.buf, CONFIG_ESP_EVENT_POST_INLINE_DATA_SIZE);
+
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, data, sizeof(data), portMAX_DELAY));
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(true, post.data_set);
+    TEST_ASSERT_EQUAL(true, post.data_allocated);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, post.data.ptr, sizeof(data));
+    free(post.data.ptr);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 TEST_CASE("can properly prepare event data posted to loop", "[event]")
 {
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -450,6 +450,17 @@ typedef struct httpd_uri {
      * Pointer to subprotocol supported by URI
      */
     const char *supported_subprotocol;
+
+    /**
+     * Flag for accepting the permessage-deflate extension (RFC 7692) if offered by the client,
+     * to compress the data messages in both directions. Frames are decompressed by httpd_ws_recv_frame()
+     * and compressed by httpd_ws_send_frame() transparently.
+     * Requires CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE, ignored otherwise.
+     *
+     * @note The compression state is shared by the messages of a connection, so frames sent from
+     *       other tasks must not be sent concurrently, e.g. send them with httpd_ws_send_data().
+     */
+    bool ws_permessage_deflate;
 #endif
 } httpd_uri_t;
 
@@ -1656,6 +1667,11 @@ typedef void (*transfer_complete_cb)(esp_err_t err, int socket, void *arg);
  *          The user can dynamically allocate space for pkt->payload as per this length and call httpd_ws_recv_frame() again to get the actual data.
  *          Please refer to the corresponding example for usage.
  *
+ * @note    Frames of compressed messages (permessage-deflate) are decompressed. To get their size with max_len as 0,
+ *          the frame is decompressed into a temporary buffer, which is then copied by the second call. With a buffer
+ *          passed in the first call, the frame is decompressed into it directly, and ESP_ERR_INVALID_SIZE is returned
+ *          if it doesn't fit.
+ *
  * @param[in]   req         Current request
  * @param[out]  pkt         WebSocket packet
  * @param[in]   max_len     Maximum length for receive
@@ -1664,6 +1680,8 @@ typedef void (*transfer_complete_cb)(esp_err_t err, int socket, void *arg);
  *  - ESP_FAIL                  : Socket errors occurs
  *  - ESP_ERR_INVALID_STATE     : Handshake was already done beforehand
  *  - ESP_ERR_INVALID_ARG       : Argument is invalid (null or non-WebSocket)
+ *  - ESP_ERR_INVALID_SIZE      : The frame is longer than max_len
+ *  - ESP_ERR_NO_MEM            : Cannot allocate memory to decompress the frame
  */
 esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len);
 
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -70,6 +70,9 @@ struct sock_db {
     esp_err_t (*ws_handler)(httpd_req_t *r);   /*!< WebSocket handler, leave to null if it's not WebSocket */
     bool ws_control_frames;                         /*!< WebSocket flag indicating that control frames should be passed to user handlers */
     void *ws_user_ctx;                         /*!< Pointer to user context data which will be available to handler for websocket*/
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+    struct httpd_ws_deflate *ws_deflate;    /*!< permessage-deflate state, NULL if the extension is not used */
+#endif
 #endif
 };
 
@@ -96,6 +99,7 @@ struct httpd_req_aux {
     httpd_ws_type_t ws_type;                        /*!< WebSocket frame type */
     bool ws_final;                                  /*!< WebSocket FIN bit (final frame or not) */
     uint8_t mask_key[4];                            /*!< WebSocket mask key for this payload */
+    bool ws_compressed;                             /*!< WebSocket frame is a part of a compressed message */
 #endif
 };
 
@@ -500,6 +504,7 @@ int httpd_default_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len,
  *
  * @param[in] req                       Pointer to handshake request that will be handled
  * @param[in] supported_subprotocol     Pointer to the subprotocol supported by this URI
+ * @param[in] permessage_deflate        Accept the permessage-deflate extension if offered
  * @return
  *  - ESP_OK                        : When handshake is sucessful
  *  - ESP_ERR_NOT_FOUND             : When some headers (Sec-WebSocket-*) are not found
@@ -508,7 +513,7 @@ int httpd_default_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len,
  *  - ESP_ERR_INVALID_ARG           : Argument is invalid (null or non-WebSocket)
  *  - ESP_FAIL                      : Socket failures
  */
-esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *supported_subprotocol);
+esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *supported_subprotocol, bool permessage_deflate);
 
 /**
  * @brief   This function is for getting a frame type
@@ -523,6 +528,15 @@ esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *suppor
  */
 esp_err_t httpd_ws_get_frame_type(httpd_req_t *req);
 
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+/**
+ * @brief   Free the permessage-deflate state of a session
+ *
+ * @param[in] sd    Session
+ */
+void httpd_ws_deflate_free(struct sock_db *sd);
+#endif
+
 /**
  * @brief   Trigger an httpd session close externally
  *
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -374,6 +374,9 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
 
     // clear all contexts
     httpd_sess_clear_ctx(session);
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+    httpd_ws_deflate_free(session);
+#endif
 
     // mark session slot as available
     session->fd = -1;
@@ -1,11 +1,12 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 
 #include <errno.h>
+#include <sys/socket.h>
 #include <esp_log.h>
 #include <esp_err.h>
 
@@ -81,6 +82,46 @@ static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
     return ESP_OK;
 }
 
+/* Number of buffers gathered into one sendmsg() call by httpd_resp_send() */
+#define HTTPD_RESP_IOV_MAX  32
+
+/* Sends out the buffers, in one sendmsg() call if the socket uses the default send function,
+ * so that the headers and a short body end up in a single TCP segment */
+static esp_err_t httpd_send_all_iov(httpd_req_t *r, struct iovec *iov, int iovcnt)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    if (ra->sd->send_fn != httpd_default_send) {
+        for (int i = 0; i < iovcnt; i++) {
+            if (httpd_send_all(r, iov[i].iov_base, iov[i].iov_len) != ESP_OK) {
+                return ESP_FAIL;
+            }
+        }
+        return ESP_OK;
+    }
+
+    while (iovcnt > 0) {
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = iovcnt };
+        ssize_t sent = sendmsg(ra->sd->fd, &msg, 0);
+        if (sent < 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in sendmsg = %d"), errno);
+            return ESP_FAIL;
+        }
+        ESP_LOGD(TAG, LOG_FMT("sent = %d"), (int)sent);
+        /* Skip over what has been sent, a partial send resumes within the buffer */
+        while (iovcnt > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return ESP_OK;
+}
+
 static size_t httpd_recv_pending(httpd_req_t *r, char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
@@ -252,43 +293,40 @@ esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
         return ESP_ERR_HTTPD_RESP_HDR;
     }
 
-    /* Sending essential headers */
-    if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
-    }
+    /* The headers and content are gathered, so that they can go out together */
+    struct iovec iov[HTTPD_RESP_IOV_MAX];
+    int iovcnt = 0;
+
+    /* Essential headers */
+    iov[iovcnt++] = (struct iovec) { .iov_base = ra->scratch, .iov_len = strlen(ra->scratch) };
 
-    /* Sending additional headers based on set_header */
+    /* Additional headers based on set_header */
     for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-        /* Send header field */
-        if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send ': ' */
-        if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send header value */
-        if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send CR + LF */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
+        /* Make room for this header, the end of the header section and the content */
+        if (iovcnt + 6 > HTTPD_RESP_IOV_MAX) {
+            if (httpd_send_all_iov(r, iov, iovcnt) != ESP_OK) {
+                return ESP_ERR_HTTPD_RESP_SEND;
+            }
+            iovcnt = 0;
         }
+        /* Header field, ': ', header value, CR + LF */
+        iov[iovcnt++] = (struct iovec) { .iov_base = (void *)ra->resp_hdrs[i].field, .iov_len = strlen(ra->resp_hdrs[i].field) };
+        iov[iovcnt++] = (struct iovec) { .iov_base = (void *)colon_separator, .iov_len = strlen(colon_separator) };
+        iov[iovcnt++] = (struct iovec) { .iov_base = (void *)ra->resp_hdrs[i].value, .iov_len = strlen(ra->resp_hdrs[i].value) };
+        iov[iovcnt++] = (struct iovec) { .iov_base = (void *)cr_lf_seperator, .iov_len = strlen(cr_lf_seperator) };
     }
 
     /* End header section */
-    if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
-    }
-    esp_http_server_dispatch_event(HTTP_SERVER_EVENT_HEADERS_SENT, &(ra->sd->fd), sizeof(int));
+    iov[iovcnt++] = (struct iovec) { .iov_base = (void *)cr_lf_seperator, .iov_len = strlen(cr_lf_seperator) };
 
-    /* Sending content */
+    /* Content */
     if (buf && buf_len) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+        iov[iovcnt++] = (struct iovec) { .iov_base = (void *)buf, .iov_len = buf_len };
+    }
+    if (httpd_send_all_iov(r, iov, iovcnt) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
     }
+    esp_http_server_dispatch_event(HTTP_SERVER_EVENT_HEADERS_SENT, &(ra->sd->fd), sizeof(int));
     esp_http_server_event_data evt_data = {
         .fd = ra->sd->fd,
         .data_len = buf_len,
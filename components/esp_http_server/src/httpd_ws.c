@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2020-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2020-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -9,10 +9,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/random.h>
+#include <sys/socket.h>
 #include <esp_log.h>
 #include <esp_err.h>
 #include <mbedtls/sha1.h>
 #include <mbedtls/base64.h>
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+#include <sys/param.h>
+#include "esp_deflate.h"
+#endif
+#include "esp_ws_mask.h"
 
 #include <esp_http_server.h>
 #include "esp_httpd_priv.h"
@@ -41,10 +47,41 @@ static const char *TAG="httpd_ws";
  */
 #define HTTPD_WS_CONTINUE       0x00U
 #define HTTPD_WS_FIN_BIT        0x80U
+#define HTTPD_WS_RSV1_BIT       0x40U
 #define HTTPD_WS_OPCODE_BITS    0x0fU
+#define HTTPD_WS_CONTROL_BIT    0x08U
 #define HTTPD_WS_MASK_BIT       0x80U
 #define HTTPD_WS_LENGTH_BITS    0x7fU
 
+/* Payloads up to this length are copied after the header on stack and sent in one call */
+#define HTTPD_WS_TX_COALESCE_LEN    128
+
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+#define HTTPD_WS_DEFLATE_WINDOW_BITS    CONFIG_HTTPD_WS_DEFLATE_WINDOW_BITS
+#define HTTPD_WS_INFLATE_MAX_LEN        CONFIG_HTTPD_WS_INFLATE_MAX_MESSAGE_LEN
+/* Close status code of a message too big to process, RFC6455 Section 7.4.1 */
+#define HTTPD_WS_STATUS_TOO_BIG         1009
+/* Compressed payload is received and unmasked on stack in pieces of this size */
+#define HTTPD_WS_INFLATE_CHUNK_LEN      128
+
+/**
+ * @brief permessage-deflate state of a WebSocket session
+ */
+struct httpd_ws_deflate {
+    uint8_t tx_window_bits;             /*!< Negotiated window sizes */
+    uint8_t rx_window_bits;
+    bool tx_no_context_takeover;        /*!< Each sent message is compressed on its own */
+    esp_deflate_handle_t deflate;       /*!< Created on the first sent message */
+    esp_inflate_handle_t inflate;       /*!< Created on the first received message */
+    bool rx_message_compressed;         /*!< The message being received is compressed */
+    size_t rx_remaining;                /*!< Compressed payload of the frame left to receive */
+    size_t rx_offset;                   /*!< Position in the payload of the frame, to unmask it */
+    size_t rx_message_len;              /*!< Decompressed length of the previous frames of the message */
+    uint8_t *rx_buf;                    /*!< Frame decompressed to get its length, until it's copied out */
+    size_t rx_len;
+};
+#endif
+
 /*
  * The magic GUID string used for handshake
  * Please refer to RFC6455 Section 1.3 for more details.
@@ -94,7 +131,90 @@ static bool httpd_ws_get_response_subprotocol(const char *supported_subprotocol,
 
 }
 
-esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *supported_subprotocol)
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+/**
+ * @brief Accepts the first usable permessage-deflate offer of the client
+ *
+ * Please refer to RFC7692 Section 7.1 for more details.
+ *
+ * @param req[in]         Handshake request
+ * @param response[out]   Sec-WebSocket-Extensions header line of the response, empty if none is accepted
+ * @param size[in]        Size of the response buffer
+ */
+static void httpd_ws_negotiate_deflate(httpd_req_t *req, char *response, size_t size)
+{
+    response[0] = '\0';
+
+    char offers[128] = { '\0' };
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Sec-WebSocket-Extensions", offers, sizeof(offers));
+    if (err == ESP_ERR_HTTPD_RESULT_TRUNC) {
+        ESP_LOGW(TAG, LOG_FMT("Sec-WebSocket-Extensions exceeds %d bytes, compression not used"), sizeof(offers));
+        return;
+    } else if (err != ESP_OK) {
+        return;
+    }
+
+    const char *ext = offers;
+    esp_ws_deflate_params_t params;
+    while ((err = esp_ws_deflate_parse_extension(&ext, &params)) != ESP_ERR_NOT_FOUND) {
+        /* The window of a client which can't limit it has to be the largest one */
+        if (err != ESP_OK || (params.client_max_window_bits == 0 &&
+                              HTTPD_WS_DEFLATE_WINDOW_BITS < ESP_DEFLATE_MAX_WINDOW_BITS)) {
+            continue;
+        }
+        struct httpd_ws_deflate *d = calloc(1, sizeof(struct httpd_ws_deflate));
+        if (d == NULL) {
+            ESP_LOGW(TAG, LOG_FMT("Failed to allocate memory, compression not used"));
+            return;
+        }
+        d->rx_window_bits = params.client_max_window_bits ?
+                            MIN(params.client_max_window_bits, HTTPD_WS_DEFLATE_WINDOW_BITS) :
+                            ESP_DEFLATE_MAX_WINDOW_BITS;
+        d->tx_window_bits = params.server_max_window_bits ?
+                            MIN(params.server_max_window_bits, HTTPD_WS_DEFLATE_WINDOW_BITS) :
+                            HTTPD_WS_DEFLATE_WINDOW_BITS;
+        d->tx_no_context_takeover = params.server_no_context_takeover;
+
+        int len = snprintf(response, size, "Sec-WebSocket-Extensions: permessage-deflate");
+        if (params.client_max_window_bits) {
+            len += snprintf(response + len, size - len, "; client_max_window_bits=%d", d->rx_window_bits);
+        }
+        if (d->tx_window_bits < ESP_DEFLATE_MAX_WINDOW_BITS || params.server_max_window_bits) {
+            len += snprintf(response + len, size - len, "; server_max_window_bits=%d", d->tx_window_bits);
+        }
+        if (params.server_no_context_takeover) {
+            len += snprintf(response + len, size - len, "; server_no_context_takeover");
+        }
+        if (params.client_no_context_takeover) {
+            len += snprintf(response + len, size - len, "; client_no_context_takeover");
+        }
+        snprintf(response + len, size - len, "\r\n");
+
+        struct httpd_req_aux *req_aux = req->aux;
+        httpd_ws_deflate_free(req_aux->sd);
+        req_aux->sd->ws_deflate = d;
+        ESP_LOGD(TAG, LOG_FMT("permessage-deflate accepted, window bits: tx %d, rx %d"),
+                 d->tx_window_bits, d->rx_window_bits);
+        return;
+    }
+    ESP_LOGD(TAG, LOG_FMT("No acceptable permessage-deflate offer in: %s"), offers);
+}
+
+void httpd_ws_deflate_free(struct sock_db *sd)
+{
+    struct httpd_ws_deflate *d = sd->ws_deflate;
+    if (d == NULL) {
+        return;
+    }
+    esp_deflate_destroy(d->deflate);
+    esp_inflate_destroy(d->inflate);
+    free(d->rx_buf);
+    free(d);
+    sd->ws_deflate = NULL;
+}
+#endif /* CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE */
+
+esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *supported_subprotocol, bool permessage_deflate)
 {
     /* Probe if input parameters are valid or not */
     if (!req || !req->aux) {
@@ -158,7 +278,7 @@ esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *suppor
 
 
     /* Prepare the Switching Protocol response */
-    char tx_buf[192] = { '\0' };
+    char tx_buf[384] = { '\0' };
     int fmt_len = snprintf(tx_buf, sizeof(tx_buf),
                            "HTTP/1.1 101 Switching Protocols\r\n"
                            "Upgrade: websocket\r\n"
@@ -188,6 +308,16 @@ esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *suppor
         }
     }
 
+    if (permessage_deflate) {
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+        /* The extension response line is up to 156 bytes long, with all the parameters */
+        httpd_ws_negotiate_deflate(req, tx_buf + fmt_len, sizeof(tx_buf) - fmt_len);
+        fmt_len += strlen(tx_buf + fmt_len);
+#else
+        ESP_LOGW(TAG, LOG_FMT("permessage-deflate requested, but CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE is disabled"));
+#endif
+    }
+
     int r = snprintf(tx_buf + fmt_len, sizeof(tx_buf) - fmt_len, "\r\n");
     if (r <= 0) {
         ESP_LOGE(TAG, "Error in response generation"
@@ -235,12 +365,204 @@ static esp_err_t httpd_ws_unmask_payload(uint8_t *payload, size_t len, const uin
         return ESP_ERR_INVALID_ARG;
     }
 
-    for (size_t idx = 0; idx < len; idx++) {
-        payload[idx] = (payload[idx] ^ mask_key[idx % 4]);
+    esp_ws_mask(payload, payload, len, mask_key, 0);
+
+    return ESP_OK;
+}
+
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+/**
+ * @brief Closes the connection because of a message too big to process
+ */
+static void httpd_ws_close_too_big(httpd_req_t *req, struct httpd_ws_deflate *d)
+{
+    struct httpd_req_aux *aux = req->aux;
+    /* Receive the rest of the frame, otherwise the close frame may be lost in a connection reset */
+    uint8_t chunk[HTTPD_WS_INFLATE_CHUNK_LEN];
+    while (d->rx_remaining > 0) {
+        int read_len = httpd_recv_with_opt(req, (char *)chunk, MIN(d->rx_remaining, sizeof(chunk)), false);
+        if (read_len <= 0) {
+            break;
+        }
+        d->rx_remaining -= read_len;
     }
 
+    uint8_t status[2] = { HTTPD_WS_STATUS_TOO_BIG >> 8, HTTPD_WS_STATUS_TOO_BIG & 0xff };
+    httpd_ws_frame_t frame = {
+        .type = HTTPD_WS_TYPE_CLOSE,
+        .payload = status,
+        .len = sizeof(status),
+    };
+    httpd_ws_send_frame_async(req->handle, aux->sd->fd, &frame);
+    aux->sd->ws_close = true;
+}
+
+/**
+ * @brief Receives the compressed payload of the current frame and decompresses it into a buffer
+ *
+ * @param req[in]       Current request
+ * @param d[in]         permessage-deflate state of the session
+ * @param buf[inout]    Output buffer, reallocated as needed if grow is set
+ * @param size[inout]   Size of the output buffer
+ * @param len[inout]    Length of the decompressed data in the buffer
+ * @param grow[in]      Reallocate the buffer when it's full
+ * @return
+ *  - ESP_OK                : The frame has been received and decompressed
+ *  - ESP_ERR_INVALID_SIZE  : The decompressed frame doesn't fit in the buffer, or the message
+ *                            is longer than CONFIG_HTTPD_WS_INFLATE_MAX_MESSAGE_LEN
+ *  - ESP_ERR_NO_MEM        : Cannot grow the buffer
+ *  - ESP_FAIL              : Socket error or corrupted data
+ */
+static esp_err_t httpd_ws_inflate_frame(httpd_req_t *req, struct httpd_ws_deflate *d,
+                                        uint8_t **buf, size_t *size, size_t *len, bool grow)
+{
+    struct httpd_req_aux *aux = req->aux;
+    uint8_t chunk[HTTPD_WS_INFLATE_CHUNK_LEN];
+    const uint8_t *in = chunk;
+    size_t in_len = 0;
+    /* Decompressed length of this frame which keeps the message within the limit */
+    const size_t max_len = HTTPD_WS_INFLATE_MAX_LEN - MIN(d->rx_message_len, HTTPD_WS_INFLATE_MAX_LEN);
+
+    while (true) {
+        if (in_len == 0 && d->rx_remaining > 0) {
+            int read_len = httpd_recv_with_opt(req, (char *)chunk, MIN(d->rx_remaining, sizeof(chunk)), false);
+            if (read_len <= 0) {
+                ESP_LOGW(TAG, LOG_FMT("Failed to receive payload"));
+                return ESP_FAIL;
+            }
+            esp_ws_mask(chunk, chunk, read_len, aux->mask_key, d->rx_offset);
+            d->rx_offset += read_len;
+            d->rx_remaining -= read_len;
+            in = chunk;
+            in_len = read_len;
+        }
+
+        /* A full buffer is still passed to the decompressor, which consumes the end of a message
+         * that fits exactly */
+        if (*len == *size && grow) {
+            /* One byte over the limit is enough to find out that the message is too big */
+            size_t new_size = MIN(*size ? *size * 2 : 512, max_len + 1);
+            uint8_t *new_buf = realloc(*buf, new_size);
+            if (new_buf == NULL) {
+                ESP_LOGW(TAG, LOG_FMT("Failed to allocate memory for the decompressed frame"));
+                return ESP_ERR_NO_MEM;
+            }
+            *buf = new_buf;
+            *size = new_size;
+        }
+
+        uint8_t *out = *buf + *len;
+        size_t out_size = *size - *len;
+        /* The message ends with the last byte of its final frame */
+        bool end = aux->ws_final && d->rx_remaining == 0;
+        esp_err_t err = esp_inflate(d->inflate, &in, &in_len, &out, &out_size, end);
+        *len = *size - out_size;
+        if (*len > max_len) {
+            ESP_LOGW(TAG, LOG_FMT("Decompressed message is longer than %d bytes"), HTTPD_WS_INFLATE_MAX_LEN);
+            httpd_ws_close_too_big(req, d);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (err == ESP_OK) {
+            d->rx_message_len += *len;
+            return ESP_OK;
+        } else if (err != ESP_ERR_NOT_FINISHED) {
+            ESP_LOGW(TAG, LOG_FMT("Failed to decompress the frame"));
+            esp_inflate_reset(d->inflate);
+            return ESP_FAIL;
+        }
+        if (in_len == 0 && d->rx_remaining == 0 && *len < *size) {
+            if (end) {
+                ESP_LOGW(TAG, LOG_FMT("Compressed message is truncated"));
+                esp_inflate_reset(d->inflate);
+                return ESP_FAIL;
+            }
+            /* Frame of a message which continues in the next frames */
+            d->rx_message_len += *len;
+            return ESP_OK;
+        }
+        if (in_len == 0 && d->rx_remaining == 0 && !end && !grow) {
+            /* Output left in the decompressor is returned with the next frame */
+            d->rx_message_len += *len;
+            return ESP_OK;
+        }
+        if (!grow && (in_len > 0 || d->rx_remaining == 0)) {
+            /* The decompressor has stopped on output which doesn't fit into the buffer */
+            ESP_LOGW(TAG, LOG_FMT("WS Message too long"));
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+}
+
+/**
+ * @brief Receives the payload of a frame of a compressed message, see httpd_ws_recv_frame()
+ */
+static esp_err_t httpd_ws_recv_compressed(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len, bool new_frame)
+{
+    struct httpd_req_aux *aux = req->aux;
+    struct httpd_ws_deflate *d = aux->sd->ws_deflate;
+    esp_err_t ret;
+
+    if (new_frame) {
+        free(d->rx_buf);
+        d->rx_buf = NULL;
+        d->rx_len = 0;
+        d->rx_remaining = frame->len;
+        d->rx_offset = 0;
+        if (d->inflate == NULL) {
+            /* zlib can't compress with the 8 bits window and uses 9 bits instead */
+            d->inflate = esp_inflate_create(MAX(d->rx_window_bits, ESP_DEFLATE_MIN_WINDOW_BITS + 1));
+            if (d->inflate == NULL) {
+                ESP_LOGW(TAG, LOG_FMT("Failed to create the decompressor"));
+                return ESP_ERR_NO_MEM;
+            }
+        }
+
+        if (max_len == 0) {
+            /* Decompress into a temporary buffer to get the length, it's copied out by the next call */
+            size_t size = 0;
+            ret = httpd_ws_inflate_frame(req, d, &d->rx_buf, &size, &d->rx_len, true);
+            if (ret != ESP_OK) {
+                free(d->rx_buf);
+                d->rx_buf = NULL;
+                return ret;
+            }
+            frame->len = d->rx_len;
+            if (frame->len > 0) {
+                return ESP_OK;
+            }
+        } else {
+            if (frame->payload == NULL) {
+                ESP_LOGW(TAG, LOG_FMT("Payload buffer is null"));
+                return ESP_FAIL;
+            }
+            size_t len = 0;
+            ret = httpd_ws_inflate_frame(req, d, &frame->payload, &max_len, &len, false);
+            frame->len = len;
+            return ret;
+        }
+    }
+
+    if (frame->len > max_len) {
+        if (max_len == 0) {
+            ESP_LOGD(TAG, "regard max_len == 0 is OK for user to get frame len");
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, LOG_FMT("WS Message too long"));
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (frame->len > 0) {
+        if (frame->payload == NULL || d->rx_buf == NULL || frame->len != d->rx_len) {
+            ESP_LOGW(TAG, LOG_FMT("Payload buffer is null"));
+            return ESP_FAIL;
+        }
+        memcpy(frame->payload, d->rx_buf, frame->len);
+    }
+    free(d->rx_buf);
+    d->rx_buf = NULL;
+    d->rx_len = 0;
     return ESP_OK;
 }
+#endif /* CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE */
 
 esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len)
 {
@@ -260,7 +582,8 @@ esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t
         return ESP_ERR_INVALID_ARG;
     }
     /* If frame len is 0, will get frame len from req. Otherwise regard frame len already achieved by calling httpd_ws_recv_frame before */
-    if (frame->len == 0) {
+    bool new_frame = frame->len == 0;
+    if (new_frame) {
         /* Assign the frame info from the previous reading */
         frame->type = aux->ws_type;
         frame->final = aux->ws_final;
@@ -320,6 +643,11 @@ esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t
             return ESP_ERR_INVALID_STATE;
         }
     }
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+    if (aux->ws_compressed) {
+        return httpd_ws_recv_compressed(req, frame, max_len, new_frame);
+    }
+#endif
     /* We only accept the incoming packet length that is smaller than the max_len (or it will overflow the buffer!) */
     /* If max_len is 0, regard it OK for userspace to get frame len */
     if (frame->len > max_len) {
@@ -363,6 +691,20 @@ esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t
     return ESP_OK;
 }
 
+static esp_err_t httpd_ws_send_all(httpd_handle_t hd, int fd, struct sock_db *sess, const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        int ret = sess->send_fn(hd, fd, (const char *)buf, len, 0);
+        if (ret <= 0) {
+            ESP_LOGW(TAG, LOG_FMT("Failed to send WS frame"));
+            return ESP_FAIL;
+        }
+        buf += ret;
+        len -= ret;
+    }
+    return ESP_OK;
+}
+
 esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
 {
     esp_err_t ret = httpd_ws_check_req(req);
@@ -372,33 +714,27 @@ esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
     return httpd_ws_send_frame_async(req->handle, httpd_req_to_sockfd(req), frame);
 }
 
-esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+static esp_err_t httpd_ws_send_frame_data(httpd_handle_t hd, int fd, struct sock_db *sess,
+                                          uint8_t first_byte, uint8_t *payload, size_t len)
 {
-    if (!frame) {
-        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
-        return ESP_ERR_INVALID_ARG;
-    }
-
     /* Prepare Tx buffer - maximum length is 14, which includes 2 bytes header, 8 bytes length, 4 bytes mask key */
     uint8_t tx_len = 0;
     uint8_t header_buf[10] = {0 };
-    /* Set the `FIN` bit by default if message is not fragmented. Else, set it as per the `final` field */
-    header_buf[0] |= (!frame->fragmented) ? HTTPD_WS_FIN_BIT : (frame->final? HTTPD_WS_FIN_BIT: HTTPD_WS_CONTINUE);
-    header_buf[0] |= frame->type; /* Type (opcode): 4 bits */
+    header_buf[0] = first_byte;
 
-    if (frame->len <= 125) {
-        header_buf[1] = frame->len & 0x7fU; /* Length for 7 bits */
+    if (len <= 125) {
+        header_buf[1] = len & 0x7fU; /* Length for 7 bits */
         tx_len = 2;
-    } else if (frame->len > 125 && frame->len < UINT16_MAX) {
+    } else if (len <= UINT16_MAX) {
         header_buf[1] = 126;                /* Length for 16 bits */
-        header_buf[2] = (frame->len >> 8U) & 0xffU;
-        header_buf[3] = frame->len & 0xffU;
+        header_buf[2] = (len >> 8U) & 0xffU;
+        header_buf[3] = len & 0xffU;
         tx_len = 4;
     } else {
         header_buf[1] = 127;                /* Length for 64 bits */
         uint8_t shift_idx = sizeof(uint64_t) - 1; /* Shift index starts at 7 */
-        uint64_t len64 = frame->len; /* Raise variable size to make sure we won't shift by more bits
-                                      * than the length has (to avoid undefined behaviour) */
+        uint64_t len64 = len; /* Raise variable size to make sure we won't shift by more bits
+                               * than the length has (to avoid undefined behaviour) */
         for (int8_t idx = 2; idx <= 9; idx++) {
             /* Now do shifting (be careful of endianness, i.e. when buffer index is 2, frame length shift index is 7) */
             header_buf[idx] = (len64 >> (shift_idx * 8)) & 0xffU;
@@ -410,26 +746,99 @@ esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t
     /* WebSocket server does not required to mask response payload, so leave the MASK bit as 0. */
     header_buf[1] &= (~HTTPD_WS_MASK_BIT);
 
-    struct sock_db *sess = httpd_sess_get(hd, fd);
-    if (!sess) {
-        return ESP_ERR_INVALID_ARG;
+    if (len == 0 || payload == NULL) {
+        return httpd_ws_send_all(hd, fd, sess, header_buf, tx_len);
     }
 
-    /* Send off header */
-    if (sess->send_fn(hd, fd, (const char *)header_buf, tx_len, 0) < 0) {
-        ESP_LOGW(TAG, LOG_FMT("Failed to send WS header"));
-        return ESP_FAIL;
+    /* Send off header and payload together, so that they don't end up in separate TCP segments or TLS records */
+    if (len <= HTTPD_WS_TX_COALESCE_LEN) {
+        uint8_t frame_buf[sizeof(header_buf) + HTTPD_WS_TX_COALESCE_LEN];
+        memcpy(frame_buf, header_buf, tx_len);
+        memcpy(frame_buf + tx_len, payload, len);
+        return httpd_ws_send_all(hd, fd, sess, frame_buf, tx_len + len);
     }
 
-    /* Send off payload */
-    if(frame->len > 0 && frame->payload != NULL) {
-        if (sess->send_fn(hd, fd, (const char *)frame->payload, frame->len, 0) < 0) {
-            ESP_LOGW(TAG, LOG_FMT("Failed to send WS payload"));
+    if (sess->send_fn == httpd_default_send) {
+        /* Plain socket, the header and payload are gathered by the TCP stack */
+        struct iovec iov[2] = {
+            { .iov_base = header_buf, .iov_len = tx_len },
+            { .iov_base = payload, .iov_len = len },
+        };
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+        ssize_t sent = sendmsg(fd, &msg, 0);
+        if (sent < 0) {
+            ESP_LOGW(TAG, LOG_FMT("Failed to send WS frame"));
             return ESP_FAIL;
         }
+        /* Finish a partial send with the default send function */
+        if (sent < tx_len) {
+            if (httpd_ws_send_all(hd, fd, sess, header_buf + sent, tx_len - sent) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            sent = tx_len;
+        }
+        return httpd_ws_send_all(hd, fd, sess, payload + (sent - tx_len), len - (sent - tx_len));
     }
 
-    return ESP_OK;
+    /* Custom send function, e.g. TLS, send off header and payload separately to avoid copying the payload */
+    if (httpd_ws_send_all(hd, fd, sess, header_buf, tx_len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_ws_send_all(hd, fd, sess, payload, len);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (!frame) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct sock_db *sess = httpd_sess_get(hd, fd);
+    if (!sess) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Set the `FIN` bit by default if message is not fragmented. Else, set it as per the `final` field */
+    bool final = !frame->fragmented || frame->final;
+    uint8_t first_byte = (final ? HTTPD_WS_FIN_BIT : HTTPD_WS_CONTINUE) | frame->type; /* Type (opcode): 4 bits */
+
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+    struct httpd_ws_deflate *d = sess->ws_deflate;
+    if (d && !(frame->type & HTTPD_WS_CONTROL_BIT)) {
+        if (d->deflate == NULL) {
+            d->deflate = esp_deflate_create(d->tx_window_bits);
+            if (d->deflate == NULL) {
+                ESP_LOGW(TAG, LOG_FMT("Failed to create the compressor"));
+                return ESP_ERR_NO_MEM;
+            }
+        }
+        size_t in_len = frame->payload ? frame->len : 0;
+        size_t out_size = esp_deflate_bound(in_len);
+        uint8_t *out = malloc(out_size);
+        if (out == NULL) {
+            ESP_LOGW(TAG, LOG_FMT("Failed to allocate memory for the compressed frame"));
+            return ESP_ERR_NO_MEM;
+        }
+        size_t out_len = 0;
+        esp_err_t ret = esp_deflate_message(d->deflate, frame->payload, in_len,
+                                            out, out_size, &out_len, final);
+        if (ret == ESP_OK) {
+            if (final && d->tx_no_context_takeover) {
+                esp_deflate_reset(d->deflate);
+            }
+            /* RSV1 marks the first frame of a compressed message only, RFC7692 Section 6 */
+            if (frame->type != HTTPD_WS_TYPE_CONTINUE) {
+                first_byte |= HTTPD_WS_RSV1_BIT;
+            }
+            ret = httpd_ws_send_frame_data(hd, fd, sess, first_byte, out, out_len);
+        }
+        free(out);
+        return ret;
+    }
+#endif
+
+    return httpd_ws_send_frame_data(hd, fd, sess, first_byte, frame->payload, frame->len);
 }
 
 esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
@@ -454,6 +863,7 @@ esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
     /* Read the first byte from the frame to get the FIN flag and Opcode */
     /* Please refer to RFC6455 Section 5.2 for more details */
     uint8_t first_byte = 0;
+    aux->ws_compressed = false;
     if (httpd_recv_with_opt(req, (char *)&first_byte, sizeof(first_byte), false) <= 0) {
         /* If the recv() return code is <= 0, then this socket FD is invalid (i.e. a broken connection) */
         /* Here we mark it as a Close message and close it later. */
@@ -469,6 +879,18 @@ esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
     aux->ws_final = (first_byte & HTTPD_WS_FIN_BIT) != 0;
     aux->ws_type = (first_byte & HTTPD_WS_OPCODE_BITS);
 
+#ifdef CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE
+    /* RSV1 is set on the first frame of a compressed message only, RFC7692 Section 6 */
+    struct httpd_ws_deflate *d = sd->ws_deflate;
+    if (d && !(aux->ws_type & HTTPD_WS_CONTROL_BIT)) {
+        if (aux->ws_type != HTTPD_WS_TYPE_CONTINUE) {
+            d->rx_message_compressed = (first_byte & HTTPD_WS_RSV1_BIT) != 0;
+            d->rx_message_len = 0;
+        }
+        aux->ws_compressed = d->rx_message_compressed;
+    }
+#endif
+
     /* If userspace requests control frames, do not deal with the control frames */
     if (!sd->ws_control_frames) {
         ESP_LOGD(TAG, LOG_FMT("Handler not requests control frames"));
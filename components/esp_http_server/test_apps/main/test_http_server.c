@@ -1,13 +1,19 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 #include <esp_system.h>
 #include <esp_http_server.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #include "unity.h"
 #include "test_utils.h"
@@ -244,6 +250,171 @@ TEST_CASE("Max Allowed Sockets Test", "[HTTP SERVER]")
     TEST_ASSERT(httpd_start(&hd, &config) != ESP_OK);
 }
 
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+/* Set and updated by the server task */
+static volatile int ws_test_fd = -1;
+static volatile size_t ws_test_send_calls;
+static volatile esp_err_t ws_test_err;
+
+static esp_err_t ws_test_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        ws_test_fd = httpd_req_to_sockfd(req);
+    }
+    return ESP_OK;
+}
+
+/* Custom send function, like the one set by TLS, which counts the calls */
+static int ws_test_counting_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    ws_test_send_calls++;
+    return send(sockfd, buf, buf_len, flags);
+}
+
+static void ws_test_set_send_override(void *arg)
+{
+    ws_test_err = httpd_sess_set_send_override(arg, ws_test_fd, ws_test_counting_send);
+}
+
+static void ws_test_send_done(esp_err_t err, int socket, void *arg)
+{
+    ws_test_err = err;
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+static void ws_test_recv_all(int sock, uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        int ret = recv(sock, buf, len, 0);
+        TEST_ASSERT_GREATER_THAN(0, ret);
+        buf += ret;
+        len -= ret;
+    }
+}
+
+/* Sends a frame from the server and checks what the client receives */
+static void ws_test_send_frame(httpd_handle_t hd, int sock, SemaphoreHandle_t done, size_t len)
+{
+    uint8_t *payload = malloc(len + 1);
+    uint8_t *received = malloc(len + 1);
+    TEST_ASSERT_NOT_NULL(payload);
+    TEST_ASSERT_NOT_NULL(received);
+    for (size_t i = 0; i < len; i++) {
+        payload[i] = i * 31 + 7;
+    }
+
+    httpd_ws_frame_t frame = {
+        .type = HTTPD_WS_TYPE_BINARY,
+        .payload = payload,
+        .len = len,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, httpd_ws_send_data_async(hd, ws_test_fd, &frame, ws_test_send_done, done));
+
+    /* The shortest length encoding must be used, RFC 6455 section 5.2 */
+    uint8_t header[10];
+    ws_test_recv_all(sock, header, 2);
+    TEST_ASSERT_EQUAL_HEX8(0x82, header[0]);
+    size_t received_len;
+    if (len <= 125) {
+        TEST_ASSERT_EQUAL(len, header[1]);
+        received_len = header[1];
+    } else if (len <= UINT16_MAX) {
+        TEST_ASSERT_EQUAL(126, header[1]);
+        ws_test_recv_all(sock, header + 2, 2);
+        received_len = (header[2] << 8) | header[3];
+    } else {
+        TEST_ASSERT_EQUAL(127, header[1]);
+        ws_test_recv_all(sock, header + 2, 8);
+        received_len = 0;
+        for (int i = 2; i < 10; i++) {
+            received_len = (received_len << 8) | header[i];
+        }
+    }
+    TEST_ASSERT_EQUAL(len, received_len);
+    ws_test_recv_all(sock, received, len);
+    if (len > 0) {
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, received, len);
+    }
+
+    TEST_ASSERT(xSemaphoreTake(done, pdMS_TO_TICKS(5000)));
+    TEST_ASSERT_EQUAL(ESP_OK, ws_test_err);
+    free(payload);
+    free(received);
+}
+
+TEST_CASE("WebSocket frame length boundaries", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    httpd_uri_t ws = {
+        .uri          = "/ws",
+        .method       = HTTP_GET,
+        .handler      = ws_test_handler,
+        .is_websocket = true,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &ws) == ESP_OK);
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, sock);
+    struct timeval timeout = { .tv_sec = 5 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config.server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    TEST_ASSERT_EQUAL(0, connect(sock, (struct sockaddr *)&addr, sizeof(addr)));
+
+    const char *request = "GET /ws HTTP/1.1\r\n"
+                          "Host: localhost\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n";
+    TEST_ASSERT_EQUAL(strlen(request), send(sock, request, strlen(request), 0));
+    char response[256] = {0};
+    size_t response_len = 0;
+    while (strstr(response, "\r\n\r\n") == NULL) {
+        TEST_ASSERT_LESS_THAN(sizeof(response) - 1, response_len);
+        int ret = recv(sock, response + response_len, 1, 0);
+        TEST_ASSERT_EQUAL(1, ret);
+        response_len++;
+    }
+    TEST_ASSERT_NOT_NULL(strstr(response, " 101 "));
+    for (int i = 0; i < 100 && ws_test_fd < 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(0, ws_test_fd);
+
+    const size_t lengths[] = { 0, 1, 125, 126, 127, 128, 129, 65535, 65536 };
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(done);
+
+    /* Plain socket, small frames are sent with one call and large ones with sendmsg() */
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        ws_test_send_frame(hd, sock, done, lengths[i]);
+    }
+
+    /* Custom send function, small frames must be sent with one call */
+    TEST_ASSERT_EQUAL(ESP_OK, httpd_queue_work(hd, ws_test_set_send_override, hd));
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        size_t calls = ws_test_send_calls;
+        ws_test_send_frame(hd, sock, done, lengths[i]);
+        if (lengths[i] <= 128) {
+            TEST_ASSERT_EQUAL(1, ws_test_send_calls - calls);
+        }
+    }
+
+    vSemaphoreDelete(done);
+    close(sock);
+    ws_test_fd = -1;
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
+
 void app_main(void)
 {
     unity_run_menu();
@@ -0,0 +1,284 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <esp_http_server.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_transport.h"
+#include "esp_transport_tcp.h"
+#include "esp_transport_ws.h"
+#include "sdkconfig.h"
+
+#include "unity.h"
+#include "test_utils.h"
+
+#if CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE && CONFIG_WS_PERMESSAGE_DEFLATE
+
+#define WS_TEST_MAX_MESSAGE_LEN     3000
+#define WS_TEST_MESSAGES            100
+#define WS_TEST_TIMEOUT_MS          5000
+#define WS_TEST_EXACT_MAX_LEN       600
+
+/* Bytes sent by the server, set and updated by the server task */
+static volatile size_t ws_deflate_test_sent;
+
+static int ws_deflate_test_counting_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    int ret = send(sockfd, buf, buf_len, flags);
+    if (ret > 0) {
+        ws_deflate_test_sent += ret;
+    }
+    return ret;
+}
+
+/* Echoes every frame, fragmented messages are echoed frame by frame */
+static esp_err_t ws_deflate_test_echo_handler(httpd_req_t *req)
+{
+    /* Called once the handshake has been sent */
+    if (req->method == HTTP_GET) {
+        return httpd_sess_set_send_override(req->handle, httpd_req_to_sockfd(req), ws_deflate_test_counting_send);
+    }
+
+    httpd_ws_frame_t frame = { 0 };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint8_t *buf = NULL;
+    if (frame.len > 0) {
+        buf = malloc(frame.len);
+        if (buf == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        frame.payload = buf;
+        ret = httpd_ws_recv_frame(req, &frame, frame.len);
+    }
+    if (ret == ESP_OK) {
+        frame.fragmented = true;
+        ret = httpd_ws_send_frame(req, &frame);
+    }
+    free(buf);
+    return ret;
+}
+
+/* Length of the next message to the exact size handler, set by the client */
+static volatile size_t ws_deflate_test_exact_len;
+
+/* Receives the message into a buffer of its exact length, without asking for the length first */
+static esp_err_t ws_deflate_test_exact_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        return ESP_OK;
+    }
+
+    size_t len = ws_deflate_test_exact_len;
+    uint8_t *buf = malloc(MAX(len, 1));
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    httpd_ws_frame_t frame = { .payload = buf };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, len);
+    if (ret == ESP_OK && frame.len != len) {
+        ret = ESP_FAIL;
+    }
+    if (ret == ESP_OK) {
+        ret = httpd_ws_send_frame(req, &frame);
+    }
+    free(buf);
+    return ret;
+}
+
+/* Generates either JSON-like text, which compresses well, or random bytes */
+static void ws_deflate_test_fill(uint8_t *buf, size_t len, bool text)
+{
+    size_t i = 0;
+    while (i < len) {
+        if (!text) {
+            buf[i++] = rand();
+            continue;
+        }
+        char item[64];
+        int item_len = snprintf(item, sizeof(item), "{\"temp\":%d.%d,\"hum\":%d,\"id\":\"dev-%d\"},",
+                                rand() % 40, rand() % 10, rand() % 100, rand() % 3);
+        size_t n = MIN(len - i, (size_t)item_len);
+        memcpy(buf + i, item, n);
+        i += n;
+    }
+}
+
+static size_t ws_deflate_test_message(uint8_t *buf, size_t max_len)
+{
+    size_t len = rand() % (max_len + 1);
+    ws_deflate_test_fill(buf, len, rand() % 3 != 0);
+    return len;
+}
+
+/* Sends messages split into up to 4 frames, with pings in between, and checks their echo */
+static void ws_deflate_test_echo(int port, const char *path, bool deflate, uint8_t window_bits, bool no_context_takeover)
+{
+    esp_transport_handle_t tcp = esp_transport_tcp_init();
+    TEST_ASSERT_NOT_NULL(tcp);
+    esp_transport_handle_t ws = esp_transport_ws_init(tcp);
+    TEST_ASSERT_NOT_NULL(ws);
+    esp_transport_ws_config_t config = {
+        .ws_path = path,
+        .permessage_deflate = deflate,
+        .deflate_window_bits = window_bits,
+        .deflate_no_context_takeover = no_context_takeover,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, esp_transport_ws_set_config(ws, &config));
+    ws_deflate_test_sent = 0;
+    TEST_ASSERT_EQUAL(0, esp_transport_connect(ws, "127.0.0.1", port, WS_TEST_TIMEOUT_MS));
+
+    uint8_t *message = malloc(WS_TEST_MAX_MESSAGE_LEN);
+    uint8_t *received = malloc(WS_TEST_MAX_MESSAGE_LEN);
+    TEST_ASSERT_NOT_NULL(message);
+    TEST_ASSERT_NOT_NULL(received);
+    size_t total = 0;
+    srand(7);
+    for (int m = 0; m < WS_TEST_MESSAGES; m++) {
+        size_t len = ws_deflate_test_message(message, WS_TEST_MAX_MESSAGE_LEN);
+        total += len;
+
+        int frames = rand() % 4 == 0 ? 1 + rand() % 4 : 1;
+        size_t pos = 0;
+        for (int f = 0; f < frames; f++) {
+            size_t frame_len = f == frames - 1 ? len - pos : (len - pos) * (rand() % 100) / 100;
+            int opcode = f == 0 ? (rand() % 2 ? WS_TRANSPORT_OPCODES_TEXT : WS_TRANSPORT_OPCODES_BINARY) : WS_TRANSPORT_OPCODES_CONT;
+            if (f == frames - 1) {
+                opcode |= WS_TRANSPORT_OPCODES_FIN;
+            }
+            TEST_ASSERT_EQUAL(frame_len, esp_transport_ws_send_raw(ws, opcode, (char *)message + pos, frame_len, WS_TEST_TIMEOUT_MS));
+            pos += frame_len;
+            if (rand() % 10 == 0) {
+                TEST_ASSERT_EQUAL(4, esp_transport_ws_send_raw(ws, WS_TRANSPORT_OPCODES_PING | WS_TRANSPORT_OPCODES_FIN,
+                                                               "ping", 4, WS_TEST_TIMEOUT_MS));
+            }
+        }
+
+        /* The echo is read in pieces of random length, across the frames */
+        size_t received_len = 0;
+        while (received_len < len || (len == 0 && received_len == 0)) {
+            int read_len = MIN(1 + rand() % 1000, WS_TEST_MAX_MESSAGE_LEN - received_len);
+            int ret = esp_transport_read(ws, (char *)received + received_len, read_len, WS_TEST_TIMEOUT_MS);
+            TEST_ASSERT_GREATER_OR_EQUAL(0, ret);
+            received_len += ret;
+            if (len == 0 && esp_transport_ws_get_fin_flag(ws) &&
+                    esp_transport_ws_get_read_opcode(ws) != WS_TRANSPORT_OPCODES_PONG) {
+                break;
+            }
+        }
+        TEST_ASSERT_EQUAL(len, received_len);
+        if (len > 0) {
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(message, received, len);
+        }
+    }
+
+    /* The server has sent the messages compressed only if the extension has been negotiated.
+     * Its send function may not have returned yet when the last echo has been received. */
+    vTaskDelay(pdMS_TO_TICKS(100));
+    size_t sent = ws_deflate_test_sent;
+    printf("%s deflate %d window bits %d no context takeover %d: %u bytes sent as %u\n",
+           path, deflate, window_bits, no_context_takeover, (unsigned)total, (unsigned)sent);
+    if (deflate && strcmp(path, "/ws") == 0) {
+        TEST_ASSERT_LESS_THAN(total, sent);
+    } else {
+        TEST_ASSERT_GREATER_OR_EQUAL(total, sent);
+    }
+
+    free(message);
+    free(received);
+    esp_transport_close(ws);
+    esp_transport_destroy(ws);
+    esp_transport_destroy(tcp);
+}
+
+/* Sends messages of every length up to WS_TEST_EXACT_MAX_LEN, which the server receives into buffers of their exact length */
+static void ws_deflate_test_exact(int port)
+{
+    esp_transport_handle_t tcp = esp_transport_tcp_init();
+    TEST_ASSERT_NOT_NULL(tcp);
+    esp_transport_handle_t ws = esp_transport_ws_init(tcp);
+    TEST_ASSERT_NOT_NULL(ws);
+    esp_transport_ws_config_t config = {
+        .ws_path = "/exact",
+        .permessage_deflate = true,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, esp_transport_ws_set_config(ws, &config));
+    TEST_ASSERT_EQUAL(0, esp_transport_connect(ws, "127.0.0.1", port, WS_TEST_TIMEOUT_MS));
+
+    uint8_t *message = malloc(WS_TEST_EXACT_MAX_LEN);
+    uint8_t *received = malloc(WS_TEST_EXACT_MAX_LEN);
+    TEST_ASSERT_NOT_NULL(message);
+    TEST_ASSERT_NOT_NULL(received);
+    srand(11);
+    for (size_t len = 1; len <= WS_TEST_EXACT_MAX_LEN; len++) {
+        bool text = len % 2;
+        ws_deflate_test_fill(message, len, text);
+        ws_deflate_test_exact_len = len;
+        int opcode = (text ? WS_TRANSPORT_OPCODES_TEXT : WS_TRANSPORT_OPCODES_BINARY) | WS_TRANSPORT_OPCODES_FIN;
+        TEST_ASSERT_EQUAL(len, esp_transport_ws_send_raw(ws, opcode, (char *)message, len, WS_TEST_TIMEOUT_MS));
+        size_t received_len = 0;
+        while (received_len < len) {
+            int ret = esp_transport_read(ws, (char *)received + received_len, len - received_len, WS_TEST_TIMEOUT_MS);
+            TEST_ASSERT_GREATER_THAN(0, ret);
+            received_len += ret;
+        }
+        /* No read of 0 bytes is needed to finish the frame */
+        TEST_ASSERT(esp_transport_ws_is_frame_complete(ws));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(message, received, len);
+    }
+
+    free(message);
+    free(received);
+    esp_transport_close(ws);
+    esp_transport_destroy(ws);
+    esp_transport_destroy(tcp);
+}
+
+TEST_CASE("WebSocket permessage-deflate client to server loopback", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    httpd_uri_t ws = {
+        .uri                   = "/ws",
+        .method                = HTTP_GET,
+        .handler               = ws_deflate_test_echo_handler,
+        .is_websocket          = true,
+        .ws_permessage_deflate = true,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &ws) == ESP_OK);
+    httpd_uri_t ws_no_deflate = ws;
+    ws_no_deflate.uri = "/nodeflate";
+    ws_no_deflate.ws_permessage_deflate = false;
+    TEST_ASSERT(httpd_register_uri_handler(hd, &ws_no_deflate) == ESP_OK);
+    httpd_uri_t ws_exact = ws;
+    ws_exact.uri = "/exact";
+    ws_exact.handler = ws_deflate_test_exact_handler;
+    TEST_ASSERT(httpd_register_uri_handler(hd, &ws_exact) == ESP_OK);
+
+    ws_deflate_test_echo(config.server_port, "/ws", false, 0, false);
+    /* Default window, with context takeover */
+    ws_deflate_test_echo(config.server_port, "/ws", true, 0, false);
+    /* Smallest window, each message compressed on its own */
+    ws_deflate_test_echo(config.server_port, "/ws", true, 9, true);
+    ws_deflate_test_echo(config.server_port, "/ws", true, 15, false);
+    /* The extension is offered, but declined by the server */
+    ws_deflate_test_echo(config.server_port, "/nodeflate", true, 11, false);
+    ws_deflate_test_exact(config.server_port);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+#endif /* CONFIG_HTTPD_WS_PERMESSAGE_DEFLATE && CONFIG_WS_PERMESSAGE_DEFLATE */
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2017-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2017-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -13,6 +13,10 @@
 #include <errno.h>
 #include <sys/param.h>
 #include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 ESP_EVENT_DEFINE_BASE(ESP_HTTPS_OTA_EVENT);
 
@@ -25,6 +29,12 @@ ESP_EVENT_DEFINE_BASE(ESP_HTTPS_OTA_EVENT);
 _Static_assert(DEFAULT_OTA_BUF_SIZE > (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t) + 1), "OTA data buffer too small");
 
 #define DEFAULT_REQUEST_SIZE (64 * 1024)
+
+/* With pipelined flash write, flash is erased in blocks of this size while the flash write task waits for data,
+ * up to PIPELINE_ERASE_AHEAD bytes ahead of the written data */
+#define PIPELINE_ERASE_BLOCK_SIZE (64 * 1024)
+#define PIPELINE_ERASE_AHEAD (2 * PIPELINE_ERASE_BLOCK_SIZE)
+
 static const char *TAG = "esp_https_ota";
 
 typedef enum {
@@ -34,6 +44,24 @@ typedef enum {
     ESP_HTTPS_OTA_SUCCESS,
 } esp_https_ota_state;
 
+typedef struct {
+    char *buf;              /* Buffer to return to the free queue once written, NULL if data has to be freed instead */
+    const char *data;       /* Data to write, NULL stops the flash write task */
+    size_t len;
+} ota_pipeline_chunk_t;
+
+/* Buffers and task used to write the image to flash while the next part of it is being downloaded */
+typedef struct {
+    char *buffers;
+    QueueHandle_t free_queue;       /* Buffers the image can be downloaded to */
+    QueueHandle_t data_queue;       /* Chunks of the image to write to flash, in order */
+    SemaphoreHandle_t done;         /* Given by the flash write task when it exits */
+    TaskHandle_t task;
+    size_t written;                 /* Bytes written to flash, owned by the flash write task while it runs */
+    volatile esp_err_t err;         /* First error of the flash write task */
+    volatile bool discard;          /* Release the queued chunks without writing them */
+} ota_pipeline_t;
+
 struct esp_https_ota_handle {
     esp_ota_handle_t update_handle;
     const esp_partition_t *update_partition;
@@ -46,6 +74,7 @@ struct esp_https_ota_handle {
     esp_https_ota_state state;
     bool bulk_flash_erase;
     bool partial_http_download;
+    ota_pipeline_t *pipeline;
 #if CONFIG_ESP_HTTPS_OTA_DECRYPT_CB
     decrypt_cb_t decrypt_cb;
     void *decrypt_user_ctx;
@@ -235,6 +264,180 @@ static esp_err_t _ota_write(esp_https_ota_t *https_ota_handle, const void *buffe
     return err;
 }
 
+static void ota_pipeline_task(void *arg)
+{
+    esp_https_ota_t *handle = (esp_https_ota_t *)arg;
+    ota_pipeline_t *pipeline = handle->pipeline;
+    size_t erase_end = 0;
+    size_t erase_limit = 0;
+    if (!handle->bulk_flash_erase) {
+        erase_limit = handle->update_partition->size;
+        if (handle->image_length > 0) {
+            erase_limit = MIN(erase_limit, handle->image_length);
+        }
+    }
+
+    while (1) {
+        ota_pipeline_chunk_t chunk;
+        bool erase_more = (pipeline->err == ESP_OK && erase_end < erase_limit && erase_end < pipeline->written + PIPELINE_ERASE_AHEAD);
+        if (xQueueReceive(pipeline->data_queue, &chunk, erase_more ? 0 : portMAX_DELAY) != pdTRUE) {
+            /* Nothing to write yet, erase the next block meanwhile */
+            erase_end = MAX(erase_end, pipeline->written);
+            erase_end = MIN((erase_end / PIPELINE_ERASE_BLOCK_SIZE + 1) * PIPELINE_ERASE_BLOCK_SIZE, erase_limit);
+            esp_err_t err = esp_ota_erase_ahead(handle->update_handle, erase_end);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Error: esp_ota_erase_ahead failed! err=0x%x", err);
+                pipeline->err = err;
+            }
+            continue;
+        }
+        if (chunk.data == NULL) {
+            break;
+        }
+        if (pipeline->err == ESP_OK && !pipeline->discard) {
+            esp_err_t err = esp_ota_write(handle->update_handle, chunk.data, chunk.len);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Error: esp_ota_write failed! err=0x%x", err);
+                pipeline->err = err;
+            } else {
+                pipeline->written += chunk.len;
+                int written = pipeline->written;
+                ESP_LOGD(TAG, "Written image length %d", written);
+                esp_https_ota_dispatch_event(ESP_HTTPS_OTA_WRITE_FLASH, (void *)(&written), sizeof(int));
+            }
+        }
+        if (chunk.buf != NULL) {
+            xQueueSend(pipeline->free_queue, &chunk.buf, portMAX_DELAY);
+        } else {
+            free((void *)chunk.data);
+        }
+    }
+    xSemaphoreGive(pipeline->done);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t ota_pipeline_create(esp_https_ota_t *handle)
+{
+    const int buf_num = CONFIG_ESP_HTTPS_OTA_PIPELINE_BUF_NUM;
+    ota_pipeline_t *pipeline = calloc(1, sizeof(ota_pipeline_t));
+    if (pipeline == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    handle->pipeline = pipeline;
+    pipeline->buffers = malloc(buf_num * CONFIG_ESP_HTTPS_OTA_PIPELINE_BUF_SIZE);
+    pipeline->free_queue = xQueueCreate(buf_num, sizeof(char *));
+    pipeline->data_queue = xQueueCreate(buf_num, sizeof(ota_pipeline_chunk_t));
+    pipeline->done = xSemaphoreCreateBinary();
+    if (pipeline->buffers == NULL || pipeline->free_queue == NULL || pipeline->data_queue == NULL || pipeline->done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < buf_num; i++) {
+        char *buf = pipeline->buffers + i * CONFIG_ESP_HTTPS_OTA_PIPELINE_BUF_SIZE;
+        xQueueSend(pipeline->free_queue, &buf, 0);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ota_pipeline_start(esp_https_ota_t *handle)
+{
+    ota_pipeline_t *pipeline = handle->pipeline;
+    pipeline->written = handle->binary_file_len;
+    if (xTaskCreate(ota_pipeline_task, "https_ota_write", CONFIG_ESP_HTTPS_OTA_PIPELINE_TASK_STACK_SIZE,
+                    handle, uxTaskPriorityGet(NULL), &pipeline->task) != pdPASS) {
+        ESP_LOGE(TAG, "Couldn't create flash write task");
+        pipeline->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* Wait until all the queued data is written (or released, if discard is set) and the flash write task exits */
+static esp_err_t ota_pipeline_stop(esp_https_ota_t *handle, bool discard)
+{
+    ota_pipeline_t *pipeline = handle->pipeline;
+    if (pipeline == NULL) {
+        return ESP_OK;
+    }
+    if (pipeline->task != NULL) {
+        pipeline->discard = discard;
+        const ota_pipeline_chunk_t stop = { 0 };
+        xQueueSend(pipeline->data_queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(pipeline->done, portMAX_DELAY);
+        pipeline->task = NULL;
+    }
+    return pipeline->err;
+}
+
+static void ota_pipeline_delete(esp_https_ota_t *handle)
+{
+    ota_pipeline_t *pipeline = handle->pipeline;
+    if (pipeline == NULL) {
+        return;
+    }
+    ota_pipeline_stop(handle, true);
+    if (pipeline->done) {
+        vSemaphoreDelete(pipeline->done);
+    }
+    if (pipeline->data_queue) {
+        vQueueDelete(pipeline->data_queue);
+    }
+    if (pipeline->free_queue) {
+        vQueueDelete(pipeline->free_queue);
+    }
+    free(pipeline->buffers);
+    free(pipeline);
+    handle->pipeline = NULL;
+}
+
+/* Get a buffer to download the next part of the image to */
+static esp_err_t ota_get_buf(esp_https_ota_t *handle, char **buf, size_t *buf_size)
+{
+    ota_pipeline_t *pipeline = handle->pipeline;
+    if (pipeline == NULL) {
+        *buf = handle->ota_upgrade_buf;
+        *buf_size = handle->ota_upgrade_buf_size;
+        return ESP_OK;
+    }
+    /* Stop downloading as soon as writing has failed */
+    if (pipeline->err != ESP_OK) {
+        return pipeline->err;
+    }
+    xQueueReceive(pipeline->free_queue, buf, portMAX_DELAY);
+    *buf_size = CONFIG_ESP_HTTPS_OTA_PIPELINE_BUF_SIZE;
+    return ESP_OK;
+}
+
+/* Return a buffer obtained from ota_get_buf() which wasn't passed to ota_write_buf() */
+static void ota_put_buf(esp_https_ota_t *handle, char *buf)
+{
+    if (handle->pipeline != NULL) {
+        xQueueSend(handle->pipeline->free_queue, &buf, portMAX_DELAY);
+    }
+}
+
+/* Write data downloaded to a buffer from ota_get_buf(), or decrypted from it */
+static esp_err_t ota_write_buf(esp_https_ota_t *handle, char *buf, const void *data, size_t len)
+{
+    ota_pipeline_t *pipeline = handle->pipeline;
+    if (pipeline == NULL || pipeline->task == NULL) {
+        ota_put_buf(handle, buf);
+        return _ota_write(handle, data, len);
+    }
+    ota_pipeline_chunk_t chunk = {
+        .buf = buf,
+        .data = data,
+        .len = len,
+    };
+    if (data != buf) {
+        /* Decrypted data is freed by the flash write task, the buffer can be reused right away */
+        ota_put_buf(handle, buf);
+        chunk.buf = NULL;
+    }
+    xQueueSend(pipeline->data_queue, &chunk, portMAX_DELAY);
+    handle->binary_file_len += len;
+    return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+}
+
 static bool is_server_verification_enabled(const esp_https_ota_config_t *ota_config) {
     return  (ota_config->http_config->cert_pem
             || ota_config->http_config->use_global_ca_store
@@ -361,6 +564,15 @@ esp_err_t esp_https_ota_begin(const esp_https_ota_config_t *ota_config, esp_http
     https_ota_handle->decrypt_cb = ota_config->decrypt_cb;
     https_ota_handle->decrypt_user_ctx = ota_config->decrypt_user_ctx;
 #endif
+    if (ota_config->pipelined_flash_write) {
+        err = ota_pipeline_create(https_ota_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Couldn't allocate memory for pipelined flash write");
+            ota_pipeline_delete(https_ota_handle);
+            free(https_ota_handle->ota_upgrade_buf);
+            goto http_cleanup;
+        }
+    }
     https_ota_handle->ota_upgrade_buf_size = alloc_size;
     https_ota_handle->bulk_flash_erase = ota_config->bulk_flash_erase;
     https_ota_handle->binary_file_len = 0;
@@ -516,11 +728,25 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
             if (err != ESP_OK) {
                 return err;
             }
-            return _ota_write(handle, data_buf, binary_file_len);
-        case ESP_HTTPS_OTA_IN_PROGRESS:
-            data_read = esp_http_client_read(handle->http_client,
-                                             handle->ota_upgrade_buf,
-                                             handle->ota_upgrade_buf_size);
+            err = _ota_write(handle, data_buf, binary_file_len);
+            if (err == ESP_ERR_HTTPS_OTA_IN_PROGRESS && handle->pipeline) {
+                esp_err_t ret = ota_pipeline_start(handle);
+                if (ret != ESP_OK) {
+                    return ret;
+                }
+            }
+            return err;
+        case ESP_HTTPS_OTA_IN_PROGRESS: {
+            char *buf;
+            size_t buf_size;
+            err = ota_get_buf(handle, &buf, &buf_size);
+            if (err != ESP_OK) {
+                return err;
+            }
+            data_read = esp_http_client_read(handle->http_client, buf, buf_size);
+            if (data_read <= 0) {
+                ota_put_buf(handle, buf);
+            }
             if (data_read == 0) {
                 /*
                  *  esp_http_client_is_complete_data_received is added to check whether
@@ -532,21 +758,22 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
                 }
                 ESP_LOGD(TAG, "Connection closed");
             } else if (data_read > 0) {
-                const void *data_buf = (const void *) handle->ota_upgrade_buf;
+                const void *data_buf = (const void *) buf;
                 int data_len = data_read;
 #if CONFIG_ESP_HTTPS_OTA_DECRYPT_CB
                 decrypt_cb_arg_t args = {};
-                args.data_in = handle->ota_upgrade_buf;
+                args.data_in = buf;
                 args.data_in_len = data_read;
                 err = esp_https_ota_decrypt_cb(handle, &args);
                 if (err == ESP_OK) {
                     data_buf = args.data_out;
                     data_len = args.data_out_len;
                 } else {
+                    ota_put_buf(handle, buf);
                     return err;
                 }
 #endif // CONFIG_ESP_HTTPS_OTA_DECRYPT_CB
-                return _ota_write(handle, data_buf, data_len);
+                return ota_write_buf(handle, buf, data_buf, data_len);
             } else {
                 if (data_read == -ESP_ERR_HTTP_EAGAIN) {
                     ESP_LOGD(TAG, "ESP_ERR_HTTP_EAGAIN invoked: Call timed out before data was ready");
@@ -557,8 +784,14 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
             }
             if (!handle->partial_http_download || (handle->partial_http_download && handle->image_length == handle->binary_file_len)) {
                 handle->state = ESP_HTTPS_OTA_SUCCESS;
+                /* Whole image is downloaded, wait until it is written */
+                err = ota_pipeline_stop(handle, false);
+                if (err != ESP_OK) {
+                    return err;
+                }
             }
             break;
+        }
          default:
             ESP_LOGE(TAG, "Invalid ESP HTTPS OTA State");
             return ESP_FAIL;
@@ -617,9 +850,15 @@ esp_err_t esp_https_ota_finish(esp_https_ota_handle_t https_ota_handle)
     switch (handle->state) {
         case ESP_HTTPS_OTA_SUCCESS:
         case ESP_HTTPS_OTA_IN_PROGRESS:
-            err = esp_ota_end(handle->update_handle);
+            err = ota_pipeline_stop(handle, false);
+            if (err == ESP_OK) {
+                err = esp_ota_end(handle->update_handle);
+            } else {
+                esp_ota_abort(handle->update_handle);
+            }
             /* falls through */
         case ESP_HTTPS_OTA_BEGIN:
+            ota_pipeline_delete(handle);
             if (handle->ota_upgrade_buf) {
                 free(handle->ota_upgrade_buf);
             }
@@ -663,9 +902,11 @@ esp_err_t esp_https_ota_abort(esp_https_ota_handle_t https_ota_handle)
     switch (handle->state) {
         case ESP_HTTPS_OTA_SUCCESS:
         case ESP_HTTPS_OTA_IN_PROGRESS:
+            ota_pipeline_stop(handle, true);
             err = esp_ota_abort(handle->update_handle);
             /* falls through */
         case ESP_HTTPS_OTA_BEGIN:
+            ota_pipeline_delete(handle);
             if (handle->ota_upgrade_buf) {
                 free(handle->ota_upgrade_buf);
             }
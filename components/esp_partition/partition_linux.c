@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2021-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -571,13 +571,6 @@ static bool esp_partition_hook_write(const void *dstAddr, const size_t size)
 {
     ESP_LOGV(TAG, "%s", __FUNCTION__);
 
-    // power-off emulation
-    for (size_t i = 0; i < size / 4; ++i) {
-        if (s_esp_partition_emulated_power_off_counter != SIZE_MAX && s_esp_partition_emulated_power_off_counter-- == 0) {
-            return false;
-        }
-    }
-
     bool ret_val = true;
 
     // one power down cycle per 4 bytes written
@@ -585,7 +578,7 @@ static bool esp_partition_hook_write(const void *dstAddr, const size_t size)
 
     // check whether power off simulation is active for write
     if (s_esp_partition_emulated_power_off_counter != SIZE_MAX &&
-            s_esp_partition_emulated_power_off_counter & ESP_PARTITION_FAIL_AFTER_MODE_WRITE) {
+            s_esp_partition_emulated_power_off_mode & ESP_PARTITION_FAIL_AFTER_MODE_WRITE) {
 
         // check if power down happens during this call
         if (s_esp_partition_emulated_power_off_counter >= write_cycles) {
@@ -634,7 +627,7 @@ static bool esp_partition_hook_erase(const void *dstAddr, const size_t size)
 
     // check whether power off simulation is active for erase
     if (s_esp_partition_emulated_power_off_counter != SIZE_MAX &&
-            s_esp_partition_emulated_power_off_counter & ESP_PARTITION_FAIL_AFTER_MODE_ERASE) {
+            s_esp_partition_emulated_power_off_mode & ESP_PARTITION_FAIL_AFTER_MODE_ERASE) {
 
         // check if power down happens during this call
         if (s_esp_partition_emulated_power_off_counter >= sector_count) {
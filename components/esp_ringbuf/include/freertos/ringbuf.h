@@ -65,6 +65,17 @@ typedef struct xSTATIC_RINGBUFFER {
     /** @endcond */
 } StaticRingbuffer_t;
 
+/**
+ * @brief Struct describing one item retrieved by xRingbufferReceiveMultiple()
+ *
+ * The item is not copied, pvItem points directly into the ring buffer's
+ * storage area until the item is returned.
+ */
+typedef struct {
+    void *pvItem;       /**< Pointer to the item (or part of a split item) inside the ring buffer */
+    size_t xItemSize;   /**< Size of the item (or part of a split item) in bytes */
+} RingbufferItem_t;
+
 /**
  * @brief       Create a ring buffer
  *
@@ -111,6 +122,53 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
                                         uint8_t *pucRingbufferStorage,
                                         StaticRingbuffer_t *pxStaticRingbuffer);
 
+/**
+ * @brief       Create a lock-free ring buffer for a single producer and a single consumer
+ *
+ * Sending and receiving items don't enter a critical section, unless the sender
+ * has to wait for free space or the receiver has to wait for data. This reduces
+ * the interrupt latency when a ring buffer connects exactly one writer (e.g. an
+ * ISR) to exactly one reader.
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes. Note that items require
+ *              space for a header in no-split buffers
+ * @param[in]   xBufferType Type of ring buffer, RINGBUF_TYPE_NOSPLIT or RINGBUF_TYPE_BYTEBUF
+ *
+ * @note    Only one task or ISR may send or acquire items, and only one task or
+ *          ISR may receive and return items. Items must be completed
+ *          (xRingbufferSendComplete()) in the order they were acquired, and
+ *          returned in the order they were received.
+ * @note    The buffer is never completely filled, so the maximum item size is
+ *          slightly smaller than for other ring buffers of the same type, see
+ *          xRingbufferGetMaxItemSize().
+ * @note    These ring buffers can't be added to a queue set.
+ *
+ * @return  A handle to the created ring buffer, or NULL in case of error.
+ */
+RingbufHandle_t xRingbufferCreateSPSC(size_t xBufferSize, RingbufferType_t xBufferType);
+
+/**
+ * @brief       Create a lock-free ring buffer for a single producer and a single
+ *              consumer, but manually provide the required memory
+ *
+ * See xRingbufferCreateSPSC() and xRingbufferCreateStatic().
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes.
+ * @param[in]   xBufferType Type of ring buffer, RINGBUF_TYPE_NOSPLIT or RINGBUF_TYPE_BYTEBUF
+ * @param[in]   pucRingbufferStorage Pointer to the ring buffer's storage area.
+ *              Storage area must have the same size as specified by xBufferSize
+ * @param[in]   pxStaticRingbuffer Pointed to a struct of type StaticRingbuffer_t
+ *              which will be used to hold the ring buffer's data structure
+ *
+ * @note    xBufferSize of no-split buffers MUST be 32-bit aligned.
+ *
+ * @return  A handle to the created ring buffer
+ */
+RingbufHandle_t xRingbufferCreateStaticSPSC(size_t xBufferSize,
+                                            RingbufferType_t xBufferType,
+                                            uint8_t *pucRingbufferStorage,
+                                            StaticRingbuffer_t *pxStaticRingbuffer);
+
 /**
  * @brief       Insert an item into the ring buffer
  *
@@ -363,6 +421,53 @@ void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer,
  */
 void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize, size_t xMaxSize);
 
+/**
+ * @brief   Retrieve multiple items from the ring buffer at once
+ *
+ * Attempt to retrieve up to uxMaxItems items from a no-split or allow-split ring
+ * buffer. All items which are currently available (up to uxMaxItems) are retrieved
+ * in a single call, without being copied. This function will block until at least
+ * one item is available or until it times out.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  pxItems         Array which will be filled with the retrieved items, in the order they were sent
+ * @param[in]   uxMaxItems      Number of elements in pxItems. Must be at least 2 for allow-split buffers.
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    A call to vRingbufferReturnMultiple() (or a call to vRingbufferReturnItem() for each item)
+ *          is required after this to free the items retrieved.
+ * @note    Both parts of a split item are retrieved together, as two consecutive elements of pxItems.
+ * @note    This function should only be called on no-split/allow-split buffers
+ *
+ * @return  Number of elements of pxItems filled in, 0 on timeout.
+ */
+UBaseType_t xRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer,
+                                       RingbufferItem_t *pxItems,
+                                       UBaseType_t uxMaxItems,
+                                       TickType_t xTicksToWait);
+
+/**
+ * @brief   Retrieve multiple items from the ring buffer at once in an ISR
+ *
+ * Attempt to retrieve up to uxMaxItems items from a no-split or allow-split ring
+ * buffer. This function returns immediately if there are no items available for
+ * retrieval.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  pxItems         Array which will be filled with the retrieved items, in the order they were sent
+ * @param[in]   uxMaxItems      Number of elements in pxItems. Must be at least 2 for allow-split buffers.
+ *
+ * @note    A call to vRingbufferReturnMultipleFromISR() (or a call to vRingbufferReturnItemFromISR()
+ *          for each item) is required after this to free the items retrieved.
+ * @note    Both parts of a split item are retrieved together, as two consecutive elements of pxItems.
+ * @note    This function should only be called on no-split/allow-split buffers
+ *
+ * @return  Number of elements of pxItems filled in, 0 if the ring buffer is empty.
+ */
+UBaseType_t xRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                              RingbufferItem_t *pxItems,
+                                              UBaseType_t uxMaxItems);
+
 /**
  * @brief   Return a previously-retrieved item to the ring buffer
  *
@@ -385,6 +490,35 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief   Return multiple previously-retrieved items to the ring buffer at once
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   pxItems     Items that were received earlier, e.g. by xRingbufferReceiveMultiple()
+ * @param[in]   uxNumItems  Number of elements in pxItems
+ *
+ * @note    Equivalent to calling vRingbufferReturnItem() for each item, but
+ *          only enters the critical section and wakes up a waiting sender once.
+ */
+void vRingbufferReturnMultiple(RingbufHandle_t xRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxNumItems);
+
+/**
+ * @brief   Return multiple previously-retrieved items to the ring buffer at once from an ISR
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   pxItems     Items that were received earlier, e.g. by xRingbufferReceiveMultipleFromISR()
+ * @param[in]   uxNumItems  Number of elements in pxItems
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE
+ *                                          if the function woke up a higher priority task.
+ *
+ * @note    Equivalent to calling vRingbufferReturnItemFromISR() for each item, but
+ *          only enters the critical section and wakes up a waiting sender once.
+ */
+void vRingbufferReturnMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                      const RingbufferItem_t *pxItems,
+                                      UBaseType_t uxNumItems,
+                                      BaseType_t *pxHigherPriorityTaskWoken);
+
 /**
  * @brief   Delete a ring buffer
  *
@@ -25,6 +25,11 @@
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
 #define rbBUFFER_STATIC_FLAG        ( ( UBaseType_t ) 8 )   //The ring buffer is statically allocated
 #define rbUSING_QUEUE_SET           ( ( UBaseType_t ) 16 )  //The ring buffer has been added to a queue set
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 32 )  //The ring buffer has a single producer and a single consumer, and is lock-free
+
+//SPSC waiting flags
+#define rbSEND_WAITING_FLAG         ( ( UBaseType_t ) 1 )   //The producer may be blocked waiting for free space
+#define rbRECEIVE_WAITING_FLAG      ( ( UBaseType_t ) 2 )   //The consumer may be blocked waiting for data
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
@@ -65,7 +70,10 @@ typedef struct RingbufferDefinition {
     uint8_t *pucHead;                           //Pointer to the start of the ring buffer storage area
     uint8_t *pucTail;                           //Pointer to the end of the ring buffer storage area
 
-    BaseType_t xItemsWaiting;                   //Number of items/bytes(for byte buffers) currently in ring buffer that have not yet been read
+    union {
+        BaseType_t xItemsWaiting;               //Number of items/bytes(for byte buffers) currently in ring buffer that have not yet been read
+        UBaseType_t uxWaitingFlags;             //SPSC buffers don't count items. Instead, sides which may be blocked (SPSC waiting flags)
+    };
     List_t xTasksWaitingToSend;                 //List of tasks that are blocked waiting to send/acquire onto this ring buffer. Stored in priority order.
     List_t xTasksWaitingToReceive;              //List of tasks that are blocked waiting to receive from this ring buffer. Stored in priority order.
     QueueSetHandle_t xQueueSet;                 //Ring buffer's read queue set handle.
@@ -169,6 +177,74 @@ static size_t prvGetCurMaxSizeAllowSplit(Ringbuffer_t *pxRingbuffer);
 //Get the maximum size an item that can currently have if sent to a byte buffer
 static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer);
 
+/*
+ * Single-producer/single-consumer (SPSC) ring buffers. The producer owns pucAcquire and pucWrite,
+ * the consumer owns pucRead and pucFree. Each side publishes its pointer with a release store and
+ * reads the pointer of the other side with an acquire load, so no critical section is needed unless
+ * a side has to block. The buffer is never filled completely (pucAcquire never catches up with
+ * pucFree), so that pucWrite == pucRead always means the buffer is empty.
+ *
+ * Unlike the functions above, the following functions are called outside of any critical section,
+ * but each of them must only be called by its own side (producer or consumer).
+ */
+
+//Switch an initialized no-split or byte buffer to SPSC mode
+static void prvInitializeSPSC(Ringbuffer_t *pxRingbuffer);
+
+//Producer: checks if an item/data will currently fit in an SPSC ring buffer
+static BaseType_t prvCheckItemFitsSPSC(Ringbuffer_t *pxRingbuffer, size_t xItemSize);
+
+//Producer: acquire space for an item in a no-split SPSC buffer. Only call after prvCheckItemFitsSPSC()
+static uint8_t *prvAcquireItemSPSC(Ringbuffer_t *pxRingbuffer, size_t xItemSize);
+
+//Producer: publish an acquired item. Items must be completed in the order they were acquired
+static void prvSendItemDoneSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Producer: copy an item to a no-split SPSC buffer and publish it
+static void prvCopyItemSPSC(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+
+//Producer: copy data to a byte SPSC buffer and publish it
+static void prvCopyItemByteBufSPSC(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+
+//Consumer: retrieve an item/data from an SPSC buffer. Returns NULL if the buffer is empty
+static void *prvGetItemSPSC(Ringbuffer_t *pxRingbuffer,
+                            BaseType_t *pxUnusedParam,
+                            size_t xMaxSize,
+                            size_t *pxItemSize);
+
+//Consumer: return an item to a no-split SPSC buffer. Items must be returned in the order they were retrieved
+static void prvReturnItemSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Consumer: return data to a byte SPSC buffer
+static void prvReturnItemByteBufSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Get the maximum size an item that can currently have if sent to an SPSC buffer
+static size_t prvGetCurMaxSizeSPSC(Ringbuffer_t *pxRingbuffer);
+
+//Count the items (bytes for byte buffers) waiting to be retrieved from an SPSC buffer. Only for debugging
+static UBaseType_t prvGetItemsWaitingSPSC(Ringbuffer_t *pxRingbuffer);
+
+//Wake up the other side of an SPSC buffer if it may be blocked waiting for the pointer which was just published
+static void prvWakeWaitingSPSC(Ringbuffer_t *pxRingbuffer,
+                               UBaseType_t uxWaitingFlag,
+                               List_t *pxTasksWaiting,
+                               BaseType_t xFromISR,
+                               BaseType_t *pxHigherPriorityTaskWoken);
+
+//Send or acquire an item to/from an SPSC buffer, blocking only if there is no space
+static BaseType_t prvSendAcquireSPSC(Ringbuffer_t *pxRingbuffer,
+                                     const void *pvItem,
+                                     void **ppvItem,
+                                     size_t xItemSize,
+                                     TickType_t xTicksToWait);
+
+//Retrieve an item/data from an SPSC buffer, blocking only if it is empty
+static BaseType_t prvReceiveSPSC(Ringbuffer_t *pxRingbuffer,
+                                 void **pvItem,
+                                 size_t *xItemSize,
+                                 size_t xMaxSize,
+                                 TickType_t xTicksToWait);
+
 /*
 Generic function used to send or acquire an item/buffer.
 - If sending, set ppvItem to NULL. pvItem remains unchanged on failure.
@@ -202,6 +278,22 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize);
 
+/*
+Retrieves up to uxMaxItems items from a no-split/allow-split ring buffer without
+blocking. Both parts of a split item are always retrieved together, into two
+consecutive elements of pxItems. Must be called within a critical section unless
+the ring buffer is an SPSC buffer.
+*/
+static UBaseType_t prvGetMultipleItems(Ringbuffer_t *pxRingbuffer,
+                                       RingbufferItem_t *pxItems,
+                                       UBaseType_t uxMaxItems);
+
+//Generic function used to retrieve multiple items, blocking until at least one item is available
+static UBaseType_t prvReceiveMultipleGeneric(Ringbuffer_t *pxRingbuffer,
+                                             RingbufferItem_t *pxItems,
+                                             UBaseType_t uxMaxItems,
+                                             TickType_t xTicksToWait);
+
 // ------------------------------------------------ Static Functions ---------------------------------------------------
 
 static void prvInitializeNewRingbuffer(size_t xBufferSize,
@@ -262,7 +354,14 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
 static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
 {
     size_t xReturn;
-    if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //SPSC buffers are never full, pucAcquire == pucFree means empty
+        BaseType_t xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
+        if (xFreeSize <= 0) {
+            xFreeSize += pxRingbuffer->xSize;
+        }
+        xReturn = xFreeSize;
+    } else if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
         xReturn =  0;
     } else {
         BaseType_t xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
@@ -742,6 +841,398 @@ static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer)
     return xFreeSize;
 }
 
+// ---------------------------------------------- SPSC Static Functions ------------------------------------------------
+
+static void prvInitializeSPSC(Ringbuffer_t *pxRingbuffer)
+{
+    pxRingbuffer->uxRingbufferFlags |= rbSPSC_FLAG;
+    pxRingbuffer->xCheckItemFits = prvCheckItemFitsSPSC;
+    pxRingbuffer->pvGetItem = prvGetItemSPSC;
+    pxRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeSPSC;
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        pxRingbuffer->vCopyItem = prvCopyItemByteBufSPSC;
+        pxRingbuffer->vReturnItem = prvReturnItemByteBufSPSC;
+        //One byte is always kept free
+        pxRingbuffer->xMaxItemSize = pxRingbuffer->xSize - 1;
+    } else {
+        pxRingbuffer->vCopyItem = prvCopyItemSPSC;
+        pxRingbuffer->vReturnItem = prvReturnItemSPSC;
+        /*
+         * Same worst case as no-split buffers (pointers at the halfway point of the buffer), but an
+         * item which wraps around must leave at least one aligned word free before pucFree.
+         */
+        pxRingbuffer->xMaxItemSize = ((pxRingbuffer->xSize / 2) & ~rbALIGN_MASK) - (rbALIGN_MASK + 1) - rbHEADER_SIZE;
+    }
+}
+
+static BaseType_t prvCheckItemFitsSPSC(Ringbuffer_t *pxRingbuffer, size_t xItemSize)
+{
+    uint8_t *pucFree = __atomic_load_n(&pxRingbuffer->pucFree, __ATOMIC_ACQUIRE);
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        BaseType_t xFreeSize = pucFree - pucAcquire;
+        if (xFreeSize <= 0) {
+            xFreeSize += pxRingbuffer->xSize;
+        }
+        //The data must not fill the buffer completely
+        return (xItemSize < xFreeSize) ? pdTRUE : pdFALSE;
+    }
+
+    configASSERT(rbCHECK_ALIGNED(pucAcquire));
+    size_t xTotalItemSize = rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE;    //Rounded up aligned item size with header
+    if (pucAcquire < pucFree) {
+        //Free space does not wrap around
+        return (xTotalItemSize < pucFree - pucAcquire) ? pdTRUE : pdFALSE;
+    }
+    //Free space wraps around, or the buffer is empty
+    if (xTotalItemSize <= pxRingbuffer->pucTail - pucAcquire) {
+        //Item fits without wrapping around. If pucAcquire then wraps around, it must not reach pucFree
+        size_t xRemLen = (pxRingbuffer->pucTail - pucAcquire) - xTotalItemSize;
+        return (xRemLen >= rbHEADER_SIZE || pucFree != pxRingbuffer->pucHead) ? pdTRUE : pdFALSE;
+    }
+    //Item is stored at the head of the buffer, a dummy header is left at pucAcquire
+    return (xTotalItemSize < pucFree - pxRingbuffer->pucHead) ? pdTRUE : pdFALSE;
+}
+
+static uint8_t *prvAcquireItemSPSC(Ringbuffer_t *pxRingbuffer, size_t xItemSize)
+{
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+    size_t xAlignedItemSize = rbALIGN_SIZE(xItemSize);                  //Rounded up aligned item size
+    configASSERT(pxRingbuffer->pucTail - pucAcquire >= rbHEADER_SIZE);  //Remaining length must be able to at least fit an item header
+
+    //If remaining length can't fit item, set as dummy data and wrap around
+    if (pxRingbuffer->pucTail - pucAcquire < xAlignedItemSize + rbHEADER_SIZE) {
+        ItemHeader_t *pxDummy = (ItemHeader_t *)pucAcquire;
+        pxDummy->uxItemFlags = rbITEM_DUMMY_DATA_FLAG;
+        pxDummy->xItemLen = 0;
+        pucAcquire = pxRingbuffer->pucHead;
+    }
+
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pucAcquire;
+    pxHeader->xItemLen = xItemSize;
+    pxHeader->uxItemFlags = 0;
+    uint8_t *pucItem = pucAcquire + rbHEADER_SIZE;
+
+    pucAcquire += rbHEADER_SIZE + xAlignedItemSize;
+    if (pxRingbuffer->pucTail - pucAcquire < rbHEADER_SIZE) {
+        pucAcquire = pxRingbuffer->pucHead;     //Wrap around pucAcquire
+    }
+    //Only read by the consumer for debugging (vRingbufferGetInfo())
+    __atomic_store_n(&pxRingbuffer->pucAcquire, pucAcquire, __ATOMIC_RELAXED);
+    return pucItem;
+}
+
+static void prvSendItemDoneSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    ItemHeader_t *pxHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+    //Items must be completed in order: the item is either at pucWrite, or at the head after a dummy header at pucWrite
+    configASSERT((uint8_t *)pxHeader == pxRingbuffer->pucWrite ||
+                 ((uint8_t *)pxHeader == pxRingbuffer->pucHead && (((ItemHeader_t *)pxRingbuffer->pucWrite)->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)));
+    configASSERT((pxHeader->uxItemFlags & rbITEM_WRITTEN_FLAG) == 0);      //Indicates item has already been written before
+    pxHeader->uxItemFlags |= rbITEM_WRITTEN_FLAG;
+
+    uint8_t *pucWrite = pucItem + rbALIGN_SIZE(pxHeader->xItemLen);
+    if (pxRingbuffer->pucTail - pucWrite < rbHEADER_SIZE) {
+        pucWrite = pxRingbuffer->pucHead;
+    }
+    //Publish the item to the consumer
+    __atomic_store_n(&pxRingbuffer->pucWrite, pucWrite, __ATOMIC_RELEASE);
+}
+
+static void prvCopyItemSPSC(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    uint8_t *pucDest = prvAcquireItemSPSC(pxRingbuffer, xItemSize);
+    memcpy(pucDest, pucItem, xItemSize);
+    prvSendItemDoneSPSC(pxRingbuffer, pucDest);
+}
+
+static void prvCopyItemByteBufSPSC(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+    size_t xRemLen = pxRingbuffer->pucTail - pucAcquire;
+
+    //Copy data up to the end of the buffer first if it wraps around
+    if (xRemLen <= xItemSize) {
+        memcpy(pucAcquire, pucItem, xRemLen);
+        pucItem += xRemLen;
+        xItemSize -= xRemLen;
+        pucAcquire = pxRingbuffer->pucHead;
+    }
+    memcpy(pucAcquire, pucItem, xItemSize);
+    pucAcquire += xItemSize;
+
+    __atomic_store_n(&pxRingbuffer->pucAcquire, pucAcquire, __ATOMIC_RELAXED);
+    //Publish the data to the consumer
+    __atomic_store_n(&pxRingbuffer->pucWrite, pucAcquire, __ATOMIC_RELEASE);
+}
+
+static void *prvGetItemSPSC(Ringbuffer_t *pxRingbuffer,
+                            BaseType_t *pxUnusedParam,
+                            size_t xMaxSize,
+                            size_t *pxItemSize)
+{
+    uint8_t *pucWrite = __atomic_load_n(&pxRingbuffer->pucWrite, __ATOMIC_ACQUIRE);
+    uint8_t *pucRead = pxRingbuffer->pucRead;
+    uint8_t *pucItem;
+
+    if (pucRead == pucWrite) {
+        return NULL;    //Buffer is empty
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //Return contiguous data from the read pointer until the write pointer or the buffer tail, or xMaxSize
+        size_t xSize = ((pucRead < pucWrite) ? pucWrite : pxRingbuffer->pucTail) - pucRead;
+        if (xMaxSize != 0 && xSize > xMaxSize) {
+            xSize = xMaxSize;
+        }
+        pucItem = pucRead;
+        *pxItemSize = xSize;
+        pucRead += xSize;
+        if (pucRead == pxRingbuffer->pucTail) {
+            pucRead = pxRingbuffer->pucHead;
+        }
+    } else {
+        ItemHeader_t *pxHeader = (ItemHeader_t *)pucRead;
+        if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            //Dummy data until the end of the buffer, the item was stored at the head
+            pxHeader = (ItemHeader_t *)pxRingbuffer->pucHead;
+        }
+        configASSERT(pxHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+        pucItem = (uint8_t *)pxHeader + rbHEADER_SIZE;
+        *pxItemSize = pxHeader->xItemLen;
+        pucRead = pucItem + rbALIGN_SIZE(pxHeader->xItemLen);
+        if (pxRingbuffer->pucTail - pucRead < rbHEADER_SIZE) {
+            pucRead = pxRingbuffer->pucHead;
+        }
+    }
+    //Only read by the producer for debugging (vRingbufferGetInfo())
+    __atomic_store_n(&pxRingbuffer->pucRead, pucRead, __ATOMIC_RELAXED);
+    return pucItem;
+}
+
+static void prvReturnItemSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    uint8_t *pucFree = pxRingbuffer->pucFree;
+    if (((ItemHeader_t *)pucFree)->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+        pucFree = pxRingbuffer->pucHead;    //Skip over dummy data
+    }
+    //Items must be returned in the order they were retrieved
+    configASSERT(pucItem == pucFree + rbHEADER_SIZE);
+
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pucFree;
+    pucFree = pucItem + rbALIGN_SIZE(pxHeader->xItemLen);
+    if (pxRingbuffer->pucTail - pucFree < rbHEADER_SIZE) {
+        pucFree = pxRingbuffer->pucHead;
+    }
+    //Release the space to the producer
+    __atomic_store_n(&pxRingbuffer->pucFree, pucFree, __ATOMIC_RELEASE);
+}
+
+static void prvReturnItemByteBufSPSC(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    //Check pointer points to address inside buffer
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem < pxRingbuffer->pucTail);
+    //Byte buffers do not allow multiple outstanding reads, release everything which was read
+    __atomic_store_n(&pxRingbuffer->pucFree, pxRingbuffer->pucRead, __ATOMIC_RELEASE);
+}
+
+static size_t prvGetCurMaxSizeSPSC(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucFree = __atomic_load_n(&pxRingbuffer->pucFree, __ATOMIC_ACQUIRE);
+    uint8_t *pucAcquire = __atomic_load_n(&pxRingbuffer->pucAcquire, __ATOMIC_RELAXED);
+    BaseType_t xFreeSize;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        xFreeSize = pucFree - pucAcquire;
+        if (xFreeSize <= 0) {
+            xFreeSize += pxRingbuffer->xSize;
+        }
+        return xFreeSize - 1;   //One byte is always kept free
+    }
+
+    if (pucAcquire < pucFree) {
+        //Free space is contiguous, an aligned word is kept free before pucFree
+        xFreeSize = (pucFree - pucAcquire) - (rbALIGN_MASK + 1);
+    } else {
+        //Free space wraps around, select largest contiguous free space. An item ending at the tail
+        //wraps pucAcquire around, which must then not reach pucFree
+        BaseType_t xSize1 = pxRingbuffer->pucTail - pucAcquire;
+        if (pucFree == pxRingbuffer->pucHead) {
+            xSize1 -= rbHEADER_SIZE;
+        }
+        BaseType_t xSize2 = (pucFree - pxRingbuffer->pucHead) - (rbALIGN_MASK + 1);
+        xFreeSize = (xSize1 > xSize2) ? xSize1 : xSize2;
+    }
+    xFreeSize -= rbHEADER_SIZE;
+
+    if (xFreeSize < 0) {
+        xFreeSize = 0;
+    } else if (xFreeSize > pxRingbuffer->xMaxItemSize) {
+        xFreeSize = pxRingbuffer->xMaxItemSize;
+    }
+    return xFreeSize;
+}
+
+static UBaseType_t prvGetItemsWaitingSPSC(Ringbuffer_t *pxRingbuffer)
+{
+    uint8_t *pucWrite = __atomic_load_n(&pxRingbuffer->pucWrite, __ATOMIC_ACQUIRE);
+    uint8_t *pucRead = __atomic_load_n(&pxRingbuffer->pucRead, __ATOMIC_RELAXED);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        BaseType_t xSize = pucWrite - pucRead;
+        return (xSize < 0) ? xSize + pxRingbuffer->xSize : xSize;
+    }
+
+    //SPSC buffers don't count items when sending and receiving, walk over the item headers
+    UBaseType_t uxItems = 0;
+    while (pucRead != pucWrite) {
+        ItemHeader_t *pxHeader = (ItemHeader_t *)pucRead;
+        if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pucRead = pxRingbuffer->pucHead;
+            continue;
+        }
+        uxItems++;
+        pucRead += rbHEADER_SIZE + rbALIGN_SIZE(pxHeader->xItemLen);
+        if (pxRingbuffer->pucTail - pucRead < rbHEADER_SIZE) {
+            pucRead = pxRingbuffer->pucHead;
+        }
+    }
+    return uxItems;
+}
+
+static void prvWakeWaitingSPSC(Ringbuffer_t *pxRingbuffer,
+                               UBaseType_t uxWaitingFlag,
+                               List_t *pxTasksWaiting,
+                               BaseType_t xFromISR,
+                               BaseType_t *pxHigherPriorityTaskWoken)
+{
+    /*
+     * The waiting side sets its flag and then checks the pointer again, the notifying side
+     * publishes its pointer and then checks the flag. The full barriers ensure that at least
+     * one of them sees the other's write, so a wake up can't be missed.
+     */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if ((__atomic_load_n(&pxRingbuffer->uxWaitingFlags, __ATOMIC_RELAXED) & uxWaitingFlag) == 0) {
+        return;     //Fast path, nobody is waiting
+    }
+
+    if (xFromISR) {
+        portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+    }
+    __atomic_fetch_and(&pxRingbuffer->uxWaitingFlags, ~uxWaitingFlag, __ATOMIC_RELAXED);
+    if (listLIST_IS_EMPTY(pxTasksWaiting) == pdFALSE) {
+        if (xTaskRemoveFromEventList(pxTasksWaiting) == pdTRUE) {
+            if (xFromISR) {
+                //The unblocked task will preempt us. Record that a context switch is required.
+                if (pxHigherPriorityTaskWoken != NULL) {
+                    *pxHigherPriorityTaskWoken = pdTRUE;
+                }
+            } else {
+                //The unblocked task will preempt us. Trigger a yield here.
+                portYIELD_WITHIN_API();
+            }
+        }
+    }
+    if (xFromISR) {
+        portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+}
+
+static BaseType_t prvSendAcquireSPSC(Ringbuffer_t *pxRingbuffer,
+                                     const void *pvItem,
+                                     void **ppvItem,
+                                     size_t xItemSize,
+                                     TickType_t xTicksToWait)
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    BaseType_t xTimedOut = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    while (prvCheckItemFitsSPSC(pxRingbuffer, xItemSize) == pdFALSE) {
+        if (xTicksToWait == (TickType_t) 0 || xTimedOut == pdTRUE) {
+            return pdFALSE;
+        }
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Tell the consumer we are waiting, then check again in case space was freed meanwhile
+            __atomic_fetch_or(&pxRingbuffer->uxWaitingFlags, rbSEND_WAITING_FLAG, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (prvCheckItemFitsSPSC(pxRingbuffer, xItemSize) == pdFALSE) {
+                //Not timed out yet. Block the current task
+                vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToSend, xTicksToWait);
+                portYIELD_WITHIN_API();
+            }
+        } else {
+            //We have timed out, check one last time
+            xTimedOut = pdTRUE;
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    if (ppvItem) {
+        //Acquire the buffer, it's published by xRingbufferSendComplete()
+        *ppvItem = prvAcquireItemSPSC(pxRingbuffer, xItemSize);
+    } else {
+        pxRingbuffer->vCopyItem(pxRingbuffer, pvItem, xItemSize);
+        prvWakeWaitingSPSC(pxRingbuffer, rbRECEIVE_WAITING_FLAG, &pxRingbuffer->xTasksWaitingToReceive, pdFALSE, NULL);
+    }
+    return pdTRUE;
+}
+
+static BaseType_t prvReceiveSPSC(Ringbuffer_t *pxRingbuffer,
+                                 void **pvItem,
+                                 size_t *xItemSize,
+                                 size_t xMaxSize,
+                                 TickType_t xTicksToWait)
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    BaseType_t xTimedOut = pdFALSE;
+    TimeOut_t xTimeOut;
+    void *pvTempItem;
+
+    while ((pvTempItem = prvGetItemSPSC(pxRingbuffer, NULL, xMaxSize, xItemSize)) == NULL) {
+        if (xTicksToWait == (TickType_t) 0 || xTimedOut == pdTRUE) {
+            return pdFALSE;
+        }
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Tell the producer we are waiting, then check again in case data was sent meanwhile
+            __atomic_fetch_or(&pxRingbuffer->uxWaitingFlags, rbRECEIVE_WAITING_FLAG, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&pxRingbuffer->pucWrite, __ATOMIC_ACQUIRE) == pxRingbuffer->pucRead) {
+                //Not timed out yet. Block the current task
+                vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToReceive, xTicksToWait);
+                portYIELD_WITHIN_API();
+            }
+        } else {
+            //We have timed out, check one last time
+            xTimedOut = pdTRUE;
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    *pvItem = pvTempItem;
+    return pdTRUE;
+}
+
+// ---------------------------------------------- Generic Static Functions ---------------------------------------------
+
 static BaseType_t prvSendAcquireGeneric(Ringbuffer_t *pxRingbuffer,
                                         const void *pvItem,
                                         void **ppvItem,
@@ -829,6 +1320,11 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer,
     }
 #endif /*__clang_analyzer__ */
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //SPSC buffers never split items
+        return prvReceiveSPSC(pxRingbuffer, pvItem1, xItemSize1, xMaxSize, xTicksToWait);
+    }
+
     while (xExitLoop == pdFALSE) {
         portENTER_CRITICAL(&pxRingbuffer->mux);
         if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
@@ -895,6 +1391,15 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     }
 #endif /*__clang_analyzer__ */
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        void *pvTempItem = prvGetItemSPSC(pxRingbuffer, NULL, xMaxSize, xItemSize1);
+        if (pvTempItem == NULL) {
+            return pdFALSE;
+        }
+        *pvItem1 = pvTempItem;
+        return pdTRUE;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
         BaseType_t xIsSplit = pdFALSE;
@@ -924,6 +1429,94 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     return xReturn;
 }
 
+static UBaseType_t prvGetMultipleItems(Ringbuffer_t *pxRingbuffer,
+                                       RingbufferItem_t *pxItems,
+                                       UBaseType_t uxMaxItems)
+{
+    UBaseType_t uxNumItems = 0;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        while (uxNumItems < uxMaxItems) {
+            void *pvItem = prvGetItemSPSC(pxRingbuffer, NULL, 0, &pxItems[uxNumItems].xItemSize);
+            if (pvItem == NULL) {
+                break;      //No more items
+            }
+            pxItems[uxNumItems++].pvItem = pvItem;
+        }
+        return uxNumItems;
+    }
+
+    while (uxNumItems < uxMaxItems && prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+        BaseType_t xIsSplit = pdFALSE;
+        if (pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) {
+            //Stop if both parts of the next item would not fit into pxItems
+            ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucRead;
+            if ((pxHeader->uxItemFlags & rbITEM_SPLIT_FLAG) && (uxMaxItems - uxNumItems) < 2) {
+                break;
+            }
+        }
+        pxItems[uxNumItems].pvItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItems[uxNumItems].xItemSize);
+        uxNumItems++;
+        if (xIsSplit == pdTRUE) {
+            pxItems[uxNumItems].pvItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItems[uxNumItems].xItemSize);
+            configASSERT(pxItems[uxNumItems].pvItem < pxItems[uxNumItems - 1].pvItem);  //Check wrap around has occurred
+            configASSERT(xIsSplit == pdFALSE);  //Second part should not have wrapped flag
+            uxNumItems++;
+        }
+    }
+    return uxNumItems;
+}
+
+static UBaseType_t prvReceiveMultipleGeneric(Ringbuffer_t *pxRingbuffer,
+                                             RingbufferItem_t *pxItems,
+                                             UBaseType_t uxMaxItems,
+                                             TickType_t xTicksToWait)
+{
+    UBaseType_t uxNumItems = 0;
+    BaseType_t xExitLoop = pdFALSE;
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //Only block for the first item, then take whatever else is already available
+        if (prvReceiveSPSC(pxRingbuffer, &pxItems[0].pvItem, &pxItems[0].xItemSize, 0, xTicksToWait) == pdFALSE) {
+            return 0;
+        }
+        return 1 + prvGetMultipleItems(pxRingbuffer, &pxItems[1], uxMaxItems - 1);
+    }
+
+    while (xExitLoop == pdFALSE) {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+            //Items are available for retrieval, take as many as possible
+            uxNumItems = prvGetMultipleItems(pxRingbuffer, pxItems, uxMaxItems);
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToReceive, xTicksToWait);
+            portYIELD_WITHIN_API();
+        } else {
+            //We have timed out.
+            xExitLoop = pdTRUE;
+        }
+loop_end:
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    return uxNumItems;
+}
+
 // ------------------------------------------------ Public Functions ---------------------------------------------------
 
 RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType)
@@ -956,6 +1549,17 @@ RingbufHandle_t xRingbufferCreateNoSplit(size_t xItemSize, size_t xItemNum)
     return xRingbufferCreate((rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE) * xItemNum, RINGBUF_TYPE_NOSPLIT);
 }
 
+RingbufHandle_t xRingbufferCreateSPSC(size_t xBufferSize, RingbufferType_t xBufferType)
+{
+    configASSERT(xBufferType == RINGBUF_TYPE_NOSPLIT || xBufferType == RINGBUF_TYPE_BYTEBUF);
+
+    Ringbuffer_t *pxNewRingbuffer = (Ringbuffer_t *)xRingbufferCreate(xBufferSize, xBufferType);
+    if (pxNewRingbuffer != NULL) {
+        prvInitializeSPSC(pxNewRingbuffer);
+    }
+    return (RingbufHandle_t)pxNewRingbuffer;
+}
+
 RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
                                         RingbufferType_t xBufferType,
                                         uint8_t *pucRingbufferStorage,
@@ -976,6 +1580,18 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
     return (RingbufHandle_t)pxNewRingbuffer;
 }
 
+RingbufHandle_t xRingbufferCreateStaticSPSC(size_t xBufferSize,
+                                            RingbufferType_t xBufferType,
+                                            uint8_t *pucRingbufferStorage,
+                                            StaticRingbuffer_t *pxStaticRingbuffer)
+{
+    configASSERT(xBufferType == RINGBUF_TYPE_NOSPLIT || xBufferType == RINGBUF_TYPE_BYTEBUF);
+
+    Ringbuffer_t *pxNewRingbuffer = (Ringbuffer_t *)xRingbufferCreateStatic(xBufferSize, xBufferType, pucRingbufferStorage, pxStaticRingbuffer);
+    prvInitializeSPSC(pxNewRingbuffer);
+    return (RingbufHandle_t)pxNewRingbuffer;
+}
+
 BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -993,6 +1609,9 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSendAcquireSPSC(pxRingbuffer, NULL, ppvItem, xItemSize, xTicksToWait);
+    }
     return prvSendAcquireGeneric(pxRingbuffer, NULL, ppvItem, xItemSize, xTicksToWait);
 }
 
@@ -1006,6 +1625,12 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
     configASSERT(pvItem != NULL);
     configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSendItemDoneSPSC(pxRingbuffer, pvItem);
+        prvWakeWaitingSPSC(pxRingbuffer, rbRECEIVE_WAITING_FLAG, &pxRingbuffer->xTasksWaitingToReceive, pdFALSE, NULL);
+        return pdTRUE;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     prvSendItemDoneNoSplit(pxRingbuffer, pvItem);
     if (pxRingbuffer->xQueueSet) {
@@ -1045,6 +1670,9 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSendAcquireSPSC(pxRingbuffer, pvItem, NULL, xItemSize, xTicksToWait);
+    }
     return prvSendAcquireGeneric(pxRingbuffer, pvItem, NULL, xItemSize, xTicksToWait);
 }
 
@@ -1067,6 +1695,15 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        if (prvCheckItemFitsSPSC(pxRingbuffer, xItemSize) == pdFALSE) {
+            return pdFALSE;
+        }
+        pxRingbuffer->vCopyItem(pxRingbuffer, pvItem, xItemSize);
+        prvWakeWaitingSPSC(pxRingbuffer, rbRECEIVE_WAITING_FLAG, &pxRingbuffer->xTasksWaitingToReceive, pdTRUE, pxHigherPriorityTaskWoken);
+        return pdTRUE;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     if (pxRingbuffer->xCheckItemFits(xRingbuffer, xItemSize) == pdTRUE) {
         pxRingbuffer->vCopyItem(xRingbuffer, pvItem, xItemSize);
@@ -1202,12 +1839,59 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     }
 }
 
+UBaseType_t xRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer,
+                                       RingbufferItem_t *pxItems,
+                                       UBaseType_t uxMaxItems,
+                                       TickType_t xTicksToWait)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+
+    //Check arguments
+    configASSERT(pxRingbuffer && pxItems);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) == 0);    //Byte buffers do not allow multiple retrievals
+    configASSERT(uxMaxItems >= ((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) ? 2 : 1));
+
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+    return prvReceiveMultipleGeneric(pxRingbuffer, pxItems, uxMaxItems, xTicksToWait);
+}
+
+UBaseType_t xRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                              RingbufferItem_t *pxItems,
+                                              UBaseType_t uxMaxItems)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    UBaseType_t uxNumItems;
+
+    //Check arguments
+    configASSERT(pxRingbuffer && pxItems);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) == 0);    //Byte buffers do not allow multiple retrievals
+    configASSERT(uxMaxItems >= ((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) ? 2 : 1));
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvGetMultipleItems(pxRingbuffer, pxItems, uxMaxItems);
+    }
+
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    uxNumItems = prvGetMultipleItems(pxRingbuffer, pxItems, uxMaxItems);
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+
+    return uxNumItems;
+}
+
 void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        prvWakeWaitingSPSC(pxRingbuffer, rbSEND_WAITING_FLAG, &pxRingbuffer->xTasksWaitingToSend, pdFALSE, NULL);
+        return;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1226,6 +1910,12 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        prvWakeWaitingSPSC(pxRingbuffer, rbSEND_WAITING_FLAG, &pxRingbuffer->xTasksWaitingToSend, pdTRUE, pxHigherPriorityTaskWoken);
+        return;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1240,6 +1930,75 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
 }
 
+void vRingbufferReturnMultiple(RingbufHandle_t xRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxNumItems)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxNumItems == 0);
+
+    if (uxNumItems == 0) {
+        return;
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        for (UBaseType_t i = 0; i < uxNumItems; i++) {
+            pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+        }
+        prvWakeWaitingSPSC(pxRingbuffer, rbSEND_WAITING_FLAG, &pxRingbuffer->xTasksWaitingToSend, pdFALSE, NULL);
+        return;
+    }
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxNumItems; i++) {
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+    }
+    //If a task was waiting for space to send, unblock it immediately.
+    if (listLIST_IS_EMPTY(&pxRingbuffer->xTasksWaitingToSend) == pdFALSE) {
+        if (xTaskRemoveFromEventList(&pxRingbuffer->xTasksWaitingToSend) == pdTRUE) {
+            //The unblocked task will preempt us. Trigger a yield here.
+            portYIELD_WITHIN_API();
+        }
+    }
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+}
+
+void vRingbufferReturnMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                      const RingbufferItem_t *pxItems,
+                                      UBaseType_t uxNumItems,
+                                      BaseType_t *pxHigherPriorityTaskWoken)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxNumItems == 0);
+
+    if (uxNumItems == 0) {
+        return;
+    }
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        for (UBaseType_t i = 0; i < uxNumItems; i++) {
+            pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+        }
+        prvWakeWaitingSPSC(pxRingbuffer, rbSEND_WAITING_FLAG, &pxRingbuffer->xTasksWaitingToSend, pdTRUE, pxHigherPriorityTaskWoken);
+        return;
+    }
+
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxNumItems; i++) {
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+    }
+    //If a task was waiting for space to send, unblock it immediately.
+    if (listLIST_IS_EMPTY(&pxRingbuffer->xTasksWaitingToSend) == pdFALSE) {
+        if (xTaskRemoveFromEventList(&pxRingbuffer->xTasksWaitingToSend) == pdTRUE) {
+            //The unblocked task will preempt us. Record that a context switch is required.
+            if (pxHigherPriorityTaskWoken != NULL) {
+                *pxHigherPriorityTaskWoken = pdTRUE;
+            }
+        }
+    }
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+}
+
 void vRingbufferDelete(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1282,8 +2041,9 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
     configASSERT(pxRingbuffer && xQueueSet);
 
     portENTER_CRITICAL(&pxRingbuffer->mux);
-    if (pxRingbuffer->xQueueSet != NULL || prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+    if (pxRingbuffer->xQueueSet != NULL || prvCheckItemAvail(pxRingbuffer) == pdTRUE || (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG)) {
         /*
+        - SPSC ring buffers don't support queue sets
         - Cannot add ring buffer to more than one queue set
         - It is dangerous to add a ring buffer to a queue set if the ring buffer currently has data to be read.
         */
@@ -1346,7 +2106,11 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
         *uxAcquire = (UBaseType_t)(pxRingbuffer->pucAcquire - pxRingbuffer->pucHead);
     }
     if (uxItemsWaiting != NULL) {
-        *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+            *uxItemsWaiting = prvGetItemsWaitingSPSC(pxRingbuffer);
+        } else {
+            *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        }
     }
     portEXIT_CRITICAL(&pxRingbuffer->mux);
 }
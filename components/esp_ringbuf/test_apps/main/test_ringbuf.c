@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -795,6 +795,66 @@ TEST_CASE("Test ring buffer ISR", "[esp_ringbuf]")
     }
 }
 
+/* ------------------------ Test ring buffer receive multiple ------------------
+ * The following test case tests retrieving and returning multiple items at once
+ * on no-split, allow-split and SPSC buffers. The items are sent such that they
+ * wrap around the end of the buffer, which splits an item in allow-split buffers.
+ */
+
+#define MULTI_TEST_NUM_ITEMS    5
+#define MULTI_TEST_MAX_ITEMS    8
+
+static UBaseType_t receive_multiple_and_check(RingbufHandle_t handle, UBaseType_t max_items, size_t *offset)
+{
+    RingbufferItem_t items[MULTI_TEST_MAX_ITEMS];
+    UBaseType_t num_items = xRingbufferReceiveMultiple(handle, items, max_items, 0);
+    TEST_ASSERT_MESSAGE(num_items <= max_items, "Received too many items");
+    for (int i = 0; i < num_items; i++) {
+        //Parts of a split item are consecutive, reassemble large_item from them
+        TEST_ASSERT_MESSAGE(*offset + items[i].xItemSize <= LARGE_ITEM_SIZE, "Received item is too large");
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(&large_item[*offset], items[i].pvItem, items[i].xItemSize);
+        *offset = (*offset + items[i].xItemSize) % LARGE_ITEM_SIZE;
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(0, *offset, "Split item was not received completely");
+    vRingbufferReturnMultiple(handle, items, num_items);
+    return num_items;
+}
+
+TEST_CASE("Test ring buffer receive multiple", "[esp_ringbuf]")
+{
+    RingbufHandle_t handles[] = {
+        xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT),
+        xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_ALLOWSPLIT),
+        xRingbufferCreateSPSC(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT),
+    };
+    for (int i = 0; i < sizeof(handles) / sizeof(handles[0]); i++) {
+        TEST_ASSERT_MESSAGE(handles[i] != NULL, "Failed to create ring buffer");
+        bool allow_split = (i == 1);
+        size_t offset = 0;
+
+        //Move the read and write pointers so that the following items wrap around
+        for (int j = 0; j < 3; j++) {
+            send_item_and_check(handles[i], large_item, LARGE_ITEM_SIZE, TIMEOUT_TICKS, false);
+        }
+        TEST_ASSERT_EQUAL(3, receive_multiple_and_check(handles[i], MULTI_TEST_MAX_ITEMS, &offset));
+
+        for (int j = 0; j < MULTI_TEST_NUM_ITEMS; j++) {
+            send_item_and_check(handles[i], large_item, LARGE_ITEM_SIZE, TIMEOUT_TICKS, false);
+        }
+        TEST_ASSERT_EQUAL(2, receive_multiple_and_check(handles[i], 2, &offset));
+        //In allow-split buffers, the 4th item is split and both of its parts are retrieved together
+        TEST_ASSERT_EQUAL(allow_split ? 1 : 2, receive_multiple_and_check(handles[i], 2, &offset));
+        TEST_ASSERT_EQUAL(allow_split ? 3 : 1, receive_multiple_and_check(handles[i], MULTI_TEST_MAX_ITEMS, &offset));
+
+        //Buffer should now be empty
+        TEST_ASSERT_EQUAL(0, receive_multiple_and_check(handles[i], MULTI_TEST_MAX_ITEMS, &offset));
+        UBaseType_t items_waiting;
+        vRingbufferGetInfo(handles[i], NULL, NULL, NULL, NULL, &items_waiting);
+        TEST_ASSERT_EQUAL(0, items_waiting);
+        vRingbufferDelete(handles[i]);
+    }
+}
+
 /* ---------------------------- Test ring buffer SMP ---------------------------
  * The following test case tests each type of ring buffer in an SMP fashion. A
  * sending task and a receiving task is created. The sending task will split
@@ -1019,6 +1079,48 @@ TEST_CASE("Test static ring buffer SMP", "[esp_ringbuf]")
 }
 #endif
 
+TEST_CASE("Test SPSC ring buffer SMP", "[esp_ringbuf]")
+{
+    setup();
+    //SPSC mode supports no split and byte buffers only
+    const RingbufferType_t buf_types[] = {RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_BYTEBUF};
+    for (int type_idx = 0; type_idx < sizeof(buf_types) / sizeof(buf_types[0]); type_idx++) {
+        RingbufferType_t buf_type = buf_types[type_idx];
+        //Create buffer
+        task_args_t task_args;
+        task_args.buffer = xRingbufferCreateSPSC(CONT_DATA_TEST_BUFF_LEN, buf_type);
+        task_args.type = buf_type;
+        TEST_ASSERT_MESSAGE(task_args.buffer != NULL, "Failed to create ring buffer");
+
+        for (int prior_mod = -1; prior_mod < 2; prior_mod++) {  //Test different relative priorities
+            //Test every permutation of core affinity
+            for (int send_core = 0; send_core < portNUM_PROCESSORS; send_core++) {
+                for (int rec_core = 0; rec_core < portNUM_PROCESSORS; rec_core ++) {
+                    esp_rom_printf("Type: %d, PM: %d, SC: %d, RC: %d\n", buf_type, prior_mod, send_core, rec_core);
+                    xTaskCreatePinnedToCore(send_task, "send tsk", 2048, (void *)&task_args, 10 + prior_mod, NULL, send_core);
+                    xTaskCreatePinnedToCore(rec_task, "rec tsk", 2048, (void *)&task_args, 10, NULL, rec_core);
+                    xSemaphoreTake(tasks_done, portMAX_DELAY);
+                    vTaskDelay(5);  //Allow idle to clean up
+                }
+            }
+        }
+        //Check that all items have been retrieved
+        UBaseType_t items_waiting;
+        vRingbufferGetInfo(task_args.buffer, NULL, NULL, NULL, NULL, &items_waiting);
+        TEST_ASSERT_EQUAL(0, items_waiting);
+
+        //SPSC buffers cannot be added to a queue set
+        QueueSetHandle_t queue_set = xQueueCreateSet(1);
+        TEST_ASSERT_EQUAL(pdFALSE, xRingbufferAddToQueueSetRead(task_args.buffer, queue_set));
+        vQueueDelete(queue_set);
+
+        //Delete ring buffer
+        vRingbufferDelete(task_args.buffer);
+        vTaskDelay(10);
+    }
+    cleanup();
+}
+
 #if !CONFIG_RINGBUF_PLACE_FUNCTIONS_INTO_FLASH && !CONFIG_RINGBUF_PLACE_ISR_FUNCTIONS_INTO_FLASH
 /* -------------------------- Test ring buffer IRAM ------------------------- */
 
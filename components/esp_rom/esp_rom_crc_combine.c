@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * esp_rom_crc32_le_combine() only needs arithmetic modulo the CRC32 polynomial, not the CRC tables,
+ * so one implementation is shared by the Linux and the chip targets.
+ */
+
+#include <stdint.h>
+#include "esp_rom_crc.h"
+
+/* Product of a and b modulo the CRC32 polynomial, bit-reflected: bit 31 is x^0 */
+static uint32_t crc32_le_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+    for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+        if (a & m) {
+            product ^= b;
+        }
+        b = (b & 1) ? (b >> 1) ^ 0xedb88320 : b >> 1;
+    }
+    return product;
+}
+
+uint32_t esp_rom_crc32_le_combine(uint32_t crc1, uint32_t crc2, uint32_t len2)
+{
+    // crc1 shifted over len2 zero bytes: crc1 * x^(8 * len2)
+    uint32_t shift = 1u << 31;
+    for (uint32_t square = 1u << 23; len2 != 0; len2 >>= 1) {
+        if (len2 & 1) {
+            shift = crc32_le_multmodp(square, shift);
+        }
+        square = crc32_le_multmodp(square, square);
+    }
+    return crc32_le_multmodp(shift, crc1) ^ crc2;
+}
@@ -58,6 +58,63 @@ TEST_CASE("crc quick check")
     CHECK(result == expected_result);
 }
 
+// Bit-by-bit reference implementations, with the same ~ before and after as the ROM API
+static uint32_t crc32_le_bitwise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t crc32_be_bitwise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint32_t) buf[i] << 24;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return ~crc;
+}
+
+TEST_CASE("crc32 matches bitwise calculation for all lengths and alignments")
+{
+    uint8_t buf[600];
+    srand(1);
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = rand();
+    }
+    // Covers the byte-wise tail, the 8 byte slices and the 64 byte folding on hosts which have it
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t len = 0; len <= sizeof(buf) - offset; len += (len < 200) ? 1 : 37) {
+            uint32_t init = rand();
+            CHECK(esp_rom_crc32_le(init, buf + offset, len) == crc32_le_bitwise(init, buf + offset, len));
+            CHECK(esp_rom_crc32_be(init, buf + offset, len) == crc32_be_bitwise(init, buf + offset, len));
+        }
+    }
+}
+
+TEST_CASE("crc32 of two buffers can be combined")
+{
+    uint8_t buf[1000];
+    srand(2);
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = rand();
+    }
+    for (size_t len1 = 0; len1 <= sizeof(buf); len1 += 111) {
+        size_t len2 = sizeof(buf) - len1;
+        uint32_t crc1 = esp_rom_crc32_le(0xffffffff, buf, len1);
+        uint32_t crc2 = esp_rom_crc32_le(0, buf + len1, len2);
+        CHECK(esp_rom_crc32_le_combine(crc1, crc2, len2) == esp_rom_crc32_le(0xffffffff, buf, sizeof(buf)));
+    }
+}
+
 TEST_CASE("reset reason basic check")
 {
     CHECK(esp_rom_get_reset_reason(0) == RESET_REASON_CHIP_POWER_ON);
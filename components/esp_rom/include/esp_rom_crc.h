@@ -1,16 +1,8 @@
-// Copyright 2010-2020 Espressif Systems (Shanghai) PTE LTD
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//     http://www.apache.org/licenses/LICENSE-2.0
-//
-// Unless required by applicable law or agreed to in writing, software
-// distributed under the License is distributed on an "AS IS" BASIS,
-// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-// See the License for the specific language governing permissions and
-// limitations under the License.
+/*
+ * SPDX-FileCopyrightText: 2010-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
 
 #pragma once
 
@@ -79,6 +71,23 @@ uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
  */
 uint32_t esp_rom_crc32_be(uint32_t crc, uint8_t const *buf, uint32_t len);
 
+/**
+ * @brief Combine CRC32 values (little endian) of two consecutive data buffers.
+ *
+ * Gives the same result as calculating the CRC over both buffers:
+ *     crc = esp_rom_crc32_le(init, buf1, len1);
+ *     crc = esp_rom_crc32_le(crc, buf2, len2);
+ * is equal to
+ *     crc = esp_rom_crc32_le_combine(esp_rom_crc32_le(init, buf1, len1), esp_rom_crc32_le(0, buf2, len2), len2);
+ * so that parts of the data can be processed independently, or in parallel.
+ *
+ * @param crc1: CRC32 value of the first buffer
+ * @param crc2: CRC32 value of the second buffer, calculated with initial value 0
+ * @param len2: Length of the second buffer
+ * @return CRC32 value of the first buffer followed by the second one
+ */
+uint32_t esp_rom_crc32_le_combine(uint32_t crc1, uint32_t crc2, uint32_t len2);
+
 /**
  * @brief CRC16 value in little endian.
  *
@@ -1,19 +1,29 @@
-// Copyright 2021 Espressif Systems (Shanghai) CO LTD
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//     http://www.apache.org/licenses/LICENSE-2.0
-//
-// Unless required by applicable law or agreed to in writing, software
-// distributed under the License is distributed on an "AS IS" BASIS,
-// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-// See the License for the specific language governing permissions and
-// limitations under the License.
+/*
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
 
+/*
+ * CRC32 is computed 8 bytes at a time, using "slicing-by-8" tables derived from the
+ * byte-wise tables below. Where the host CPU has CRC32 or carry-less multiply
+ * instructions (ARMv8 CRC extension, x86-64 PCLMULQDQ), CRC32 LE uses those instead.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
 #include "esp_rom_crc.h"
 
+#if defined(__ARM_FEATURE_CRC32) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define CRC32_LE_ARM 1
+#include <arm_acle.h>
+#elif defined(__x86_64__) && defined(__GNUC__)
+#define CRC32_LE_PCLMUL 1
+#include <immintrin.h>
+#endif
+
 static const uint32_t crc32_le_table[256] = {
     0x00000000L, 0x77073096L, 0xee0e612cL, 0x990951baL, 0x076dc419L, 0x706af48fL, 0xe963a535L, 0x9e6495a3L,
     0x0edb8832L, 0x79dcb8a4L, 0xe0d5e91eL, 0x97d2d988L, 0x09b64c2bL, 0x7eb17cbdL, 0xe7b82d07L, 0x90bf1d91L,
@@ -163,26 +173,170 @@ static uint8_t crc8_be_table[256] = {
     0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
 };
 
-uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const * buf,uint32_t len)
+/* crc32_xx_slice[0] is a copy of crc32_xx_table, crc32_xx_slice[k][n] is the CRC
+ * of byte n followed by k zero bytes */
+static uint32_t crc32_le_slice[8][256];
+static uint32_t crc32_be_slice[8][256];
+static pthread_once_t s_crc32_init_once = PTHREAD_ONCE_INIT;
+
+#if CRC32_LE_PCLMUL
+static bool s_crc32_has_pclmul;
+#endif
+
+static void crc32_init(void)
 {
-    uint32_t i;
-    crc = ~crc;
-    for(i=0;i<len;i++){
-        crc = crc32_le_table[(crc^buf[i])&0xff]^(crc>>8);
+    for (int n = 0; n < 256; n++) {
+        crc32_le_slice[0][n] = crc32_le_table[n];
+        crc32_be_slice[0][n] = crc32_be_table[n];
     }
-    return ~crc;
+    for (int k = 1; k < 8; k++) {
+        for (int n = 0; n < 256; n++) {
+            uint32_t le = crc32_le_slice[k - 1][n];
+            uint32_t be = crc32_be_slice[k - 1][n];
+            crc32_le_slice[k][n] = crc32_le_table[le & 0xff] ^ (le >> 8);
+            crc32_be_slice[k][n] = crc32_be_table[be >> 24] ^ (be << 8);
+        }
+    }
+#if CRC32_LE_PCLMUL
+    __builtin_cpu_init();
+    s_crc32_has_pclmul = __builtin_cpu_supports("pclmul");
+#endif
 }
 
-uint32_t esp_rom_crc32_be(uint32_t crc, uint8_t const * buf,uint32_t len)
+static inline uint32_t load_le32(const uint8_t *p)
 {
-    uint32_t i;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint32_t crc32_le_slice8(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    for (; len >= 8; len -= 8, buf += 8) {
+        uint32_t one = load_le32(buf) ^ crc;
+        uint32_t two = load_le32(buf + 4);
+        crc = crc32_le_slice[7][one & 0xff] ^ crc32_le_slice[6][(one >> 8) & 0xff] ^
+              crc32_le_slice[5][(one >> 16) & 0xff] ^ crc32_le_slice[4][one >> 24] ^
+              crc32_le_slice[3][two & 0xff] ^ crc32_le_slice[2][(two >> 8) & 0xff] ^
+              crc32_le_slice[1][(two >> 16) & 0xff] ^ crc32_le_slice[0][two >> 24];
+    }
+    for (; len > 0; len--, buf++) {
+        crc = crc32_le_table[(crc ^ *buf) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static uint32_t crc32_be_slice8(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    for (; len >= 8; len -= 8, buf += 8) {
+        uint32_t one = load_be32(buf) ^ crc;
+        uint32_t two = load_be32(buf + 4);
+        crc = crc32_be_slice[7][one >> 24] ^ crc32_be_slice[6][(one >> 16) & 0xff] ^
+              crc32_be_slice[5][(one >> 8) & 0xff] ^ crc32_be_slice[4][one & 0xff] ^
+              crc32_be_slice[3][two >> 24] ^ crc32_be_slice[2][(two >> 16) & 0xff] ^
+              crc32_be_slice[1][(two >> 8) & 0xff] ^ crc32_be_slice[0][two & 0xff];
+    }
+    for (; len > 0; len--, buf++) {
+        crc = crc32_be_table[(crc >> 24) ^ *buf] ^ (crc << 8);
+    }
+    return crc;
+}
+
+#if CRC32_LE_ARM
+static uint32_t crc32_le_arm(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    for (; len >= 8; len -= 8, buf += 8) {
+        uint64_t val;
+        memcpy(&val, buf, sizeof(val));
+        crc = __crc32d(crc, val);
+    }
+    for (; len > 0; len--, buf++) {
+        crc = __crc32b(crc, *buf);
+    }
+    return crc;
+}
+#endif // CRC32_LE_ARM
+
+#if CRC32_LE_PCLMUL
+/*
+ * Folds 64 bytes at a time using carry-less multiplication, then reduces the result
+ * with Barrett reduction, as described in Intel's "Fast CRC Computation for Generic
+ * Polynomials Using PCLMULQDQ Instruction". len must be a multiple of 16, at least 64.
+ */
+__attribute__((target("pclmul,sse2")))
+static uint32_t crc32_le_pclmul(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+    const __m128i k5 = _mm_set_epi64x(0, 0x163cd6124);
+    const __m128i poly_mu = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+    const __m128i mask32 = _mm_set_epi32(0, 0, 0, -1);
+
+    __m128i x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) buf), _mm_cvtsi32_si128(crc));
+    __m128i x1 = _mm_loadu_si128((const __m128i *) (buf + 16));
+    __m128i x2 = _mm_loadu_si128((const __m128i *) (buf + 32));
+    __m128i x3 = _mm_loadu_si128((const __m128i *) (buf + 48));
+    buf += 64;
+    len -= 64;
+
+#define CRC32_FOLD(x, k, data) \
+    _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), data)
+
+    for (; len >= 64; len -= 64, buf += 64) {
+        x0 = CRC32_FOLD(x0, k1k2, _mm_loadu_si128((const __m128i *) buf));
+        x1 = CRC32_FOLD(x1, k1k2, _mm_loadu_si128((const __m128i *) (buf + 16)));
+        x2 = CRC32_FOLD(x2, k1k2, _mm_loadu_si128((const __m128i *) (buf + 32)));
+        x3 = CRC32_FOLD(x3, k1k2, _mm_loadu_si128((const __m128i *) (buf + 48)));
+    }
+    x0 = CRC32_FOLD(x0, k3k4, x1);
+    x0 = CRC32_FOLD(x0, k3k4, x2);
+    x0 = CRC32_FOLD(x0, k3k4, x3);
+    for (; len >= 16; len -= 16, buf += 16) {
+        x0 = CRC32_FOLD(x0, k3k4, _mm_loadu_si128((const __m128i *) buf));
+    }
+#undef CRC32_FOLD
+
+    // 128 bits -> 64 bits
+    x0 = _mm_xor_si128(_mm_clmulepi64_si128(x0, k3k4, 0x10), _mm_srli_si128(x0, 8));
+    // 64 bits -> 32 bits
+    x0 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x0, mask32), k5, 0x00), _mm_srli_si128(x0, 4));
+    // Barrett reduction
+    __m128i t = _mm_clmulepi64_si128(_mm_and_si128(x0, mask32), poly_mu, 0x10);
+    t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), poly_mu, 0x00);
+    x0 = _mm_xor_si128(x0, t);
+    return _mm_cvtsi128_si32(_mm_srli_si128(x0, 4));
+}
+#endif // CRC32_LE_PCLMUL
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    pthread_once(&s_crc32_init_once, crc32_init);
     crc = ~crc;
-    for(i=0;i<len;i++){
-        crc = crc32_be_table[(crc>>24)^buf[i]]^(crc<<8);
+#if CRC32_LE_ARM
+    crc = crc32_le_arm(crc, buf, len);
+#else
+#if CRC32_LE_PCLMUL
+    if (s_crc32_has_pclmul && len >= 64) {
+        uint32_t fold_len = len & ~15;
+        crc = crc32_le_pclmul(crc, buf, fold_len);
+        buf += fold_len;
+        len -= fold_len;
     }
+#endif // CRC32_LE_PCLMUL
+    crc = crc32_le_slice8(crc, buf, len);
+#endif // CRC32_LE_ARM
     return ~crc;
 }
 
+uint32_t esp_rom_crc32_be(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    pthread_once(&s_crc32_init_once, crc32_init);
+    return ~crc32_be_slice8(~crc, buf, len);
+}
+
 uint16_t esp_rom_crc16_le(uint16_t crc, uint8_t const * buf, uint32_t len)
 {
     uint32_t i;
@@ -0,0 +1,279 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "unity.h"
+
+#define NUM_TIMERS 4000
+
+typedef struct {
+    size_t index;
+    uint64_t expiry;
+    size_t *order;
+    size_t *count;
+    SemaphoreHandle_t done;
+    size_t done_count;
+} test_timer_arg_t;
+
+static void test_timer_cb(void *arg)
+{
+    test_timer_arg_t *p = (test_timer_arg_t *) arg;
+    p->order[(*p->count)++] = p->index;
+    if (*p->count == p->done_count) {
+        xSemaphoreGive(p->done);
+    }
+}
+
+TEST_CASE("esp_timer_get_time is monotonic", "[esp_timer]")
+{
+    int64_t prev = esp_timer_get_time();
+    for (int i = 0; i < 100000; ++i) {
+        int64_t now = esp_timer_get_time();
+        TEST_ASSERT_GREATER_OR_EQUAL_INT64(prev, now);
+        prev = now;
+    }
+    int64_t start = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(50));
+    TEST_ASSERT_INT64_WITHIN(20000, 50000, esp_timer_get_time() - start);
+}
+
+TEST_CASE("one-shot timers fire in order of their timeouts", "[esp_timer]")
+{
+    const size_t num_timers = 64;
+    esp_timer_handle_t *handles = calloc(num_timers, sizeof(esp_timer_handle_t));
+    test_timer_arg_t *args = calloc(num_timers, sizeof(test_timer_arg_t));
+    size_t *order = calloc(num_timers, sizeof(size_t));
+    size_t count = 0;
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    srand(1);
+
+    for (size_t i = 0; i < num_timers; ++i) {
+        args[i] = (test_timer_arg_t) {
+            .index = i, .order = order, .count = &count, .done = done, .done_count = num_timers
+        };
+        esp_timer_create_args_t create_args = {
+            .callback = &test_timer_cb,
+            .arg = &args[i],
+            .name = "order",
+        };
+        TEST_ESP_OK(esp_timer_create(&create_args, &handles[i]));
+    }
+    /* Several timers share a timeout, those have to fire in the order they were started */
+    for (size_t i = 0; i < num_timers; ++i) {
+        TEST_ESP_OK(esp_timer_start_once(handles[i], 10000 + (rand() % 16) * 5000));
+        TEST_ESP_OK(esp_timer_get_expiry_time(handles[i], &args[i].expiry));
+    }
+    esp_timer_dump(stdout);
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+
+    uint64_t prev_expiry = 0;
+    for (size_t i = 0; i < num_timers; ++i) {
+        uint64_t expiry = args[order[i]].expiry;
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT64(prev_expiry, expiry);
+        if (i > 0 && expiry == prev_expiry) {
+            TEST_ASSERT_GREATER_THAN(order[i - 1], order[i]);
+        }
+        prev_expiry = expiry;
+    }
+
+    for (size_t i = 0; i < num_timers; ++i) {
+        TEST_ESP_OK(esp_timer_delete(handles[i]));
+    }
+    vSemaphoreDelete(done);
+    free(order);
+    free(args);
+    free(handles);
+}
+
+TEST_CASE("periodic timer fires with the requested period", "[esp_timer]")
+{
+    size_t order[16];
+    size_t count = 0;
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    test_timer_arg_t arg = { .order = order, .count = &count, .done = done, .done_count = 10 };
+    esp_timer_create_args_t create_args = {
+        .callback = &test_timer_cb,
+        .arg = &arg,
+        .name = "periodic",
+    };
+    esp_timer_handle_t timer;
+    TEST_ESP_OK(esp_timer_create(&create_args, &timer));
+
+    int64_t start = esp_timer_get_time();
+    TEST_ESP_OK(esp_timer_start_periodic(timer, 20000));
+    TEST_ASSERT_TRUE(esp_timer_is_active(timer));
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+    TEST_ESP_OK(esp_timer_stop(timer));
+    int64_t elapsed = esp_timer_get_time() - start;
+    TEST_ASSERT_INT64_WITHIN(30000, 200000, elapsed);
+    TEST_ASSERT_EQUAL(10, count);
+
+    TEST_ESP_OK(esp_timer_delete(timer));
+    vSemaphoreDelete(done);
+}
+
+TEST_CASE("stopped timer does not fire and can be restarted", "[esp_timer]")
+{
+    size_t order[4];
+    size_t count = 0;
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    test_timer_arg_t arg = { .order = order, .count = &count, .done = done, .done_count = 1 };
+    esp_timer_create_args_t create_args = {
+        .callback = &test_timer_cb,
+        .arg = &arg,
+        .name = "stop",
+    };
+    esp_timer_handle_t timer;
+    TEST_ESP_OK(esp_timer_create(&create_args, &timer));
+
+    TEST_ESP_OK(esp_timer_start_once(timer, 20000));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_timer_start_once(timer, 20000));
+    TEST_ESP_OK(esp_timer_stop(timer));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_timer_stop(timer));
+    TEST_ASSERT_FALSE(xSemaphoreTake(done, pdMS_TO_TICKS(50)));
+    TEST_ASSERT_EQUAL(0, count);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_timer_restart(timer, 10000));
+    TEST_ESP_OK(esp_timer_start_once(timer, 100000));
+    TEST_ESP_OK(esp_timer_restart(timer, 10000));
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(50)));
+    TEST_ASSERT_EQUAL(1, count);
+
+    TEST_ESP_OK(esp_timer_delete(timer));
+    vSemaphoreDelete(done);
+}
+
+TEST_CASE("next alarm is the earliest armed timer", "[esp_timer]")
+{
+    enum { num_timers = 32 };
+    esp_timer_handle_t handles[num_timers];
+    size_t order[num_timers];
+    size_t count = 0;
+    test_timer_arg_t arg = { .order = order, .count = &count };
+    esp_timer_create_args_t create_args = {
+        .callback = &test_timer_cb,
+        .arg = &arg,
+        .name = "next",
+    };
+    /* Timers deleted by the previous tests stay in the heap until the timer task frees them */
+    vTaskDelay(pdMS_TO_TICKS(10));
+    for (size_t i = 0; i < num_timers; ++i) {
+        TEST_ESP_OK(esp_timer_create(&create_args, &handles[i]));
+        TEST_ESP_OK(esp_timer_start_once(handles[i], 1000000 + (i * 7919) % 1000000));
+    }
+    /* Stop timers one by one, starting from the earliest, checking the next alarm each time */
+    for (size_t n = 0; n < num_timers; ++n) {
+        int64_t earliest = INT64_MAX;
+        size_t earliest_index = 0;
+        for (size_t i = 0; i < num_timers; ++i) {
+            uint64_t expiry;
+            if (esp_timer_is_active(handles[i]) && esp_timer_get_expiry_time(handles[i], &expiry) == ESP_OK
+                    && (int64_t) expiry < earliest) {
+                earliest = expiry;
+                earliest_index = i;
+            }
+        }
+        TEST_ASSERT_EQUAL_INT64(earliest, esp_timer_get_next_alarm());
+        TEST_ESP_OK(esp_timer_stop(handles[earliest_index]));
+    }
+    TEST_ASSERT_EQUAL_INT64(INT64_MAX, esp_timer_get_next_alarm());
+    TEST_ASSERT_EQUAL(0, count);
+    for (size_t i = 0; i < num_timers; ++i) {
+        TEST_ESP_OK(esp_timer_delete(handles[i]));
+    }
+}
+
+TEST_CASE("thousands of timers can be started, stopped and fired", "[esp_timer][timing]")
+{
+    esp_timer_handle_t *handles = calloc(NUM_TIMERS, sizeof(esp_timer_handle_t));
+    test_timer_arg_t *args = calloc(NUM_TIMERS, sizeof(test_timer_arg_t));
+    size_t *order = calloc(NUM_TIMERS, sizeof(size_t));
+    bool *stopped = calloc(NUM_TIMERS, sizeof(bool));
+    TEST_ASSERT_NOT_NULL(handles);
+    TEST_ASSERT_NOT_NULL(args);
+    TEST_ASSERT_NOT_NULL(order);
+    TEST_ASSERT_NOT_NULL(stopped);
+    size_t count = 0;
+    size_t num_stopped = 0;
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    srand(2);
+
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        args[i] = (test_timer_arg_t) {
+            .index = i, .order = order, .count = &count, .done = done
+        };
+        esp_timer_create_args_t create_args = {
+            .callback = &test_timer_cb,
+            .arg = &args[i],
+            .name = "many",
+        };
+        TEST_ESP_OK(esp_timer_create(&create_args, &handles[i]));
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        TEST_ESP_OK(esp_timer_start_once(handles[i], 200000 + rand() % 200000));
+        TEST_ESP_OK(esp_timer_get_expiry_time(handles[i], &args[i].expiry));
+    }
+    int64_t started = esp_timer_get_time();
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        size_t index = rand() % NUM_TIMERS;
+        if (stopped[index]) {
+            continue;
+        }
+        if (rand() % 2) {
+            TEST_ESP_OK(esp_timer_restart(handles[index], 200000 + rand() % 200000));
+            TEST_ESP_OK(esp_timer_get_expiry_time(handles[index], &args[index].expiry));
+        } else {
+            TEST_ESP_OK(esp_timer_stop(handles[index]));
+            stopped[index] = true;
+            ++num_stopped;
+        }
+    }
+    int64_t updated = esp_timer_get_time();
+    printf("started %d timers in %" PRIi64 " us, restarted or stopped them in %" PRIi64 " us\n",
+           NUM_TIMERS, started - start, updated - started);
+    TEST_ASSERT_LESS_THAN_INT64(200000, updated - start);
+
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        args[i].done_count = NUM_TIMERS - num_stopped;
+    }
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(2000)));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    TEST_ASSERT_EQUAL(NUM_TIMERS - num_stopped, count);
+
+    uint64_t prev_expiry = 0;
+    for (size_t i = 0; i < count; ++i) {
+        TEST_ASSERT_FALSE(stopped[order[i]]);
+        uint64_t expiry = args[order[i]].expiry;
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT64(prev_expiry, expiry);
+        prev_expiry = expiry;
+    }
+
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        TEST_ESP_OK(esp_timer_delete(handles[i]));
+    }
+    vSemaphoreDelete(done);
+    free(stopped);
+    free(order);
+    free(args);
+    free(handles);
+}
+
+void app_main(void)
+{
+    printf("Running esp_timer linux host test app\n");
+    ESP_ERROR_CHECK(esp_timer_early_init());
+    ESP_ERROR_CHECK(esp_timer_init());
+    unity_run_menu();
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2017-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2017-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -103,6 +103,10 @@ esp_err_t esp_timer_early_init(void);
  * It allocates the timer ISR on MULTIPLE cores and
  * creates the timer task which can be run on any core.
  *
+ * @note On the Linux target there is no startup code calling esp_timer functions,
+ * so the application has to call esp_timer_early_init and esp_timer_init itself,
+ * from a FreeRTOS task, before using other esp_timer APIs (except esp_timer_get_time).
+ *
  * @return
  *      - ESP_OK on success
  *      - ESP_ERR_NO_MEM if allocation has failed
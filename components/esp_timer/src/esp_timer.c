@@ -1,28 +1,33 @@
 /*
- * SPDX-FileCopyrightText: 2017-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2017-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 #include <sys/param.h>
+#include <stdlib.h>
 #include <string.h>
-#include "soc/soc.h"
 #include "esp_types.h"
 #include "esp_attr.h"
 #include "esp_err.h"
 #include "esp_task.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "esp_ipc.h"
 #include "esp_timer.h"
 #include "esp_timer_impl.h"
 
-#include "esp_private/startup_internal.h"
 #include "esp_private/esp_timer_private.h"
 #include "esp_private/system_internal.h"
 
+#if !CONFIG_IDF_TARGET_LINUX
+#include "soc/soc.h"
+#include "esp_ipc.h"
+#include "esp_private/startup_internal.h"
+#endif
+
 #if CONFIG_IDF_TARGET_ESP32
 #include "esp32/rtc.h"
 #elif CONFIG_IDF_TARGET_ESP32S2
@@ -60,6 +65,15 @@ typedef enum {
     FL_SKIP_UNHANDLED_EVENTS = (1 << 1),  //!< 0=NOT skip unhandled events for periodic timers, 1=Skip unhandled events for periodic timers
 } flags_t;
 
+/*
+ * Armed timers are kept in a pairing heap ordered by alarm time, one heap per dispatch method.
+ * The earliest timer is the root of the heap. Arming a timer is O(1), removing a timer is
+ * O(log n) amortized, and neither needs memory allocation, so both can be done from an ISR.
+ *
+ * Children of a timer form a list: heap.child points to the first child, heap.sibling to the
+ * next one. heap.prev points to the previous sibling, or to the parent for the first child.
+ * Timers with the same alarm time are ordered by the time they were armed (seq).
+ */
 struct esp_timer {
     uint64_t alarm;
     uint64_t period:56;
@@ -69,6 +83,7 @@ struct esp_timer {
         uint32_t event_id;
     };
     void* arg;
+    uint32_t seq;
 #if WITH_PROFILING
     const char* name;
     size_t times_triggered;
@@ -76,15 +91,28 @@ struct esp_timer {
     size_t times_skipped;
     uint64_t total_callback_run_time;
 #endif // WITH_PROFILING
-    LIST_ENTRY(esp_timer) list_entry;
+    union {
+        struct {
+            struct esp_timer* child;
+            struct esp_timer* sibling;
+            struct esp_timer* prev;
+        } heap;                             // armed timers
+#if WITH_PROFILING
+        LIST_ENTRY(esp_timer) list_entry;   // unarmed timers
+#endif
+    };
 };
 
 static inline bool is_initialized(void);
-static esp_err_t timer_insert(esp_timer_handle_t timer, bool without_update_alarm);
+static esp_err_t timer_insert(esp_timer_handle_t timer);
 static esp_err_t timer_remove(esp_timer_handle_t timer);
 static bool timer_armed(esp_timer_handle_t timer);
 static void timer_list_lock(esp_timer_dispatch_t timer_type);
 static void timer_list_unlock(esp_timer_dispatch_t timer_type);
+static void timer_heap_push(esp_timer_handle_t timer);
+static esp_timer_handle_t timer_heap_link(esp_timer_handle_t a, esp_timer_handle_t b);
+static esp_timer_handle_t timer_heap_merge_pairs(esp_timer_handle_t first);
+static esp_timer_handle_t timer_heap_next(esp_timer_handle_t timer, bool skip_children);
 
 #if WITH_PROFILING
 static void timer_insert_inactive(esp_timer_handle_t timer);
@@ -93,15 +121,15 @@ static void timer_remove_inactive(esp_timer_handle_t timer);
 
 __attribute__((unused)) static const char* TAG = "esp_timer";
 
-// lists of currently armed timers for two dispatch methods: ISR and TASK
-static LIST_HEAD(esp_timer_list, esp_timer) s_timers[ESP_TIMER_MAX] = {
-    [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_timers)
-};
+// heaps of currently armed timers for two dispatch methods: ISR and TASK
+static esp_timer_handle_t s_timers[ESP_TIMER_MAX];
+// sequence number of the last armed timer, orders timers with the same alarm time
+static uint32_t s_timer_seq;
 #if WITH_PROFILING
 // lists of unarmed timers for two dispatch methods: ISR and TASK,
 // used only to be able to dump statistics about all the timers
 static LIST_HEAD(esp_inactive_timer_list, esp_timer) s_inactive_timers[ESP_TIMER_MAX] = {
-    [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_timers)
+    [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_inactive_timers)
 };
 #endif
 // task used to dispatch timer callbacks
@@ -164,9 +192,8 @@ esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us)
     const int64_t now = esp_timer_impl_get_time();
     const uint64_t period = timer->period;
 
-    /* We need to remove the timer to the list of timers and reinsert it at
-     * the right position. In fact, the timers are sorted by their alarm value
-     * (earliest first) */
+    /* We need to remove the timer from the heap of timers and reinsert it
+     * with its new alarm value */
     ret = timer_remove(timer);
 
     if (ret == ESP_OK) {
@@ -183,7 +210,7 @@ esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us)
             timer->alarm = now + timeout_us;
             timer->period = 0;
         }
-        ret = timer_insert(timer, false);
+        ret = timer_insert(timer);
     }
 
     timer_list_unlock(dispatch_method);
@@ -207,7 +234,7 @@ esp_err_t IRAM_ATTR esp_timer_start_once(esp_timer_handle_t timer, uint64_t time
 #if WITH_PROFILING
     timer->times_armed++;
 #endif
-    esp_err_t err = timer_insert(timer, false);
+    esp_err_t err = timer_insert(timer);
     timer_list_unlock(dispatch_method);
     return err;
 }
@@ -230,7 +257,7 @@ esp_err_t IRAM_ATTR esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t
     timer->times_armed++;
     timer->times_skipped = 0;
 #endif
-    esp_err_t err = timer_insert(timer, false);
+    esp_err_t err = timer_insert(timer);
     timer_list_unlock(dispatch_method);
     return err;
 }
@@ -255,8 +282,8 @@ esp_err_t esp_timer_delete(esp_timer_handle_t timer)
         return ESP_ERR_INVALID_STATE;
     }
     // A case for the timer with ESP_TIMER_ISR:
-    // This ISR timer was removed from the ISR list in esp_timer_stop() or in timer_process_alarm() -> LIST_REMOVE(it, list_entry)
-    // and here this timer will be added to another the TASK list, see below.
+    // This ISR timer was removed from the ISR heap in esp_timer_stop() or in timer_process_alarm()
+    // and here this timer will be added to the TASK heap, see below.
     // We do this because we want to free memory of the timer in a task context instead of an isr context.
     int64_t alarm = esp_timer_get_time();
     timer_list_lock(ESP_TIMER_TASK);
@@ -264,34 +291,19 @@ esp_err_t esp_timer_delete(esp_timer_handle_t timer)
     timer->event_id = EVENT_ID_DELETE_TIMER;
     timer->alarm = alarm;
     timer->period = 0;
-    timer_insert(timer, false);
+    timer_insert(timer);
     timer_list_unlock(ESP_TIMER_TASK);
     return ESP_OK;
 }
 
-static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer, bool without_update_alarm)
+static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer)
 {
 #if WITH_PROFILING
     timer_remove_inactive(timer);
 #endif
-    esp_timer_handle_t it, last = NULL;
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
-    if (LIST_FIRST(&s_timers[dispatch_method]) == NULL) {
-        LIST_INSERT_HEAD(&s_timers[dispatch_method], timer, list_entry);
-    } else {
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
-            if (timer->alarm < it->alarm) {
-                LIST_INSERT_BEFORE(it, timer, list_entry);
-                break;
-            }
-            last = it;
-        }
-        if (it == NULL) {
-            assert(last);
-            LIST_INSERT_AFTER(last, timer, list_entry);
-        }
-    }
-    if (without_update_alarm == false && timer == LIST_FIRST(&s_timers[dispatch_method])) {
+    timer_heap_push(timer);
+    if (timer == s_timers[dispatch_method]) {
         esp_timer_impl_set_alarm_id(timer->alarm, dispatch_method);
     }
     return ESP_OK;
@@ -301,14 +313,30 @@ static IRAM_ATTR esp_err_t timer_remove(esp_timer_handle_t timer)
 {
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
     timer_list_lock(dispatch_method);
-    esp_timer_handle_t first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-    LIST_REMOVE(timer, list_entry);
+    esp_timer_handle_t first_timer = s_timers[dispatch_method];
+    if (timer == first_timer) {
+        s_timers[dispatch_method] = timer_heap_merge_pairs(timer->heap.child);
+    } else {
+        // Unlink the timer from its parent and siblings, then link its children back to the heap
+        if (timer->heap.prev->heap.child == timer) {
+            timer->heap.prev->heap.child = timer->heap.sibling;
+        } else {
+            timer->heap.prev->heap.sibling = timer->heap.sibling;
+        }
+        if (timer->heap.sibling) {
+            timer->heap.sibling->heap.prev = timer->heap.prev;
+        }
+        esp_timer_handle_t children = timer_heap_merge_pairs(timer->heap.child);
+        if (children) {
+            s_timers[dispatch_method] = timer_heap_link(first_timer, children);
+        }
+    }
     timer->alarm = 0;
     timer->period = 0;
-    if (timer == first_timer) { // if this timer was the first in the list.
+    if (timer == first_timer) { // if this timer was the first in the heap.
         uint64_t next_timestamp = UINT64_MAX;
-        first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-        if (first_timer) { // if after removing the timer from the list, this list is not empty.
+        first_timer = s_timers[dispatch_method];
+        if (first_timer) { // if after removing the timer from the heap, this heap is not empty.
             next_timestamp = first_timer->alarm;
         }
         esp_timer_impl_set_alarm_id(next_timestamp, dispatch_method);
@@ -320,6 +348,99 @@ static IRAM_ATTR esp_err_t timer_remove(esp_timer_handle_t timer)
     return ESP_OK;
 }
 
+static IRAM_ATTR bool timer_before(esp_timer_handle_t a, esp_timer_handle_t b)
+{
+    return a->alarm < b->alarm || (a->alarm == b->alarm && (int32_t) (a->seq - b->seq) < 0);
+}
+
+/* Adds an unlinked timer to the heap of its dispatch method */
+static IRAM_ATTR void timer_heap_push(esp_timer_handle_t timer)
+{
+    esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
+    timer->seq = ++s_timer_seq;
+    timer->heap.child = NULL;
+    timer->heap.sibling = NULL;
+    timer->heap.prev = NULL;
+    if (s_timers[dispatch_method] != NULL) {
+        s_timers[dispatch_method] = timer_heap_link(s_timers[dispatch_method], timer);
+    } else {
+        s_timers[dispatch_method] = timer;
+    }
+}
+
+/* Links two heaps, returns the root of the resulting heap. The siblings of the roots are not used. */
+static IRAM_ATTR esp_timer_handle_t timer_heap_link(esp_timer_handle_t a, esp_timer_handle_t b)
+{
+    if (timer_before(b, a)) {
+        esp_timer_handle_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+    // b becomes the first child of a
+    b->heap.sibling = a->heap.child;
+    if (a->heap.child) {
+        a->heap.child->heap.prev = b;
+    }
+    b->heap.prev = a;
+    a->heap.child = b;
+    a->heap.sibling = NULL;
+    a->heap.prev = NULL;
+    return a;
+}
+
+/* Links a list of sibling heaps into one heap, returns its root */
+static IRAM_ATTR esp_timer_handle_t timer_heap_merge_pairs(esp_timer_handle_t first)
+{
+    // First pass: link pairs of siblings from left to right, keep the results in reverse order
+    esp_timer_handle_t pairs = NULL;
+    while (first) {
+        esp_timer_handle_t a = first;
+        esp_timer_handle_t b = a->heap.sibling;
+        if (b) {
+            first = b->heap.sibling;
+            a = timer_heap_link(a, b);
+        } else {
+            first = NULL;
+        }
+        a->heap.sibling = pairs;
+        pairs = a;
+    }
+    if (pairs == NULL) {
+        return NULL;
+    }
+    // Second pass: link the results from right to left
+    esp_timer_handle_t root = pairs;
+    pairs = pairs->heap.sibling;
+    while (pairs) {
+        esp_timer_handle_t next = pairs->heap.sibling;
+        root = timer_heap_link(root, pairs);
+        pairs = next;
+    }
+    root->heap.sibling = NULL;
+    root->heap.prev = NULL;
+    return root;
+}
+
+/* Pre-order traversal of a heap: returns the timer visited after the given one,
+ * or NULL at the end. Children of the timer are not visited if skip_children is set. */
+static IRAM_ATTR esp_timer_handle_t timer_heap_next(esp_timer_handle_t timer, bool skip_children)
+{
+    if (!skip_children && timer->heap.child) {
+        return timer->heap.child;
+    }
+    while (timer->heap.sibling == NULL) {
+        // Go up to the parent: walk back to the first child, whose prev is the parent
+        while (timer->heap.prev && timer->heap.prev->heap.child != timer) {
+            timer = timer->heap.prev;
+        }
+        timer = timer->heap.prev;
+        if (timer == NULL) {
+            return NULL;
+        }
+    }
+    return timer->heap.sibling;
+}
+
 #if WITH_PROFILING
 
 static IRAM_ATTR void timer_insert_inactive(esp_timer_handle_t timer)
@@ -371,16 +492,16 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
     bool processed = false;
     esp_timer_handle_t it;
     while (1) {
-        it = LIST_FIRST(&s_timers[dispatch_method]);
+        it = s_timers[dispatch_method];
         int64_t now = esp_timer_impl_get_time();
         if (it == NULL || it->alarm > now) {
             break;
         }
         processed = true;
-        LIST_REMOVE(it, list_entry);
+        s_timers[dispatch_method] = timer_heap_merge_pairs(it->heap.child);
         if (it->event_id == EVENT_ID_DELETE_TIMER) {
             // It is handled only by ESP_TIMER_TASK (see esp_timer_delete()).
-            // All the ESP_TIMER_ISR timers which should be deleted are moved by esp_timer_delete() to the ESP_TIMER_TASK list.
+            // All the ESP_TIMER_ISR timers which should be deleted are moved by esp_timer_delete() to the ESP_TIMER_TASK heap.
             // We want to free memory of the timer in a task context instead of an isr context.
             free(it);
             it = NULL;
@@ -395,7 +516,8 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
                 } else {
                     it->alarm += it->period;
                 }
-                timer_insert(it, true);
+                // The timer was just taken out of the heap, it is not in the list of inactive timers
+                timer_heap_push(it);
             } else {
                 it->alarm = 0;
 #if WITH_PROFILING
@@ -461,9 +583,7 @@ static void IRAM_ATTR timer_alarm_handler(void* arg)
     if (isr_timers_processed == false) {
         vTaskNotifyGiveFromISR(s_timer_task, &xHigherPriorityTaskWoken);
     }
-    if (xHigherPriorityTaskWoken == pdTRUE) {
-        portYIELD_FROM_ISR();
-    }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 static IRAM_ATTR inline bool is_initialized(void)
@@ -531,10 +651,12 @@ esp_err_t esp_timer_init(void)
     return err;
 }
 
+#if !CONFIG_IDF_TARGET_LINUX
 ESP_SYSTEM_INIT_FN(esp_timer_startup_init, CONFIG_ESP_TIMER_ISR_AFFINITY, 100)
 {
     return esp_timer_init();
 }
+#endif
 
 esp_err_t esp_timer_deinit(void)
 {
@@ -544,7 +666,7 @@ esp_err_t esp_timer_deinit(void)
 
     /* Check if there are any active timers */
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
-        if (!LIST_EMPTY(&s_timers[dispatch_method])) {
+        if (s_timers[dispatch_method] != NULL) {
             return ESP_ERR_INVALID_STATE;
         }
     }
@@ -575,20 +697,29 @@ static void print_timer_info(esp_timer_handle_t t, char** dst, size_t* dst_size)
     } else {
         cb = snprintf(*dst, *dst_size, "timer@%-10p  ", t);
     }
-    cb += snprintf(*dst + cb, *dst_size + cb, "%-10lld  %-12lld  %-12d  %-12d  %-12d  %-12lld\n",
+    cb += snprintf(*dst + cb, *dst_size - cb, "%-10lld  %-12lld  %-12d  %-12d  %-12d  %-12lld\n",
                     (uint64_t)t->period, t->alarm, t->times_armed,
                     t->times_triggered, t->times_skipped, t->total_callback_run_time);
     /* keep this in sync with the format string, used in esp_timer_dump */
-#define TIMER_INFO_LINE_LEN 90
+#define TIMER_INFO_LINE_LEN 103
 #else
     size_t cb = snprintf(*dst, *dst_size, "timer@%-14p  %-10lld  %-12lld\n", t, (uint64_t)t->period, t->alarm);
-#define TIMER_INFO_LINE_LEN 46
+#define TIMER_INFO_LINE_LEN 47
 #endif
+    /* the output is truncated if it does not fit into the buffer */
+    cb = MIN(cb, *dst_size - 1);
     *dst += cb;
     *dst_size -= cb;
 }
 
 
+static int timer_compare(const void* a, const void* b)
+{
+    esp_timer_handle_t timer_a = *(const esp_timer_handle_t*) a;
+    esp_timer_handle_t timer_b = *(const esp_timer_handle_t*) b;
+    return timer_before(timer_a, timer_b) ? -1 : timer_before(timer_b, timer_a) ? 1 : 0;
+}
+
 esp_err_t esp_timer_dump(FILE* stream)
 {
     /* Since timer lock is a critical section, we don't want to print directly
@@ -603,7 +734,7 @@ esp_err_t esp_timer_dump(FILE* stream)
     size_t timer_count = 0;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        for (it = s_timers[dispatch_method]; it != NULL; it = timer_heap_next(it, false)) {
             ++timer_count;
         }
 #if WITH_PROFILING
@@ -621,7 +752,12 @@ esp_err_t esp_timer_dump(FILE* stream)
      */
     size_t buf_size = TIMER_INFO_LINE_LEN * (timer_count + 3);
     char* print_buf = calloc(1, buf_size + 1);
-    if (print_buf == NULL) {
+    /* Armed timers are not sorted in the heap, they are sorted in this array before being printed */
+    size_t sorted_size = timer_count + 3;
+    esp_timer_handle_t* sorted = calloc(sorted_size, sizeof(esp_timer_handle_t));
+    if (print_buf == NULL || sorted == NULL) {
+        free(print_buf);
+        free(sorted);
         return ESP_ERR_NO_MEM;
     }
 
@@ -629,8 +765,13 @@ esp_err_t esp_timer_dump(FILE* stream)
     char* pos = print_buf;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
-            print_timer_info(it, &pos, &buf_size);
+        size_t sorted_count = 0;
+        for (it = s_timers[dispatch_method]; it != NULL && sorted_count < sorted_size; it = timer_heap_next(it, false)) {
+            sorted[sorted_count++] = it;
+        }
+        qsort(sorted, sorted_count, sizeof(esp_timer_handle_t), timer_compare);
+        for (size_t i = 0; i < sorted_count; ++i) {
+            print_timer_info(sorted[i], &pos, &buf_size);
         }
 #if WITH_PROFILING
         LIST_FOREACH(it, &s_inactive_timers[dispatch_method], list_entry) {
@@ -653,6 +794,7 @@ esp_err_t esp_timer_dump(FILE* stream)
         fputs(print_buf, stream);
     }
 
+    free(sorted);
     free(print_buf);
     return ESP_OK;
 }
@@ -662,7 +804,7 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm(void)
     int64_t next_alarm = INT64_MAX;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        esp_timer_handle_t it = LIST_FIRST(&s_timers[dispatch_method]);
+        esp_timer_handle_t it = s_timers[dispatch_method];
         if (it) {
             if (next_alarm > it->alarm) {
                 next_alarm = it->alarm;
@@ -678,15 +820,20 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm_for_wake_up(void)
     int64_t next_alarm = INT64_MAX;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        esp_timer_handle_t it = NULL;
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
-            // timers with the SKIP_UNHANDLED_EVENTS flag do not want to wake up CPU from a sleep mode.
-            if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0) {
-                if (next_alarm > it->alarm) {
+        esp_timer_handle_t it = s_timers[dispatch_method];
+        while (it) {
+            // Children of a timer have later alarms, they only need to be visited
+            // if the timer is earlier than the earliest alarm found so far and does not wake up.
+            bool skip_children = true;
+            if (next_alarm > it->alarm) {
+                // timers with the SKIP_UNHANDLED_EVENTS flag do not want to wake up CPU from a sleep mode.
+                if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0) {
                     next_alarm = it->alarm;
+                } else {
+                    skip_children = false;
                 }
-                break;
             }
+            it = timer_heap_next(it, skip_children);
         }
         timer_list_unlock(dispatch_method);
     }
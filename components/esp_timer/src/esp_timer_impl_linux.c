@@ -0,0 +1,223 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/param.h>
+#include "sdkconfig.h"
+#include "esp_timer_impl.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @file esp_timer_impl_linux.c
+ * @brief Implementation of esp_timer for the Linux target.
+ *
+ * Time is taken from CLOCK_MONOTONIC, relative to the moment esp_timer_impl_early_init
+ * (or the first esp_timer_impl_get_time call) has happened.
+ *
+ * There is no alarm interrupt on the host, so it is emulated by a task running at the
+ * highest FreeRTOS priority. The task sleeps until the alarm time, or until it is
+ * notified that the alarm has been changed, and then calls the handler registered
+ * by the upper layer. Same as the hardware alarm, it fires only once per set alarm.
+ * The resolution of the alarm is limited by the FreeRTOS tick period.
+ */
+
+static const char *TAG = "esp_timer_linux";
+
+/* Function from the upper layer to be called when the alarm happens.
+ * Registered in esp_timer_impl_init.
+ */
+static intr_handler_t s_alarm_handler = NULL;
+
+/* Task emulating the alarm interrupt */
+static TaskHandle_t s_alarm_task = NULL;
+
+/* Spinlock used to protect the alarm and time state */
+static portMUX_TYPE s_time_update_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* CLOCK_MONOTONIC time, in microseconds, which corresponds to esp_timer time 0 */
+static int64_t s_time_base_us;
+
+/* Adjustment applied by esp_timer_impl_set and esp_timer_impl_advance */
+static int64_t s_time_offset_us;
+
+/* Alarms set for each dispatch method, and whether the earliest of them still has to fire */
+static uint64_t s_alarm_id[2] = { UINT64_MAX, UINT64_MAX };
+static bool s_alarm_pending;
+
+static int64_t get_monotonic_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t get_time_base_us(void)
+{
+    int64_t base = __atomic_load_n(&s_time_base_us, __ATOMIC_ACQUIRE);
+    if (base == 0) {
+        int64_t expected = 0;
+        base = get_monotonic_time_us();
+        if (!__atomic_compare_exchange_n(&s_time_base_us, &expected, base, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            base = expected;
+        }
+    }
+    return base;
+}
+
+void esp_timer_impl_lock(void)
+{
+    portENTER_CRITICAL(&s_time_update_lock);
+}
+
+void esp_timer_impl_unlock(void)
+{
+    portEXIT_CRITICAL(&s_time_update_lock);
+}
+
+int64_t esp_timer_impl_get_time(void)
+{
+    return get_monotonic_time_us() - get_time_base_us() + __atomic_load_n(&s_time_offset_us, __ATOMIC_RELAXED);
+}
+
+int64_t esp_timer_get_time(void) __attribute__((alias("esp_timer_impl_get_time")));
+
+uint64_t esp_timer_impl_get_counter_reg(void)
+{
+    return esp_timer_impl_get_time();
+}
+
+void esp_timer_impl_set_alarm_id(uint64_t timestamp, unsigned alarm_id)
+{
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    s_alarm_id[alarm_id] = timestamp;
+    s_alarm_pending = true;
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+    /* The upper layer calls this function with its own lock taken,
+     * so the alarm task is woken up without yielding to it here.
+     */
+    if (s_alarm_task != NULL && xTaskGetCurrentTaskHandle() != s_alarm_task) {
+        vTaskNotifyGiveFromISR(s_alarm_task, NULL);
+    }
+}
+
+void esp_timer_impl_set_alarm(uint64_t timestamp)
+{
+    esp_timer_impl_set_alarm_id(timestamp, 0);
+}
+
+static void alarm_task(void *arg)
+{
+    while (true) {
+        portENTER_CRITICAL(&s_time_update_lock);
+        uint64_t alarm = MIN(s_alarm_id[0], s_alarm_id[1]);
+        bool pending = s_alarm_pending && alarm != UINT64_MAX;
+        int64_t now = esp_timer_impl_get_time();
+        bool fire = pending && (int64_t) alarm <= now;
+        if (fire) {
+            s_alarm_pending = false;
+        }
+        portEXIT_CRITICAL(&s_time_update_lock);
+
+        if (fire) {
+            (*s_alarm_handler)(arg);
+            continue;
+        }
+
+        TickType_t ticks = portMAX_DELAY;
+        if (pending) {
+            /* Round up, so that the alarm is not checked before its time */
+            uint64_t wait_us = alarm - now;
+            uint64_t tick_us = portTICK_PERIOD_MS * 1000;
+            ticks = (TickType_t) MIN((wait_us + tick_us - 1) / tick_us, (uint64_t) (portMAX_DELAY - 1));
+        }
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
+}
+
+void esp_timer_impl_update_apb_freq(uint32_t apb_ticks_per_us)
+{
+    (void) apb_ticks_per_us;
+}
+
+void esp_timer_impl_set(uint64_t new_us)
+{
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    int64_t offset = (int64_t) new_us - (get_monotonic_time_us() - get_time_base_us());
+    __atomic_store_n(&s_time_offset_us, offset, __ATOMIC_RELAXED);
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+}
+
+void esp_timer_impl_advance(int64_t time_diff_us)
+{
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    __atomic_add_fetch(&s_time_offset_us, time_diff_us, __ATOMIC_RELAXED);
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+    if (s_alarm_task != NULL) {
+        xTaskNotifyGive(s_alarm_task);
+    }
+}
+
+esp_err_t esp_timer_impl_early_init(void)
+{
+    get_time_base_us();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_impl_init(intr_handler_t alarm_handler)
+{
+    if (s_alarm_task != NULL) {
+        ESP_EARLY_LOGE(TAG, "timer alarm task is already initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_alarm_handler = alarm_handler;
+    if (xTaskCreate(&alarm_task, "esp_timer_alarm", configMINIMAL_STACK_SIZE * 4, NULL,
+                    configMAX_PRIORITIES - 1, &s_alarm_task) != pdPASS) {
+        ESP_EARLY_LOGE(TAG, "Not enough memory to create timer alarm task");
+        s_alarm_handler = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void esp_timer_impl_deinit(void)
+{
+    if (s_alarm_task != NULL) {
+        vTaskDelete(s_alarm_task);
+        s_alarm_task = NULL;
+    }
+    portENTER_CRITICAL(&s_time_update_lock);
+    s_alarm_id[0] = UINT64_MAX;
+    s_alarm_id[1] = UINT64_MAX;
+    s_alarm_pending = false;
+    portEXIT_CRITICAL(&s_time_update_lock);
+    s_alarm_handler = NULL;
+}
+
+uint64_t esp_timer_impl_get_min_period_us(void)
+{
+    return 50;
+}
+
+uint64_t esp_timer_impl_get_alarm_reg(void)
+{
+    portENTER_CRITICAL_SAFE(&s_time_update_lock);
+    uint64_t val = MIN(s_alarm_id[0], s_alarm_id[1]);
+    portEXIT_CRITICAL_SAFE(&s_time_update_lock);
+    return val;
+}
+
+void esp_timer_private_update_apb_freq(uint32_t apb_ticks_per_us) __attribute__((alias("esp_timer_impl_update_apb_freq")));
+void esp_timer_private_set(uint64_t new_us) __attribute__((alias("esp_timer_impl_set")));
+void esp_timer_private_advance(int64_t time_diff_us) __attribute__((alias("esp_timer_impl_advance")));
+void esp_timer_private_lock(void) __attribute__((alias("esp_timer_impl_lock")));
+void esp_timer_private_unlock(void) __attribute__((alias("esp_timer_impl_unlock")));
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -76,6 +76,18 @@ DRESULT ff_wl_ioctl (BYTE pdrv, BYTE cmd, void *buff)
         return RES_OK;
     case GET_BLOCK_SIZE:
         return RES_ERROR;
+#if FF_USE_TRIM
+    case CTRL_TRIM: {
+        LBA_t start = ((LBA_t *) buff)[0];
+        LBA_t end = ((LBA_t *) buff)[1];
+        esp_err_t err = wl_discard_range(wl_handle, start * wl_sector_size(wl_handle), (end - start + 1) * wl_sector_size(wl_handle));
+        if (unlikely(err != ESP_OK)) {
+            ESP_LOGE(TAG, "wl_discard_range failed (%d)", err);
+            return RES_ERROR;
+        }
+        return RES_OK;
+    }
+#endif
     }
     return RES_ERROR;
 }
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -12,6 +12,7 @@
 #include <sys/time.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <utime.h>
 #include "unity.h"
@@ -171,6 +172,54 @@ void test_fatfs_pwrite_file(const char *filename)
     test_file_content(filename, "Hello, Dolly!");
 }
 
+void test_fatfs_readv_writev_file(const char *filename)
+{
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+
+    char hello[] = "Hello";
+    char sep[] = ", ";
+    char world[] = "world!";
+    const struct iovec wr_iov[] = {
+        { .iov_base = hello, .iov_len = strlen(hello) },
+        { .iov_base = NULL, .iov_len = 0 },
+        { .iov_base = sep, .iov_len = strlen(sep) },
+        { .iov_base = world, .iov_len = strlen(world) },
+    };
+    TEST_ASSERT_EQUAL(13, writev(fd, wr_iov, 4));
+    TEST_ASSERT_EQUAL(13, lseek(fd, 0, SEEK_CUR));
+
+    char dolly[] = "Dolly";
+    const struct iovec pwr_iov[] = {
+        { .iov_base = dolly, .iov_len = 3 },
+        { .iov_base = dolly + 3, .iov_len = 2 },
+    };
+    TEST_ASSERT_EQUAL(5, pwritev(fd, pwr_iov, 2, strlen("Hello, ")));
+    // pwritev doesn't move the file position
+    TEST_ASSERT_EQUAL(13, lseek(fd, 0, SEEK_CUR));
+
+    char buf1[4] = { 0 };
+    char buf2[32] = { 0 };
+    const struct iovec rd_iov[] = {
+        { .iov_base = buf1, .iov_len = sizeof(buf1) },
+        { .iov_base = buf2, .iov_len = sizeof(buf2) },
+    };
+    TEST_ASSERT_EQUAL(0, readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL(0, lseek(fd, 0, SEEK_SET));
+    TEST_ASSERT_EQUAL(13, readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL_STRING_LEN("Hell", buf1, sizeof(buf1));
+    TEST_ASSERT_EQUAL_STRING("o, Dolly!", buf2);
+
+    memset(buf1, 0, sizeof(buf1));
+    memset(buf2, 0, sizeof(buf2));
+    TEST_ASSERT_EQUAL(6, preadv(fd, rd_iov, 2, strlen("Hello, Dol")));
+    TEST_ASSERT_EQUAL_STRING_LEN("ly!", buf1, sizeof(buf1));
+    TEST_ASSERT_EQUAL(13, lseek(fd, 0, SEEK_CUR));
+
+    TEST_ASSERT_EQUAL(0, close(fd));
+    test_file_content(filename, "Hello, Dolly!");
+}
+
 void test_fatfs_open_max_files(const char* filename_prefix, size_t files_count)
 {
     FILE** files = calloc(files_count, sizeof(FILE*));
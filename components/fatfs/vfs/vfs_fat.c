@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -11,6 +11,7 @@
 #include <sys/errno.h>
 #include <sys/fcntl.h>
 #include <sys/lock.h>
+#include <sys/uio.h>
 #include "esp_vfs.h"
 #include "esp_log.h"
 #include "ff.h"
@@ -62,6 +63,10 @@ static off_t vfs_fat_lseek(void* p, int fd, off_t size, int mode);
 static ssize_t vfs_fat_read(void* ctx, int fd, void * dst, size_t size);
 static ssize_t vfs_fat_pread(void *ctx, int fd, void *dst, size_t size, off_t offset);
 static ssize_t vfs_fat_pwrite(void *ctx, int fd, const void *src, size_t size, off_t offset);
+static ssize_t vfs_fat_readv(void *ctx, int fd, const struct iovec *iov, int iovcnt);
+static ssize_t vfs_fat_writev(void *ctx, int fd, const struct iovec *iov, int iovcnt);
+static ssize_t vfs_fat_preadv(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);
+static ssize_t vfs_fat_pwritev(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);
 static int vfs_fat_open(void* ctx, const char * path, int flags, int mode);
 static int vfs_fat_close(void* ctx, int fd);
 static int vfs_fat_fstat(void* ctx, int fd, struct stat * st);
@@ -129,6 +134,10 @@ esp_err_t esp_vfs_fat_register(const char* base_path, const char* fat_drive, siz
         .read_p = &vfs_fat_read,
         .pread_p = &vfs_fat_pread,
         .pwrite_p = &vfs_fat_pwrite,
+        .readv_p = &vfs_fat_readv,
+        .writev_p = &vfs_fat_writev,
+        .preadv_p = &vfs_fat_preadv,
+        .pwritev_p = &vfs_fat_pwritev,
         .open_p = &vfs_fat_open,
         .close_p = &vfs_fat_close,
         .fstat_p = &vfs_fat_fstat,
@@ -519,6 +528,123 @@ pwrite_release:
     return ret;
 }
 
+/* Reads into the buffers one by one at the current position of the file, stops at the end of the file */
+static ssize_t fat_read_iov(FIL *file, const struct iovec *iov, int iovcnt)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        unsigned read = 0;
+        FRESULT res = f_read(file, iov[i].iov_base, iov[i].iov_len, &read);
+        total += read;
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            return (total > 0) ? total : -1;
+        }
+        if (read < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+/* Writes the buffers one by one at the current position of the file, stops when the volume is full */
+static ssize_t fat_write_iov(FIL *file, const struct iovec *iov, int iovcnt)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        unsigned written = 0;
+        FRESULT res = f_write(file, iov[i].iov_base, iov[i].iov_len, &written);
+        total += written;
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            return (total > 0) ? total : -1;
+        }
+        if (written < iov[i].iov_len) {
+            if (total == 0) {
+                errno = ENOSPC;
+                return -1;
+            }
+            break;
+        }
+    }
+    return total;
+}
+
+static ssize_t vfs_fat_readv(void *ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
+    _lock_acquire(&fat_ctx->lock);
+    ssize_t ret = fat_read_iov(&fat_ctx->files[fd], iov, iovcnt);
+    _lock_release(&fat_ctx->lock);
+    return ret;
+}
+
+static ssize_t vfs_fat_writev(void *ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    ssize_t ret = -1;
+    vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
+    /* The buffers are written as one piece, not interleaved with other writes to the file */
+    _lock_acquire(&fat_ctx->lock);
+    FIL *file = &fat_ctx->files[fd];
+    if (fat_ctx->o_append[fd]) {
+        FRESULT res = f_lseek(file, f_size(file));
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            goto release;
+        }
+    }
+    ret = fat_write_iov(file, iov, iovcnt);
+
+release:
+    _lock_release(&fat_ctx->lock);
+    return ret;
+}
+
+/* Runs a read or write of the buffers at the given offset, keeping the current position of the file */
+static ssize_t fat_iov_at_offset(vfs_fat_ctx_t *fat_ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset,
+                                 ssize_t (*op)(FIL *file, const struct iovec *iov, int iovcnt))
+{
+    ssize_t ret = -1;
+    _lock_acquire(&fat_ctx->lock);
+    FIL *file = &fat_ctx->files[fd];
+    const off_t prev_pos = f_tell(file);
+
+    FRESULT f_res = f_lseek(file, offset);
+    if (f_res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
+        errno = fresult_to_errno(f_res);
+        goto release;
+    }
+
+    ret = (*op)(file, iov, iovcnt);
+
+    f_res = f_lseek(file, prev_pos);
+    if (f_res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
+        if (ret >= 0) {
+            errno = fresult_to_errno(f_res);
+        } // else the operation failed so errno shouldn't be overwritten
+        ret = -1;
+    }
+
+release:
+    _lock_release(&fat_ctx->lock);
+    return ret;
+}
+
+static ssize_t vfs_fat_preadv(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return fat_iov_at_offset((vfs_fat_ctx_t *) ctx, fd, iov, iovcnt, offset, &fat_read_iov);
+}
+
+static ssize_t vfs_fat_pwritev(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return fat_iov_at_offset((vfs_fat_ctx_t *) ctx, fd, iov, iovcnt, offset, &fat_write_iov);
+}
+
 static int vfs_fat_fsync(void* ctx, int fd)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
@@ -40,6 +40,10 @@ void vPortYieldOtherCore(BaseType_t coreid);
 
 #define portMUX_INITIALIZE(mux)             spinlock_initialize(mux)    /*< Initialize a spinlock to its unlocked state */
 
+/* There is no separate ISR context on the simulator, the same critical section is used everywhere */
+#define portENTER_CRITICAL_SAFE(mux)        portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux)         portEXIT_CRITICAL(mux)
+
 /**
  * @brief Get the current core's ID
  *
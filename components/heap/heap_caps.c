@@ -10,9 +10,11 @@
 #include <sys/param.h>
 #include "esp_attr.h"
 #include "esp_heap_caps.h"
+#include "esp_heap_caps_pool.h"
 #include "multi_heap.h"
 #include "esp_log.h"
 #include "heap_private.h"
+#include "heap_caps_cache.h"
 #include "esp_system.h"
 
 /* Forward declaration for base function, put in IRAM.
@@ -123,6 +125,16 @@ IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
         return NULL;
     }
 
+#if CONFIG_HEAP_MAGAZINE_CACHE
+    if (heap_caps_cache_accepts(size, caps)) {
+        ret = heap_caps_cache_get(size);
+        if (ret != NULL) {
+            return ret;
+        }
+        size = heap_caps_cache_block_size(size);
+    }
+#endif
+
     if (caps & MALLOC_CAP_EXEC) {
         //MALLOC_CAP_EXEC forces an alloc from IRAM. There is a region which has both this as well as the following
         //caps, but the following caps are not possible for IRAM.  Thus, the combination is impossible and we return
@@ -373,8 +385,23 @@ IRAM_ATTR void heap_caps_free( void *ptr)
 
     heap_t *heap = find_containing_heap(ptr);
     assert(heap != NULL && "free() target pointer is outside heap areas");
+#if CONFIG_HEAP_MAGAZINE_CACHE
+    if ((get_all_caps(heap) & HEAP_CACHE_CAPS) == HEAP_CACHE_CAPS
+            && heap_caps_cache_put(ptr, multi_heap_get_allocated_size(heap->heap, ptr))) {
+        return;
+    }
+#endif
+    multi_heap_free(heap->heap, ptr);
+}
+
+#if CONFIG_HEAP_MAGAZINE_CACHE
+IRAM_ATTR void heap_caps_cache_release(void *ptr)
+{
+    heap_t *heap = find_containing_heap(ptr);
+    assert(heap != NULL);
     multi_heap_free(heap->heap, ptr);
 }
+#endif
 
 /*
 This function should not be called directly as it does not
@@ -517,7 +544,11 @@ size_t heap_caps_get_free_size( uint32_t caps )
             ret += multi_heap_free_size(heap->heap);
         }
     }
-    return ret;
+
+    // the unallocated objects of the pools are free memory as well
+    heap_caps_pool_info_t pool_info;
+    heap_caps_get_pool_info(&pool_info, caps);
+    return ret + pool_info.free_bytes;
 }
 
 size_t heap_caps_get_minimum_free_size( uint32_t caps )
@@ -529,7 +560,10 @@ size_t heap_caps_get_minimum_free_size( uint32_t caps )
             ret += multi_heap_minimum_free_size(heap->heap);
         }
     }
-    return ret;
+
+    heap_caps_pool_info_t pool_info;
+    heap_caps_get_pool_info(&pool_info, caps);
+    return ret + pool_info.minimum_free_bytes;
 }
 
 size_t heap_caps_get_largest_free_block( uint32_t caps )
@@ -559,6 +593,13 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
             info->total_blocks += hinfo.total_blocks;
         }
     }
+
+    // the unallocated objects of the pools are counted as free, instead of as allocated by the pools
+    heap_caps_pool_info_t pool_info;
+    heap_caps_get_pool_info(&pool_info, caps);
+    info->total_free_bytes += pool_info.free_bytes;
+    info->total_allocated_bytes -= MIN(pool_info.free_bytes, info->total_allocated_bytes);
+    info->minimum_free_bytes += pool_info.minimum_free_bytes;
 }
 
 void heap_caps_print_heap_info( uint32_t caps )
@@ -581,6 +622,14 @@ void heap_caps_print_heap_info( uint32_t caps )
     heap_caps_get_info(&info, caps);
 
     printf("    free %d allocated %d min_free %d largest_free_block %d\n", info.total_free_bytes, info.total_allocated_bytes, info.minimum_free_bytes, info.largest_free_block);
+
+    heap_caps_pool_info_t pool_info;
+    heap_caps_get_pool_info(&pool_info, caps);
+    if (pool_info.pools > 0) {
+        printf("  Object pools (unallocated objects counted as free):\n");
+        printf("    pools %d bytes %d objects %d free_objects %d\n", pool_info.pools, pool_info.total_bytes,
+               pool_info.total_objects, pool_info.free_objects);
+    }
 }
 
 bool heap_caps_check_integrity(uint32_t caps, bool print_errors)
@@ -623,6 +672,7 @@ void heap_caps_dump(uint32_t caps)
             multi_heap_dump(heap->heap);
         }
     }
+    heap_caps_pool_dump(caps);
 }
 
 void heap_caps_dump_all(void)
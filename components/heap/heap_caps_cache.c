@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "heap_caps_cache.h"
+
+#if CONFIG_HEAP_MAGAZINE_CACHE
+
+/*
+ Each slot holds a magazine (a stack of freed blocks) per size class. The slot is picked by the core the caller
+ runs on, so the lock of a slot is only contended if a task is preempted and moved to the other core while it
+ holds it, or while heap_caps_cache_flush() runs. Class 'n' holds blocks whose usable size is in the range
+ [(n + 1) * HEAP_CACHE_GRANULE, (n + 2) * HEAP_CACHE_GRANULE).
+
+ On Linux, there is a slot per thread (FreeRTOS task), up to CACHE_SLOT_NUM threads, after which threads share them.
+*/
+
+#define CACHE_CLASS_NUM     (HEAP_CACHE_MAX_SIZE / HEAP_CACHE_GRANULE)
+#define CACHE_DEPTH         CONFIG_HEAP_MAGAZINE_CACHE_DEPTH
+#define CACHE_FLUSH_BATCH   (CACHE_DEPTH / 2)
+
+#if CONFIG_IDF_TARGET_LINUX
+
+#include <sched.h>
+
+#define CACHE_SLOT_NUM 8
+#define CACHE_SLOT_ALIGN 64 // keep the slots used by different threads on separate cache lines
+
+/* A slot is almost always locked by the thread it belongs to, so a spinlock is enough */
+typedef int cache_lock_t;
+#define CACHE_LOCK_STATIC_INITIALIZER 0
+#define CACHE_LOCK(PLOCK) do {                                      \
+        while (__atomic_exchange_n((PLOCK), 1, __ATOMIC_ACQUIRE)) { \
+            sched_yield();                                          \
+        }                                                           \
+    } while(0)
+#define CACHE_UNLOCK(PLOCK) __atomic_store_n((PLOCK), 0, __ATOMIC_RELEASE)
+
+static size_t cache_slot_index(void)
+{
+    static size_t s_next_slot;
+    static __thread size_t s_slot = SIZE_MAX;
+
+    if (s_slot == SIZE_MAX) {
+        s_slot = __atomic_fetch_add(&s_next_slot, 1, __ATOMIC_RELAXED) % CACHE_SLOT_NUM;
+    }
+    return s_slot;
+}
+
+#else // CONFIG_IDF_TARGET_LINUX
+
+#include "multi_heap_platform.h"
+#include "esp_cpu.h"
+
+#define CACHE_SLOT_NUM portNUM_PROCESSORS
+#define CACHE_SLOT_ALIGN 4
+
+typedef multi_heap_lock_t cache_lock_t;
+#define CACHE_LOCK_STATIC_INITIALIZER MULTI_HEAP_LOCK_STATIC_INITIALIZER
+#define CACHE_LOCK(PLOCK) MULTI_HEAP_LOCK(PLOCK)
+#define CACHE_UNLOCK(PLOCK) MULTI_HEAP_UNLOCK(PLOCK)
+
+IRAM_ATTR static inline size_t cache_slot_index(void)
+{
+    return esp_cpu_get_core_id();
+}
+
+#endif // CONFIG_IDF_TARGET_LINUX
+
+_Static_assert(CACHE_CLASS_NUM > 0, "CONFIG_HEAP_MAGAZINE_CACHE_MAX_SIZE must be at least HEAP_CACHE_GRANULE");
+
+typedef struct {
+    cache_lock_t lock;
+    uint8_t count[CACHE_CLASS_NUM];
+    void *blocks[CACHE_CLASS_NUM][CACHE_DEPTH];
+    size_t hits;
+    size_t misses;
+    size_t flushed_blocks;
+} __attribute__((aligned(CACHE_SLOT_ALIGN))) cache_slot_t;
+
+static cache_slot_t s_cache_slots[CACHE_SLOT_NUM] = {
+    [0 ... CACHE_SLOT_NUM - 1] = { .lock = CACHE_LOCK_STATIC_INITIALIZER }
+};
+
+IRAM_ATTR void *heap_caps_cache_get(size_t size)
+{
+    void *ret = NULL;
+    // blocks of a class are at least (class + 1) * HEAP_CACHE_GRANULE bytes
+    const size_t cls = (size == 0) ? 0 : (size - 1) / HEAP_CACHE_GRANULE;
+
+    cache_slot_t *slot = &s_cache_slots[cache_slot_index()];
+    CACHE_LOCK(&slot->lock);
+    if (slot->count[cls] > 0) {
+        ret = slot->blocks[cls][--slot->count[cls]];
+        slot->hits++;
+    } else {
+        slot->misses++;
+    }
+    CACHE_UNLOCK(&slot->lock);
+    return ret;
+}
+
+IRAM_ATTR bool heap_caps_cache_put(void *ptr, size_t block_size)
+{
+    void *evicted[CACHE_FLUSH_BATCH];
+    size_t evicted_num = 0;
+
+    if (block_size < HEAP_CACHE_GRANULE) {
+        return false;
+    }
+    const size_t cls = block_size / HEAP_CACHE_GRANULE - 1;
+    if (cls >= CACHE_CLASS_NUM) {
+        return false;
+    }
+
+    cache_slot_t *slot = &s_cache_slots[cache_slot_index()];
+    CACHE_LOCK(&slot->lock);
+    if (slot->count[cls] == CACHE_DEPTH) {
+        // the magazine is full: give back its oldest half, keeping the recently freed blocks
+        evicted_num = CACHE_FLUSH_BATCH;
+        memcpy(evicted, slot->blocks[cls], evicted_num * sizeof(void *));
+        memmove(slot->blocks[cls], slot->blocks[cls] + evicted_num, (CACHE_DEPTH - evicted_num) * sizeof(void *));
+        slot->count[cls] -= evicted_num;
+        slot->flushed_blocks += evicted_num;
+    }
+    slot->blocks[cls][slot->count[cls]++] = ptr;
+    CACHE_UNLOCK(&slot->lock);
+
+    // free outside of the cache lock, so the heap lock is never taken while holding it
+    for (size_t i = 0; i < evicted_num; i++) {
+        heap_caps_cache_release(evicted[i]);
+    }
+    return true;
+}
+
+void heap_caps_cache_flush(void)
+{
+    void *evicted[CACHE_FLUSH_BATCH];
+
+    for (int i = 0; i < CACHE_SLOT_NUM; i++) {
+        cache_slot_t *slot = &s_cache_slots[i];
+        for (size_t cls = 0; cls < CACHE_CLASS_NUM; cls++) {
+            size_t evicted_num;
+            do {
+                CACHE_LOCK(&slot->lock);
+                evicted_num = slot->count[cls];
+                if (evicted_num > CACHE_FLUSH_BATCH) {
+                    evicted_num = CACHE_FLUSH_BATCH;
+                }
+                slot->count[cls] -= evicted_num;
+                memcpy(evicted, slot->blocks[cls] + slot->count[cls], evicted_num * sizeof(void *));
+                slot->flushed_blocks += evicted_num;
+                CACHE_UNLOCK(&slot->lock);
+
+                for (size_t j = 0; j < evicted_num; j++) {
+                    heap_caps_cache_release(evicted[j]);
+                }
+            } while (evicted_num > 0);
+        }
+    }
+}
+
+void heap_caps_cache_get_stats(heap_caps_cache_stats_t *stats)
+{
+    memset(stats, 0, sizeof(heap_caps_cache_stats_t));
+
+    for (int i = 0; i < CACHE_SLOT_NUM; i++) {
+        cache_slot_t *slot = &s_cache_slots[i];
+        CACHE_LOCK(&slot->lock);
+        stats->hits += slot->hits;
+        stats->misses += slot->misses;
+        stats->flushed_blocks += slot->flushed_blocks;
+        for (size_t cls = 0; cls < CACHE_CLASS_NUM; cls++) {
+            stats->cached_blocks += slot->count[cls];
+            stats->cached_bytes += slot->count[cls] * (cls + 1) * HEAP_CACHE_GRANULE;
+        }
+        CACHE_UNLOCK(&slot->lock);
+    }
+}
+
+#else // CONFIG_HEAP_MAGAZINE_CACHE
+
+void heap_caps_cache_flush(void)
+{
+}
+
+void heap_caps_cache_get_stats(heap_caps_cache_stats_t *stats)
+{
+    memset(stats, 0, sizeof(heap_caps_cache_stats_t));
+}
+
+#endif // CONFIG_HEAP_MAGAZINE_CACHE
@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Small allocation cache (CONFIG_HEAP_MAGAZINE_CACHE), shared by heap_caps.c and heap_caps_linux.c.
+
+   Freed blocks of up to HEAP_CACHE_MAX_SIZE bytes are kept in per-core (per-thread on Linux) magazines, one per
+   size class of HEAP_CACHE_GRANULE bytes, and handed out again without walking the heaps or taking their locks.
+   When a magazine is full, half of it is returned to the heap in one go.
+*/
+
+#define HEAP_CACHE_GRANULE      16
+
+#if CONFIG_HEAP_MAGAZINE_CACHE
+#define HEAP_CACHE_MAX_SIZE     (CONFIG_HEAP_MAGAZINE_CACHE_MAX_SIZE & ~(HEAP_CACHE_GRANULE - 1))
+#else
+#define HEAP_CACHE_MAX_SIZE     0
+#endif
+
+/* Blocks are only cached if they come from a heap with all of these capabilities, so a cached block can be
+   returned for any allocation whose capabilities are a subset of them. */
+#define HEAP_CACHE_CAPS (MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT | MALLOC_CAP_32BIT)
+
+/* Return true if an allocation of this size and these capabilities can be served by the cache */
+static inline bool heap_caps_cache_accepts(size_t size, uint32_t caps)
+{
+    return size <= HEAP_CACHE_MAX_SIZE && (caps & ~HEAP_CACHE_CAPS) == 0;
+}
+
+/* Size to allocate from the heap on a cache miss, so that the block fits its whole size class once freed */
+static inline size_t heap_caps_cache_block_size(size_t size)
+{
+    return (size + HEAP_CACHE_GRANULE - 1) & ~(HEAP_CACHE_GRANULE - 1);
+}
+
+/* Take a block of at least 'size' bytes from the cache of the current core, or return NULL on a miss */
+void *heap_caps_cache_get(size_t size);
+
+/* Put a freed block of 'block_size' usable bytes into the cache of the current core.
+
+   Returns false if the block isn't cached, in which case the caller frees it.
+*/
+bool heap_caps_cache_put(void *ptr, size_t block_size);
+
+/* Free a block from the cache back to its heap. Implemented by heap_caps.c / heap_caps_linux.c */
+void heap_caps_cache_release(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,9 +9,20 @@
 #include <malloc.h>
 #endif
 #include <string.h>
+#include "sdkconfig.h"
+#if CONFIG_HEAP_MAGAZINE_CACHE
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#define malloc_usable_size(ptr) malloc_size(ptr)
+#else
+#include <malloc.h>
+#endif
+#endif
 
 #include "esp_attr.h"
 #include "esp_heap_caps.h"
+#include "esp_heap_caps_pool.h"
+#include "heap_caps_cache.h"
 
 static esp_alloc_failed_hook_t alloc_failed_callback;
 
@@ -44,6 +55,16 @@ Routine to allocate a bit of memory with certain capabilities. caps is a bitfiel
 */
 static void *heap_caps_malloc_base( size_t size, uint32_t caps)
 {
+#if CONFIG_HEAP_MAGAZINE_CACHE
+    // there is a single kind of memory on linux, so the capabilities don't restrict the use of the cache
+    if (size > 0 && size <= HEAP_CACHE_MAX_SIZE) {
+        void *ptr = heap_caps_cache_get(size);
+        if (ptr != NULL) {
+            return ptr;
+        }
+        size = heap_caps_cache_block_size(size);
+    }
+#endif
 
     void *ptr = malloc(size);
 
@@ -80,7 +101,7 @@ void *heap_caps_malloc_prefer( size_t size, size_t num, ... )
 
 static void *heap_caps_realloc_base( void *ptr, size_t size, uint32_t caps)
 {
-    ptr = realloc(ptr, caps);
+    ptr = realloc(ptr, size);
 
     if (ptr == NULL && size > 0) {
         heap_caps_alloc_failed(size, caps, __func__);
@@ -105,9 +126,21 @@ void *heap_caps_realloc_prefer( void *ptr, size_t size, size_t num, ... )
 }
 
 void heap_caps_free( void *ptr)
+{
+#if CONFIG_HEAP_MAGAZINE_CACHE
+    if (ptr != NULL && heap_caps_cache_put(ptr, malloc_usable_size(ptr))) {
+        return;
+    }
+#endif
+    free(ptr);
+}
+
+#if CONFIG_HEAP_MAGAZINE_CACHE
+void heap_caps_cache_release(void *ptr)
 {
     free(ptr);
 }
+#endif
 
 static void *heap_caps_calloc_base( size_t n, size_t size, uint32_t caps)
 {
@@ -184,6 +217,7 @@ bool heap_caps_check_integrity_addr(intptr_t addr, bool print_errors)
 
 void heap_caps_dump(uint32_t caps)
 {
+    heap_caps_pool_dump(caps);
 }
 
 void heap_caps_dump_all(void)
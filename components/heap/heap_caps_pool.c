@@ -0,0 +1,339 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/queue.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_pool.h"
+
+/*
+ The objects of a pool are stored in up to HEAP_CAPS_POOL_MAX_SLABS slabs of 'slab_objects' objects each, and are
+ numbered across the slabs. The free objects form a singly linked list (a Treiber stack), where each free object
+ holds the index of the next one in its first word.
+
+ The head of the list packs the index of the first free object with a counter which is incremented by each
+ change, so that a compare-and-swap on the head fails if the list was changed in between, even if the same object
+ is on top of it again (the ABA problem). Slabs are never freed before the pool is deleted, so reading the next
+ index of an object which was allocated in between is harmless.
+*/
+
+#define POOL_NO_OBJECT      0xFFFF
+#define POOL_INDEX_MASK     0xFFFF
+#define POOL_TAG_SHIFT      16
+
+#if CONFIG_IDF_TARGET_LINUX
+
+#include <stdio.h>
+#include <pthread.h>
+
+typedef pthread_mutex_t pool_lock_t;
+#define POOL_LOCK_STATIC_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define POOL_LOCK(PLOCK) pthread_mutex_lock(PLOCK)
+#define POOL_UNLOCK(PLOCK) pthread_mutex_unlock(PLOCK)
+#define POOL_PRINTF(MSG, ...) fprintf(stderr, MSG, __VA_ARGS__)
+#define POOL_IN_ISR() false
+
+#else // CONFIG_IDF_TARGET_LINUX
+
+#include "heap_private.h"
+
+typedef multi_heap_lock_t pool_lock_t;
+#define POOL_LOCK_STATIC_INITIALIZER MULTI_HEAP_LOCK_STATIC_INITIALIZER
+#define POOL_LOCK(PLOCK) MULTI_HEAP_LOCK(PLOCK)
+#define POOL_UNLOCK(PLOCK) MULTI_HEAP_UNLOCK(PLOCK)
+#define POOL_PRINTF MULTI_HEAP_STDERR_PRINTF
+#define POOL_IN_ISR() xPortInIsrContext()
+
+#endif // CONFIG_IDF_TARGET_LINUX
+
+struct heap_caps_pool {
+    uint32_t head;              ///< Index of the first free object, and change counter in the upper bits
+    size_t used;                ///< Number of allocated objects
+    size_t min_free;            ///< Lowest number of unallocated objects since the pool was created
+    size_t slab_num;            ///< Number of slabs which are allocated
+    size_t max_slabs;
+    size_t slab_objects;        ///< Number of objects per slab
+    size_t stride;              ///< Size of an object, including padding
+    uint32_t caps;
+    uint8_t *slabs[HEAP_CAPS_POOL_MAX_SLABS];
+    SLIST_ENTRY(heap_caps_pool) next;
+};
+
+/* All pools, for heap_caps_get_pool_info() and heap_caps_pool_dump() */
+static SLIST_HEAD(pool_ll, heap_caps_pool) s_pools = SLIST_HEAD_INITIALIZER(s_pools);
+static pool_lock_t s_pools_lock = POOL_LOCK_STATIC_INITIALIZER;
+
+IRAM_ATTR static inline uint32_t *pool_object(heap_caps_pool_handle_t pool, uint32_t index)
+{
+    uint8_t *slab = __atomic_load_n(&pool->slabs[index / pool->slab_objects], __ATOMIC_ACQUIRE);
+    return (uint32_t *)(slab + (index % pool->slab_objects) * pool->stride);
+}
+
+IRAM_ATTR static void *pool_pop(heap_caps_pool_handle_t pool)
+{
+    uint32_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    uint32_t *obj;
+    uint32_t new_head;
+
+    do {
+        const uint32_t index = head & POOL_INDEX_MASK;
+        if (index == POOL_NO_OBJECT) {
+            return NULL;
+        }
+        obj = pool_object(pool, index);
+        const uint32_t next = __atomic_load_n(obj, __ATOMIC_RELAXED) & POOL_INDEX_MASK;
+        new_head = (((head >> POOL_TAG_SHIFT) + 1) << POOL_TAG_SHIFT) | next;
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, new_head, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    return obj;
+}
+
+/* Push the objects from 'first' to 'last', which are already linked to each other */
+IRAM_ATTR static void pool_push(heap_caps_pool_handle_t pool, uint32_t first, uint32_t last)
+{
+    uint32_t *last_obj = pool_object(pool, last);
+    uint32_t head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+    uint32_t new_head;
+
+    do {
+        __atomic_store_n(last_obj, head & POOL_INDEX_MASK, __ATOMIC_RELAXED);
+        new_head = (((head >> POOL_TAG_SHIFT) + 1) << POOL_TAG_SHIFT) | first;
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, new_head, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/* Link the objects of a new slab to each other, and return the index of the first one */
+static uint32_t pool_init_slab(heap_caps_pool_handle_t pool, size_t slab)
+{
+    const uint32_t first = slab * pool->slab_objects;
+    for (uint32_t i = 0; i < pool->slab_objects - 1; i++) {
+        *(uint32_t *)(pool->slabs[slab] + i * pool->stride) = first + i + 1;
+    }
+    *(uint32_t *)(pool->slabs[slab] + (pool->slab_objects - 1) * pool->stride) = POOL_NO_OBJECT;
+    return first;
+}
+
+/*
+ Add a slab to the pool. Tasks which run out of objects at the same time may each allocate a slab; the first one
+ to claim the next slot keeps it and the others free theirs. Returns false if the pool can't grow any more.
+*/
+IRAM_ATTR static bool pool_grow(heap_caps_pool_handle_t pool)
+{
+    size_t slab = __atomic_load_n(&pool->slab_num, __ATOMIC_ACQUIRE);
+    if (slab >= pool->max_slabs) {
+        return false;
+    }
+
+    uint8_t *mem = heap_caps_malloc(pool->slab_objects * pool->stride, pool->caps);
+    if (mem == NULL) {
+        return false;
+    }
+
+    uint8_t *expected = NULL;
+    if (!__atomic_compare_exchange_n(&pool->slabs[slab], &expected, mem, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        // another task added this slab, help it to move on to the next one
+        heap_caps_free(mem);
+        __atomic_compare_exchange_n(&pool->slab_num, &slab, slab + 1, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    const uint32_t first = pool_init_slab(pool, slab);
+    __atomic_compare_exchange_n(&pool->slab_num, &slab, slab + 1, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    pool_push(pool, first, first + pool->slab_objects - 1);
+    return true;
+}
+
+heap_caps_pool_handle_t heap_caps_pool_create(size_t obj_size, size_t count, uint32_t caps)
+{
+    const heap_caps_pool_config_t config = {
+        .obj_size = obj_size,
+        .count = count,
+        .max_count = 0,
+        .caps = caps,
+    };
+    return heap_caps_pool_create_with_config(&config);
+}
+
+heap_caps_pool_handle_t heap_caps_pool_create_with_config(const heap_caps_pool_config_t *config)
+{
+    if (config == NULL || config->obj_size == 0 || config->obj_size > SIZE_MAX - sizeof(void *)
+            || config->count == 0 || config->count > HEAP_CAPS_POOL_MAX_OBJECTS) {
+        return NULL;
+    }
+    const size_t max_slabs = (config->max_count > config->count) ? config->max_count / config->count : 1;
+    if (max_slabs * config->count > HEAP_CAPS_POOL_MAX_OBJECTS || max_slabs > HEAP_CAPS_POOL_MAX_SLABS) {
+        return NULL;
+    }
+
+    // free objects hold the index of the next one, and objects are aligned like pointers
+    size_t stride = (config->obj_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (stride < sizeof(uint32_t)) {
+        stride = sizeof(uint32_t);
+    }
+    size_t slab_size;
+    if (__builtin_mul_overflow(stride, config->count, &slab_size)) {
+        return NULL;
+    }
+
+    heap_caps_pool_handle_t pool = heap_caps_calloc(1, sizeof(struct heap_caps_pool), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->slabs[0] = heap_caps_malloc(slab_size, config->caps);
+    if (pool->slabs[0] == NULL) {
+        heap_caps_free(pool);
+        return NULL;
+    }
+    pool->slab_objects = config->count;
+    pool->stride = stride;
+    pool->caps = config->caps;
+    pool->max_slabs = max_slabs;
+    pool->slab_num = 1;
+    pool->min_free = config->count;
+    pool->head = pool_init_slab(pool, 0);
+
+    POOL_LOCK(&s_pools_lock);
+    SLIST_INSERT_HEAD(&s_pools, pool, next);
+    POOL_UNLOCK(&s_pools_lock);
+    return pool;
+}
+
+void heap_caps_pool_delete(heap_caps_pool_handle_t pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    POOL_LOCK(&s_pools_lock);
+    SLIST_REMOVE(&s_pools, pool, heap_caps_pool, next);
+    POOL_UNLOCK(&s_pools_lock);
+
+    for (size_t i = 0; i < HEAP_CAPS_POOL_MAX_SLABS; i++) {
+        heap_caps_free(pool->slabs[i]);
+    }
+    heap_caps_free(pool);
+}
+
+IRAM_ATTR void *heap_caps_pool_alloc(heap_caps_pool_handle_t pool)
+{
+    void *obj;
+
+    while ((obj = pool_pop(pool)) == NULL) {
+        /* Note: if the last slab was added by another task which didn't push its objects yet, this fails even though
+           objects are about to become available. The pool doesn't grow in an ISR, where the heap can't be used. */
+        if (POOL_IN_ISR() || !pool_grow(pool)) {
+            return NULL;
+        }
+    }
+
+    const size_t used = __atomic_add_fetch(&pool->used, 1, __ATOMIC_RELAXED);
+    const size_t total = __atomic_load_n(&pool->slab_num, __ATOMIC_RELAXED) * pool->slab_objects;
+    const size_t free_objs = (used < total) ? total - used : 0;
+    size_t min_free = __atomic_load_n(&pool->min_free, __ATOMIC_RELAXED);
+    while (free_objs < min_free
+            && !__atomic_compare_exchange_n(&pool->min_free, &min_free, free_objs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // another task changed the minimum, compare again
+    }
+    return obj;
+}
+
+IRAM_ATTR void heap_caps_pool_free(heap_caps_pool_handle_t pool, void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    uint32_t index = POOL_NO_OBJECT;
+    const size_t slab_num = __atomic_load_n(&pool->slab_num, __ATOMIC_ACQUIRE);
+    for (size_t slab = 0; slab < slab_num; slab++) {
+        const intptr_t offset = (intptr_t)ptr - (intptr_t)pool->slabs[slab];
+        if (offset >= 0 && offset < (intptr_t)(pool->slab_objects * pool->stride)) {
+            assert(offset % pool->stride == 0 && "heap_caps_pool_free() pointer is not the start of an object");
+            index = slab * pool->slab_objects + offset / pool->stride;
+            break;
+        }
+    }
+    assert(index != POOL_NO_OBJECT && "heap_caps_pool_free() pointer is outside the pool");
+
+    pool_push(pool, index, index);
+    __atomic_sub_fetch(&pool->used, 1, __ATOMIC_RELAXED);
+}
+
+static void pool_add_info(heap_caps_pool_handle_t pool, heap_caps_pool_info_t *info)
+{
+    const size_t total = __atomic_load_n(&pool->slab_num, __ATOMIC_ACQUIRE) * pool->slab_objects;
+    const size_t used = __atomic_load_n(&pool->used, __ATOMIC_RELAXED);
+    // 'used' is updated after the free list, so it may briefly be off by the objects being allocated or freed
+    const size_t free_objs = (used < total) ? total - used : 0;
+
+    info->total_objects += total;
+    info->free_objects += free_objs;
+    info->total_bytes += total * pool->stride;
+    info->free_bytes += free_objs * pool->stride;
+    info->minimum_free_bytes += __atomic_load_n(&pool->min_free, __ATOMIC_RELAXED) * pool->stride;
+    info->pools++;
+}
+
+void heap_caps_pool_get_info(heap_caps_pool_handle_t pool, heap_caps_pool_info_t *info)
+{
+    memset(info, 0, sizeof(heap_caps_pool_info_t));
+    pool_add_info(pool, info);
+    info->obj_size = pool->stride;
+}
+
+/* Whether the pool is in memory with all of the given capabilities */
+static bool pool_match_caps(heap_caps_pool_handle_t pool, uint32_t caps)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    // there is a single kind of memory on linux
+    (void)pool;
+    (void)caps;
+    return true;
+#else
+    const intptr_t p = (intptr_t)pool->slabs[0];
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap->heap != NULL && p >= heap->start && p < heap->end) {
+            return heap_caps_match(heap, caps);
+        }
+    }
+    return false;
+#endif
+}
+
+void heap_caps_get_pool_info(heap_caps_pool_info_t *info, uint32_t caps)
+{
+    memset(info, 0, sizeof(heap_caps_pool_info_t));
+
+    heap_caps_pool_handle_t pool;
+    POOL_LOCK(&s_pools_lock);
+    SLIST_FOREACH(pool, &s_pools, next) {
+        if (pool_match_caps(pool, caps)) {
+            pool_add_info(pool, info);
+        }
+    }
+    POOL_UNLOCK(&s_pools_lock);
+}
+
+void heap_caps_pool_dump(uint32_t caps)
+{
+    bool all_pools = caps & MALLOC_CAP_INVALID;
+    heap_caps_pool_handle_t pool;
+
+    POOL_LOCK(&s_pools_lock);
+    SLIST_FOREACH(pool, &s_pools, next) {
+        if (all_pools || pool_match_caps(pool, caps)) {
+            heap_caps_pool_info_t info = { 0 };
+            pool_add_info(pool, &info);
+            POOL_PRINTF("pool %p: object size %d objects %d free %d slabs %d/%d\n", pool, (int)pool->stride,
+                        (int)info.total_objects, (int)info.free_objects,
+                        (int)__atomic_load_n(&pool->slab_num, __ATOMIC_RELAXED), (int)pool->max_slabs);
+        }
+    }
+    POOL_UNLOCK(&s_pools_lock);
+}
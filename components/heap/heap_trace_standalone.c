@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -21,6 +21,8 @@
 
 #if CONFIG_HEAP_TRACING_STANDALONE
 
+#define HASH_MAP_SIZE CONFIG_HEAP_TRACE_HASH_MAP_SIZE
+
 static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
 static bool tracing;
 static heap_trace_mode_t mode;
@@ -29,6 +31,10 @@ static heap_trace_mode_t mode;
 TAILQ_HEAD(heap_trace_record_list_struct_t, heap_trace_record_t);
 typedef struct heap_trace_record_list_struct_t heap_trace_record_list_t;
 
+/* Hash map of the records in records.list, by address. A record which is not in the
+   hash map (e.g. a freed record in HEAP_TRACE_ALL mode) has a NULL tailq_hashmap.tqe_prev. */
+static heap_trace_record_list_t hash_map[HASH_MAP_SIZE];
+
 /* Linked List of Records */
 typedef struct {
 
@@ -63,7 +69,11 @@ static void list_setup(void);
 static void list_remove(heap_trace_record_t* r_remove);
 static bool list_add(const heap_trace_record_t* r_append);
 static heap_trace_record_t* list_pop_unused(void);
-static heap_trace_record_t* list_find_address_reverse(void* p);
+static void map_add(heap_trace_record_t *r_add);
+static void map_remove(heap_trace_record_t *r_remove);
+static heap_trace_record_t* map_find(void *p);
+static void callsite_add(const heap_trace_record_t *r_alloc);
+static void callsite_release(const heap_trace_record_t *r_free);
 
 /* The actual records. */
 static records_t records;
@@ -74,6 +84,23 @@ static size_t total_allocations;
 /* Actual number of frees logged */
 static size_t total_frees;
 
+/* Number of allocations which were not recorded because of sampling */
+static size_t skipped_allocations;
+
+/* Sampling of the allocations, see heap_trace_set_sampling() */
+static heap_trace_sample_mode_t sample_mode;
+static size_t sample_period;
+static size_t sample_count; // allocations or bytes since the last recorded allocation
+
+/* Statistics of the recorded allocations per call stack, see heap_trace_init_callsites().
+   The buffer is an open addressing hash table, an entry with no allocations is empty. */
+static struct {
+    heap_trace_callsite_t *buffer;
+    size_t capacity;
+    size_t count;
+    bool has_overflowed;
+} callsites;
+
 /* Used to speed up heap_trace_get */
 static heap_trace_record_t* r_get;
 static size_t r_get_idx;
@@ -94,6 +121,44 @@ esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t
     return ESP_OK;
 }
 
+esp_err_t heap_trace_set_sampling(heap_trace_sample_mode_t sample_mode_param, size_t period)
+{
+    if (tracing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (sample_mode_param > HEAP_TRACE_SAMPLE_BYTES || (sample_mode_param != HEAP_TRACE_SAMPLE_NONE && period == 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&trace_mux);
+    sample_mode = sample_mode_param;
+    sample_period = (sample_mode == HEAP_TRACE_SAMPLE_NONE) ? 0 : period;
+    sample_count = 0;
+    portEXIT_CRITICAL(&trace_mux);
+
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_init_callsites(heap_trace_callsite_t *callsite_buffer, size_t num_callsites)
+{
+    if (tracing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&trace_mux);
+    callsites.buffer = (num_callsites != 0) ? callsite_buffer : NULL;
+    callsites.capacity = (callsite_buffer != NULL) ? num_callsites : 0;
+    callsites.count = 0;
+    callsites.has_overflowed = false;
+    if (callsites.buffer) {
+        memset(callsites.buffer, 0, sizeof(heap_trace_callsite_t) * callsites.capacity);
+    }
+    portEXIT_CRITICAL(&trace_mux);
+
+    return ESP_OK;
+}
+
 esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
 {
     if (records.buffer == NULL || records.capacity == 0) {
@@ -112,8 +177,16 @@ esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
     records.has_overflowed = false;
     list_setup();
 
+    if (callsites.buffer) {
+        memset(callsites.buffer, 0, sizeof(heap_trace_callsite_t) * callsites.capacity);
+    }
+    callsites.count = 0;
+    callsites.has_overflowed = false;
+
     total_allocations = 0;
     total_frees = 0;
+    skipped_allocations = 0;
+    sample_count = 0;
     heap_trace_resume();
 
     portEXIT_CRITICAL(&trace_mux);
@@ -144,6 +217,38 @@ size_t heap_trace_get_count(void)
     return records.count;
 }
 
+size_t heap_trace_get_callsite_count(void)
+{
+    return callsites.count;
+}
+
+esp_err_t heap_trace_get_callsite(size_t index, heap_trace_callsite_t *callsite)
+{
+    if (callsite == NULL || callsites.buffer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t result = ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&trace_mux);
+
+    // the used entries are spread over the hash table, skip the empty ones
+    for (size_t i = 0; i < callsites.capacity; i++) {
+        if (callsites.buffer[i].allocations == 0) {
+            continue;
+        }
+        if (index == 0) {
+            memcpy(callsite, &callsites.buffer[i], sizeof(heap_trace_callsite_t));
+            result = ESP_OK;
+            break;
+        }
+        index--;
+    }
+
+    portEXIT_CRITICAL(&trace_mux);
+    return result;
+}
+
 esp_err_t heap_trace_get(size_t index, heap_trace_record_t *r_out)
 {
     if (r_out == NULL) {
@@ -207,12 +312,17 @@ esp_err_t heap_trace_summary(heap_trace_summary_t *summary)
 
     portENTER_CRITICAL(&trace_mux);
     summary->mode = mode;
-    summary->total_allocations = total_allocations;
+    summary->total_allocations = total_allocations + skipped_allocations;
     summary->total_frees = total_frees;
     summary->count = records.count;
     summary->capacity = records.capacity;
     summary->high_water_mark = records.high_water_mark;
     summary->has_overflowed = records.has_overflowed;
+    summary->sample_mode = sample_mode;
+    summary->sample_period = sample_period;
+    summary->skipped_allocations = skipped_allocations;
+    summary->callsite_count = callsites.count;
+    summary->callsites_overflowed = callsites.has_overflowed;
     portEXIT_CRITICAL(&trace_mux);
 
     return ESP_OK;
@@ -288,6 +398,24 @@ static void heap_trace_dump_base(bool internal_ram, bool psram)
         rCur = TAILQ_NEXT(rCur, tailq);
     }
 
+    if (callsites.buffer) {
+        esp_rom_printf("====== Heap Trace Callsites: %u (%u capacity) ======\n", callsites.count, callsites.capacity);
+
+        for (size_t i = 0; i < callsites.capacity; i++) {
+            const heap_trace_callsite_t *c = &callsites.buffer[i];
+            if (c->allocations == 0) {
+                continue;
+            }
+            esp_rom_printf("%6u bytes alive in %u allocations (%u bytes in %u allocations recorded) caller ",
+                   c->live_bytes, c->live_allocations, c->bytes, c->allocations);
+            for (int j = 0; j < STACK_DEPTH && c->alloced_by[j] != 0; j++) {
+                esp_rom_printf("%p%s", c->alloced_by[j],
+                       (j < STACK_DEPTH - 1) ? ":" : "");
+            }
+            esp_rom_printf("\n");
+        }
+    }
+
     esp_rom_printf("====== Heap Trace Summary ======\n");
 
     if (mode == HEAP_TRACE_ALL) {
@@ -302,20 +430,66 @@ static void heap_trace_dump_base(bool internal_ram, bool psram)
     esp_rom_printf("records: %u (%u capacity, %u high water mark)\n",
         records.count, records.capacity, records.high_water_mark);
 
-    esp_rom_printf("total allocations: %u\n", total_allocations);
+    esp_rom_printf("total allocations: %u\n", total_allocations + skipped_allocations);
     esp_rom_printf("total frees: %u\n", total_frees);
 
+    if (sample_mode == HEAP_TRACE_SAMPLE_COUNT) {
+        esp_rom_printf("sampling: 1 allocation every %u allocations (%u recorded)\n", sample_period, total_allocations);
+    } else if (sample_mode == HEAP_TRACE_SAMPLE_BYTES) {
+        esp_rom_printf("sampling: 1 allocation every %u bytes (%u recorded)\n", sample_period, total_allocations);
+    }
+
     if (start_count != records.count) { // only a problem if trace isn't stopped before dumping
         esp_rom_printf("(NB: New entries were traced while dumping, so trace dump may have duplicate entries.)\n");
     }
     if (records.has_overflowed) {
         esp_rom_printf("(NB: Internal Buffer has overflowed, so trace data is incomplete.)\n");
     }
+    if (callsites.has_overflowed) {
+        esp_rom_printf("(NB: Callsite Buffer has overflowed, so callsite data is incomplete.)\n");
+    }
     esp_rom_printf("================================\n");
 
     portEXIT_CRITICAL(&trace_mux);
 }
 
+/* Decide whether an allocation of 'size' bytes is recorded, according to the sampling mode.
+   Called for every allocation before its call stack is read, see HEAP_TRACE_SAMPLE_ALLOCATION. */
+static IRAM_ATTR bool sample_allocation(size_t size)
+{
+    if (!tracing) {
+        return false;
+    }
+    if (sample_mode == HEAP_TRACE_SAMPLE_NONE) {
+        return true;
+    }
+
+    bool sampled = false;
+
+    portENTER_CRITICAL(&trace_mux);
+
+    if (sample_mode == HEAP_TRACE_SAMPLE_COUNT) {
+        if (++sample_count >= sample_period) {
+            sample_count = 0;
+            sampled = true;
+        }
+    } else { // HEAP_TRACE_SAMPLE_BYTES
+        sample_count += size;
+        if (sample_count >= sample_period) {
+            sample_count %= sample_period;
+            sampled = true;
+        }
+    }
+    if (!sampled) {
+        skipped_allocations++;
+    }
+
+    portEXIT_CRITICAL(&trace_mux);
+    return sampled;
+}
+
+#define HEAP_TRACE_SAMPLE_ALLOCATION(size) sample_allocation(size)
+
 /* Add a new allocation to the heap trace records */
 static IRAM_ATTR void record_allocation(const heap_trace_record_t *rAllocation)
 {
@@ -341,6 +515,8 @@ static IRAM_ATTR void record_allocation(const heap_trace_record_t *rAllocation)
         // push onto end of list
         list_add(rAllocation);
 
+        callsite_add(rAllocation);
+
         total_allocations++;
     }
 
@@ -367,15 +543,22 @@ static IRAM_ATTR void record_free(void *p, void **callers)
 
         total_frees++;
 
-        // search backwards for the allocation record matching this free
-        heap_trace_record_t* rFound = list_find_address_reverse(p);
+        // look up the allocation record matching this free. It's not
+        // found if the allocation wasn't recorded (e.g. not sampled)
+        heap_trace_record_t* rFound = map_find(p);
 
         if (rFound) {
+            callsite_release(rFound);
+
             if (mode == HEAP_TRACE_ALL) {
 
                 // add 'freed_by' info to the record
                 memcpy(rFound->freed_by, callers, sizeof(void *) * STACK_DEPTH);
 
+                // the record stays in the list, but a later free of the
+                // same address must not find it anymore
+                map_remove(rFound);
+
             } else { // HEAP_TRACE_LEAKS
 
                 // Leak trace mode, once an allocation is freed
@@ -400,6 +583,10 @@ static void list_setup(void)
 
         TAILQ_INSERT_TAIL(&records.unused, rCur, tailq);
     }
+
+    for (int i = 0; i < HASH_MAP_SIZE; i++) {
+        TAILQ_INIT(&hash_map[i]);
+    }
 }
 
 /* 1. removes record r_remove from records.list,
@@ -411,6 +598,8 @@ static IRAM_ATTR void list_remove(heap_trace_record_t* r_remove)
     // remove from records.list
     TAILQ_REMOVE(&records.list, r_remove, tailq);
 
+    map_remove(r_remove);
+
     // set as unused
     r_remove->address = 0;
     r_remove->size = 0;
@@ -472,6 +661,8 @@ static IRAM_ATTR bool list_add(const heap_trace_record_t *r_append)
         // append to records.list
         TAILQ_INSERT_TAIL(&records.list, rDest, tailq);
 
+        map_add(rDest);
+
         // increment
         records.count++;
 
@@ -488,26 +679,98 @@ static IRAM_ATTR bool list_add(const heap_trace_record_t *r_append)
     }
 }
 
-// search records.list backwards for the allocation record matching this address
-static IRAM_ATTR heap_trace_record_t* list_find_address_reverse(void* p)
+static IRAM_ATTR size_t hash_idx(void *p)
 {
-    if (records.count == 0) {
-        return NULL;
-    }
+    // allocations are at least 4 byte aligned, scramble the remaining bits
+    return ((uint32_t)((uintptr_t)p >> 2) * 2654435761U) % HASH_MAP_SIZE;
+}
+
+// add a record to its hash map bucket. New records are inserted first, so that
+// they are found before older records of the same address.
+static IRAM_ATTR void map_add(heap_trace_record_t *r_add)
+{
+    TAILQ_INSERT_HEAD(&hash_map[hash_idx(r_add->address)], r_add, tailq_hashmap);
+}
 
-    heap_trace_record_t* rFound = NULL;
+static IRAM_ATTR void map_remove(heap_trace_record_t *r_remove)
+{
+    if (r_remove->tailq_hashmap.tqe_prev == NULL) {
+        return; // not in the hash map
+    }
+    TAILQ_REMOVE(&hash_map[hash_idx(r_remove->address)], r_remove, tailq_hashmap);
+    r_remove->tailq_hashmap.tqe_prev = NULL;
+}
 
-    // Perf: We search backwards because new allocations are appended
-    // to the end of the list and most allocations are short lived.
+// find the most recent record of an address in the hash map
+static IRAM_ATTR heap_trace_record_t* map_find(void *p)
+{
     heap_trace_record_t *rCur = NULL;
-    TAILQ_FOREACH_REVERSE(rCur, &records.list, heap_trace_record_list_struct_t, tailq) {
+    TAILQ_FOREACH(rCur, &hash_map[hash_idx(p)], tailq_hashmap) {
         if (rCur->address == p) {
-            rFound = rCur;
-            break;
+            return rCur;
+        }
+    }
+    return NULL;
+}
+
+// find the entry of a call stack in the callsite buffer, or the empty entry where it should be
+// added. Returns NULL if the call stack is not in the buffer and the buffer is full.
+static IRAM_ATTR heap_trace_callsite_t* callsite_find(void * const *alloced_by)
+{
+    uint32_t hash = 2166136261U; // FNV-1a over the return addresses
+    for (int j = 0; j < STACK_DEPTH; j++) {
+        hash = (hash ^ (uint32_t)(uintptr_t)alloced_by[j]) * 16777619U;
+    }
+
+    size_t idx = hash % callsites.capacity;
+    for (size_t i = 0; i < callsites.capacity; i++) {
+        heap_trace_callsite_t *c = &callsites.buffer[idx];
+        if (c->allocations == 0
+            || memcmp(c->alloced_by, alloced_by, sizeof(void *) * STACK_DEPTH) == 0) {
+            return c;
         }
+        idx = (idx + 1 == callsites.capacity) ? 0 : idx + 1;
+    }
+    return NULL;
+}
+
+// count a recorded allocation in the statistics of its call stack
+static IRAM_ATTR void callsite_add(const heap_trace_record_t *r_alloc)
+{
+    if (callsites.buffer == NULL) {
+        return;
+    }
+
+    heap_trace_callsite_t *c = callsite_find(r_alloc->alloced_by);
+    if (c == NULL) {
+        callsites.has_overflowed = true;
+        return;
+    }
+
+    if (c->allocations == 0) {
+        memcpy(c->alloced_by, r_alloc->alloced_by, sizeof(void *) * STACK_DEPTH);
+        callsites.count++;
+    }
+    c->allocations++;
+    c->bytes += r_alloc->size;
+    c->live_allocations++;
+    c->live_bytes += r_alloc->size;
+}
+
+// count the free of a recorded allocation in the statistics of its call stack
+static IRAM_ATTR void callsite_release(const heap_trace_record_t *r_free)
+{
+    if (callsites.buffer == NULL) {
+        return;
+    }
+
+    heap_trace_callsite_t *c = callsite_find(r_free->alloced_by);
+    if (c == NULL || c->live_allocations == 0) {
+        return; // allocation wasn't counted, the buffer was full
     }
 
-    return rFound;
+    c->live_allocations--;
+    c->live_bytes -= r_free->size;
 }
 
 #include "heap_trace.inc"
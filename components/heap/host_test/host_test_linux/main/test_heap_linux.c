@@ -7,8 +7,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
 #include "sdkconfig.h"
 #include "esp_heap_caps.h"
+#include "esp_heap_caps_pool.h"
 #include "unity.h"
 
 #define MALLOC_LEN 1000
@@ -105,6 +108,287 @@ TEST_CASE("Misc APIs", "[heap]")
     TEST_ASSERT_TRUE(alloc_failed);
 }
 
+#define POOL_OBJ_SIZE 20
+#define POOL_COUNT 8
+
+TEST_CASE("Pool allocates and frees fixed-size objects", "[heap]")
+{
+    TEST_ASSERT_NULL(heap_caps_pool_create(0, POOL_COUNT, MALLOC_CAP_DEFAULT));
+    TEST_ASSERT_NULL(heap_caps_pool_create(POOL_OBJ_SIZE, 0, MALLOC_CAP_DEFAULT));
+    TEST_ASSERT_NULL(heap_caps_pool_create(POOL_OBJ_SIZE, HEAP_CAPS_POOL_MAX_OBJECTS + 1, MALLOC_CAP_DEFAULT));
+
+    heap_caps_pool_handle_t pool = heap_caps_pool_create(POOL_OBJ_SIZE, POOL_COUNT, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    uint8_t *objs[POOL_COUNT];
+    for (int i = 0; i < POOL_COUNT; i++) {
+        objs[i] = heap_caps_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(objs[i]);
+        TEST_ASSERT_EQUAL(0, (intptr_t)objs[i] % sizeof(void *));
+        memset(objs[i], i, POOL_OBJ_SIZE);
+    }
+    TEST_ASSERT_NULL(heap_caps_pool_alloc(pool));
+
+    heap_caps_pool_info_t info;
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(POOL_COUNT, info.total_objects);
+    TEST_ASSERT_EQUAL(0, info.free_objects);
+    TEST_ASSERT_TRUE(info.obj_size >= POOL_OBJ_SIZE);
+    TEST_ASSERT_EQUAL(info.obj_size * POOL_COUNT, info.total_bytes);
+    TEST_ASSERT_EQUAL(0, info.free_bytes);
+    TEST_ASSERT_EQUAL(0, info.minimum_free_bytes);
+
+    for (int i = 0; i < POOL_COUNT; i++) {
+        TEST_ASSERT_EACH_EQUAL_HEX8(i, objs[i], POOL_OBJ_SIZE);
+    }
+    heap_caps_pool_free(pool, objs[3]);
+    heap_caps_pool_free(pool, NULL);
+    TEST_ASSERT_EQUAL_PTR(objs[3], heap_caps_pool_alloc(pool));
+    for (int i = 0; i < POOL_COUNT; i++) {
+        heap_caps_pool_free(pool, objs[i]);
+    }
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(POOL_COUNT, info.free_objects);
+    TEST_ASSERT_EQUAL(info.total_bytes, info.free_bytes);
+    TEST_ASSERT_EQUAL(0, info.minimum_free_bytes);
+
+    heap_caps_pool_delete(pool);
+}
+
+TEST_CASE("Pool grows up to its maximum size", "[heap]")
+{
+    const heap_caps_pool_config_t config = {
+        .obj_size = POOL_OBJ_SIZE,
+        .count = POOL_COUNT,
+        .max_count = POOL_COUNT * 3,
+        .caps = MALLOC_CAP_DEFAULT,
+    };
+    heap_caps_pool_handle_t pool = heap_caps_pool_create_with_config(&config);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    heap_caps_pool_info_t before;
+    heap_caps_get_pool_info(&before, MALLOC_CAP_DEFAULT);
+
+    void *objs[POOL_COUNT * 3];
+    for (int i = 0; i < POOL_COUNT * 3; i++) {
+        objs[i] = heap_caps_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(objs[i]);
+    }
+    TEST_ASSERT_NULL(heap_caps_pool_alloc(pool));
+
+    /* The pools show up in the heap diagnostics */
+    heap_caps_pool_info_t after;
+    heap_caps_get_pool_info(&after, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_EQUAL(before.pools, after.pools);
+    TEST_ASSERT_EQUAL(before.total_objects + POOL_COUNT * 2, after.total_objects);
+    TEST_ASSERT_EQUAL(before.free_objects - POOL_COUNT, after.free_objects);
+    heap_caps_dump_all();
+
+    for (int i = 0; i < POOL_COUNT * 3; i++) {
+        heap_caps_pool_free(pool, objs[i]);
+    }
+    heap_caps_pool_delete(pool);
+    heap_caps_get_pool_info(&after, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_EQUAL(before.pools - 1, after.pools);
+}
+
+#define POOL_THREADS 4
+#define POOL_ROUNDS 20000
+#define POOL_HELD 4
+
+typedef struct {
+    heap_caps_pool_handle_t pool;
+    bool failed;
+} pool_thread_arg_t;
+
+static void *pool_thread(void *arg)
+{
+    pool_thread_arg_t *test = (pool_thread_arg_t *)arg;
+    uintptr_t *objs[POOL_HELD];
+    const uintptr_t mark = (uintptr_t)&objs;
+
+    for (int round = 0; round < POOL_ROUNDS && !test->failed; round++) {
+        for (int i = 0; i < POOL_HELD; i++) {
+            objs[i] = heap_caps_pool_alloc(test->pool);
+            if (objs[i] == NULL) {
+                test->failed = true;
+                return NULL;
+            }
+            objs[i][1] = mark;
+        }
+        for (int i = 0; i < POOL_HELD; i++) {
+            // an object handed out twice would have been overwritten by the other thread
+            if (objs[i][1] != mark) {
+                test->failed = true;
+            }
+            heap_caps_pool_free(test->pool, objs[i]);
+        }
+    }
+    return NULL;
+}
+
+TEST_CASE("Pool is shared between threads", "[heap]")
+{
+    const heap_caps_pool_config_t config = {
+        .obj_size = 2 * sizeof(uintptr_t),
+        .count = POOL_HELD,
+        .max_count = POOL_HELD * POOL_THREADS * 2,
+        .caps = MALLOC_CAP_DEFAULT,
+    };
+    pool_thread_arg_t test = {
+        .pool = heap_caps_pool_create_with_config(&config),
+        .failed = false,
+    };
+    TEST_ASSERT_NOT_NULL(test.pool);
+
+    pthread_t threads[POOL_THREADS];
+    for (int i = 0; i < POOL_THREADS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, pool_thread, &test));
+    }
+    for (int i = 0; i < POOL_THREADS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_join(threads[i], NULL));
+    }
+    TEST_ASSERT_FALSE(test.failed);
+
+    heap_caps_pool_info_t info;
+    heap_caps_pool_get_info(test.pool, &info);
+    TEST_ASSERT_EQUAL(info.total_objects, info.free_objects);
+    heap_caps_pool_delete(test.pool);
+}
+
+#if CONFIG_HEAP_MAGAZINE_CACHE
+
+#define CACHE_TEST_SIZE 24
+
+TEST_CASE("Small allocation cache reuses freed blocks", "[heap]")
+{
+    heap_caps_cache_stats_t before, after;
+
+    heap_caps_cache_flush();
+    heap_caps_cache_get_stats(&before);
+    TEST_ASSERT_EQUAL(0, before.cached_blocks);
+
+    uint8_t *p = heap_caps_malloc(CACHE_TEST_SIZE, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(p);
+    memset(p, TEST_VAL, CACHE_TEST_SIZE);
+    heap_caps_free(p);
+    heap_caps_cache_get_stats(&after);
+    TEST_ASSERT_EQUAL(1, after.cached_blocks);
+
+    /* Any size of the same size class gets the cached block back */
+    uint8_t *q = heap_caps_malloc(CACHE_TEST_SIZE + 4, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_EQUAL_PTR(p, q);
+    heap_caps_cache_get_stats(&after);
+    TEST_ASSERT_EQUAL(before.hits + 1, after.hits);
+    TEST_ASSERT_EQUAL(0, after.cached_blocks);
+
+    /* Large blocks are not cached */
+    uint8_t *large = heap_caps_malloc(CONFIG_HEAP_MAGAZINE_CACHE_MAX_SIZE + 100, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(large);
+    heap_caps_free(large);
+    heap_caps_cache_get_stats(&after);
+    TEST_ASSERT_EQUAL(0, after.cached_blocks);
+
+    /* Freeing more blocks than a magazine holds returns half of them to the heap */
+    uint8_t *blocks[CONFIG_HEAP_MAGAZINE_CACHE_DEPTH + 1];
+    blocks[0] = q;
+    for (int i = 1; i < CONFIG_HEAP_MAGAZINE_CACHE_DEPTH + 1; i++) {
+        blocks[i] = heap_caps_malloc(CACHE_TEST_SIZE, MALLOC_CAP_DEFAULT);
+        TEST_ASSERT_NOT_NULL(blocks[i]);
+    }
+    for (int i = 0; i < CONFIG_HEAP_MAGAZINE_CACHE_DEPTH + 1; i++) {
+        heap_caps_free(blocks[i]);
+    }
+    heap_caps_cache_get_stats(&after);
+    TEST_ASSERT_EQUAL(before.flushed_blocks + CONFIG_HEAP_MAGAZINE_CACHE_DEPTH / 2, after.flushed_blocks);
+    TEST_ASSERT_EQUAL(CONFIG_HEAP_MAGAZINE_CACHE_DEPTH / 2 + 1, after.cached_blocks);
+
+    heap_caps_cache_flush();
+    heap_caps_cache_get_stats(&after);
+    TEST_ASSERT_EQUAL(0, after.cached_blocks);
+    TEST_ASSERT_EQUAL(0, after.cached_bytes);
+}
+
+#define BENCH_THREADS 4
+#define BENCH_ROUNDS 20000
+#define BENCH_BLOCKS 16
+
+typedef struct {
+    bool use_heap_caps;
+    unsigned seed;
+    bool corrupted;
+} bench_arg_t;
+
+static void *bench_thread(void *arg)
+{
+    bench_arg_t *bench = (bench_arg_t *)arg;
+    uint8_t *blocks[BENCH_BLOCKS];
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int i = 0; i < BENCH_BLOCKS; i++) {
+            size_t size = 8 + rand_r(&bench->seed) % (CONFIG_HEAP_MAGAZINE_CACHE_MAX_SIZE - 8);
+            blocks[i] = bench->use_heap_caps ? heap_caps_malloc(size, MALLOC_CAP_DEFAULT) : malloc(size);
+            blocks[i][0] = (uint8_t)i;
+            blocks[i][size - 1] = (uint8_t)i;
+        }
+        for (int i = 0; i < BENCH_BLOCKS; i++) {
+            // a block handed out twice would have been overwritten by its other owner
+            if (blocks[i][0] != (uint8_t)i) {
+                bench->corrupted = true;
+            }
+            if (bench->use_heap_caps) {
+                heap_caps_free(blocks[i]);
+            } else {
+                free(blocks[i]);
+            }
+        }
+    }
+    return NULL;
+}
+
+static double bench_run(bool use_heap_caps)
+{
+    pthread_t threads[BENCH_THREADS];
+    bench_arg_t args[BENCH_THREADS];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_THREADS; i++) {
+        args[i] = (bench_arg_t) {
+            .use_heap_caps = use_heap_caps, .seed = i, .corrupted = false
+        };
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, bench_thread, &args[i]));
+    }
+    for (int i = 0; i < BENCH_THREADS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_join(threads[i], NULL));
+        TEST_ASSERT_FALSE(args[i].corrupted);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return elapsed_ns / ((double)BENCH_THREADS * BENCH_ROUNDS * BENCH_BLOCKS);
+}
+
+TEST_CASE("Small allocation cache benchmark", "[heap]")
+{
+    heap_caps_cache_stats_t before, after;
+
+    heap_caps_cache_get_stats(&before);
+    double cached_ns = bench_run(true);
+    heap_caps_cache_get_stats(&after);
+    double libc_ns = bench_run(false);
+
+    printf("%d threads, malloc+free of small blocks: heap_caps with cache %.1f ns, libc %.1f ns\n",
+           BENCH_THREADS, cached_ns, libc_ns);
+    printf("cache hits %zu misses %zu flushed blocks %zu\n",
+           after.hits - before.hits, after.misses - before.misses, after.flushed_blocks - before.flushed_blocks);
+    TEST_ASSERT_GREATER_THAN(after.misses - before.misses, after.hits - before.hits);
+
+    heap_caps_cache_flush();
+}
+
+#endif // CONFIG_HEAP_MAGAZINE_CACHE
+
 void app_main(void)
 {
     printf("Running heap linux API host test app");
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2019-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2019-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -175,6 +175,8 @@ size_t heap_caps_get_total_size(uint32_t caps);
  *
  * @note Note that because of heap fragmentation it is probably not possible to allocate a single block of memory
  * of this size. Use heap_caps_get_largest_free_block() for this purpose.
+ *
+ * @note The unallocated objects of pools of fixed-size objects (see esp_heap_caps_pool.h) are counted as free.
 
  * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
  *                    of memory
@@ -192,7 +194,8 @@ size_t heap_caps_get_free_size( uint32_t caps );
  *
  * @note Note the result may be less than the global all-time minimum available heap of this kind, as "low watermarks" are
  * tracked per-region. Individual regions' heaps may have reached their "low watermarks" at different points in time. However,
- * this result still gives a "worst case" indication for all-time minimum free heap.
+ * this result still gives a "worst case" indication for all-time minimum free heap. The low watermarks of
+ * pools of fixed-size objects are added in the same way.
  *
  * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
  *                    of memory
@@ -220,6 +223,8 @@ size_t heap_caps_get_largest_free_block( uint32_t caps );
  * Calls multi_heap_info() on all heaps which share the given capabilities. The information returned is an aggregate
  * across all matching heaps. The meanings of fields are the same as defined for multi_heap_info_t, except that
  * ``minimum_free_bytes`` has the same caveats described in heap_caps_get_minimum_free_size().
+ * The unallocated objects of pools of fixed-size objects are counted in ``total_free_bytes`` instead of
+ * ``total_allocated_bytes``.
  *
  * @param info        Pointer to a structure which will be filled with relevant
  *                    heap metadata.
@@ -395,6 +400,36 @@ void heap_caps_dump_all(void);
  */
 size_t heap_caps_get_allocated_size( void *ptr );
 
+/**
+ * @brief Statistics of the small allocation cache
+ *
+ * @note Blocks held by the cache are counted as allocated by heap_caps_get_info() and related functions.
+ */
+typedef struct {
+    size_t hits;            ///< Allocations served from the cache
+    size_t misses;          ///< Allocations which could have been served from the cache, but went to the heap
+    size_t flushed_blocks;  ///< Blocks returned from the cache to the heap
+    size_t cached_blocks;   ///< Blocks currently held by the cache
+    size_t cached_bytes;    ///< Total size of the blocks currently held by the cache, counting each block by its size class
+} heap_caps_cache_stats_t;
+
+/**
+ * @brief Get the statistics of the small allocation cache
+ *
+ * All fields are zero if CONFIG_HEAP_MAGAZINE_CACHE is disabled.
+ *
+ * @param stats Pointer to a structure which will be filled with the statistics
+ */
+void heap_caps_cache_get_stats(heap_caps_cache_stats_t *stats);
+
+/**
+ * @brief Return all blocks held by the small allocation cache to their heaps
+ *
+ * Call this before inspecting the heaps (for example with heap_caps_get_info() or heap_caps_dump())
+ * to see the cached blocks as free. Does nothing if CONFIG_HEAP_MAGAZINE_CACHE is disabled.
+ */
+void heap_caps_cache_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
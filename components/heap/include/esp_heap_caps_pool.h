@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handle of a pool of fixed-size objects, see heap_caps_pool_create()
+ */
+typedef struct heap_caps_pool *heap_caps_pool_handle_t;
+
+/**
+ * @brief Maximum number of objects in a pool
+ */
+#define HEAP_CAPS_POOL_MAX_OBJECTS  0xFFFE
+
+/**
+ * @brief Maximum number of times a pool is allocated memory: once when it's created, and then each time it grows
+ */
+#define HEAP_CAPS_POOL_MAX_SLABS    16
+
+/**
+ * @brief Configuration of a pool of fixed-size objects
+ */
+typedef struct {
+    size_t obj_size;    ///< Size of an object, in bytes
+    size_t count;       ///< Number of objects allocated when the pool is created, and added each time it grows
+    size_t max_count;   ///< Number of objects up to which the pool grows when it's exhausted. 0 for a pool which doesn't grow.
+                        ///< At most HEAP_CAPS_POOL_MAX_SLABS times 'count'.
+    uint32_t caps;      ///< Bitwise OR of MALLOC_CAP_* flags indicating the type of memory holding the objects
+} heap_caps_pool_config_t;
+
+/**
+ * @brief Usage of one or more pools of fixed-size objects
+ */
+typedef struct {
+    size_t obj_size;            ///< Size of an object, including padding. 0 if the information covers several pools.
+    size_t total_objects;       ///< Number of objects the pools currently hold
+    size_t free_objects;        ///< Number of objects which are not allocated
+    size_t total_bytes;         ///< Heap memory used by the pools, including the unallocated objects
+    size_t free_bytes;          ///< Memory of the unallocated objects
+    size_t minimum_free_bytes;  ///< Lowest value of free_bytes since the pools were created
+    size_t pools;               ///< Number of pools
+} heap_caps_pool_info_t;
+
+/**
+ * @brief Create a pool of fixed-size objects
+ *
+ * The memory of all objects is allocated once, from memory with the given capabilities. The objects are then
+ * allocated and freed in constant time, without locks, so that frequently allocated objects of the same size
+ * don't fragment the heap.
+ *
+ * The pool doesn't grow, use heap_caps_pool_create_with_config() for a pool which grows when it's exhausted.
+ *
+ * @param obj_size Size of an object, in bytes
+ * @param count Number of objects in the pool
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory holding the objects
+ *
+ * @return Handle of the pool, or NULL if the arguments are invalid or the memory can't be allocated
+ */
+heap_caps_pool_handle_t heap_caps_pool_create(size_t obj_size, size_t count, uint32_t caps);
+
+/**
+ * @brief Create a pool of fixed-size objects with the given configuration
+ *
+ * Same as heap_caps_pool_create(), but if config->max_count is larger than config->count, the pool allocates
+ * memory for config->count more objects each time it is exhausted, until it holds config->max_count objects
+ * (rounded down to a multiple of config->count).
+ * The memory is only returned to the heap when the pool is deleted.
+ *
+ * @param config Configuration of the pool
+ *
+ * @return Handle of the pool, or NULL if the configuration is invalid or the memory can't be allocated
+ */
+heap_caps_pool_handle_t heap_caps_pool_create_with_config(const heap_caps_pool_config_t *config);
+
+/**
+ * @brief Delete a pool and return its memory to the heap
+ *
+ * @note Objects which are still allocated from the pool become invalid.
+ *
+ * @param pool Handle of the pool. Can be NULL.
+ */
+void heap_caps_pool_delete(heap_caps_pool_handle_t pool);
+
+/**
+ * @brief Allocate an object from a pool
+ *
+ * The object is aligned to the size of a pointer. This function can be called from an ISR, but the pool
+ * doesn't grow then.
+ *
+ * @param pool Handle of the pool
+ *
+ * @return Pointer to the object, or NULL if all objects are allocated and the pool can't grow
+ */
+void *heap_caps_pool_alloc(heap_caps_pool_handle_t pool);
+
+/**
+ * @brief Return an object to its pool
+ *
+ * This function can be called from an ISR.
+ *
+ * @param pool Handle of the pool the object was allocated from
+ * @param ptr Pointer returned by heap_caps_pool_alloc(). Can be NULL.
+ */
+void heap_caps_pool_free(heap_caps_pool_handle_t pool, void *ptr);
+
+/**
+ * @brief Get the usage of a pool
+ *
+ * @param pool Handle of the pool
+ * @param info Pointer to a structure which will be filled with the usage of the pool
+ */
+void heap_caps_pool_get_info(heap_caps_pool_handle_t pool, heap_caps_pool_info_t *info);
+
+/**
+ * @brief Get the total usage of the pools in memory with the given capabilities
+ *
+ * A pool is counted if the memory it was created with has all of the given capabilities.
+ * The unallocated objects of the pools are counted as free memory by heap_caps_get_info(),
+ * heap_caps_get_free_size() and heap_caps_get_minimum_free_size().
+ *
+ * @param info Pointer to a structure which will be filled with the total usage of the pools
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ */
+void heap_caps_get_pool_info(heap_caps_pool_info_t *info, uint32_t caps);
+
+/**
+ * @brief Print the usage of the pools in memory with the given capabilities
+ *
+ * This is also done by heap_caps_dump().
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory. MALLOC_CAP_INVALID for all pools.
+ */
+void heap_caps_pool_dump(uint32_t caps);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -38,9 +38,30 @@ typedef struct heap_trace_record_t {
     void *freed_by[CONFIG_HEAP_TRACING_STACK_DEPTH];   ///< Call stack of the caller which freed the memory (all zero if not freed.)
 #ifdef CONFIG_HEAP_TRACING_STANDALONE
     TAILQ_ENTRY(heap_trace_record_t) tailq; ///< Linked list: prev & next records
+    TAILQ_ENTRY(heap_trace_record_t) tailq_hashmap; ///< Linked list of the hash map bucket holding the record
 #endif // CONFIG_HEAP_TRACING_STANDALONE
 } heap_trace_record_t;
 
+/**
+ * @brief Selects which allocations are recorded by a standalone heap trace, see heap_trace_set_sampling()
+ */
+typedef enum {
+    HEAP_TRACE_SAMPLE_NONE,     ///< Every allocation is recorded
+    HEAP_TRACE_SAMPLE_COUNT,    ///< One allocation out of every 'period' allocations is recorded
+    HEAP_TRACE_SAMPLE_BYTES,    ///< An allocation is recorded each time 'period' more bytes have been allocated
+} heap_trace_sample_mode_t;
+
+/**
+ * @brief Statistics of the allocations recorded from one call stack, see heap_trace_init_callsites()
+ */
+typedef struct {
+    void *alloced_by[CONFIG_HEAP_TRACING_STACK_DEPTH]; ///< Call stack of the allocations
+    size_t allocations;         ///< Number of recorded allocations made from this call stack
+    size_t bytes;               ///< Total size of the recorded allocations made from this call stack
+    size_t live_allocations;    ///< Number of these allocations which have not been freed
+    size_t live_bytes;          ///< Total size of the allocations which have not been freed
+} heap_trace_callsite_t;
+
 /**
  * @brief Stores information about the result of a heap trace.
  */
@@ -52,6 +73,11 @@ typedef struct {
     size_t capacity;                 ///< The capacity of the internal buffer
     size_t high_water_mark;          ///< The maximum value that 'count' got to
     size_t has_overflowed;           ///< True if the internal buffer overflowed at some point
+    heap_trace_sample_mode_t sample_mode; ///< Which allocations are recorded
+    size_t sample_period;            ///< Sampling period, in allocations or bytes depending on 'sample_mode'
+    size_t skipped_allocations;      ///< The number of allocations which were not recorded because of sampling
+    size_t callsite_count;           ///< The number of call stacks in the callsite buffer
+    size_t callsites_overflowed;     ///< True if allocations weren't counted because the callsite buffer was full
 } heap_trace_summary_t;
 
 /**
@@ -71,6 +97,48 @@ typedef struct {
  */
 esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records);
 
+/**
+ * @brief Record only a sample of the allocations in standalone mode.
+ *
+ * Recording every allocation slows down every heap operation and needs a record per live allocation.
+ * When sampling, the allocations which are not recorded only update a counter, so tracing can run for a long
+ * time (for example in the field) with a small record buffer. Frees of allocations which were not recorded are
+ * ignored.
+ *
+ * The sampling is reset by heap_trace_start(). Sampling is disabled (HEAP_TRACE_SAMPLE_NONE) by default.
+ *
+ * @param sample_mode Which allocations are recorded
+ * @param period Sampling period: number of allocations for HEAP_TRACE_SAMPLE_COUNT, number of bytes for
+ * HEAP_TRACE_SAMPLE_BYTES. Ignored for HEAP_TRACE_SAMPLE_NONE.
+ * @return
+ *  - ESP_ERR_NOT_SUPPORTED Project was compiled without standalone heap tracing enabled in menuconfig.
+ *  - ESP_ERR_INVALID_STATE Heap tracing is currently in progress.
+ *  - ESP_ERR_INVALID_ARG The sampling mode is invalid or the period is zero.
+ *  - ESP_OK Sampling configured successfully.
+ */
+esp_err_t heap_trace_set_sampling(heap_trace_sample_mode_t sample_mode, size_t period);
+
+/**
+ * @brief Aggregate the recorded allocations per call stack in standalone mode.
+ *
+ * For each call stack which allocated memory, the buffer holds the number and size of the recorded
+ * allocations, and how many of them have not been freed. Unlike the records, whose number is limited by the
+ * record buffer, the statistics cover every recorded allocation, so the call stacks which leak memory can be
+ * found with a small record buffer and sampling (see heap_trace_set_sampling()).
+ *
+ * Allocations are only counted as freed while their record is in the record buffer, see heap_trace_summary_t::has_overflowed.
+ *
+ * To stop aggregating the allocations, stop tracing and then call heap_trace_init_callsites(NULL, 0);
+ *
+ * @param callsite_buffer Buffer holding the statistics. The same restrictions as for the record buffer apply.
+ * @param num_callsites Size of the buffer, as number of callsite structures.
+ * @return
+ *  - ESP_ERR_NOT_SUPPORTED Project was compiled without standalone heap tracing enabled in menuconfig.
+ *  - ESP_ERR_INVALID_STATE Heap tracing is currently in progress.
+ *  - ESP_OK Callsite buffer set successfully.
+ */
+esp_err_t heap_trace_init_callsites(heap_trace_callsite_t *callsite_buffer, size_t num_callsites);
+
 /**
  * @brief Initialise heap tracing in host-based mode.
  *
@@ -149,6 +217,26 @@ size_t heap_trace_get_count(void);
  */
 esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record);
 
+/**
+ * @brief Return number of call stacks in the callsite buffer
+ *
+ * It is safe to call this function while heap tracing is running.
+ */
+size_t heap_trace_get_callsite_count(void);
+
+/**
+ * @brief Return the statistics of a call stack from the callsite buffer
+ *
+ * @param index Index (zero-based) of the call stack to return.
+ * @param[out] callsite Structure where the statistics will be copied.
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without standalone heap tracing enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE No callsite buffer was set via heap_trace_init_callsites().
+ * - ESP_ERR_INVALID_ARG Index is out of bounds for current call stack count.
+ * - ESP_OK Statistics returned successfully.
+ */
+esp_err_t heap_trace_get_callsite(size_t index, heap_trace_callsite_t *callsite);
+
 /**
  * @brief Dump heap trace record data to stdout
  *
@@ -203,6 +203,58 @@ TEST_CASE("check for summary value validity", "[heap-trace]") {
     heap_trace_stop();
 }
 
+TEST_CASE("sampled heap trace aggregates allocations per call stack", "[heap-trace]")
+{
+    const size_t alloc_count = 40;
+    const size_t sample_period = 4;
+    void *ptrs[alloc_count];
+
+    heap_trace_record_t recs[alloc_count / sample_period + 2];
+    heap_trace_callsite_t callsites[8];
+    heap_trace_init_standalone(recs, sizeof(recs) / sizeof(recs[0]));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, heap_trace_set_sampling(HEAP_TRACE_SAMPLE_COUNT, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_set_sampling(HEAP_TRACE_SAMPLE_COUNT, sample_period));
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_init_callsites(callsites, 8));
+    heap_trace_start(HEAP_TRACE_LEAKS);
+
+    for (size_t i = 0; i < alloc_count; i++) {
+        ptrs[i] = heap_caps_malloc(32, MALLOC_CAP_INTERNAL);
+        TEST_ASSERT_NOT_NULL(ptrs[i]);
+    }
+
+    heap_trace_summary_t summary;
+    heap_trace_summary(&summary);
+    TEST_ASSERT(summary.total_allocations >= alloc_count);
+    TEST_ASSERT(summary.skipped_allocations >= alloc_count - alloc_count / sample_period - 1);
+    TEST_ASSERT(heap_trace_get_callsite_count() >= 1);
+
+    // every allocation still recorded is alive in the statistics of its call stack
+    size_t live_allocations = 0;
+    for (size_t i = 0; i < heap_trace_get_callsite_count(); i++) {
+        heap_trace_callsite_t callsite;
+        TEST_ASSERT_EQUAL(ESP_OK, heap_trace_get_callsite(i, &callsite));
+        live_allocations += callsite.live_allocations;
+    }
+    TEST_ASSERT_EQUAL(heap_trace_get_count(), live_allocations);
+    heap_trace_dump();
+
+    for (size_t i = 0; i < alloc_count; i++) {
+        heap_caps_free(ptrs[i]);
+    }
+    heap_trace_stop();
+
+    live_allocations = 0;
+    for (size_t i = 0; i < heap_trace_get_callsite_count(); i++) {
+        heap_trace_callsite_t callsite;
+        heap_trace_get_callsite(i, &callsite);
+        live_allocations += callsite.live_allocations;
+    }
+    TEST_ASSERT_EQUAL(heap_trace_get_count(), live_allocations);
+
+    heap_trace_set_sampling(HEAP_TRACE_SAMPLE_NONE, 0);
+    heap_trace_init_callsites(NULL, 0);
+}
+
 #ifdef CONFIG_SPIRAM
 void* allocate_pointer(uint32_t caps)
 {
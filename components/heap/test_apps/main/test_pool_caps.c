@@ -0,0 +1,145 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/*
+ Tests for the pools of fixed-size objects.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_pool.h"
+#include "esp_memory_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define POOL_OBJ_SIZE 24
+#define POOL_COUNT 32
+
+TEST_CASE("Pool allocates objects from memory with the requested caps", "[heap]")
+{
+    heap_caps_pool_handle_t pool = heap_caps_pool_create(POOL_OBJ_SIZE, POOL_COUNT, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    void *objs[POOL_COUNT];
+    for (int i = 0; i < POOL_COUNT; i++) {
+        objs[i] = heap_caps_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(objs[i]);
+        TEST_ASSERT_TRUE(esp_ptr_dma_capable(objs[i]));
+        memset(objs[i], i, POOL_OBJ_SIZE);
+    }
+    TEST_ASSERT_NULL(heap_caps_pool_alloc(pool));
+
+    heap_caps_pool_info_t info;
+    heap_caps_get_pool_info(&info, MALLOC_CAP_DMA);
+    TEST_ASSERT_EQUAL(1, info.pools);
+    TEST_ASSERT_EQUAL(POOL_COUNT, info.total_objects);
+    TEST_ASSERT_EQUAL(0, info.free_objects);
+    heap_caps_dump(MALLOC_CAP_DMA);
+
+    for (int i = 0; i < POOL_COUNT; i++) {
+        TEST_ASSERT_EACH_EQUAL_HEX8(i, objs[i], POOL_OBJ_SIZE);
+        heap_caps_pool_free(pool, objs[i]);
+    }
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(POOL_COUNT, info.free_objects);
+
+    heap_caps_pool_delete(pool);
+    heap_caps_get_pool_info(&info, MALLOC_CAP_DMA);
+    TEST_ASSERT_EQUAL(0, info.pools);
+}
+
+TEST_CASE("Pool objects which are not allocated are counted as free heap", "[heap]")
+{
+    heap_caps_pool_handle_t pool = heap_caps_pool_create(POOL_OBJ_SIZE, POOL_COUNT, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(pool);
+    heap_caps_pool_info_t info;
+    heap_caps_pool_get_info(pool, &info);
+
+    size_t free_size = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    void *obj = heap_caps_pool_alloc(pool);
+    TEST_ASSERT_NOT_NULL(obj);
+    TEST_ASSERT_EQUAL(free_size - info.obj_size, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+
+    multi_heap_info_t heap_info;
+    heap_caps_get_info(&heap_info, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_EQUAL(free_size - info.obj_size, heap_info.total_free_bytes);
+
+    size_t minimum_free_size = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    heap_caps_pool_free(pool, obj);
+    TEST_ASSERT_EQUAL(free_size, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    TEST_ASSERT_EQUAL(minimum_free_size, heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+
+    heap_caps_pool_delete(pool);
+}
+
+#define POOL_TEST_ROUNDS 10000
+
+typedef struct {
+    heap_caps_pool_handle_t pool;
+    SemaphoreHandle_t done;
+    bool corrupted;
+} pool_test_arg_t;
+
+static void pool_test_task(void *arg)
+{
+    pool_test_arg_t *test = (pool_test_arg_t *)arg;
+    uint32_t *objs[4];
+    const uint32_t mark = (uint32_t)xTaskGetCurrentTaskHandle();
+
+    for (int round = 0; round < POOL_TEST_ROUNDS; round++) {
+        for (int i = 0; i < 4; i++) {
+            objs[i] = heap_caps_pool_alloc(test->pool);
+            if (objs[i] == NULL) {
+                test->corrupted = true;
+                break;
+            }
+            objs[i][1] = mark;
+        }
+        for (int i = 0; i < 4 && objs[i] != NULL; i++) {
+            // an object handed out twice would have been overwritten by the other task
+            if (objs[i][1] != mark) {
+                test->corrupted = true;
+            }
+            heap_caps_pool_free(test->pool, objs[i]);
+        }
+    }
+    xSemaphoreGive(test->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Pool allocates objects from tasks on all cores", "[heap]")
+{
+    const heap_caps_pool_config_t config = {
+        .obj_size = 8,
+        .count = 4,
+        .max_count = 4 * portNUM_PROCESSORS * 4,
+        .caps = MALLOC_CAP_DEFAULT,
+    };
+    pool_test_arg_t test = {
+        .pool = heap_caps_pool_create_with_config(&config),
+        .done = xSemaphoreCreateCounting(portNUM_PROCESSORS * 2, 0),
+        .corrupted = false,
+    };
+    TEST_ASSERT_NOT_NULL(test.pool);
+    TEST_ASSERT_NOT_NULL(test.done);
+
+    for (int i = 0; i < portNUM_PROCESSORS * 2; i++) {
+        xTaskCreatePinnedToCore(pool_test_task, "pool_test", 2048, &test, 5, NULL, i % portNUM_PROCESSORS);
+    }
+    for (int i = 0; i < portNUM_PROCESSORS * 2; i++) {
+        xSemaphoreTake(test.done, portMAX_DELAY);
+    }
+    TEST_ASSERT_FALSE(test.corrupted);
+
+    heap_caps_pool_info_t info;
+    heap_caps_pool_get_info(test.pool, &info);
+    TEST_ASSERT_EQUAL(info.total_objects, info.free_objects);
+
+    vSemaphoreDelete(test.done);
+    heap_caps_pool_delete(test.pool);
+}
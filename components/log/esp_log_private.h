@@ -1,6 +1,28 @@
 #pragma once
 #include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "sdkconfig.h"
 
 void esp_log_impl_lock(void);
 bool esp_log_impl_lock_timeout(void);
 void esp_log_impl_unlock(void);
+
+// Output a message using the function set by esp_log_set_vprintf(), without any filtering
+int esp_log_output(const char *format, ...);
+
+#if LOG_DEFERRED_ENABLED   // Defined by CMakeLists.txt when deferred log is enabled and supported
+// Defer a message which passed level filtering. Returns false if the message must be output immediately.
+bool esp_log_deferred_writev(const char *format, va_list args);
+// Format and output all pending deferred messages, only called by the task/thread started by esp_log_impl_deferred_start()
+void esp_log_deferred_process(void);
+
+// Start the task/thread processing deferred messages if possible. Returns true if it is running.
+bool esp_log_impl_deferred_start(void);
+// Wake up the task/thread processing deferred messages. Can be called from an ISR.
+void esp_log_impl_deferred_notify(void);
+// Wait a short while, used when waiting for deferred messages to be output
+void esp_log_impl_deferred_delay(void);
+// Get the index of the current core
+uint32_t esp_log_impl_get_core_id(void);
+#endif
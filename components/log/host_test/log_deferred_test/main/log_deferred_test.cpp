@@ -0,0 +1,230 @@
+/* Deferred LOG unit tests
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#define CATCH_CONFIG_MAIN
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include <regex>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "esp_log.h"
+
+#include "catch.hpp"
+
+using namespace std;
+
+static const char *TEST_TAG = "test";
+
+/* Collects the output of the deferred log thread (and of messages which are output immediately) */
+struct DeferredLogFixture {
+    DeferredLogFixture()
+    {
+        esp_log_deferred_flush();
+        reset_output();
+        blocked = false;
+        old_vprintf = esp_log_set_vprintf(print_callback);
+    }
+
+    ~DeferredLogFixture()
+    {
+        blocked = false;
+        esp_log_deferred_flush();
+        esp_log_set_vprintf(old_vprintf);
+    }
+
+    string get_output()
+    {
+        lock_guard<mutex> lock(output_mutex);
+        return output;
+    }
+
+    void reset_output()
+    {
+        lock_guard<mutex> lock(output_mutex);
+        output.clear();
+    }
+
+    static atomic<bool> blocked;    // Block the output, to fill the deferred log buffer
+
+private:
+    static int print_callback(const char *format, va_list args)
+    {
+        char buffer[512];
+        while (blocked) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        int ret = vsnprintf(buffer, sizeof(buffer), format, args);
+        lock_guard<mutex> lock(output_mutex);
+        output += buffer;
+        return ret;
+    }
+
+    static mutex output_mutex;
+    static string output;
+    vprintf_like_t old_vprintf;
+};
+
+atomic<bool> DeferredLogFixture::blocked(false);
+mutex DeferredLogFixture::output_mutex;
+string DeferredLogFixture::output;
+
+TEST_CASE("deferred message is formatted later")
+{
+    DeferredLogFixture fix;
+    char stack_str[16];
+    strcpy(stack_str, "on stack");
+
+    ESP_LOGI(TEST_TAG, "int %d uint %u hex %08x str '%s' %-8s| char %c %%", -42, 42u, 0xbeefu, stack_str, "padded", 'x');
+    // String arguments are copied, changing the string after the call must not change the message
+    strcpy(stack_str, "modified");
+    esp_log_deferred_flush();
+
+    const regex test_print("I \\([0-9]*\\) test: int -42 uint 42 hex 0000beef str 'on stack' padded  \\| char x %", regex::ECMAScript);
+    CHECK(regex_search(fix.get_output(), test_print) == true);
+}
+
+TEST_CASE("deferred message with a format string which doesn't outlive the call")
+{
+    DeferredLogFixture fix;
+    char format[64];
+    strcpy(format, "format on stack %d\n");
+
+    esp_log_write(ESP_LOG_INFO, TEST_TAG, format, 42);
+    // The format string is copied as well, if it is not a constant one
+    strcpy(format, "format modified %d\n");
+    esp_log_deferred_flush();
+
+    CHECK(fix.get_output().find("format on stack 42") != string::npos);
+    CHECK(fix.get_output().find("format modified") == string::npos);
+}
+
+TEST_CASE("deferred message with wide and floating point arguments")
+{
+    DeferredLogFixture fix;
+    const long long ll = -1234567890123LL;
+    const uint64_t u64 = 0xfedcba9876543210ULL;
+    const size_t sz = 123456;
+    const double d = 3.14159;
+    int local;
+    char expected[256];
+
+    snprintf(expected, sizeof(expected), "%lld %" PRIx64 " %zu %.3f %e [%*d] [%-*.*s] %p %s",
+             ll, u64, sz, d, d, 6, 42, 8, 3, "truncated", (void *)&local, (const char *)NULL);
+    ESP_LOGW(TEST_TAG, "%lld %" PRIx64 " %zu %.3f %e [%*d] [%-*.*s] %p %s",
+             ll, u64, sz, d, d, 6, 42, 8, 3, "truncated", (void *)&local, (const char *)NULL);
+    esp_log_deferred_flush();
+
+    CHECK(fix.get_output().find(expected) != string::npos);
+}
+
+TEST_CASE("deferred message with strings limited by precision")
+{
+    DeferredLogFixture fix;
+    // Not NUL-terminated, only the bytes within the precision may be read
+    const char ssid[4] = {'w', 'i', 'f', 'i'};
+    const char *str = "abcdef";
+    char expected[64];
+
+    snprintf(expected, sizeof(expected), "[%.*s] [%.3s] [%.*s] [%.10s] [%.*s]", (int)sizeof(ssid), ssid, str, 2, str, str, -1, str);
+    ESP_LOGI(TEST_TAG, "[%.*s] [%.3s] [%.*s] [%.10s] [%.*s]", (int)sizeof(ssid), ssid, str, 2, str, str, -1, str);
+    esp_log_deferred_flush();
+
+    CHECK(fix.get_output().find(expected) != string::npos);
+}
+
+TEST_CASE("deferred messages are output in order")
+{
+    DeferredLogFixture fix;
+    const int num_messages = 1000;  // Fits into the deferred log buffer, no message is dropped
+
+    for (int i = 0; i < num_messages; i++) {
+        ESP_LOGD(TEST_TAG, "message %d", i);
+    }
+    esp_log_deferred_flush();
+
+    const regex message_regex("test: message ([0-9]+)", regex::ECMAScript);
+    string output = fix.get_output();
+    int expected = 0;
+    for (sregex_iterator it(output.begin(), output.end(), message_regex), end; it != end; ++it) {
+        CHECK(stoi((*it)[1]) == expected);
+        expected++;
+    }
+    CHECK(expected == num_messages);
+}
+
+TEST_CASE("dropped deferred messages are reported")
+{
+    DeferredLogFixture fix;
+    const int num_messages = 10000;
+
+    // Messages take at least 24 bytes in the deferred log buffer, so some of them can't fit into it
+    DeferredLogFixture::blocked = true;
+    for (int i = 0; i < num_messages; i++) {
+        ESP_LOGD(TEST_TAG, "message %d", i);
+    }
+    DeferredLogFixture::blocked = false;
+    esp_log_deferred_flush();
+
+    const regex message_regex("test: message [0-9]+", regex::ECMAScript);
+    const regex dropped_regex("log: ([0-9]+) deferred log messages dropped", regex::ECMAScript);
+    string output = fix.get_output();
+    int received = distance(sregex_iterator(output.begin(), output.end(), message_regex), sregex_iterator());
+    int dropped = 0;
+    for (sregex_iterator it(output.begin(), output.end(), dropped_regex), end; it != end; ++it) {
+        dropped += stoi((*it)[1]);
+    }
+    CHECK(dropped > 0);
+    CHECK(received + dropped == num_messages);
+}
+
+TEST_CASE("message with long arguments is output immediately")
+{
+    DeferredLogFixture fix;
+    string long_str(300, 'a');
+
+    ESP_LOGI(TEST_TAG, "long: %s", long_str.c_str());
+    // No need to flush, the message does not fit into a record
+    CHECK(fix.get_output().find("test: long: " + long_str) != string::npos);
+}
+
+TEST_CASE("deferred log throughput")
+{
+    DeferredLogFixture fix;
+    const int num_batches = 100;
+    const int batch_size = 500;     // Fits into the deferred log buffer, with the copied format strings
+    chrono::nanoseconds deferred_time(0);
+    chrono::nanoseconds formatted_time(0);
+    char buffer[128];
+
+    for (int batch = 0; batch < num_batches; batch++) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < batch_size; i++) {
+            ESP_LOGD(TEST_TAG, "benchmark message %d, value %u, name %s", i, i * 3, "deferred");
+        }
+        deferred_time += chrono::steady_clock::now() - start;
+        esp_log_deferred_flush();
+        fix.reset_output();
+
+        // What the caller pays for formatting the same message, without deferred log
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < batch_size; i++) {
+            snprintf(buffer, sizeof(buffer), LOG_FORMAT(D, "benchmark message %d, value %u, name %s"),
+                     esp_log_timestamp(), TEST_TAG, i, i * 3, "deferred");
+        }
+        formatted_time += chrono::steady_clock::now() - start;
+    }
+
+    const int num_messages = num_batches * batch_size;
+    printf("Deferred log: %" PRId64 " ns per message, formatting in the caller: %" PRId64 " ns per message\n",
+           (int64_t)(deferred_time.count() / num_messages), (int64_t)(formatted_time.count() / num_messages));
+    CHECK(deferred_time.count() > 0);
+}
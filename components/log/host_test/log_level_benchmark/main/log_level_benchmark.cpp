@@ -0,0 +1,137 @@
+/* LOG tag level lookup benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#define CATCH_CONFIG_MAIN
+#include <cstdio>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "esp_log.h"
+
+#include "catch.hpp"
+
+using namespace std;
+
+static const int NUM_ITERATIONS = 1000000;
+static const int NUM_TAGS = 300;
+
+static atomic<int> s_printed(0);
+
+static int count_callback(const char *format, va_list args)
+{
+    s_printed++;
+    return 0;
+}
+
+/* All messages logged by the benchmarks are filtered out, the callback only counts them in case they aren't */
+struct BenchmarkFixture {
+    BenchmarkFixture()
+    {
+        esp_log_level_set("*", ESP_LOG_INFO);
+        s_printed = 0;
+        old_vprintf = esp_log_set_vprintf(count_callback);
+        for (int i = 0; i < NUM_TAGS; i++) {
+            tags.push_back("component" + to_string(i));
+        }
+    }
+
+    ~BenchmarkFixture()
+    {
+        esp_log_set_vprintf(old_vprintf);
+        esp_log_level_set("*", ESP_LOG_INFO);
+    }
+
+    /* Log a filtered out message with each of the first num_tags tags in turn, return the time per message */
+    int64_t run(int num_tags)
+    {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < NUM_ITERATIONS; i++) {
+            ESP_LOGD(tags[i % num_tags].c_str(), "filtered out %d", i);
+        }
+        auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+        return elapsed.count() / NUM_ITERATIONS;
+    }
+
+    vector<string> tags;
+    vprintf_like_t old_vprintf;
+};
+
+TEST_CASE("filtered out message, no tag level set")
+{
+    BenchmarkFixture fix;
+
+    int64_t ns = fix.run(NUM_TAGS);
+    printf("No tag level set, %d tags: %" PRId64 " ns per message\n", NUM_TAGS, ns);
+    CHECK(s_printed == 0);
+}
+
+TEST_CASE("filtered out message, few tags")
+{
+    BenchmarkFixture fix;
+    for (int i = 0; i < NUM_TAGS; i += 10) {
+        esp_log_level_set(fix.tags[i].c_str(), ESP_LOG_WARN);
+    }
+
+    int64_t ns = fix.run(16);
+    printf("%d tag levels set, 16 tags: %" PRId64 " ns per message\n", NUM_TAGS / 10, ns);
+    CHECK(s_printed == 0);
+}
+
+TEST_CASE("filtered out message, many tags")
+{
+    BenchmarkFixture fix;
+    for (int i = 0; i < NUM_TAGS; i++) {
+        esp_log_level_set(fix.tags[i].c_str(), ESP_LOG_WARN);
+    }
+
+    int64_t ns = fix.run(NUM_TAGS);
+    printf("%d tag levels set, %d tags: %" PRId64 " ns per message\n", NUM_TAGS, NUM_TAGS, ns);
+    CHECK(s_printed == 0);
+}
+
+TEST_CASE("tag levels changed while messages are logged")
+{
+    BenchmarkFixture fix;
+    atomic<bool> done(false);
+    atomic<int> wrong_level(0);
+
+    // Levels of the first 16 tags are changed between WARN and ERROR, messages must be filtered out with any of them
+    for (int i = 0; i < 16; i++) {
+        esp_log_level_set(fix.tags[i].c_str(), ESP_LOG_WARN);
+    }
+    thread setter([&]() {
+        for (int i = 0; !done; i++) {
+            esp_log_level_set(fix.tags[i % 16].c_str(), (i % 2 == 0) ? ESP_LOG_WARN : ESP_LOG_ERROR);
+            this_thread::yield();
+        }
+    });
+    vector<thread> getters;
+    for (int t = 0; t < 3; t++) {
+        getters.emplace_back([&]() {
+            for (int i = 0; i < NUM_ITERATIONS / 10; i++) {
+                esp_log_level_t level = esp_log_level_get(fix.tags[i % 32].c_str());
+                bool expected = (i % 32 < 16) ? (level == ESP_LOG_WARN || level == ESP_LOG_ERROR) : (level == ESP_LOG_INFO);
+                if (!expected) {
+                    wrong_level++;
+                }
+                ESP_LOGI(fix.tags[i % 16].c_str(), "filtered out %d", i);
+            }
+        });
+    }
+    for (auto &getter : getters) {
+        getter.join();
+    }
+    done = true;
+    setter.join();
+
+    CHECK(wrong_level == 0);
+    CHECK(s_printed == 0);
+}
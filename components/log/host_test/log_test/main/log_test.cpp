@@ -10,6 +10,9 @@
 #include <cstdio>
 #include <regex>
 #include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
 #include "esp_log.h"
 
 #include "catch.hpp"
@@ -193,6 +196,48 @@ TEST_CASE("changing log level")
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
 
+TEST_CASE("log level is looked up by tag string")
+{
+    BasicLogFixture fix(ESP_LOG_INFO);
+    char tag_copy[16];
+    strcpy(tag_copy, TEST_TAG);
+
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_INFO);
+    esp_log_level_set(tag_copy, ESP_LOG_ERROR);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_ERROR);
+    CHECK(esp_log_level_get(tag_copy) == ESP_LOG_ERROR);
+    CHECK(esp_log_level_get("other") == ESP_LOG_INFO);
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_WARN);
+    CHECK(esp_log_level_get(tag_copy) == ESP_LOG_WARN);
+}
+
+TEST_CASE("log level of many tags")
+{
+    BasicLogFixture fix(ESP_LOG_INFO);
+    const int NUM_TAGS = 200;   // More than the tags which can be cached
+    vector<string> tags;
+    for (int i = 0; i < NUM_TAGS; i++) {
+        tags.push_back("tag" + to_string(i));
+    }
+
+    for (int i = 0; i < NUM_TAGS; i += 2) {
+        esp_log_level_set(tags[i].c_str(), ESP_LOG_DEBUG);
+    }
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < NUM_TAGS; i++) {
+            CHECK(esp_log_level_get(tags[i].c_str()) == ((i % 2 == 0) ? ESP_LOG_DEBUG : ESP_LOG_INFO));
+        }
+    }
+
+    // Changing the level of one tag must be seen for cached tags too
+    esp_log_level_set(tags[0].c_str(), ESP_LOG_NONE);
+    CHECK(esp_log_level_get(tags[0].c_str()) == ESP_LOG_NONE);
+    CHECK(esp_log_level_get(tags[2].c_str()) == ESP_LOG_DEBUG);
+    CHECK(esp_log_level_get(tags[1].c_str()) == ESP_LOG_INFO);
+}
+
 TEST_CASE("log buffer")
 {
     PrintFixture fix(ESP_LOG_INFO);
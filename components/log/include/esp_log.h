@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -144,6 +144,19 @@ void esp_log_write(esp_log_level_t level, const char* tag, const char* format, .
  */
 void esp_log_writev(esp_log_level_t level, const char* tag, const char* format, va_list args);
 
+#if CONFIG_LOG_DEFERRED
+/**
+ * @brief Wait until all pending deferred log messages have been output
+ *
+ * Only available if CONFIG_LOG_DEFERRED is enabled. Messages which are logged
+ * while this function is waiting may or may not be output before it returns.
+ *
+ * This function must not be called from an interrupt, or from the function set
+ * by esp_log_set_vprintf().
+ */
+void esp_log_deferred_flush(void);
+#endif
+
 /** @cond */
 
 #include "esp_log_internal.h"
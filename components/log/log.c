@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -7,30 +7,46 @@
 /*
  * Log library implementation notes.
  *
- * Log library stores all tags provided to esp_log_level_set as a linked
- * list. See uncached_tag_entry_t structure.
+ * Log library stores all tags provided to esp_log_level_set in a hash table
+ * indexed by a hash of the tag string. Each bucket is a linked list, see
+ * uncached_tag_entry_t structure. This table is only accessed with the lock held.
  *
- * To avoid looking up log level for given tag each time message is
- * printed, this library caches pointers to tags. Because the suggested
- * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * Looking up the log level of a tag each time a message is printed must be
+ * fast, even when the message is filtered out, so it is done without taking
+ * the lock:
  *
- * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * - If no tag has been given its own level, the default level is used.
+ *
+ * - Otherwise, the level is looked up in a cache indexed by a hash of the
+ *   tag pointer. Because the suggested way of creating tags uses one 'TAG'
+ *   constant per file, the same pointer is usually passed for the same tag.
+ *   A tag is looked up in TAG_CACHE_PROBES consecutive entries. Each entry is
+ *   protected by a sequence counter, which is odd while the entry is being
+ *   written, so that readers can detect that they have read a torn entry.
+ *
+ * Updates are done in the RCU style: cache entries are not modified by
+ * esp_log_level_set. Instead, each entry records the version of the tag table
+ * at which its level was looked up, and esp_log_level_set publishes a new
+ * version. Entries with an older version are ignored by readers and reused by
+ * writers.
+ *
+ * On a cache miss, the lock is taken, the tag is looked up in the hash table
+ * of tags (comparing strings) and the cache is updated. If all the probed
+ * entries are in use, one of them is replaced in a round robin fashion.
+ *
+ * The potential problem with wrap-around of the table version is ignored for
+ * now. This will happen if someone happens to call esp_log_level_set more than
+ * 500 million times, at which point wrap-around will not be the biggest problem.
+ *
+ * If CONFIG_LOG_DEFERRED is enabled, messages which pass the level check are
+ * not formatted here but handed over to log_deferred.c.
  *
  */
 
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -47,13 +63,23 @@
 
 #include "sys/queue.h"
 
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
-#define TAG_CACHE_SIZE 31
+// Number of tags to be cached is 2**TAG_CACHE_BITS.
+#define TAG_CACHE_BITS 5
+#define TAG_CACHE_SIZE (1 << TAG_CACHE_BITS)
+// Number of consecutive cache entries in which a tag can be stored.
+#define TAG_CACHE_PROBES 4
+// Number of buckets of the hash table of tags. Must be 2**n.
+#define TAG_TABLE_SIZE 16
+
+// level_version member of cache entries holds the level in the lowest bits, and the table version in the others
+#define LEVEL_BITS 3
+#define LEVEL_MASK ((1 << LEVEL_BITS) - 1)
+#define VERSION_MASK (UINT32_MAX >> LEVEL_BITS)
 
 typedef struct {
+    uint32_t seq;       // odd while the entry is being written
     const char *tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
+    uint32_t level_version;
 } cached_tag_entry_t;
 
 typedef struct uncached_tag_entry_ {
@@ -62,11 +88,15 @@ typedef struct uncached_tag_entry_ {
     char tag[0];    // beginning of a zero-terminated string
 } uncached_tag_entry_t;
 
+SLIST_HEAD(log_tags_head, uncached_tag_entry_);
+
 esp_log_level_t esp_log_default_level = CONFIG_LOG_DEFAULT_LEVEL;
-static SLIST_HEAD(log_tags_head, uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
+static struct log_tags_head s_log_tags[TAG_TABLE_SIZE];
+static uint32_t s_log_tags_count = 0;
+// Version 0 is never used, so that zero-initialized cache entries are not valid
+static uint32_t s_log_tags_version = 1;
 static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
-static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
+static uint32_t s_log_cache_next_victim = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
 
 #ifdef LOG_BUILTIN_CHECKS
@@ -74,11 +104,14 @@ static uint32_t s_log_cache_misses = 0;
 #endif
 
 
+static inline bool get_log_level_lock_free(const char *tag, esp_log_level_t *level);
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level);
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level);
 static inline void add_to_cache(const char *tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
+static inline void write_cache_entry(cached_tag_entry_t *entry, const char *tag, uint32_t level_version);
+static inline uint32_t tag_cache_index(const char *tag);
+static inline struct log_tags_head *tag_table_bucket(const char *tag);
+static inline void publish_new_version(void);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list(void);
 
@@ -95,19 +128,21 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
 {
     esp_log_impl_lock();
 
-    // for wildcard tag, remove all linked list items and clear the cache
+    // for wildcard tag, remove all hash table items, this invalidates the cache
     if (strcmp(tag, "*") == 0) {
-        esp_log_default_level = level;
+        __atomic_store_n(&esp_log_default_level, level, __ATOMIC_RELAXED);
         clear_log_level_list();
+        publish_new_version();
         esp_log_impl_unlock();
         return;
     }
 
     // search for existing tag
+    struct log_tags_head *bucket = tag_table_bucket(tag);
     uncached_tag_entry_t *it = NULL;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
+    SLIST_FOREACH(it, bucket, entries) {
         if (strcmp(it->tag, tag) == 0) {
-            // one tag in the linked list matched, update the level
+            // one tag in the bucket matched, update the level
             it->level = level;
             // quit with it != NULL
             break;
@@ -115,7 +150,7 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
     }
     // no existing tag, append new one
     if (it == NULL) {
-        // allocate new linked list entry and append it to the head of the list
+        // allocate new linked list entry and append it to the head of the bucket
         size_t tag_len = strlen(tag) + 1;
         size_t entry_size = offsetof(uncached_tag_entry_t, tag) + tag_len;
         uncached_tag_entry_t *new_entry = (uncached_tag_entry_t *) malloc(entry_size);
@@ -125,32 +160,25 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
         }
         new_entry->level = (uint8_t) level;
         memcpy(new_entry->tag, tag, tag_len); // we know the size and strncpy would trigger a compiler warning here
-        SLIST_INSERT_HEAD(&s_log_tags, new_entry, entries);
+        SLIST_INSERT_HEAD(bucket, new_entry, entries);
+        __atomic_store_n(&s_log_tags_count, s_log_tags_count + 1, __ATOMIC_RELEASE);
     }
 
-    // search in the cache and update the entry it if exists
-    for (uint32_t i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag, tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
-        }
-    }
+    // cached levels of all tags are outdated now
+    publish_new_version();
     esp_log_impl_unlock();
 }
 
 
-/* Common code for getting the log level from cache, esp_log_impl_lock()
+/* Common code for getting the log level on a cache miss, esp_log_impl_lock()
    should be called before calling this function. The function unlocks,
    as indicated in the name.
 */
 static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 {
     esp_log_level_t level_for_tag;
-    // Look for the tag in cache first, then in the linked list of all tags
-    if (!get_cached_log_level(tag, &level_for_tag)) {
+    // Another task may have added the tag to the cache while we were waiting for the lock
+    if (!get_log_level_lock_free(tag, &level_for_tag)) {
         if (!get_uncached_log_level(tag, &level_for_tag)) {
             level_for_tag = esp_log_default_level;
         }
@@ -166,19 +194,24 @@ static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 
 esp_log_level_t esp_log_level_get(const char *tag)
 {
+    esp_log_level_t level_for_tag;
+    if (get_log_level_lock_free(tag, &level_for_tag)) {
+        return level_for_tag;
+    }
     esp_log_impl_lock();
     return s_log_level_get_and_unlock(tag);
 }
 
 void clear_log_level_list(void)
 {
-    uncached_tag_entry_t *it;
-    while ((it = SLIST_FIRST(&s_log_tags)) != NULL) {
-        SLIST_REMOVE_HEAD(&s_log_tags, entries);
-        free(it);
+    for (int i = 0; i < TAG_TABLE_SIZE; ++i) {
+        uncached_tag_entry_t *it;
+        while ((it = SLIST_FIRST(&s_log_tags[i])) != NULL) {
+            SLIST_REMOVE_HEAD(&s_log_tags[i], entries);
+            free(it);
+        }
     }
-    s_log_cache_entry_count = 0;
-    s_log_cache_max_generation = 0;
+    __atomic_store_n(&s_log_tags_count, 0, __ATOMIC_RELEASE);
 #ifdef LOG_BUILTIN_CHECKS
     s_log_cache_misses = 0;
 #endif
@@ -189,18 +222,40 @@ void esp_log_writev(esp_log_level_t level,
                    const char *format,
                    va_list args)
 {
-    if (!esp_log_impl_lock_timeout()) {
-        return;
+    esp_log_level_t level_for_tag;
+    if (!get_log_level_lock_free(tag, &level_for_tag)) {
+        if (!esp_log_impl_lock_timeout()) {
+            return;
+        }
+        level_for_tag = s_log_level_get_and_unlock(tag);
     }
-    esp_log_level_t level_for_tag = s_log_level_get_and_unlock(tag);
     if (!should_output(level, level_for_tag)) {
         return;
     }
 
+#if LOG_DEFERRED_ENABLED
+    va_list args_copy;
+    va_copy(args_copy, args);
+    bool deferred = esp_log_deferred_writev(format, args_copy);
+    va_end(args_copy);
+    if (deferred) {
+        return;
+    }
+#endif
+
     (*s_log_print_func)(format, args);
 
 }
 
+int esp_log_output(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    int ret = (*s_log_print_func)(format, list);
+    va_end(list);
+    return ret;
+}
+
 void esp_log_write(esp_log_level_t level,
                    const char *tag,
                    const char *format, ...)
@@ -211,70 +266,88 @@ void esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
+static inline bool get_log_level_lock_free(const char *tag, esp_log_level_t *level)
+{
+    // No tag has its own level, there is nothing to look up
+    if (__atomic_load_n(&s_log_tags_count, __ATOMIC_ACQUIRE) == 0) {
+        *level = __atomic_load_n(&esp_log_default_level, __ATOMIC_RELAXED);
+        return true;
+    }
+    return get_cached_log_level(tag, level);
+}
+
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
 {
-    // Look for `tag` in cache
-    uint32_t i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
+    uint32_t version = __atomic_load_n(&s_log_tags_version, __ATOMIC_ACQUIRE);
+    uint32_t index = tag_cache_index(tag);
+    for (int i = 0; i < TAG_CACHE_PROBES; ++i) {
+        cached_tag_entry_t *entry = &s_log_cache[(index + i) & (TAG_CACHE_SIZE - 1)];
+        // Read the entry, then check that it has not been written in the meantime
+        uint32_t seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+        const char *entry_tag = __atomic_load_n(&entry->tag, __ATOMIC_RELAXED);
+        uint32_t level_version = __atomic_load_n(&entry->level_version, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((seq & 1) != 0 || __atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq) {
+            return false;
+        }
+        if (entry_tag == tag) {
+            // Level may have been changed since it was cached
+            if ((level_version >> LEVEL_BITS) != version) {
+                return false;
+            }
+            *level = (esp_log_level_t) (level_version & LEVEL_MASK);
+            return true;
+        }
+        if (entry_tag == NULL) { // Entries are never emptied, the tag can't be in the following ones
+            return false;
         }
     }
-    if (i == s_log_cache_entry_count) { // Not found in cache
-        return false;
-    }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
-    }
-    return true;
+    return false;
 }
 
 static inline void add_to_cache(const char *tag, esp_log_level_t level)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
-        return;
+    uint32_t version = s_log_tags_version;
+    uint32_t index = tag_cache_index(tag);
+    cached_tag_entry_t *free_entry = NULL;
+    // Reuse the entry of this tag if there is one, otherwise the first unused or outdated entry
+    for (int i = 0; i < TAG_CACHE_PROBES; ++i) {
+        cached_tag_entry_t *entry = &s_log_cache[(index + i) & (TAG_CACHE_SIZE - 1)];
+        if (entry->tag == tag) {
+            free_entry = entry;
+            break;
+        }
+        if (free_entry == NULL && (entry->tag == NULL || (entry->level_version >> LEVEL_BITS) != version)) {
+            free_entry = entry;
+        }
     }
+    // All entries are in use, replace one of them
+    if (free_entry == NULL) {
+        uint32_t victim = s_log_cache_next_victim++ % TAG_CACHE_PROBES;
+        free_entry = &s_log_cache[(index + victim) & (TAG_CACHE_SIZE - 1)];
+    }
+    write_cache_entry(free_entry, tag, (version << LEVEL_BITS) | level);
+}
 
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+static inline void write_cache_entry(cached_tag_entry_t *entry, const char *tag, uint32_t level_version)
+{
+    uint32_t seq = entry->seq;
+#ifdef LOG_BUILTIN_CHECKS
+    assert((seq & 1) == 0);
+#endif
+    __atomic_store_n(&entry->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&entry->tag, tag, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->level_version, level_version, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
 }
 
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level)
 {
-    // Walk the linked list of all tags and see if given tag is present in the list.
+    // Walk the bucket of the hash table and see if given tag is present in it.
     // This is slow because tags are compared as strings.
     uncached_tag_entry_t *it;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
+    SLIST_FOREACH(it, tag_table_bucket(tag), entries) {
         if (strcmp(tag, it->tag) == 0) {
             *level = it->level;
             return true;
@@ -283,25 +356,33 @@ static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *leve
     return false;
 }
 
-static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag)
+static inline uint32_t tag_cache_index(const char *tag)
 {
-    return level_for_message <= level_for_tag;
+    // Fibonacci hashing of the tag pointer
+    uintptr_t ptr = (uintptr_t) tag;
+    return ((uint32_t) (ptr ^ (ptr >> 16)) * 2654435769u) >> (32 - TAG_CACHE_BITS);
 }
 
-static void heap_bubble_down(int index)
+static inline struct log_tags_head *tag_table_bucket(const char *tag)
 {
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
+    // FNV-1a hash of the tag string
+    uint32_t hash = 2166136261u;
+    for (const char *p = tag; *p != '\0'; ++p) {
+        hash = (hash ^ (uint8_t) *p) * 16777619u;
     }
+    return &s_log_tags[hash & (TAG_TABLE_SIZE - 1)];
 }
 
-static inline void heap_swap(int i, int j)
+static inline void publish_new_version(void)
 {
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
+    uint32_t version = (s_log_tags_version + 1) & VERSION_MASK;
+    if (version == 0) {
+        version = 1;
+    }
+    __atomic_store_n(&s_log_tags_version, version, __ATOMIC_RELEASE);
+}
+
+static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag)
+{
+    return level_for_message <= level_for_tag;
 }
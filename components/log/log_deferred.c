@@ -0,0 +1,530 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Deferred log implementation notes.
+ *
+ * In deferred mode, esp_log_writev() doesn't format the message. Instead, it
+ * stores a record made of the address of the format string and the raw values
+ * of the arguments into a log buffer. Only format strings in flash (DROM) are
+ * known to outlive the call, other ones are copied into the record in front of
+ * the arguments, and the address is NULL then. Records are formatted and output later
+ * by a low priority task (a thread on Linux), see esp_log_deferred_process().
+ *
+ * There is one log buffer per core. Producers (tasks and ISRs) reserve space in
+ * the buffer of the core they are running on by advancing its 'reserve' position
+ * with a compare-and-swap, so they never take a lock and only contend with each
+ * other if they preempt each other. A record is committed by setting a flag in
+ * its header with a release store once it has been written. The consumer
+ * processes records in order and stops at the first record which has not been
+ * committed yet. Consumed space is zeroed, so that a header which has been
+ * reserved but not written yet never looks committed.
+ *
+ * Positions are free running 32-bit counters, the buffer size is a power of two.
+ * A record never wraps around the end of the buffer, a padding record fills the
+ * remaining space instead.
+ *
+ * Arguments are stored in the order given by the conversion specifications of
+ * the format string, each one 4-byte aligned. Strings (%s) are copied into the
+ * record, as they may not outlive the call, up to the precision if there is one. The consumer parses the format string
+ * again and formats each conversion separately.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+#if !CONFIG_IDF_TARGET_LINUX && !CONFIG_FREERTOS_UNICORE
+#include "soc/soc_caps.h"
+#define LOG_DEFERRED_NUM_BUFFERS    SOC_CPU_CORES_NUM
+#else
+#define LOG_DEFERRED_NUM_BUFFERS    1
+#endif
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_memory_utils.h"
+#define FORMAT_IS_CONSTANT(format)  esp_ptr_in_drom(format)
+#else
+#define FORMAT_IS_CONSTANT(format)  false   // Constant strings can't be told apart from other ones
+#endif
+
+#define LOG_DEFERRED_BUFFER_SIZE    CONFIG_LOG_DEFERRED_BUFFER_SIZE
+#define LOG_DEFERRED_BUFFER_MASK    (LOG_DEFERRED_BUFFER_SIZE - 1)
+_Static_assert((LOG_DEFERRED_BUFFER_SIZE & LOG_DEFERRED_BUFFER_MASK) == 0, "CONFIG_LOG_DEFERRED_BUFFER_SIZE must be a power of two");
+
+// Maximum size of a record. Messages with larger arguments are output immediately.
+#define LOG_DEFERRED_MAX_RECORD_SIZE    256
+_Static_assert(LOG_DEFERRED_MAX_RECORD_SIZE <= LOG_DEFERRED_BUFFER_SIZE / 4, "Deferred log buffer is too small");
+
+// Size of the buffer used by the consumer to assemble the output
+#define LOG_DEFERRED_LINE_SIZE      128
+
+#define ALIGN_UP(size)              (((size) + 3) & ~3)
+
+// Record header word
+#define RECORD_LEN_MASK             0xffff          // Length of the record in bytes, including the header
+#define RECORD_COMMITTED            (1 << 16)       // Record has been written and can be processed
+#define RECORD_PADDING              (1 << 17)       // Record only fills the space until the end of the buffer
+
+// A record is made of the header word, the address of the format string (or NULL if the format string
+// is copied, right after it) and the arguments
+#define RECORD_FORMAT_OFFSET        sizeof(uint32_t)
+#define RECORD_ARGS_OFFSET          (RECORD_FORMAT_OFFSET + ALIGN_UP(sizeof(const char *)))
+
+typedef struct {
+    uint32_t reserve;       // Position up to which space has been reserved by producers
+    uint32_t read;          // Position of the next record to be processed by the consumer
+    uint32_t dropped;       // Number of messages dropped because the buffer was full
+    uint8_t data[LOG_DEFERRED_BUFFER_SIZE] __attribute__((aligned(4)));
+} log_buffer_t;
+
+typedef enum {
+    ARG_NONE,               // Conversion doesn't take an argument (%%)
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LONG_DOUBLE,
+    ARG_POINTER,
+    ARG_STRING,
+    ARG_UNSUPPORTED,        // Conversion can't be deferred (e.g. %n, wide strings or invalid specification)
+} arg_type_t;
+
+typedef struct {
+    const char *start;      // Points to the '%' character
+    const char *end;        // Points past the conversion character
+    int num_stars;          // Number of '*' (width or precision passed as an int argument)
+    int precision;          // Precision given in the format string, -1 if there is none
+    bool precision_star;    // Precision is passed as an int argument, the last of the '*' arguments
+    arg_type_t type;
+} conv_spec_t;
+
+typedef struct {
+    char line[LOG_DEFERRED_LINE_SIZE];
+    size_t len;
+} output_ctx_t;
+
+static const char *TAG = "log";
+static log_buffer_t s_log_buffers[LOG_DEFERRED_NUM_BUFFERS];
+static output_ctx_t s_output_ctx;
+
+/* Parse the conversion specification starting at the '%' character pointed to by p */
+static void parse_conv_spec(const char *p, conv_spec_t *spec)
+{
+    enum { LEN_NONE, LEN_LONG, LEN_LONG_LONG, LEN_INTMAX, LEN_SIZE, LEN_PTRDIFF, LEN_LONG_DOUBLE } length = LEN_NONE;
+
+    spec->start = p++;
+    spec->num_stars = 0;
+    spec->precision = -1;
+    spec->precision_star = false;
+    // Flags
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        p++;
+    }
+    // Width
+    if (*p == '*') {
+        spec->num_stars++;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    // Precision
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->num_stars++;
+            spec->precision_star = true;
+            p++;
+        } else {
+            spec->precision = 0;
+            while (*p >= '0' && *p <= '9') {
+                spec->precision = spec->precision * 10 + (*p - '0');
+                p++;
+            }
+        }
+    }
+    // Length modifier
+    switch (*p) {
+    case 'h':
+        p += (p[1] == 'h') ? 2 : 1;     // char and short are promoted to int
+        break;
+    case 'l':
+        if (p[1] == 'l') {
+            length = LEN_LONG_LONG;
+            p += 2;
+        } else {
+            length = LEN_LONG;
+            p++;
+        }
+        break;
+    case 'q':
+        length = LEN_LONG_LONG;
+        p++;
+        break;
+    case 'j':
+        length = LEN_INTMAX;
+        p++;
+        break;
+    case 'z':
+        length = LEN_SIZE;
+        p++;
+        break;
+    case 't':
+        length = LEN_PTRDIFF;
+        p++;
+        break;
+    case 'L':
+        length = LEN_LONG_DOUBLE;
+        p++;
+        break;
+    default:
+        break;
+    }
+    // Conversion
+    switch (*p) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        switch (length) {
+        case LEN_LONG:      spec->type = ARG_LONG; break;
+        case LEN_LONG_LONG: spec->type = ARG_LONG_LONG; break;
+        case LEN_INTMAX:    spec->type = ARG_INTMAX; break;
+        case LEN_SIZE:      spec->type = ARG_SIZE; break;
+        case LEN_PTRDIFF:   spec->type = ARG_PTRDIFF; break;
+        default:            spec->type = ARG_INT; break;
+        }
+        break;
+    case 'c':
+        spec->type = (length == LEN_NONE) ? ARG_INT : ARG_UNSUPPORTED;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec->type = (length == LEN_LONG_DOUBLE) ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+        break;
+    case 's':
+        spec->type = (length == LEN_NONE) ? ARG_STRING : ARG_UNSUPPORTED;
+        break;
+    case 'p':
+        spec->type = ARG_POINTER;
+        break;
+    case '%':
+        spec->type = ARG_NONE;
+        break;
+    default:
+        spec->type = ARG_UNSUPPORTED;
+        break;
+    }
+    spec->end = (*p != '\0') ? p + 1 : p;
+}
+
+#define PACK_ARG(type) do { \
+        type _value = va_arg(args, type); \
+        if (len + ALIGN_UP(sizeof(type)) > LOG_DEFERRED_MAX_RECORD_SIZE) { \
+            return 0; \
+        } \
+        memcpy(record + len, &_value, sizeof(type)); \
+        len += ALIGN_UP(sizeof(type)); \
+    } while (0)
+
+/* Pack the format string and arguments into a record. Returns the length of the record, or 0 if it can't be deferred. */
+static size_t pack_record(uint8_t *record, const char *format, va_list args)
+{
+    size_t len = RECORD_ARGS_OFFSET;
+    if (FORMAT_IS_CONSTANT(format)) {
+        memcpy(record + RECORD_FORMAT_OFFSET, &format, sizeof(format));
+    } else {
+        // The format string may be in a buffer which doesn't outlive the call
+        const char *copied = NULL;
+        size_t format_len = strlen(format);
+        if (len + ALIGN_UP(format_len + 1) > LOG_DEFERRED_MAX_RECORD_SIZE) {
+            return 0;
+        }
+        memcpy(record + RECORD_FORMAT_OFFSET, &copied, sizeof(copied));
+        memcpy(record + len, format, format_len + 1);
+        len += ALIGN_UP(format_len + 1);
+    }
+
+    for (const char *p = format; *p != '\0';) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        conv_spec_t spec;
+        parse_conv_spec(p, &spec);
+        p = spec.end;
+        for (int i = 0; i < spec.num_stars; i++) {
+            PACK_ARG(int);
+        }
+        int precision = spec.precision;
+        if (spec.precision_star) {
+            // A negative precision argument is taken as if the precision was omitted
+            memcpy(&precision, record + len - ALIGN_UP(sizeof(int)), sizeof(int));
+        }
+        switch (spec.type) {
+        case ARG_NONE:          break;
+        case ARG_INT:           PACK_ARG(int); break;
+        case ARG_LONG:          PACK_ARG(long); break;
+        case ARG_LONG_LONG:     PACK_ARG(long long); break;
+        case ARG_INTMAX:        PACK_ARG(intmax_t); break;
+        case ARG_SIZE:          PACK_ARG(size_t); break;
+        case ARG_PTRDIFF:       PACK_ARG(ptrdiff_t); break;
+        case ARG_DOUBLE:        PACK_ARG(double); break;
+        case ARG_LONG_DOUBLE:   PACK_ARG(long double); break;
+        case ARG_POINTER:       PACK_ARG(void *); break;
+        case ARG_STRING: {
+            const char *str = va_arg(args, const char *);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            // With a precision, the string doesn't need to be NUL-terminated and no more than that is read
+            size_t str_len = (precision >= 0) ? strnlen(str, precision) : strlen(str);
+            if (len + ALIGN_UP(str_len + 1) > LOG_DEFERRED_MAX_RECORD_SIZE) {
+                return 0;
+            }
+            memcpy(record + len, str, str_len);
+            record[len + str_len] = '\0';
+            len += ALIGN_UP(str_len + 1);
+            break;
+        }
+        default:
+            return 0;
+        }
+    }
+    return len;
+}
+
+bool esp_log_deferred_writev(const char *format, va_list args)
+{
+    uint32_t record[LOG_DEFERRED_MAX_RECORD_SIZE / sizeof(uint32_t)];
+
+    if (!esp_log_impl_deferred_start()) {
+        return false;   // Nobody can process the record yet (e.g. the scheduler is not running)
+    }
+    size_t len = pack_record((uint8_t *)record, format, args);
+    if (len == 0) {
+        return false;
+    }
+
+    log_buffer_t *buffer = &s_log_buffers[esp_log_impl_get_core_id() % LOG_DEFERRED_NUM_BUFFERS];
+    uint32_t reserve = __atomic_load_n(&buffer->reserve, __ATOMIC_RELAXED);
+    uint32_t padding;
+    do {
+        uint32_t read = __atomic_load_n(&buffer->read, __ATOMIC_ACQUIRE);
+        uint32_t offset = reserve & LOG_DEFERRED_BUFFER_MASK;
+        padding = (offset + len > LOG_DEFERRED_BUFFER_SIZE) ? LOG_DEFERRED_BUFFER_SIZE - offset : 0;
+        if (reserve + padding + len - read > LOG_DEFERRED_BUFFER_SIZE) {
+            // Buffer is full, the consumer reports the number of dropped messages
+            __atomic_fetch_add(&buffer->dropped, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    } while (!__atomic_compare_exchange_n(&buffer->reserve, &reserve, reserve + padding + len, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    // Write the record, then commit it (and the padding in front of it, if any)
+    uint32_t *header = (uint32_t *)&buffer->data[(reserve + padding) & LOG_DEFERRED_BUFFER_MASK];
+    memcpy(header + 1, &record[1], len - sizeof(uint32_t));
+    __atomic_store_n(header, len | RECORD_COMMITTED, __ATOMIC_RELEASE);
+    if (padding) {
+        __atomic_store_n((uint32_t *)&buffer->data[reserve & LOG_DEFERRED_BUFFER_MASK], padding | RECORD_COMMITTED | RECORD_PADDING, __ATOMIC_RELEASE);
+    }
+
+    /*
+     * The consumer only waits if it has found the buffer empty, or the record at
+     * its read position not committed yet. In both cases its read position is the
+     * start of this reservation. The consumer stores its read position and then
+     * checks the header, this function stores the header and then checks the read
+     * position, the full barriers ensure that at least one of them sees the other's write.
+     */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&buffer->read, __ATOMIC_RELAXED) == reserve) {
+        esp_log_impl_deferred_notify();
+    }
+    return true;
+}
+
+static void output_flush(output_ctx_t *ctx)
+{
+    if (ctx->len > 0) {
+        esp_log_output("%.*s", (int)ctx->len, ctx->line);
+        ctx->len = 0;
+    }
+}
+
+static void output_text(output_ctx_t *ctx, const char *text, size_t len)
+{
+    while (len > 0) {
+        size_t chunk = sizeof(ctx->line) - ctx->len;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(ctx->line + ctx->len, text, chunk);
+        ctx->len += chunk;
+        text += chunk;
+        len -= chunk;
+        if (ctx->len == sizeof(ctx->line)) {
+            output_flush(ctx);
+        }
+    }
+}
+
+/* Format a conversion into the line buffer. If it doesn't fit even into an empty line buffer, output it directly. */
+#define OUTPUT_CONVERSION(ctx, conv, ...) do { \
+        size_t _size = sizeof((ctx)->line) - (ctx)->len; \
+        int _ret = snprintf((ctx)->line + (ctx)->len, _size, conv, __VA_ARGS__); \
+        if (_ret >= (int)_size) { \
+            output_flush(ctx); \
+            _ret = snprintf((ctx)->line, sizeof((ctx)->line), conv, __VA_ARGS__); \
+            if (_ret >= (int)sizeof((ctx)->line)) { \
+                esp_log_output(conv, __VA_ARGS__); \
+                _ret = 0; \
+            } \
+        } \
+        if (_ret > 0) { \
+            (ctx)->len += _ret; \
+        } \
+    } while (0)
+
+#define UNPACK_AND_OUTPUT(type, ctx, conv, num_stars, stars) do { \
+        type _value; \
+        memcpy(&_value, args, sizeof(type)); \
+        args += ALIGN_UP(sizeof(type)); \
+        switch (num_stars) { \
+        case 0:  OUTPUT_CONVERSION(ctx, conv, _value); break; \
+        case 1:  OUTPUT_CONVERSION(ctx, conv, (stars)[0], _value); break; \
+        default: OUTPUT_CONVERSION(ctx, conv, (stars)[0], (stars)[1], _value); break; \
+        } \
+    } while (0)
+
+static void output_record(output_ctx_t *ctx, const uint8_t *record)
+{
+    const uint8_t *args = record + RECORD_ARGS_OFFSET;
+    const char *p;
+    memcpy(&p, record + RECORD_FORMAT_OFFSET, sizeof(p));
+    if (p == NULL) {
+        p = (const char *)args;
+        args += ALIGN_UP(strlen(p) + 1);
+    }
+
+    while (*p != '\0') {
+        const char *text = p;
+        while (*p != '\0' && *p != '%') {
+            p++;
+        }
+        output_text(ctx, text, p - text);
+        if (*p == '\0') {
+            break;
+        }
+
+        conv_spec_t spec;
+        char conv[16];
+        int stars[2];
+        parse_conv_spec(p, &spec);
+        p = spec.end;
+        for (int i = 0; i < spec.num_stars; i++) {
+            memcpy(&stars[i], args, sizeof(int));
+            args += ALIGN_UP(sizeof(int));
+        }
+        size_t conv_len = spec.end - spec.start;
+        if (conv_len >= sizeof(conv)) {
+            // Unreasonably long specification (e.g. many flags), only keep the end of it
+            conv[0] = '%';
+            memcpy(conv + 1, spec.end - (sizeof(conv) - 2), sizeof(conv) - 2);
+            conv_len = sizeof(conv) - 1;
+        } else {
+            memcpy(conv, spec.start, conv_len);
+        }
+        conv[conv_len] = '\0';
+
+        switch (spec.type) {
+        case ARG_NONE:          output_text(ctx, "%", 1); break;
+        case ARG_INT:           UNPACK_AND_OUTPUT(int, ctx, conv, spec.num_stars, stars); break;
+        case ARG_LONG:          UNPACK_AND_OUTPUT(long, ctx, conv, spec.num_stars, stars); break;
+        case ARG_LONG_LONG:     UNPACK_AND_OUTPUT(long long, ctx, conv, spec.num_stars, stars); break;
+        case ARG_INTMAX:        UNPACK_AND_OUTPUT(intmax_t, ctx, conv, spec.num_stars, stars); break;
+        case ARG_SIZE:          UNPACK_AND_OUTPUT(size_t, ctx, conv, spec.num_stars, stars); break;
+        case ARG_PTRDIFF:       UNPACK_AND_OUTPUT(ptrdiff_t, ctx, conv, spec.num_stars, stars); break;
+        case ARG_DOUBLE:        UNPACK_AND_OUTPUT(double, ctx, conv, spec.num_stars, stars); break;
+        case ARG_LONG_DOUBLE:   UNPACK_AND_OUTPUT(long double, ctx, conv, spec.num_stars, stars); break;
+        case ARG_POINTER:       UNPACK_AND_OUTPUT(void *, ctx, conv, spec.num_stars, stars); break;
+        case ARG_STRING: {
+            const char *str = (const char *)args;
+            size_t str_len = strlen(str);
+            args += ALIGN_UP(str_len + 1);
+            if (conv_len == 2 && spec.num_stars == 0) {
+                output_text(ctx, str, str_len);     // Plain %s, no need to go through snprintf
+            } else {
+                switch (spec.num_stars) {
+                case 0:  OUTPUT_CONVERSION(ctx, conv, str); break;
+                case 1:  OUTPUT_CONVERSION(ctx, conv, stars[0], str); break;
+                default: OUTPUT_CONVERSION(ctx, conv, stars[0], stars[1], str); break;
+                }
+            }
+            break;
+        }
+        default:
+            // Records with unsupported conversions are never deferred
+            break;
+        }
+    }
+    output_flush(ctx);
+}
+
+void esp_log_deferred_process(void)
+{
+    for (int i = 0; i < LOG_DEFERRED_NUM_BUFFERS; i++) {
+        log_buffer_t *buffer = &s_log_buffers[i];
+        uint32_t read = buffer->read;
+
+        uint32_t dropped = __atomic_exchange_n(&buffer->dropped, 0, __ATOMIC_RELAXED);
+        if (dropped) {
+            esp_log_output(LOG_FORMAT(W, "%" PRIu32 " deferred log messages dropped"), esp_log_timestamp(), TAG, dropped);
+        }
+
+        while (read != __atomic_load_n(&buffer->reserve, __ATOMIC_ACQUIRE)) {
+            uint32_t *header = (uint32_t *)&buffer->data[read & LOG_DEFERRED_BUFFER_MASK];
+            uint32_t value = __atomic_load_n(header, __ATOMIC_ACQUIRE);
+            if ((value & RECORD_COMMITTED) == 0) {
+                break;  // The producer is still writing the record, it notifies us when it's done
+            }
+            uint32_t len = value & RECORD_LEN_MASK;
+            if ((value & RECORD_PADDING) == 0) {
+                output_record(&s_output_ctx, (const uint8_t *)header);
+            }
+            // Zero the space before releasing it, so that it doesn't contain stale headers
+            memset(header, 0, len);
+            read += len;
+            __atomic_store_n(&buffer->read, read, __ATOMIC_RELEASE);
+            // Pairs with the barrier in esp_log_deferred_writev()
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        }
+    }
+}
+
+void esp_log_deferred_flush(void)
+{
+    uint32_t reserve[LOG_DEFERRED_NUM_BUFFERS];
+
+    if (!esp_log_impl_deferred_start()) {
+        return;     // Nothing was deferred
+    }
+    for (int i = 0; i < LOG_DEFERRED_NUM_BUFFERS; i++) {
+        reserve[i] = __atomic_load_n(&s_log_buffers[i].reserve, __ATOMIC_ACQUIRE);
+    }
+    for (int i = 0; i < LOG_DEFERRED_NUM_BUFFERS; i++) {
+        while ((int32_t)(__atomic_load_n(&s_log_buffers[i].read, __ATOMIC_ACQUIRE) - reserve[i]) < 0) {
+            esp_log_impl_deferred_notify();
+            esp_log_impl_deferred_delay();
+        }
+    }
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -56,6 +56,64 @@ void esp_log_impl_unlock(void)
     xSemaphoreGive(s_log_mutex);
 }
 
+#if LOG_DEFERRED_ENABLED
+static TaskHandle_t s_log_deferred_task = NULL;
+static bool s_log_deferred_starting = false;
+
+static void log_deferred_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        esp_log_deferred_process();
+    }
+}
+
+bool esp_log_impl_deferred_start(void)
+{
+    if (likely(s_log_deferred_task != NULL)) {
+        return true;
+    }
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED || xPortInIsrContext()) {
+        return false;
+    }
+    if (__atomic_exchange_n(&s_log_deferred_starting, true, __ATOMIC_ACQ_REL)) {
+        return false;   // Another task is creating the log task, output this message immediately
+    }
+    TaskHandle_t task;
+    if (xTaskCreate(log_deferred_task, "log", CONFIG_LOG_DEFERRED_TASK_STACK_SIZE, NULL,
+                    CONFIG_LOG_DEFERRED_TASK_PRIORITY, &task) != pdPASS) {
+        __atomic_store_n(&s_log_deferred_starting, false, __ATOMIC_RELEASE);
+        return false;
+    }
+    __atomic_store_n(&s_log_deferred_task, task, __ATOMIC_RELEASE);
+    return true;
+}
+
+void esp_log_impl_deferred_notify(void)
+{
+    TaskHandle_t task = __atomic_load_n(&s_log_deferred_task, __ATOMIC_ACQUIRE);
+    if (task == NULL) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        // The log task has a low priority, no need to yield
+        vTaskNotifyGiveFromISR(task, NULL);
+    } else {
+        xTaskNotifyGive(task);
+    }
+}
+
+void esp_log_impl_deferred_delay(void)
+{
+    vTaskDelay(1);
+}
+
+uint32_t esp_log_impl_get_core_id(void)
+{
+    return xPortGetCoreID();
+}
+#endif // LOG_DEFERRED_ENABLED
+
 char *esp_log_system_timestamp(void)
 {
     static char buffer[18] = {0};
@@ -14,6 +14,7 @@
 
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
 #include <assert.h>
 #include <stdint.h>
 #include "esp_log_private.h"
@@ -44,3 +45,58 @@ uint32_t esp_log_timestamp(void)
     uint32_t milliseconds = current_time.tv_sec * 1000 + current_time.tv_nsec / 1000000;
     return milliseconds;
 }
+
+#if LOG_DEFERRED_ENABLED
+static pthread_once_t s_log_deferred_once = PTHREAD_ONCE_INIT;
+static bool s_log_deferred_started = false;
+static pthread_mutex_t s_log_deferred_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_log_deferred_cond = PTHREAD_COND_INITIALIZER;
+static bool s_log_deferred_pending = false;
+
+static void *log_deferred_thread(void *arg)
+{
+    while (1) {
+        pthread_mutex_lock(&s_log_deferred_mutex);
+        while (!s_log_deferred_pending) {
+            pthread_cond_wait(&s_log_deferred_cond, &s_log_deferred_mutex);
+        }
+        s_log_deferred_pending = false;
+        pthread_mutex_unlock(&s_log_deferred_mutex);
+        esp_log_deferred_process();
+    }
+    return NULL;
+}
+
+static void log_deferred_thread_start(void)
+{
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, log_deferred_thread, NULL) == 0) {
+        pthread_detach(thread);
+        __atomic_store_n(&s_log_deferred_started, true, __ATOMIC_RELEASE);
+    }
+}
+
+bool esp_log_impl_deferred_start(void)
+{
+    pthread_once(&s_log_deferred_once, log_deferred_thread_start);
+    return __atomic_load_n(&s_log_deferred_started, __ATOMIC_ACQUIRE);
+}
+
+void esp_log_impl_deferred_notify(void)
+{
+    pthread_mutex_lock(&s_log_deferred_mutex);
+    s_log_deferred_pending = true;
+    pthread_cond_signal(&s_log_deferred_cond);
+    pthread_mutex_unlock(&s_log_deferred_mutex);
+}
+
+void esp_log_impl_deferred_delay(void)
+{
+    usleep(1000);
+}
+
+uint32_t esp_log_impl_get_core_id(void)
+{
+    return 0;
+}
+#endif // LOG_DEFERRED_ENABLED
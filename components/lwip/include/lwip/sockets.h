@@ -1,10 +1,15 @@
 /*
- * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #pragma once
 
+#include <sys/uio.h>
+/* struct iovec comes from sys/uio.h, lwIP defines its own only if iovec is not a macro */
+#ifndef iovec
+#define iovec iovec
+#endif
 #include_next "lwip/sockets.h"
 #include "sdkconfig.h"
 
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2020-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2020-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -41,6 +41,24 @@ ssize_t _read_r(struct _reent *r, int fd, void * dst, size_t size)
     return lwip_read(fd, dst, size);
 }
 
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    if (fd < LWIP_SOCKET_OFFSET) {
+        errno = ENOSYS;
+        return -1;
+    }
+    return lwip_writev(fd, iov, iovcnt);
+}
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    if (fd < LWIP_SOCKET_OFFSET) {
+        errno = ENOSYS;
+        return -1;
+    }
+    return lwip_readv(fd, iov, iovcnt);
+}
+
 int _close_r(struct _reent *r, int fd)
 {
     if (fd < LWIP_SOCKET_OFFSET) {
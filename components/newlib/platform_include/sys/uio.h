@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -13,12 +13,19 @@
 extern "C" {
 #endif
 
-struct iovec;
+struct iovec {
+    void *iov_base;     /* Base address of the buffer */
+    size_t iov_len;     /* Length of the buffer */
+};
 
-int writev(int s, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
 
 ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
 
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
 #ifdef __cplusplus
 }
 #endif
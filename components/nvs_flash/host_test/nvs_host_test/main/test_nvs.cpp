@@ -2055,3 +2055,241 @@ TEST_CASE("Recovery from power-off during modification of blob present in old-fo
 
     TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
 }
+
+TEST_CASE("nvs write batch is applied on commit and discarded on abort", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 5);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "counter", 1));
+    TEST_ESP_OK(nvs_set_str(handle, "name", "old"));
+
+    TEST_ESP_ERR(nvs_batch_commit(handle), ESP_ERR_INVALID_STATE);
+    TEST_ESP_ERR(nvs_batch_abort(handle), ESP_ERR_INVALID_STATE);
+
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_ERR(nvs_batch_begin(handle), ESP_ERR_INVALID_STATE);
+    TEST_ESP_OK(nvs_set_i32(handle, "counter", 2));
+    TEST_ESP_OK(nvs_set_i32(handle, "counter", 3));
+    TEST_ESP_OK(nvs_set_str(handle, "name", "new"));
+    TEST_ESP_OK(nvs_set_u8(handle, "flag", 1));
+    uint8_t blob[] = {1, 2, 3};
+    TEST_ESP_ERR(nvs_set_blob(handle, "blob", blob, sizeof(blob)), ESP_ERR_NOT_SUPPORTED);
+    TEST_ESP_ERR(nvs_erase_key(handle, "counter"), ESP_ERR_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_all(handle), ESP_ERR_INVALID_STATE);
+
+    // staged values aren't visible before the commit
+    int32_t counter;
+    uint8_t flag;
+    char name[8];
+    size_t nameSize = sizeof(name);
+    TEST_ESP_OK(nvs_get_i32(handle, "counter", &counter));
+    CHECK(counter == 1);
+    TEST_ESP_OK(nvs_get_str(handle, "name", name, &nameSize));
+    CHECK(strcmp(name, "old") == 0);
+    TEST_ESP_ERR(nvs_get_u8(handle, "flag", &flag), ESP_ERR_NVS_NOT_FOUND);
+
+    TEST_ESP_OK(nvs_batch_commit(handle));
+    TEST_ESP_OK(nvs_get_i32(handle, "counter", &counter));
+    CHECK(counter == 3);
+    nameSize = sizeof(name);
+    TEST_ESP_OK(nvs_get_str(handle, "name", name, &nameSize));
+    CHECK(strcmp(name, "new") == 0);
+    TEST_ESP_OK(nvs_get_u8(handle, "flag", &flag));
+    CHECK(flag == 1);
+
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "counter", 4));
+    TEST_ESP_OK(nvs_set_u8(handle, "other", 1));
+    TEST_ESP_OK(nvs_batch_abort(handle));
+    TEST_ESP_OK(nvs_get_i32(handle, "counter", &counter));
+    CHECK(counter == 3);
+    TEST_ESP_ERR(nvs_get_u8(handle, "other", &flag), ESP_ERR_NVS_NOT_FOUND);
+
+    // an empty batch and a batch without changes commit without touching flash
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_OK(nvs_batch_commit(handle));
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "counter", 3));
+    esp_partition_clear_stats();
+    TEST_ESP_OK(nvs_batch_commit(handle));
+    CHECK(esp_partition_get_write_ops() == 0);
+
+    nvs_close(handle);
+
+    nvs_handle_t handle_ro;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle_ro));
+    TEST_ESP_ERR(nvs_batch_begin(handle_ro), ESP_ERR_NVS_READ_ONLY);
+    nvs_close(handle_ro);
+
+    // the journal is neither visible nor left behind
+    nvs_iterator_t it = nullptr;
+    size_t entries = 0;
+    esp_err_t res = nvs_entry_find(NVS_DEFAULT_PART_NAME, nullptr, NVS_TYPE_ANY, &it);
+    while (res == ESP_OK) {
+        ++entries;
+        res = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    CHECK(entries == 3);
+
+    nvs_stats_t stats;
+    TEST_ESP_OK(nvs_get_stats(NVS_DEFAULT_PART_NAME, &stats));
+    CHECK(stats.used_entries == 5);
+
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("nvs write batch needs fewer flash writes than separate writes", "[nvs]")
+{
+    const size_t KEY_COUNT = 200;
+    char key[16];
+    size_t write_ops[2];
+
+    for (int batched = 0; batched < 2; ++batched) {
+        PartitionEmulationFixture f(0, 8);
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 8));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+
+        esp_partition_clear_stats();
+        if (batched) {
+            TEST_ESP_OK(nvs_batch_begin(handle));
+        }
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        }
+        if (batched) {
+            TEST_ESP_OK(nvs_batch_commit(handle));
+        }
+        write_ops[batched] = esp_partition_get_write_ops();
+
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            uint32_t value;
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == i);
+        }
+
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    }
+
+    CHECK(write_ops[1] * 4 < write_ops[0]);
+}
+
+TEST_CASE("nvs blob stream writes and reads a blob in pieces", "[nvs]")
+{
+    const size_t BLOB_SIZE = 20000;
+    PartitionEmulationFixture f(0, 10);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 10));
+
+    std::unique_ptr<uint8_t[]> blob(new uint8_t[BLOB_SIZE]);
+    std::unique_ptr<uint8_t[]> read_blob(new uint8_t[BLOB_SIZE]);
+    for (size_t i = 0; i < BLOB_SIZE; ++i) {
+        blob[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_ERR(nvs_blob_open_stream(handle, "blob", NVS_BLOB_STREAM_READ), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_ERR(nvs_blob_stream_write(handle, blob.get(), 1), ESP_ERR_INVALID_STATE);
+    TEST_ESP_ERR(nvs_blob_close_stream(handle), ESP_ERR_INVALID_STATE);
+
+    // the blob is written in pieces which don't match the chunk size
+    TEST_ESP_OK(nvs_blob_open_stream(handle, "blob", NVS_BLOB_STREAM_WRITE));
+    TEST_ESP_ERR(nvs_blob_open_stream(handle, "other", NVS_BLOB_STREAM_WRITE), ESP_ERR_INVALID_STATE);
+    for (size_t offset = 0; offset < BLOB_SIZE; offset += 97) {
+        TEST_ESP_OK(nvs_blob_stream_write(handle, blob.get() + offset, std::min<size_t>(97, BLOB_SIZE - offset)));
+    }
+    size_t size = 0;
+    TEST_ESP_ERR(nvs_get_blob(handle, "blob", nullptr, &size), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(nvs_blob_close_stream(handle));
+
+    size = BLOB_SIZE;
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", read_blob.get(), &size));
+    CHECK(size == BLOB_SIZE);
+    CHECK(memcmp(blob.get(), read_blob.get(), BLOB_SIZE) == 0);
+
+    // reading in pieces, a read at the end of the blob returns no data
+    memset(read_blob.get(), 0, BLOB_SIZE);
+    TEST_ESP_OK(nvs_blob_open_stream(handle, "blob", NVS_BLOB_STREAM_READ));
+    TEST_ESP_ERR(nvs_blob_stream_write(handle, blob.get(), 1), ESP_ERR_INVALID_STATE);
+    size_t length;
+    for (size_t offset = 0; offset < BLOB_SIZE; offset += length) {
+        length = std::min<size_t>(61, BLOB_SIZE - offset);
+        TEST_ESP_OK(nvs_blob_stream_read(handle, read_blob.get() + offset, &length));
+        REQUIRE(length == std::min<size_t>(61, BLOB_SIZE - offset));
+    }
+    CHECK(memcmp(blob.get(), read_blob.get(), BLOB_SIZE) == 0);
+    length = 1;
+    TEST_ESP_OK(nvs_blob_stream_read(handle, read_blob.get(), &length));
+    CHECK(length == 0);
+    TEST_ESP_OK(nvs_blob_close_stream(handle));
+
+    // the previous version stays valid until the stream is closed
+    nvs_stats_t stats_before, stats;
+    TEST_ESP_OK(nvs_get_stats(NVS_DEFAULT_PART_NAME, &stats_before));
+    TEST_ESP_OK(nvs_blob_open_stream(handle, "blob", NVS_BLOB_STREAM_WRITE));
+    TEST_ESP_OK(nvs_blob_stream_write(handle, read_blob.get(), 5000));
+    size = BLOB_SIZE;
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", read_blob.get(), &size));
+    CHECK(size == BLOB_SIZE);
+    TEST_ESP_OK(nvs_blob_abort_stream(handle));
+    TEST_ESP_ERR(nvs_blob_abort_stream(handle), ESP_ERR_INVALID_STATE);
+    TEST_ESP_OK(nvs_get_stats(NVS_DEFAULT_PART_NAME, &stats));
+    CHECK(stats.used_entries == stats_before.used_entries);
+
+    // setting the blob closes a stream reading it
+    nvs_handle_t handle2;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle2));
+    TEST_ESP_ERR(nvs_blob_open_stream(handle2, "blob", NVS_BLOB_STREAM_WRITE), ESP_ERR_NVS_READ_ONLY);
+    TEST_ESP_OK(nvs_blob_open_stream(handle2, "blob", NVS_BLOB_STREAM_READ));
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob.get(), 100));
+    length = 10;
+    TEST_ESP_ERR(nvs_blob_stream_read(handle2, read_blob.get(), &length), ESP_ERR_INVALID_STATE);
+    CHECK(length == 0);
+    TEST_ESP_ERR(nvs_blob_close_stream(handle2), ESP_ERR_INVALID_STATE);
+
+    // an empty blob, and a blob stored by nvs_set_blob() read by a stream
+    TEST_ESP_OK(nvs_blob_open_stream(handle, "empty", NVS_BLOB_STREAM_WRITE));
+    TEST_ESP_OK(nvs_blob_close_stream(handle));
+    size = 0;
+    TEST_ESP_OK(nvs_get_blob(handle, "empty", nullptr, &size));
+    CHECK(size == 0);
+    TEST_ESP_OK(nvs_blob_open_stream(handle2, "blob", NVS_BLOB_STREAM_READ));
+    length = BLOB_SIZE;
+    TEST_ESP_OK(nvs_blob_stream_read(handle2, read_blob.get(), &length));
+    CHECK(length == 100);
+    CHECK(memcmp(blob.get(), read_blob.get(), 100) == 0);
+    nvs_close(handle2);
+
+    // closing the handle aborts its stream
+    TEST_ESP_OK(nvs_blob_open_stream(handle, "blob", NVS_BLOB_STREAM_WRITE));
+    TEST_ESP_OK(nvs_blob_stream_write(handle, blob.get(), 5000));
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    size = 0;
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", nullptr, &size));
+    CHECK(size == 100);
+    nvs_close(handle);
+
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("nvs_get_read_cache_stats checks its arguments", "[nvs]")
+{
+    nvs_read_cache_stats_t stats;
+    TEST_ESP_ERR(nvs_get_read_cache_stats(NULL, NULL), ESP_ERR_INVALID_ARG);
+    TEST_ESP_ERR(nvs_get_read_cache_stats("no_such_part", &stats), ESP_ERR_NVS_NOT_INITIALIZED);
+    CHECK(stats.hits == 0);
+
+    PartitionEmulationFixture f(0, 3);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 3));
+    TEST_ESP_OK(nvs_get_read_cache_stats(NULL, &stats));
+    CHECK(stats.total_bytes == CONFIG_NVS_READ_CACHE_SIZE);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -9,6 +9,8 @@
 #include "nvs_partition_manager.hpp"
 #include "test_fixtures.hpp"
 #include <iostream>
+#include <chrono>
+#include <cstdio>
 
 TEST_CASE("Storage iterator recognizes blob with VerOffset::VER_1_OFFSET", "[nvs_storage]")
 {
@@ -43,3 +45,549 @@ TEST_CASE("Storage iterator recognizes blob with VerOffset::VER_1_OFFSET", "[nvs
 
     REQUIRE(nvs::NVSPartitionManager::get_instance()->deinit_partition("test") == ESP_OK);
 }
+
+TEST_CASE("Storage key index keeps track of items while pages are reclaimed", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 8;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    nvs::Storage storage(f.part());
+    storage.setKeyIndexMaxEntries(1024);
+    REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+    CHECK(storage.isKeyIndexValid());
+
+    const size_t KEY_COUNT = 200;
+    char key[16];
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+    }
+
+    // overwriting the values several times makes the page manager reclaim pages and move items around
+    for (uint32_t round = 1; round <= 5; ++round) {
+        for (size_t i = 0; i < KEY_COUNT; i += 2) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i + round * KEY_COUNT)) == ESP_OK);
+        }
+    }
+    uint8_t blob[nvs::Page::CHUNK_MAX_SIZE + 100];
+    std::fill_n(blob, sizeof(blob), 0xa5);
+    REQUIRE(storage.writeItem(1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+    CHECK(storage.isKeyIndexValid());
+
+    for (size_t i = 0; i < KEY_COUNT; i += 3) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        REQUIRE(storage.eraseItem(1, key) == ESP_OK);
+    }
+
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        uint32_t value;
+        if (i % 3 == 0) {
+            CHECK(storage.readItem(1, key, value) == ESP_ERR_NVS_NOT_FOUND);
+        } else {
+            REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+            CHECK(value == ((i % 2 == 0) ? i + 5 * KEY_COUNT : i));
+        }
+        uint16_t wrong_type;
+        CHECK(storage.readItem(1, key, wrong_type) != ESP_OK);
+        CHECK(storage.readItem(2, key, value) == ESP_ERR_NVS_NOT_FOUND);
+    }
+    uint8_t blob_read[sizeof(blob)];
+    REQUIRE(storage.readItem(1, nvs::ItemType::BLOB, "blob", blob_read, sizeof(blob_read)) == ESP_OK);
+    CHECK(memcmp(blob, blob_read, sizeof(blob)) == 0);
+
+    // the index is rebuilt from flash contents when the storage is loaded again
+    nvs::Storage reloaded(f.part());
+    reloaded.setKeyIndexMaxEntries(1024);
+    reloaded.setLazyLoad(false);
+    REQUIRE(reloaded.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+    CHECK(reloaded.isKeyIndexValid());
+    uint32_t value;
+    CHECK(reloaded.readItem(1, "key1", value) == ESP_OK);
+    CHECK(value == 1);
+    CHECK(reloaded.readItem(1, "key3", value) == ESP_ERR_NVS_NOT_FOUND);
+    REQUIRE(reloaded.eraseNamespace(1) == ESP_OK);
+    CHECK(reloaded.readItem(1, "key1", value) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(reloaded.readItem(1, nvs::ItemType::BLOB, "blob", blob_read, sizeof(blob_read)) == ESP_ERR_NVS_NOT_FOUND);
+}
+
+TEST_CASE("Storage key index is dropped when it exceeds its budget", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 4;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    nvs::Storage storage(f.part());
+    storage.setKeyIndexMaxEntries(16);
+    REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+    CHECK(storage.isKeyIndexValid());
+
+    char key[16];
+    for (uint32_t i = 0; i < 32; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        REQUIRE(storage.writeItem(1, key, i) == ESP_OK);
+    }
+    CHECK(!storage.isKeyIndexValid());
+
+    // lookups fall back to searching all pages
+    for (uint32_t i = 0; i < 32; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        uint32_t value;
+        REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+        CHECK(value == i);
+    }
+}
+
+TEST_CASE("benchmark Storage lookups with and without key index", "[nvs_storage][benchmark]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 64;
+    const size_t KEY_COUNT = 4000;
+    const size_t READ_ROUNDS = 5;
+
+    for (size_t maxEntries : {static_cast<size_t>(0), static_cast<size_t>(8192)}) {
+        PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+        nvs::Storage storage(f.part());
+        storage.setKeyIndexMaxEntries(maxEntries);
+        REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+
+        char key[16];
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+        REQUIRE(storage.isKeyIndexValid() == (maxEntries != 0));
+
+        esp_partition_clear_stats();
+        auto start = std::chrono::steady_clock::now();
+        uint32_t value;
+        for (size_t round = 0; round < READ_ROUNDS; ++round) {
+            for (size_t i = 0; i < KEY_COUNT; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+            }
+            REQUIRE(storage.readItem(1, "missing", value) == ESP_ERR_NVS_NOT_FOUND);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        std::cout << "Key index " << (maxEntries ? "enabled: " : "disabled: ")
+                  << READ_ROUNDS * KEY_COUNT << " reads on " << NVS_FLASH_SECTOR_COUNT << " pages took "
+                  << elapsed.count() << " us, " << esp_partition_get_read_ops() << " flash reads" << std::endl;
+    }
+}
+
+TEST_CASE("Storage write batch is all-or-nothing on power-off", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 4;
+    const size_t KEY_COUNT = 12;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    nvs::NVSPartition part(&f.esp_partition);
+    char key[16];
+    char str[32];
+
+    auto check_values = [&](nvs::Storage& storage, uint32_t generation, size_t keyCount) {
+        for (size_t i = 0; i < keyCount; ++i) {
+            uint32_t value;
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+            CHECK(value == generation * 100 + i);
+        }
+        char read_str[sizeof(str)];
+        snprintf(str, sizeof(str), "generation %u", static_cast<unsigned>(generation));
+        REQUIRE(storage.readItem(1, nvs::ItemType::SZ, "str", read_str, strlen(str) + 1) == ESP_OK);
+        CHECK(strcmp(read_str, str) == 0);
+    };
+
+    auto write_values = [&](nvs::Storage& storage, uint32_t generation, size_t keyCount) {
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(generation * 100 + i)) == ESP_OK);
+        }
+        snprintf(str, sizeof(str), "generation %u", static_cast<unsigned>(generation));
+        REQUIRE(storage.writeItem(1, nvs::ItemType::SZ, "str", str, strlen(str) + 1) == ESP_OK);
+    };
+
+    // the journal of an interrupted batch also has to be found if the storage is loaded lazily
+    for (bool lazy : {false, true}) {
+        bool committed = false;
+        for (size_t failAfter = 0; !committed; ++failAfter) {
+            REQUIRE(esp_partition_erase_range(&f.esp_partition, 0, f.esp_partition.size) == ESP_OK);
+            {
+                nvs::Storage storage(&part);
+                REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+                write_values(storage, 1, KEY_COUNT / 2);
+
+                // the batch changes the existing values and adds new ones
+                nvs::BatchJournal batch(1);
+                for (size_t i = 0; i < KEY_COUNT; ++i) {
+                    uint32_t value = 200 + i;
+                    snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                    REQUIRE(batch.add(nvs::ItemType::U32, key, &value, sizeof(value)) == ESP_OK);
+                }
+                snprintf(str, sizeof(str), "generation %u", 2);
+                REQUIRE(batch.add(nvs::ItemType::SZ, "str", str, strlen(str) + 1) == ESP_OK);
+
+                // the emulated power-off counts down one step per 4 bytes written
+                esp_partition_clear_stats();
+                esp_partition_fail_after(failAfter, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+                committed = (storage.writeBatch(batch) == ESP_OK);
+                esp_partition_fail_after(SIZE_MAX, 0);
+                // so the power has been cut at each word written by the commit
+                if (committed) {
+                    CHECK(failAfter == esp_partition_get_write_bytes() / 4);
+                }
+            }
+
+            nvs::Storage storage(&part);
+            storage.setLazyLoad(lazy);
+            REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+            uint32_t value;
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(KEY_COUNT - 1));
+            if (storage.readItem(1, key, value) == ESP_OK) {
+                check_values(storage, 2, KEY_COUNT);
+            } else {
+                REQUIRE(!committed);
+                check_values(storage, 1, KEY_COUNT / 2);
+                for (size_t i = KEY_COUNT / 2; i < KEY_COUNT; ++i) {
+                    snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                    CHECK(storage.readItem(1, key, value) == ESP_ERR_NVS_NOT_FOUND);
+                }
+            }
+
+            // no stale versions are left behind which could show up after the next update
+            write_values(storage, 3, KEY_COUNT);
+            nvs::Storage reloaded(&part);
+            reloaded.setLazyLoad(lazy);
+            REQUIRE(reloaded.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+            check_values(reloaded, 3, KEY_COUNT);
+        }
+    }
+}
+
+TEST_CASE("Storage blob stream replaces a blob all-or-nothing on power-off", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 6;
+    const size_t BLOB_SIZE = 9000;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    nvs::NVSPartition part(&f.esp_partition);
+    std::unique_ptr<uint8_t[]> blob(new uint8_t[BLOB_SIZE]);
+    std::unique_ptr<uint8_t[]> read_blob(new uint8_t[BLOB_SIZE]);
+
+    auto fill_blob = [&](uint8_t generation) {
+        for (size_t i = 0; i < BLOB_SIZE; ++i) {
+            blob[i] = static_cast<uint8_t>(i + generation);
+        }
+    };
+
+    bool committed = false;
+    for (size_t failAfter = 0; !committed; ++failAfter) {
+        REQUIRE(esp_partition_erase_range(&f.esp_partition, 0, f.esp_partition.size) == ESP_OK);
+        {
+            nvs::Storage storage(&part);
+            REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+            fill_blob(1);
+            REQUIRE(storage.writeItem(1, nvs::ItemType::BLOB, "blob", blob.get(), BLOB_SIZE) == ESP_OK);
+
+            fill_blob(2);
+            nvs::BlobStream stream;
+            REQUIRE(storage.openBlobStream(stream, 1, "blob", nvs::BlobStream::Mode::WRITE) == ESP_OK);
+            esp_partition_fail_after(failAfter, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+            esp_err_t err = ESP_OK;
+            for (size_t offset = 0; offset < BLOB_SIZE && err == ESP_OK; offset += 1000) {
+                err = storage.writeBlobStream(stream, blob.get() + offset, 1000);
+            }
+            committed = (err == ESP_OK && storage.commitBlobStream(stream) == ESP_OK);
+            storage.abortBlobStream(stream);
+            esp_partition_fail_after(SIZE_MAX, 0);
+        }
+
+        // either version is complete, and no chunks of the other one are left behind
+        nvs::Storage storage(&part);
+        REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+        REQUIRE(storage.readItem(1, nvs::ItemType::BLOB, "blob", read_blob.get(), BLOB_SIZE) == ESP_OK);
+        CHECK((read_blob[0] == 1 || read_blob[0] == 2));
+        if (committed) {
+            CHECK(read_blob[0] == 2);
+        }
+        fill_blob(read_blob[0]);
+        CHECK(memcmp(blob.get(), read_blob.get(), BLOB_SIZE) == 0);
+
+        nvs_stats_t stats;
+        REQUIRE(storage.fillStats(stats) == ESP_OK);
+        CHECK(stats.used_entries == 1 + 3 + (BLOB_SIZE + 31) / 32);
+    }
+}
+
+TEST_CASE("Storage read cache serves repeated reads from RAM", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 3;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    nvs::Storage storage(f.part());
+    storage.setReadCacheSize(1024);
+    REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+
+    const char str[] = "cached string";
+    uint8_t blob[64];
+    for (size_t i = 0; i < sizeof(blob); ++i) {
+        blob[i] = static_cast<uint8_t>(i);
+    }
+    REQUIRE(storage.writeItem(1, "u32", static_cast<uint32_t>(42)) == ESP_OK);
+    REQUIRE(storage.writeItem(1, nvs::ItemType::SZ, "str", str, sizeof(str)) == ESP_OK);
+    REQUIRE(storage.writeItem(1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+
+    uint32_t value;
+    char read_str[sizeof(str)];
+    uint8_t read_blob[sizeof(blob)];
+    size_t size;
+    for (int i = 0; i < 2; ++i) {
+        esp_partition_clear_stats();
+        REQUIRE(storage.readItem(1, "u32", value) == ESP_OK);
+        CHECK(value == 42);
+        REQUIRE(storage.getItemDataSize(1, nvs::ItemType::SZ, "str", size) == ESP_OK);
+        CHECK(size == sizeof(str));
+        REQUIRE(storage.readItem(1, nvs::ItemType::SZ, "str", read_str, size) == ESP_OK);
+        CHECK(strcmp(read_str, str) == 0);
+        REQUIRE(storage.getItemDataSize(1, nvs::ItemType::BLOB, "blob", size) == ESP_OK);
+        CHECK(size == sizeof(blob));
+        REQUIRE(storage.readItem(1, nvs::ItemType::BLOB, "blob", read_blob, size) == ESP_OK);
+        CHECK(memcmp(read_blob, blob, sizeof(blob)) == 0);
+        CHECK((esp_partition_get_read_ops() == 0) == (i == 1));
+    }
+
+    nvs_read_cache_stats_t stats;
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.hits == 3);
+    CHECK(stats.misses == 3);
+    CHECK(stats.evictions == 0);
+    CHECK(stats.used_bytes > sizeof(str) + sizeof(blob));
+    CHECK(stats.total_bytes == 1024);
+
+    // a value of a different size is read from flash
+    uint8_t short_blob[8];
+    CHECK(storage.readItem(1, nvs::ItemType::BLOB, "blob", short_blob, sizeof(short_blob)) != ESP_OK);
+
+    // a string read into a larger buffer is cached with its own size
+    char long_str[sizeof(str) + 16];
+    REQUIRE(storage.writeItem(1, nvs::ItemType::SZ, "str2", str, sizeof(str)) == ESP_OK);
+    REQUIRE(storage.readItem(1, nvs::ItemType::SZ, "str2", long_str, sizeof(long_str)) == ESP_OK);
+    CHECK(strcmp(long_str, str) == 0);
+    REQUIRE(storage.getItemDataSize(1, nvs::ItemType::SZ, "str2", size) == ESP_OK);
+    CHECK(size == sizeof(str));
+    REQUIRE(storage.readItem(1, nvs::ItemType::SZ, "str2", read_str, size) == ESP_OK);
+    CHECK(strcmp(read_str, str) == 0);
+
+    // writing and erasing drop the cached values
+    REQUIRE(storage.writeItem(1, "u32", static_cast<uint32_t>(43)) == ESP_OK);
+    REQUIRE(storage.readItem(1, "u32", value) == ESP_OK);
+    CHECK(value == 43);
+    blob[0] = 0xff;
+    REQUIRE(storage.writeItem(1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+    REQUIRE(storage.readItem(1, nvs::ItemType::BLOB, "blob", read_blob, sizeof(read_blob)) == ESP_OK);
+    CHECK(read_blob[0] == 0xff);
+    REQUIRE(storage.eraseItem(1, "u32") == ESP_OK);
+    CHECK(storage.readItem(1, "u32", value) == ESP_ERR_NVS_NOT_FOUND);
+    REQUIRE(storage.eraseNamespace(1) == ESP_OK);
+    CHECK(storage.readItem(1, nvs::ItemType::SZ, "str", read_str, sizeof(str)) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(storage.getItemDataSize(1, nvs::ItemType::BLOB, "blob", size) == ESP_ERR_NVS_NOT_FOUND);
+
+    nvs::BatchJournal batch(1);
+    REQUIRE(storage.writeItem(1, "batched", static_cast<uint32_t>(1)) == ESP_OK);
+    REQUIRE(storage.readItem(1, "batched", value) == ESP_OK);
+    value = 2;
+    REQUIRE(batch.add(nvs::ItemType::U32, "batched", &value, sizeof(value)) == ESP_OK);
+    REQUIRE(storage.writeBatch(batch) == ESP_OK);
+    REQUIRE(storage.readItem(1, "batched", value) == ESP_OK);
+    CHECK(value == 2);
+}
+
+TEST_CASE("Storage read cache evicts least recently used values", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 3;
+    const size_t KEY_COUNT = 32;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    nvs::Storage storage(f.part());
+    storage.setReadCacheSize(512);
+    REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+
+    char key[16];
+    uint32_t value;
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+    }
+
+    // keep reading key0 so that it stays cached while the others are evicted
+    for (size_t i = 1; i < KEY_COUNT; ++i) {
+        REQUIRE(storage.readItem(1, "key0", value) == ESP_OK);
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+        CHECK(value == i);
+    }
+
+    nvs_read_cache_stats_t stats;
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.evictions > 0);
+    CHECK(stats.used_bytes <= stats.total_bytes);
+
+    esp_partition_clear_stats();
+    REQUIRE(storage.readItem(1, "key0", value) == ESP_OK);
+    CHECK(value == 0);
+    CHECK(esp_partition_get_read_ops() == 0);
+    REQUIRE(storage.readItem(1, "key1", value) == ESP_OK);
+    CHECK(value == 1);
+    CHECK(esp_partition_get_read_ops() > 0);
+
+    // values larger than the cache aren't cached
+    uint8_t blob[1024] = {};
+    REQUIRE(storage.writeItem(1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+    REQUIRE(storage.readItem(1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+    storage.fillReadCacheStats(stats);
+    CHECK(stats.used_bytes <= stats.total_bytes);
+    CHECK(stats.used_bytes > 0);
+}
+
+TEST_CASE("benchmark polling a few keys with and without read cache", "[nvs_storage][benchmark]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 8;
+    const size_t KEY_COUNT = 4;
+    const size_t READ_ROUNDS = 10000;
+
+    for (size_t cacheSize : {static_cast<size_t>(0), static_cast<size_t>(512)}) {
+        PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+        nvs::Storage storage(f.part());
+        storage.setReadCacheSize(cacheSize);
+        REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+
+        char key[16];
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+
+        esp_partition_clear_stats();
+        auto start = std::chrono::steady_clock::now();
+        uint32_t value;
+        for (size_t round = 0; round < READ_ROUNDS; ++round) {
+            for (size_t i = 0; i < KEY_COUNT; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        std::cout << "Read cache " << (cacheSize ? "enabled: " : "disabled: ")
+                  << READ_ROUNDS * KEY_COUNT << " reads of " << KEY_COUNT << " keys took "
+                  << elapsed.count() << " us, " << esp_partition_get_read_ops() << " flash reads" << std::endl;
+    }
+}
+
+static void fill_namespaces(nvs::Storage& storage, size_t nsCount, size_t keyCount)
+{
+    char name[16];
+    for (size_t ns = 0; ns < nsCount; ++ns) {
+        uint8_t nsIndex;
+        snprintf(name, sizeof(name), "ns%u", static_cast<unsigned>(ns));
+        REQUIRE(storage.createOrOpenNamespace(name, true, nsIndex) == ESP_OK);
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(name, sizeof(name), "key%u", static_cast<unsigned>(i));
+            REQUIRE(storage.writeItem(nsIndex, name, static_cast<uint32_t>(ns * 1000 + i)) == ESP_OK);
+        }
+    }
+}
+
+TEST_CASE("Storage lazy load reads full pages on first access", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 8;
+    const size_t NS_COUNT = 6;
+    const size_t KEY_COUNT = 100;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    {
+        nvs::Storage storage(f.part());
+        REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+        fill_namespaces(storage, NS_COUNT, KEY_COUNT);
+        const uint8_t blob[64] = {1, 2, 3};
+        REQUIRE(storage.writeItem(1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+    }
+
+    nvs::Storage storage(f.part());
+    storage.setLazyLoad(true);
+    REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+    CHECK(!storage.isLoadComplete());
+
+    // namespaces and values on pages which aren't loaded yet are found
+    uint8_t nsIndex;
+    REQUIRE(storage.createOrOpenNamespace("ns0", false, nsIndex) == ESP_OK);
+    uint32_t value;
+    REQUIRE(storage.readItem(nsIndex, "key7", value) == ESP_OK);
+    CHECK(value == 7);
+    CHECK(storage.readItem(nsIndex, "missing", value) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(storage.createOrOpenNamespace("missing", false, nsIndex) == ESP_ERR_NVS_NOT_FOUND);
+
+    // values are updated and erased without loading the rest
+    REQUIRE(storage.createOrOpenNamespace("ns2", false, nsIndex) == ESP_OK);
+    REQUIRE(storage.writeItem(nsIndex, "key3", static_cast<uint32_t>(42)) == ESP_OK);
+    REQUIRE(storage.eraseItem(nsIndex, "key4") == ESP_OK);
+
+    // the remaining pages are loaded step by step
+    size_t steps = 0;
+    esp_err_t err;
+    while ((err = storage.loadPendingPages(1)) == ESP_ERR_NOT_FINISHED) {
+        CHECK(!storage.isLoadComplete());
+        ++steps;
+    }
+    REQUIRE(err == ESP_OK);
+    CHECK(steps < NVS_FLASH_SECTOR_COUNT);
+    CHECK(storage.isLoadComplete());
+
+    // once everything is loaded, the contents are the same as after a complete load
+    nvs::Storage eager(f.part());
+    REQUIRE(eager.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+    nvs_stats_t lazyStats, eagerStats;
+    REQUIRE(storage.fillStats(lazyStats) == ESP_OK);
+    REQUIRE(eager.fillStats(eagerStats) == ESP_OK);
+    CHECK(lazyStats.used_entries == eagerStats.used_entries);
+    CHECK(lazyStats.namespace_count == eagerStats.namespace_count);
+    REQUIRE(eager.readItem(nsIndex, "key3", value) == ESP_OK);
+    CHECK(value == 42);
+    CHECK(eager.readItem(nsIndex, "key4", value) == ESP_ERR_NVS_NOT_FOUND);
+
+    // operations which need all pages load them first
+    nvs::Storage other(f.part());
+    other.setLazyLoad(true);
+    REQUIRE(other.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+    REQUIRE(other.createOrOpenNamespace("new_ns", true, nsIndex) == ESP_OK);
+    CHECK(other.isLoadComplete());
+    nvs_stats_t otherStats;
+    REQUIRE(other.fillStats(otherStats) == ESP_OK);
+    CHECK(otherStats.namespace_count == eagerStats.namespace_count + 1);
+}
+
+TEST_CASE("benchmark Storage init with and without lazy load", "[nvs_storage][benchmark]")
+{
+    for (uint32_t sectorCount : {16u, 64u, 256u}) {
+        PartitionEmulationFixture f(0, sectorCount);
+        {
+            nvs::Storage storage(f.part());
+            REQUIRE(storage.init(0, sectorCount) == ESP_OK);
+            // leave a few pages free, so that no page is reclaimed while filling
+            fill_namespaces(storage, 1, (sectorCount - 3) * (nvs::Page::ENTRY_COUNT - 1));
+        }
+
+        for (bool lazy : {false, true}) {
+            nvs::Storage storage(f.part());
+            storage.setLazyLoad(lazy);
+            esp_partition_clear_stats();
+            auto start = std::chrono::steady_clock::now();
+            REQUIRE(storage.init(0, sectorCount) == ESP_OK);
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            const size_t initReads = esp_partition_get_read_ops();
+
+            uint8_t nsIndex;
+            uint32_t value;
+            REQUIRE(storage.createOrOpenNamespace("ns0", false, nsIndex) == ESP_OK);
+            REQUIRE(storage.readItem(nsIndex, "key0", value) == ESP_OK);
+            const size_t firstReadReads = esp_partition_get_read_ops() - initReads;
+
+            std::cout << (lazy ? "Lazy" : "Eager") << " init of " << sectorCount << " pages took "
+                      << elapsed.count() << " us, " << initReads << " flash reads; first read took "
+                      << firstReadReads << " flash reads" << std::endl;
+        }
+    }
+}
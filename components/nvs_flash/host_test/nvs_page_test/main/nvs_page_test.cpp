@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <stdio.h>
+#include <chrono>
 #include "unity.h"
 #include "test_fixtures.hpp"
 
@@ -939,6 +940,117 @@ void test_Page_calcEntries__invalid()
     TEST_ASSERT_EQUAL(0, nvsStats.namespace_count);
 }
 
+template<typename T>
+static void check_hash_list_semantics()
+{
+    T hash_list;
+    Item item_a(1, ItemType::U32, 1, "a");
+    Item item_b(1, ItemType::U32, 1, "b");
+
+    TEST_ASSERT_EQUAL(SIZE_MAX, hash_list.find(0, item_a));
+    TEST_ASSERT_EQUAL(ESP_OK, hash_list.insert(item_a, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, hash_list.insert(item_b, 4));
+    TEST_ASSERT_EQUAL(ESP_OK, hash_list.insert(item_a, 7));
+
+    TEST_ASSERT_EQUAL(3, hash_list.find(0, item_a));
+    TEST_ASSERT_EQUAL(7, hash_list.find(4, item_a));
+    TEST_ASSERT_EQUAL(SIZE_MAX, hash_list.find(8, item_a));
+    TEST_ASSERT_EQUAL(4, hash_list.find(0, item_b));
+
+    TEST_ASSERT_TRUE(hash_list.erase(item_a, 3));
+    TEST_ASSERT_FALSE(hash_list.erase(item_a, 3));
+    TEST_ASSERT_EQUAL(7, hash_list.find(0, item_a));
+    TEST_ASSERT_TRUE(hash_list.erase(item_a, 7));
+    TEST_ASSERT_EQUAL(SIZE_MAX, hash_list.find(0, item_a));
+    TEST_ASSERT_EQUAL(4, hash_list.find(0, item_b));
+    hash_list.clear();
+    TEST_ASSERT_EQUAL(SIZE_MAX, hash_list.find(0, item_b));
+}
+
+void test_HashList_semantics()
+{
+    check_hash_list_semantics<HashList>();
+}
+
+void test_FlatHashList_semantics()
+{
+    check_hash_list_semantics<FlatHashList>();
+}
+
+void test_FlatHashList_holds_full_page()
+{
+    FlatHashList hash_list;
+    char key[16];
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+        TEST_ASSERT_EQUAL(ESP_OK, hash_list.insert(Item(1, ItemType::U8, 1, key), i));
+    }
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+        TEST_ASSERT_EQUAL(i, hash_list.find(0, Item(1, ItemType::U8, 1, key)));
+    }
+    // erase every other entry, the remaining ones have to be found still
+    for (size_t i = 0; i < Page::ENTRY_COUNT; i += 2) {
+        snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+        TEST_ASSERT_TRUE(hash_list.erase(Item(1, ItemType::U8, 1, key), i));
+    }
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+        size_t expected = (i % 2 == 0) ? SIZE_MAX : i;
+        TEST_ASSERT_EQUAL(expected, hash_list.find(0, Item(1, ItemType::U8, 1, key)));
+    }
+}
+
+template<typename T>
+static void benchmark_hash_list(const char *name, const Item *items, size_t count, size_t rounds)
+{
+    using namespace std::chrono;
+    T hash_list;
+    nanoseconds insert_time(0);
+    nanoseconds find_time(0);
+    nanoseconds erase_time(0);
+
+    for (size_t round = 0; round < rounds; ++round) {
+        auto start = steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            hash_list.insert(items[i], i);
+        }
+        auto inserted = steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            TEST_ASSERT_EQUAL(i, hash_list.find(0, items[i]));
+        }
+        auto found = steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            hash_list.erase(items[i], i);
+        }
+        auto erased = steady_clock::now();
+
+        insert_time += inserted - start;
+        find_time += found - inserted;
+        erase_time += erased - found;
+    }
+
+    const size_t ops = count * rounds;
+    printf("%s: insert %lld ns/op, find %lld ns/op, erase %lld ns/op\n", name,
+           (long long) (insert_time.count() / ops),
+           (long long) (find_time.count() / ops),
+           (long long) (erase_time.count() / ops));
+}
+
+void test_HashList_benchmark()
+{
+    const size_t ROUNDS = 200;
+    static Item items[Page::ENTRY_COUNT];
+    char key[16];
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+        items[i] = Item(1, ItemType::U32, 1, key);
+    }
+
+    benchmark_hash_list<HashList>("HashList (blocks)", items, Page::ENTRY_COUNT, ROUNDS);
+    benchmark_hash_list<FlatHashList>("FlatHashList (open addressing)", items, Page::ENTRY_COUNT, ROUNDS);
+}
+
 int main(int argc, char **argv)
 {
     UNITY_BEGIN();
@@ -995,6 +1107,10 @@ int main(int argc, char **argv)
     RUN_TEST(test_Page_calcEntries__active_wo_blob);
     RUN_TEST(test_Page_calcEntries__active_with_blob);
     RUN_TEST(test_Page_calcEntries__invalid);
+    RUN_TEST(test_HashList_semantics);
+    RUN_TEST(test_FlatHashList_semantics);
+    RUN_TEST(test_FlatHashList_holds_full_page);
+    RUN_TEST(test_HashList_benchmark);
     int failures = UNITY_END();
     return failures;
 }
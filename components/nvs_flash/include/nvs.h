@@ -520,6 +520,177 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  */
 esp_err_t nvs_commit(nvs_handle_t handle);
 
+/**
+ * @brief      Start a write batch on the handle
+ *
+ * After this call, values set through this handle with nvs_set_* functions are not written to flash
+ * right away. Instead, they are staged in RAM until nvs_batch_commit() writes all of them at once,
+ * or nvs_batch_abort() discards them. Setting the same key more than once within a batch keeps the last value.
+ *
+ * Reading values through the handle returns the values stored in flash, i.e. not the staged ones.
+ * Integer and string values can be staged, nvs_set_blob() returns ESP_ERR_NOT_SUPPORTED while a batch
+ * is open. nvs_erase_key() and nvs_erase_all() return ESP_ERR_INVALID_STATE while a batch is open.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the batch was started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if handle was opened as read only
+ *             - ESP_ERR_INVALID_STATE if a batch has already been started on this handle
+ *             - ESP_ERR_NO_MEM if memory could not be allocated for the batch
+ */
+esp_err_t nvs_batch_begin(nvs_handle_t handle);
+
+/**
+ * @brief      Write all values staged by the write batch of the handle and end the batch
+ *
+ * The values are written all-or-nothing: if the power goes off while they are written, either none
+ * or all of them will be present after NVS has been initialized again. The staged values are first
+ * stored as a single journal entry, then values which differ from the stored ones are written
+ * next to each other, and finally the old values are erased. Compared to setting the values one
+ * by one, this saves flash writes when many values are changed at once.
+ *
+ * The batch ends with this call, regardless of the result.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if all values have been written successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_STATE if no batch has been started on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the underlying storage
+ *               to store the batch next to the old values; none of the values have been written
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the new values were written, but the old ones could not be
+ *               erased because a flash write operation has failed. The update will be finished after
+ *               re-initialization of NVS, provided that the flash operation doesn't fail again.
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_batch_commit(nvs_handle_t handle);
+
+/**
+ * @brief      Discard all values staged by the write batch of the handle and end the batch
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the batch was discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_STATE if no batch has been started on this handle
+ */
+esp_err_t nvs_batch_abort(nvs_handle_t handle);
+
+/**
+ * @brief Mode of a blob stream, see nvs_blob_open_stream()
+ */
+typedef enum {
+    NVS_BLOB_STREAM_READ,       /*!< Read an existing blob */
+    NVS_BLOB_STREAM_WRITE,      /*!< Write a new version of a blob */
+} nvs_blob_stream_mode_t;
+
+/**
+ * @brief      Open a stream to read or write a blob piece by piece
+ *
+ * Unlike nvs_get_blob() and nvs_set_blob(), which need a buffer for the whole blob, a stream transfers the
+ * blob in pieces of any size using nvs_blob_stream_read() or nvs_blob_stream_write(). At most one stream can be
+ * open per handle; it is closed with nvs_blob_close_stream() or nvs_blob_abort_stream().
+ *
+ * A blob written by a stream is stored in the same format as by nvs_set_blob(), so it can be read either way.
+ * Data is collected in RAM until it fills the space left on the current page (about 4 kB at most), then it is
+ * written to flash. The previous version of the blob stays valid until nvs_blob_close_stream() is called: if the
+ * stream is aborted or the power goes off, the data written so far is discarded.
+ *
+ * Setting or erasing the blob (also through another handle) while it is open in a stream closes the stream;
+ * further operations on the stream return ESP_ERR_INVALID_STATE. Opening a write stream closes other write
+ * streams of the same blob, and closing a write stream closes the read streams of the blob.
+ *
+ * @param[in]  handle  Handle obtained from nvs_open function. Handles opened read only can only be used with
+ *                     NVS_BLOB_STREAM_READ.
+ * @param[in]  key     Key name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ * @param[in]  mode    NVS_BLOB_STREAM_READ or NVS_BLOB_STREAM_WRITE
+ *
+ * @return
+ *             - ESP_OK if the stream has been opened
+ *             - ESP_ERR_NVS_NOT_FOUND if the blob doesn't exist (read mode)
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if the handle was opened as read only (write mode)
+ *             - ESP_ERR_NOT_SUPPORTED if a write batch is open on the handle (write mode)
+ *             - ESP_ERR_INVALID_STATE if a stream is already open on the handle
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+ *             - ESP_ERR_NO_MEM if memory could not be allocated for the stream
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_open_stream(nvs_handle_t handle, const char* key, nvs_blob_stream_mode_t mode);
+
+/**
+ * @brief      Read the next piece of the blob open in a stream
+ *
+ * @param[in]     handle    Handle with a stream opened in NVS_BLOB_STREAM_READ mode
+ * @param[out]    out_data  Buffer for the data
+ * @param[inout]  length    Size of out_data. On return, the number of bytes read, which is less than the size
+ *                          of the buffer only at the end of the blob.
+ *
+ * @return
+ *             - ESP_OK if the data has been read, including at the end of the blob
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_STATE if no stream is open on the handle, or it is open in write mode
+ *             - ESP_ERR_NVS_NOT_FOUND if a chunk of the blob is missing or corrupted (the data read by this call
+ *               may be corrupted as well); the stream is closed
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_stream_read(nvs_handle_t handle, void* out_data, size_t* length);
+
+/**
+ * @brief      Append data to the blob written by a stream
+ *
+ * If this function fails, the stream is aborted.
+ *
+ * @param[in]  handle  Handle with a stream opened in NVS_BLOB_STREAM_WRITE mode
+ * @param[in]  data    Data to append
+ * @param[in]  length  Size of data
+ *
+ * @return
+ *             - ESP_OK if the data has been appended
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_STATE if no stream is open on the handle, or it is open in read mode
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space to store the blob
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob gets too long
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_stream_write(nvs_handle_t handle, const void* data, size_t length);
+
+/**
+ * @brief      Close the stream of the handle
+ *
+ * For a write stream, the rest of the data and the blob index are written, which makes the new version of the
+ * blob valid, then the previous version is erased. The stream is closed regardless of the result.
+ *
+ * @param[in]  handle  Handle with an open stream
+ *
+ * @return
+ *             - ESP_OK if the stream has been closed and, in write mode, the blob has been stored
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_STATE if no stream is open on the handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space to store the blob
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the blob has been stored, but the previous version couldn't be erased
+ *               because a flash write operation has failed
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_close_stream(nvs_handle_t handle);
+
+/**
+ * @brief      Close the stream of the handle, discarding the data written by a write stream
+ *
+ * @param[in]  handle  Handle with an open stream
+ *
+ * @return
+ *             - ESP_OK if the stream has been closed
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_STATE if no stream is open on the handle
+ */
+esp_err_t nvs_blob_abort_stream(nvs_handle_t handle);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
@@ -578,6 +749,38 @@ typedef struct {
  */
 esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
 
+/**
+ * @note    Info about the read cache of a partition (see CONFIG_NVS_READ_CACHE_SIZE).
+ *          The counters are kept from the initialization of the partition on.
+ */
+typedef struct {
+    size_t hits;              /**< Number of reads served from the cache. */
+    size_t misses;            /**< Number of reads which had to access flash. */
+    size_t evictions;         /**< Number of values dropped to make room for other values. */
+    size_t used_bytes;        /**< Amount of RAM used by the cached values. */
+    size_t total_bytes;       /**< Capacity of the cache, 0 if it is disabled. */
+} nvs_read_cache_stats_t;
+
+/**
+ * @brief      Fill structure nvs_read_cache_stats_t. It provides info about the read cache of the partition.
+ *
+ * Values read with nvs_get_* functions are kept in a RAM cache of CONFIG_NVS_READ_CACHE_SIZE bytes,
+ * so reading the same value again doesn't access flash. Use this function to check how effective
+ * the cache is for the keys an application reads.
+ *
+ * @param[in]   part_name   Partition name NVS in the partition table.
+ *                          If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  stats       Returns filled structure nvs_read_cache_stats_t.
+ *
+ * @return
+ *             - ESP_OK if the structure has been filled.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *               Return param stats will be filled 0.
+ *             - ESP_ERR_INVALID_ARG if stats equal to NULL.
+ */
+esp_err_t nvs_get_read_cache_stats(const char *part_name, nvs_read_cache_stats_t *stats);
+
 /**
  * @brief      Calculate all entries in a namespace.
  *
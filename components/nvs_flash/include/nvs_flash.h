@@ -117,6 +117,25 @@ esp_err_t nvs_flash_deinit(void);
  */
 esp_err_t nvs_flash_deinit_partition(const char* partition_label);
 
+/**
+ * @brief Load the pages of an NVS partition which haven't been read yet
+ *
+ * With CONFIG_NVS_LAZY_LOAD, initialization only reads the page headers, and the items of full pages are read on
+ * first access. This function reads up to max_pages of the remaining pages, so the loading can be finished from a
+ * low priority task in small steps instead of delaying the first access. Once all pages are loaded, the cleanup
+ * of interrupted blob writes is done.
+ *
+ * @param[in]  partition_label   Label of the partition, NULL for the default NVS partition
+ * @param[in]  max_pages         Maximum number of pages to load
+ *
+ * @return
+ *      - ESP_OK if all pages of the partition are loaded
+ *      - ESP_ERR_NOT_FINISHED if there are pages left to load
+ *      - ESP_ERR_NVS_NOT_INITIALIZED if the storage for given partition was not initialized prior to this call
+ *      - one of the error codes from the underlying flash storage driver
+ */
+esp_err_t nvs_flash_load_pending_pages(const char* partition_label, size_t max_pages);
+
 /**
  * @brief Erase the default NVS partition
  *
@@ -183,6 +183,103 @@ public:
      */
     virtual esp_err_t commit() = 0;
 
+    /**
+     * @brief Start a write batch. Until the batch is committed or aborted, set functions only stage the values
+     *        in RAM.
+     *
+     * @note compare to \ref nvs_batch_begin in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports write batches
+     */
+    virtual esp_err_t batch_begin()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Write all values staged by the write batch all-or-nothing, and end the batch.
+     *
+     * @note compare to \ref nvs_batch_commit in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports write batches
+     */
+    virtual esp_err_t batch_commit()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Discard all values staged by the write batch, and end the batch.
+     *
+     * @note compare to \ref nvs_batch_abort in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports write batches
+     */
+    virtual esp_err_t batch_abort()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Open a stream to read or write a blob piece by piece. At most one stream can be open per handle.
+     *
+     * @note compare to \ref nvs_blob_open_stream in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports blob streams
+     */
+    virtual esp_err_t blob_stream_open(const char *key, nvs_blob_stream_mode_t mode)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Read up to \c length bytes from the blob stream. On return, \c length holds the number of bytes read.
+     *
+     * @note compare to \ref nvs_blob_stream_read in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports blob streams
+     */
+    virtual esp_err_t blob_stream_read(void *out_data, size_t &length)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Append data to the blob written by the stream.
+     *
+     * @note compare to \ref nvs_blob_stream_write in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports blob streams
+     */
+    virtual esp_err_t blob_stream_write(const void *data, size_t length)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Close the blob stream. A blob written by the stream replaces the previous version of the blob.
+     *
+     * @note compare to \ref nvs_blob_close_stream in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports blob streams
+     */
+    virtual esp_err_t blob_stream_close()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief Close the blob stream, discarding the data written by the stream.
+     *
+     * @note compare to \ref nvs_blob_abort_stream in nvs.h
+     *
+     * @return ESP_ERR_NOT_SUPPORTED unless the handle implementation supports blob streams
+     */
+    virtual esp_err_t blob_stream_abort()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
     /**
      * @brief      Calculate all entries in the scope of the handle.
      *
@@ -258,6 +258,19 @@ extern "C" esp_err_t nvs_flash_deinit(void)
     return nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME);
 }
 
+extern "C" esp_err_t nvs_flash_load_pending_pages(const char* partition_label, size_t max_pages)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    pStorage = lookup_storage_from_name((partition_label == nullptr) ? NVS_DEFAULT_PART_NAME : partition_label);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    return pStorage->loadPendingPages(max_pages);
+}
+
 static esp_err_t nvs_find_ns_handle(nvs_handle_t c_handle, NVSHandleSimple** handle)
 {
     auto it = find_if(begin(s_nvs_handles), end(s_nvs_handles), [=](NVSHandleEntry& e) -> bool {
@@ -402,6 +415,108 @@ extern "C" esp_err_t nvs_commit(nvs_handle_t c_handle)
     return handle->commit();
 }
 
+extern "C" esp_err_t nvs_batch_begin(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->batch_begin();
+}
+
+extern "C" esp_err_t nvs_batch_commit(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->batch_commit();
+}
+
+extern "C" esp_err_t nvs_batch_abort(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->batch_abort();
+}
+
+extern "C" esp_err_t nvs_blob_open_stream(nvs_handle_t c_handle, const char* key, nvs_blob_stream_mode_t mode)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s %d", __func__, key, static_cast<int>(mode));
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_stream_open(key, mode);
+}
+
+extern "C" esp_err_t nvs_blob_stream_read(nvs_handle_t c_handle, void* out_data, size_t* length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    if (out_data == nullptr || length == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_stream_read(out_data, *length);
+}
+
+extern "C" esp_err_t nvs_blob_stream_write(nvs_handle_t c_handle, const void* data, size_t length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d", __func__, static_cast<int>(length));
+    if (data == nullptr && length > 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_stream_write(data, length);
+}
+
+extern "C" esp_err_t nvs_blob_close_stream(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_stream_close();
+}
+
+extern "C" esp_err_t nvs_blob_abort_stream(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->blob_stream_abort();
+}
+
 extern "C" esp_err_t nvs_set_str(nvs_handle_t c_handle, const char* key, const char* value)
 {
     Lock lock;
@@ -545,6 +660,25 @@ extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats
     return pStorage->fillStats(*nvs_stats);
 }
 
+extern "C" esp_err_t nvs_get_read_cache_stats(const char* part_name, nvs_read_cache_stats_t* stats)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    if (stats == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = {};
+
+    pStorage = lookup_storage_from_name((part_name == nullptr) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    pStorage->fillReadCacheStats(*stats);
+    return ESP_OK;
+}
+
 extern "C" esp_err_t nvs_get_used_entry_count(nvs_handle_t c_handle, size_t* used_entries)
 {
     Lock lock;
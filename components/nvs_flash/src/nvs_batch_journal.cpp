@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstring>
+#include "nvs_batch_journal.hpp"
+#include "nvs_page.hpp"
+
+namespace nvs
+{
+
+static bool isPrimitiveType(ItemType datatype)
+{
+    switch (datatype) {
+    case ItemType::U8:
+    case ItemType::I8:
+    case ItemType::U16:
+    case ItemType::I16:
+    case ItemType::U32:
+    case ItemType::I32:
+    case ItemType::U64:
+    case ItemType::I64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isValidRecord(ItemType datatype, size_t keySize, size_t dataSize)
+{
+    if (keySize == 0 || keySize > Item::MAX_KEY_LENGTH) {
+        return false;
+    }
+    if (isPrimitiveType(datatype)) {
+        return dataSize == (static_cast<uint8_t>(datatype) & 0x0f);
+    }
+    return datatype == ItemType::SZ && dataSize <= Page::CHUNK_MAX_SIZE;
+}
+
+BatchJournal::BatchJournal(uint8_t nsIndex) : mNsIndex(nsIndex)
+{
+}
+
+BatchJournal::~BatchJournal()
+{
+}
+
+esp_err_t BatchJournal::reserve(size_t size)
+{
+    if (size <= mCapacity) {
+        return ESP_OK;
+    }
+
+    size_t newCapacity = (mCapacity == 0) ? MIN_CAPACITY : mCapacity;
+    while (newCapacity < size) {
+        newCapacity *= 2;
+    }
+
+    uint8_t* newData = new (std::nothrow) uint8_t[newCapacity];
+    if (newData == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (mSize > 0) {
+        memcpy(newData, mData.get(), mSize);
+    }
+    mData.reset(newData);
+    mCapacity = newCapacity;
+    return ESP_OK;
+}
+
+void BatchJournal::updateHeader()
+{
+    mData[0] = FORMAT_VERSION;
+    mData[1] = mNsIndex;
+    mData[2] = static_cast<uint8_t>(mCount & 0xff);
+    mData[3] = static_cast<uint8_t>(mCount >> 8);
+}
+
+esp_err_t BatchJournal::add(ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (key == nullptr || data == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const size_t keySize = strlen(key);
+    if (keySize > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (datatype == ItemType::SZ && dataSize > Page::CHUNK_MAX_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+    if (!isValidRecord(datatype, keySize, dataSize)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (mCount == UINT16_MAX) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    const size_t headerSize = (mSize == 0) ? HEADER_SIZE : 0;
+    esp_err_t err = reserve(mSize + headerSize + RECORD_HEADER_SIZE + keySize + dataSize);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // drop the value staged before for this key, so that the journal holds at most one record per item
+    size_t offset = 0;
+    Record record;
+    for (size_t recordOffset = HEADER_SIZE; next(offset, record); recordOffset = offset) {
+        if (record.datatype == datatype && strcmp(record.key, key) == 0) {
+            memmove(mData.get() + recordOffset, mData.get() + offset, mSize - offset);
+            mSize -= offset - recordOffset;
+            --mCount;
+            break;
+        }
+    }
+    mSize += headerSize;
+
+    uint8_t* dst = mData.get() + mSize;
+    dst[0] = static_cast<uint8_t>(datatype);
+    dst[1] = static_cast<uint8_t>(keySize);
+    dst[2] = static_cast<uint8_t>(dataSize & 0xff);
+    dst[3] = static_cast<uint8_t>(dataSize >> 8);
+    memcpy(dst + RECORD_HEADER_SIZE, key, keySize);
+    memcpy(dst + RECORD_HEADER_SIZE + keySize, data, dataSize);
+    mSize += RECORD_HEADER_SIZE + keySize + dataSize;
+    ++mCount;
+    updateHeader();
+    return ESP_OK;
+}
+
+esp_err_t BatchJournal::assign(const void* data, size_t size)
+{
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    if (size < HEADER_SIZE || src[0] != FORMAT_VERSION) {
+        return ESP_FAIL;
+    }
+
+    // walk over the records before taking the data over
+    const size_t count = src[2] | (src[3] << 8);
+    size_t offset = HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        if (size - offset < RECORD_HEADER_SIZE) {
+            return ESP_FAIL;
+        }
+        const size_t keySize = src[offset + 1];
+        const size_t dataSize = src[offset + 2] | (src[offset + 3] << 8);
+        if (!isValidRecord(static_cast<ItemType>(src[offset]), keySize, dataSize) ||
+                size - offset - RECORD_HEADER_SIZE < keySize + dataSize) {
+            return ESP_FAIL;
+        }
+        offset += RECORD_HEADER_SIZE + keySize + dataSize;
+    }
+    if (offset != size) {
+        return ESP_FAIL;
+    }
+
+    mSize = 0;
+    esp_err_t err = reserve(size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    memcpy(mData.get(), src, size);
+    mSize = size;
+    mCount = count;
+    mNsIndex = src[1];
+    return ESP_OK;
+}
+
+bool BatchJournal::next(size_t& offset, Record& record) const
+{
+    if (offset == 0) {
+        offset = HEADER_SIZE;
+    }
+    if (offset >= mSize) {
+        return false;
+    }
+
+    const uint8_t* src = mData.get() + offset;
+    const size_t keySize = src[1];
+    record.datatype = static_cast<ItemType>(src[0]);
+    record.dataSize = src[2] | (src[3] << 8);
+    memcpy(record.key, src + RECORD_HEADER_SIZE, keySize);
+    record.key[keySize] = 0;
+    record.data = src + RECORD_HEADER_SIZE + keySize;
+    offset += RECORD_HEADER_SIZE + keySize + record.dataSize;
+    return true;
+}
+
+size_t BatchJournal::entryCount() const
+{
+    size_t entries = 0;
+    size_t offset = 0;
+    Record record;
+    while (next(offset, record)) {
+        entries += 1;
+        if (record.datatype == ItemType::SZ) {
+            entries += (record.dataSize + Page::ENTRY_SIZE - 1) / Page::ENTRY_SIZE;
+        }
+    }
+    return entries;
+}
+
+} // namespace nvs
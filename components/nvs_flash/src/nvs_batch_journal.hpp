@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_batch_journal_hpp
+#define nvs_batch_journal_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "nvs_types.hpp"
+#include "nvs_memory_management.hpp"
+
+namespace nvs
+{
+
+/**
+ * Values of one namespace which are staged in RAM by a write batch (see nvs_batch_begin()).
+ *
+ * The values are kept in their serialized form, so the journal can be written to flash as a single blob before
+ * the values are applied, which makes applying them all-or-nothing (see Storage::writeBatch()).
+ *
+ * Layout: a 4-byte header (format version, namespace index, record count) followed by the records. Each record
+ * consists of the item type, the key length, the data size (little endian), the key without zero terminator and
+ * the data.
+ */
+class BatchJournal : public ExceptionlessAllocatable
+{
+public:
+    struct Record {
+        ItemType datatype;
+        char key[Item::MAX_KEY_LENGTH + 1];
+        const uint8_t* data;
+        size_t dataSize;
+    };
+
+    BatchJournal(uint8_t nsIndex = 0);
+
+    ~BatchJournal();
+
+    /**
+     * Stage a value, replacing the value staged before for the same type and key, if any.
+     * Only primitive types and strings can be staged.
+     */
+    esp_err_t add(ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Replace the content by a serialized journal, e.g. read back from flash. The journal is checked for consistency.
+     */
+    esp_err_t assign(const void* data, size_t size);
+
+    /**
+     * Get the record at offset and advance offset to the next record. offset has to be 0 for the first record.
+     * Returns false if there are no more records.
+     */
+    bool next(size_t& offset, Record& record) const;
+
+    uint8_t nsIndex() const
+    {
+        return mNsIndex;
+    }
+
+    size_t count() const
+    {
+        return mCount;
+    }
+
+    bool empty() const
+    {
+        return mCount == 0;
+    }
+
+    /**
+     * Serialized journal, only valid if the journal isn't empty.
+     */
+    const uint8_t* data() const
+    {
+        return mData.get();
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    /**
+     * Number of entries needed to store the staged values (not counting the journal itself).
+     */
+    size_t entryCount() const;
+
+    static const uint8_t FORMAT_VERSION = 1;
+
+protected:
+    BatchJournal(const BatchJournal& other);
+    const BatchJournal& operator= (const BatchJournal& rhs);
+
+    static const size_t HEADER_SIZE = 4;
+    static const size_t RECORD_HEADER_SIZE = 4;
+    static const size_t MIN_CAPACITY = 64;
+
+    esp_err_t reserve(size_t size);
+
+    void updateHeader();
+
+    std::unique_ptr<uint8_t[]> mData;
+    size_t mSize = 0;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    uint8_t mNsIndex;
+}; // class BatchJournal
+
+} // namespace nvs
+
+#endif /* nvs_batch_journal_hpp */
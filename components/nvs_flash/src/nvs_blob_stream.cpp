@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nvs_blob_stream.hpp"
+#include "nvs_page.hpp"
+
+namespace nvs
+{
+
+BlobStream::BlobStream()
+{
+    mKey[0] = 0;
+}
+
+BlobStream::~BlobStream()
+{
+}
+
+esp_err_t BlobStream::allocateBuffer()
+{
+    if (!mBuffer) {
+        mBuffer.reset(new (std::nothrow) uint8_t[Page::CHUNK_MAX_SIZE]);
+        if (!mBuffer) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    mBufferSize = 0;
+    return ESP_OK;
+}
+
+} // namespace nvs
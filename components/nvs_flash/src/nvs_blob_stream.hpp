@@ -0,0 +1,102 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_blob_stream_hpp
+#define nvs_blob_stream_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "intrusive_list.h"
+#include "nvs_types.hpp"
+#include "nvs_memory_management.hpp"
+
+namespace nvs
+{
+
+class Storage;
+
+/**
+ * State of a blob which is read or written piece by piece (see nvs_blob_open_stream()).
+ *
+ * The blob is stored in the same format as by Storage::writeMultiPageBlob(): a BLOB_DATA chunk per page and a
+ * BLOB_IDX item. A write stream collects the data of one chunk in RAM, so at most Page::CHUNK_MAX_SIZE bytes are
+ * buffered regardless of the blob size. The chunks are written with the version offset which isn't used by the
+ * current version of the blob, and the index is only written when the stream is closed. Until then, readers see
+ * the previous version, and if the power goes off, the chunks are erased as orphans by the next Storage::init().
+ *
+ * All operations on the stream are done by Storage, which keeps track of the open streams. Writing or erasing
+ * a blob which is open in a stream closes the stream (see Storage::closeBlobStreams()).
+ */
+class BlobStream : public intrusive_list_node<BlobStream>, public ExceptionlessAllocatable
+{
+    friend class Storage;
+
+public:
+    enum class Mode {
+        READ,
+        WRITE,
+    };
+
+    BlobStream();
+
+    ~BlobStream();
+
+    Mode mode() const
+    {
+        return mMode;
+    }
+
+    /**
+     * Whether the stream is open in a Storage. A stream is closed by Storage::commitBlobStream() and
+     * Storage::abortBlobStream(), or if the blob is modified by another operation.
+     */
+    bool isOpen() const
+    {
+        return mStorage != nullptr;
+    }
+
+    /**
+     * Read mode: size of the blob. Write mode: number of bytes written so far.
+     */
+    size_t dataSize() const
+    {
+        return mDataSize;
+    }
+
+protected:
+    BlobStream(const BlobStream& other);
+    const BlobStream& operator= (const BlobStream& rhs);
+
+    esp_err_t allocateBuffer();
+
+    Storage* mStorage = nullptr;
+    Mode mMode = Mode::READ;
+    uint8_t mNsIndex = 0;
+    char mKey[Item::MAX_KEY_LENGTH + 1];
+    VerOffset mChunkStart = VerOffset::VER_0_OFFSET;
+    uint8_t mChunkCount = 0;
+    size_t mDataSize = 0;
+
+    /* write mode: version of the blob which is replaced when the stream is committed */
+    bool mReplace = false;
+    VerOffset mPrevChunkStart = VerOffset::VER_0_OFFSET;
+    std::unique_ptr<uint8_t[]> mBuffer;
+    size_t mBufferSize = 0;
+
+    /* read mode: position in the blob, and in the current chunk whose CRC is calculated while reading */
+    bool mLegacyFormat = false;
+    size_t mOffset = 0;
+    uint8_t mChunkNum = 0;
+    size_t mChunkOffset = 0;
+    size_t mChunkSize = 0;
+    uint32_t mChunkCrc32 = 0;
+    uint32_t mExpectedCrc32 = 0;
+}; // class BlobStream
+
+} // namespace nvs
+
+#endif /* nvs_blob_stream_hpp */
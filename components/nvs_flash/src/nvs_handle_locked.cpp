@@ -62,6 +62,46 @@ esp_err_t NVSHandleLocked::commit() {
     return handle->commit();
 }
 
+esp_err_t NVSHandleLocked::batch_begin() {
+    Lock lock;
+    return handle->batch_begin();
+}
+
+esp_err_t NVSHandleLocked::batch_commit() {
+    Lock lock;
+    return handle->batch_commit();
+}
+
+esp_err_t NVSHandleLocked::batch_abort() {
+    Lock lock;
+    return handle->batch_abort();
+}
+
+esp_err_t NVSHandleLocked::blob_stream_open(const char *key, nvs_blob_stream_mode_t mode) {
+    Lock lock;
+    return handle->blob_stream_open(key, mode);
+}
+
+esp_err_t NVSHandleLocked::blob_stream_read(void *out_data, size_t &length) {
+    Lock lock;
+    return handle->blob_stream_read(out_data, length);
+}
+
+esp_err_t NVSHandleLocked::blob_stream_write(const void *data, size_t length) {
+    Lock lock;
+    return handle->blob_stream_write(data, length);
+}
+
+esp_err_t NVSHandleLocked::blob_stream_close() {
+    Lock lock;
+    return handle->blob_stream_close();
+}
+
+esp_err_t NVSHandleLocked::blob_stream_abort() {
+    Lock lock;
+    return handle->blob_stream_abort();
+}
+
 esp_err_t NVSHandleLocked::get_used_entry_count(size_t& usedEntries) {
     Lock lock;
     return handle->get_used_entry_count(usedEntries);
@@ -55,6 +55,22 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t batch_begin() override;
+
+    esp_err_t batch_commit() override;
+
+    esp_err_t batch_abort() override;
+
+    esp_err_t blob_stream_open(const char *key, nvs_blob_stream_mode_t mode) override;
+
+    esp_err_t blob_stream_read(void *out_data, size_t &length) override;
+
+    esp_err_t blob_stream_write(const void *data, size_t length) override;
+
+    esp_err_t blob_stream_close() override;
+
+    esp_err_t blob_stream_abort() override;
+
     esp_err_t get_used_entry_count(size_t& usedEntries) override;
 
 protected:
@@ -18,6 +18,9 @@
 namespace nvs {
 
 NVSHandleSimple::~NVSHandleSimple() {
+    if (valid && mBlobStream) {
+        mStoragePtr->abortBlobStream(*mBlobStream);
+    }
     NVSPartitionManager::get_instance()->close_handle(this);
 }
 
@@ -25,6 +28,7 @@ esp_err_t NVSHandleSimple::set_typed_item(ItemType datatype, const char *key, co
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBatch) return mBatch->add(datatype, key, data, dataSize);
 
     return mStoragePtr->writeItem(mNsIndex, datatype, key, data, dataSize);
 }
@@ -40,6 +44,7 @@ esp_err_t NVSHandleSimple::set_string(const char *key, const char* str)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBatch) return mBatch->add(nvs::ItemType::SZ, key, str, strlen(str) + 1);
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::SZ, key, str, strlen(str) + 1);
 }
@@ -48,6 +53,7 @@ esp_err_t NVSHandleSimple::set_blob(const char *key, const void* blob, size_t le
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBatch) return ESP_ERR_NOT_SUPPORTED;
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::BLOB, key, blob, len);
 }
@@ -77,6 +83,7 @@ esp_err_t NVSHandleSimple::erase_item(const char* key)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBatch) return ESP_ERR_INVALID_STATE;
 
     return mStoragePtr->eraseItem(mNsIndex, key);
 }
@@ -85,6 +92,7 @@ esp_err_t NVSHandleSimple::erase_all()
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBatch) return ESP_ERR_INVALID_STATE;
 
     return mStoragePtr->eraseNamespace(mNsIndex);
 }
@@ -96,6 +104,89 @@ esp_err_t NVSHandleSimple::commit()
     return ESP_OK;
 }
 
+esp_err_t NVSHandleSimple::batch_begin()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mBatch) return ESP_ERR_INVALID_STATE;
+
+    mBatch.reset(new (std::nothrow) BatchJournal(mNsIndex));
+    if (!mBatch) return ESP_ERR_NO_MEM;
+
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::batch_commit()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBatch) return ESP_ERR_INVALID_STATE;
+
+    std::unique_ptr<BatchJournal> batch(std::move(mBatch));
+    return mStoragePtr->writeBatch(*batch);
+}
+
+esp_err_t NVSHandleSimple::batch_abort()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBatch) return ESP_ERR_INVALID_STATE;
+
+    mBatch.reset();
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::blob_stream_open(const char *key, nvs_blob_stream_mode_t mode)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mode == NVS_BLOB_STREAM_WRITE) {
+        if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+        if (mBatch) return ESP_ERR_NOT_SUPPORTED;
+    } else if (mode != NVS_BLOB_STREAM_READ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mBlobStream && mBlobStream->isOpen()) return ESP_ERR_INVALID_STATE;
+
+    if (!mBlobStream) {
+        mBlobStream.reset(new (std::nothrow) BlobStream);
+        if (!mBlobStream) return ESP_ERR_NO_MEM;
+    }
+
+    return mStoragePtr->openBlobStream(*mBlobStream, mNsIndex, key,
+            (mode == NVS_BLOB_STREAM_WRITE) ? BlobStream::Mode::WRITE : BlobStream::Mode::READ);
+}
+
+esp_err_t NVSHandleSimple::blob_stream_read(void *out_data, size_t &length)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobStream) return ESP_ERR_INVALID_STATE;
+
+    return mStoragePtr->readBlobStream(*mBlobStream, out_data, length);
+}
+
+esp_err_t NVSHandleSimple::blob_stream_write(const void *data, size_t length)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobStream) return ESP_ERR_INVALID_STATE;
+
+    return mStoragePtr->writeBlobStream(*mBlobStream, data, length);
+}
+
+esp_err_t NVSHandleSimple::blob_stream_close()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobStream) return ESP_ERR_INVALID_STATE;
+
+    return mStoragePtr->commitBlobStream(*mBlobStream);
+}
+
+esp_err_t NVSHandleSimple::blob_stream_abort()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mBlobStream || !mBlobStream->isOpen()) return ESP_ERR_INVALID_STATE;
+
+    mStoragePtr->abortBlobStream(*mBlobStream);
+    return ESP_OK;
+}
+
 esp_err_t NVSHandleSimple::get_used_entry_count(size_t& used_entries)
 {
     used_entries = 0;
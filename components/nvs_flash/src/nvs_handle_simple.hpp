@@ -57,6 +57,22 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t batch_begin() override;
+
+    esp_err_t batch_commit() override;
+
+    esp_err_t batch_abort() override;
+
+    esp_err_t blob_stream_open(const char *key, nvs_blob_stream_mode_t mode) override;
+
+    esp_err_t blob_stream_read(void *out_data, size_t &length) override;
+
+    esp_err_t blob_stream_write(const void *data, size_t length) override;
+
+    esp_err_t blob_stream_close() override;
+
+    esp_err_t blob_stream_abort() override;
+
     esp_err_t get_used_entry_count(size_t &usedEntries) override;
 
     esp_err_t getItemDataSize(ItemType datatype, const char *key, size_t &dataSize);
@@ -95,6 +111,16 @@ private:
      * Upon opening, a handle is valid. It becomes invalid if the underlying storage is de-initialized.
      */
     uint8_t valid;
+
+    /**
+     * Values staged by a write batch, nullptr if no batch has been started.
+     */
+    std::unique_ptr<BatchJournal> mBatch;
+
+    /**
+     * Blob stream of this handle, nullptr if no stream has been opened yet.
+     */
+    std::unique_ptr<BlobStream> mBlobStream;
 };
 
 } // nvs
@@ -119,5 +119,132 @@ size_t HashList::find(size_t start, const Item& item)
     return SIZE_MAX;
 }
 
+FlatHashList::FlatHashList()
+{
+}
+
+FlatHashList::~FlatHashList()
+{
+    clear();
+}
+
+void FlatHashList::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mCount = 0;
+}
+
+esp_err_t FlatHashList::grow()
+{
+    const size_t newCapacity = (mCapacity == 0) ? MIN_CAPACITY : mCapacity * 2;
+    if (newCapacity > MAX_CAPACITY) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    HashListNode* newNodes = new (std::nothrow) HashListNode[newCapacity];
+    if (!newNodes) return ESP_ERR_NO_MEM;
+
+    for (size_t i = 0; i < newCapacity; ++i) {
+        newNodes[i].mIndex = 0xff;
+        newNodes[i].mHash = 0;
+    }
+
+    HashListNode* oldNodes = mNodes;
+    const size_t oldCapacity = mCapacity;
+    mNodes = newNodes;
+    mCapacity = newCapacity;
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldNodes[i].mIndex != 0xff) {
+            size_t slot = homeSlot(oldNodes[i].mHash);
+            while (mNodes[slot].mIndex != 0xff) {
+                slot = (slot + 1) & (mCapacity - 1);
+            }
+            mNodes[slot] = oldNodes[i];
+        }
+    }
+    delete[] oldNodes;
+    return ESP_OK;
+}
+
+esp_err_t FlatHashList::insert(const Item& item, size_t index)
+{
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+
+    if ((mCount + 1U) * 4 > mCapacity * 3U) {
+        esp_err_t err = grow();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    size_t slot = homeSlot(hash_24);
+    while (mNodes[slot].mIndex != 0xff) {
+        slot = (slot + 1) & (mCapacity - 1);
+    }
+    mNodes[slot].mIndex = (uint32_t) index;
+    mNodes[slot].mHash = hash_24;
+    ++mCount;
+    return ESP_OK;
+}
+
+bool FlatHashList::erase(const Item& item, size_t index)
+{
+    if (mCount == 0) {
+        return false;
+    }
+
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    const size_t mask = mCapacity - 1;
+    size_t slot = homeSlot(hash_24);
+    while (mNodes[slot].mIndex != 0xff && mNodes[slot].mIndex != index) {
+        slot = (slot + 1) & mask;
+    }
+    if (mNodes[slot].mIndex != index) {
+        // the item read back from flash may be corrupted and hash elsewhere, look for its index in the whole table
+        slot = 0;
+        while (slot < mCapacity && mNodes[slot].mIndex != index) {
+            ++slot;
+        }
+        if (slot == mCapacity) {
+            // item hasn't been present in cache
+            return false;
+        }
+    }
+
+    // close the gap so that probe sequences of the following nodes stay unbroken
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; mNodes[next].mIndex != 0xff; next = (next + 1) & mask) {
+        const size_t home = homeSlot(mNodes[next].mHash);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            mNodes[hole] = mNodes[next];
+            hole = next;
+        }
+    }
+    mNodes[hole].mIndex = 0xff;
+
+    if (--mCount == 0) {
+        clear();
+    }
+    return true;
+}
+
+size_t FlatHashList::find(size_t start, const Item& item)
+{
+    if (mCount == 0) {
+        return SIZE_MAX;
+    }
+
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    size_t result = SIZE_MAX;
+    for (size_t slot = homeSlot(hash_24); mNodes[slot].mIndex != 0xff; slot = (slot + 1) & (mCapacity - 1)) {
+        const HashListNode& e = mNodes[slot];
+        if (e.mHash == hash_24 && e.mIndex >= start && e.mIndex < result) {
+            result = e.mIndex;
+        }
+    }
+    return result;
+}
 
 } // namespace nvs
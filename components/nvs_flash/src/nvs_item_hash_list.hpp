@@ -23,9 +23,25 @@ public:
 
     esp_err_t insert(const Item& item, size_t index);
     bool erase(const size_t index);
+    bool erase(const Item& item, const size_t index)
+    {
+        return erase(index);
+    }
     size_t find(size_t start, const Item& item);
     void clear();
 
+    template<typename T>
+    void forEach(T visitor)
+    {
+        for (auto it = mBlockList.begin(); it != mBlockList.end(); ++it) {
+            for (size_t i = 0; i < it->mCount; ++i) {
+                if (it->mNodes[i].mIndex != 0xff) {
+                    visitor(it->mNodes[i].mHash);
+                }
+            }
+        }
+    }
+
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
@@ -61,6 +77,61 @@ protected:
     TBlockList mBlockList;
 }; // class HashList
 
+/**
+ * Drop-in alternative to HashList which keeps the hashes of one page in a single open-addressed table.
+ *
+ * Lookups probe only the slots following the home slot of the hash instead of scanning all blocks, and the
+ * table is one contiguous allocation which grows by doubling. The table is sized for the entries of one page
+ * (Page::ENTRY_COUNT) at a load factor of at most 3/4, so it needs more RAM than HashList for full pages.
+ */
+class FlatHashList
+{
+public:
+    FlatHashList();
+    ~FlatHashList();
+
+    esp_err_t insert(const Item& item, size_t index);
+    /* The item is only used to find the home slot of its hash, erasing doesn't scan the table */
+    bool erase(const Item& item, const size_t index);
+    size_t find(size_t start, const Item& item);
+    void clear();
+
+    template<typename T>
+    void forEach(T visitor)
+    {
+        for (size_t i = 0; i < mCapacity; ++i) {
+            if (mNodes[i].mIndex != 0xff) {
+                visitor(mNodes[i].mHash);
+            }
+        }
+    }
+
+private:
+    FlatHashList(const FlatHashList& other);
+    const FlatHashList& operator= (const FlatHashList& rhs);
+
+protected:
+
+    struct HashListNode {
+        uint32_t mIndex : 8;
+        uint32_t mHash  : 24;
+    };
+
+    static const size_t MIN_CAPACITY = 16;
+    static const size_t MAX_CAPACITY = 256;
+
+    esp_err_t grow();
+
+    size_t homeSlot(uint32_t hash_24) const
+    {
+        return hash_24 & (mCapacity - 1);
+    }
+
+    HashListNode* mNodes = nullptr;
+    uint16_t mCapacity = 0;
+    uint16_t mCount = 0;
+}; // class FlatHashList
+
 } // namespace nvs
 
 
@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nvs_key_index.hpp"
+
+namespace nvs
+{
+
+KeyIndex::KeyIndex()
+{
+}
+
+KeyIndex::~KeyIndex()
+{
+}
+
+void KeyIndex::reset()
+{
+    mTable.reset();
+    mCapacity = 0;
+    mCount = 0;
+    mValid = (mMaxEntries > 0);
+}
+
+void KeyIndex::invalidate()
+{
+    mTable.reset();
+    mCapacity = 0;
+    mCount = 0;
+    mValid = false;
+}
+
+esp_err_t KeyIndex::grow()
+{
+    size_t newCapacity = (mCapacity == 0) ? MIN_CAPACITY : mCapacity * 2;
+    std::unique_ptr<Entry[]> oldTable(mTable.release());
+    size_t oldCapacity = mCapacity;
+
+    mTable.reset(new (std::nothrow) Entry[newCapacity]);
+    if (!mTable) {
+        return ESP_ERR_NO_MEM;
+    }
+    std::fill_n(mTable.get(), newCapacity, Entry{0, nullptr});
+    mCapacity = newCapacity;
+    mCount = 0;
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldTable[i].mPage != nullptr) {
+            insert(oldTable[i].mHash, oldTable[i].mPage);
+        }
+    }
+    return ESP_OK;
+}
+
+void KeyIndex::insert(uint32_t hash, Page* page)
+{
+    if (!mValid) {
+        return;
+    }
+
+    if (mCount + 1 > mMaxEntries) {
+        invalidate();
+        return;
+    }
+
+    // keep the load factor below 3/4 so that probe sequences stay short
+    if ((mCount + 1) * 4 > mCapacity * 3) {
+        if (grow() != ESP_OK) {
+            invalidate();
+            return;
+        }
+    }
+
+    size_t slot = slotOf(hash);
+    while (mTable[slot].mPage != nullptr) {
+        slot = (slot + 1) & (mCapacity - 1);
+    }
+    mTable[slot].mHash = hash;
+    mTable[slot].mPage = page;
+    ++mCount;
+}
+
+void KeyIndex::erase(uint32_t hash, Page* page)
+{
+    if (!mValid || mCount == 0) {
+        return;
+    }
+
+    const size_t mask = mCapacity - 1;
+    size_t slot = slotOf(hash);
+    while (mTable[slot].mPage != nullptr) {
+        if (mTable[slot].mHash == hash && mTable[slot].mPage == page) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (mTable[slot].mPage == nullptr) {
+        return;
+    }
+
+    // backward-shift deletion: move following entries of the cluster into the hole if their home slot allows it
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; mTable[next].mPage != nullptr; next = (next + 1) & mask) {
+        size_t home = slotOf(mTable[next].mHash);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            mTable[hole] = mTable[next];
+            hole = next;
+        }
+    }
+    mTable[hole].mPage = nullptr;
+    --mCount;
+}
+
+Page* KeyIndex::find(uint32_t hash, size_t& cursor) const
+{
+    if (!mValid || mCount == 0) {
+        return nullptr;
+    }
+
+    const size_t mask = mCapacity - 1;
+    for (; cursor < mCapacity; ++cursor) {
+        const Entry& e = mTable[(slotOf(hash) + cursor) & mask];
+        if (e.mPage == nullptr) {
+            break;
+        }
+        if (e.mHash == hash) {
+            ++cursor;
+            return e.mPage;
+        }
+    }
+    cursor = mCapacity;
+    return nullptr;
+}
+
+} // namespace nvs
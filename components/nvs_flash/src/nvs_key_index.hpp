@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_key_index_hpp
+#define nvs_key_index_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "nvs_types.hpp"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Partition-wide index mapping the hash of <namespace, key, chunk index> to the page(s) holding such an item.
+ *
+ * The index is an open-addressed hash table with linear probing. It uses the same 24-bit hash as the per-page
+ * HashList, so it can be built from the page hash lists without reading flash. Entries are hints only: a lookup
+ * has to be confirmed on the page, and several entries may share a hash (collisions or transient duplicates).
+ * The index is, however, complete: a hash which is not present in the index is not present in the partition.
+ *
+ * The number of entries is limited by a RAM budget. Once the budget is exceeded (or memory runs out), the index
+ * invalidates itself and the caller has to fall back to scanning all pages.
+ */
+class KeyIndex
+{
+public:
+    KeyIndex();
+
+    ~KeyIndex();
+
+    /**
+     * Set the maximum number of entries. Zero disables the index. Takes effect with the next call to reset().
+     */
+    void setMaxEntries(size_t maxEntries)
+    {
+        mMaxEntries = maxEntries;
+    }
+
+    size_t getMaxEntries() const
+    {
+        return mMaxEntries;
+    }
+
+    /**
+     * Drop all entries. The index becomes valid (usable) if it is enabled.
+     */
+    void reset();
+
+    /**
+     * Drop all entries and mark the index as unusable until the next reset().
+     */
+    void invalidate();
+
+    bool isValid() const
+    {
+        return mValid;
+    }
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    /**
+     * Add the hash of an item stored on page. If the budget is exceeded the index is invalidated.
+     */
+    void insert(uint32_t hash, Page* page);
+
+    /**
+     * Remove one entry for hash pointing to page, if present.
+     */
+    void erase(uint32_t hash, Page* page);
+
+    /**
+     * Return the next page which may contain an item with the given hash, nullptr if there is none left.
+     * cursor has to be 0 for the first call and is advanced by each call.
+     */
+    Page* find(uint32_t hash, size_t& cursor) const;
+
+    static uint32_t hashOf(uint8_t nsIndex, const char* key, uint8_t chunkIdx)
+    {
+        return Item(nsIndex, ItemType::ANY, 0, key, chunkIdx).calculateCrc32WithoutValue() & HASH_MASK;
+    }
+
+    static const uint32_t HASH_MASK = 0xffffff;
+
+private:
+    KeyIndex(const KeyIndex& other);
+    const KeyIndex& operator= (const KeyIndex& rhs);
+
+    struct Entry {
+        uint32_t mHash;
+        Page* mPage; // nullptr marks a free slot
+    };
+
+    esp_err_t grow();
+
+    size_t slotOf(uint32_t hash) const
+    {
+        return (hash * 2654435761u) & (mCapacity - 1);
+    }
+
+    static const size_t MIN_CAPACITY = 64;
+
+    std::unique_ptr<Entry[]> mTable;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    size_t mMaxEntries = 0;
+    bool mValid = false;
+}; // class KeyIndex
+
+} // namespace nvs
+
+#endif /* nvs_key_index_hpp */
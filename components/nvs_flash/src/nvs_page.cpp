@@ -21,7 +21,7 @@ uint32_t Page::Header::calculateCrc32()
                     offsetof(Header, mCrc32) - offsetof(Header, mSeqNumber));
 }
 
-esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
+esp_err_t Page::load(Partition *partition, uint32_t sectorNumber, bool lazy)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -31,6 +31,8 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     mBaseAddress = sectorNumber * SEC_SIZE;
     mUsedEntryCount = 0;
     mErasedEntryCount = 0;
+    mItemsPending = false;
+    mPendingErase = nullptr;
 
     Header header;
     auto rc = mPartition->read_raw(mBaseAddress, &header, sizeof(header));
@@ -80,7 +82,7 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     case PageState::FULL:
     case PageState::ACTIVE:
     case PageState::FREEING:
-        return mLoadEntryTable();
+        return mLoadEntryTable(lazy);
         break;
 
     default:
@@ -297,6 +299,46 @@ esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, vo
     return ESP_OK;
 }
 
+esp_err_t Page::readItemData(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t size, uint8_t chunkIdx)
+{
+    size_t index = 0;
+    Item item;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    esp_err_t rc = findItem(nsIndex, datatype, key, index, item, chunkIdx);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
+    if (!isVariableLengthType(item.datatype)) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+
+    if (offset > item.varLength.dataSize || size > item.varLength.dataSize - offset) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    uint8_t* dst = reinterpret_cast<uint8_t*>(data);
+    size_t entryOffset = offset % ENTRY_SIZE;
+    for (size_t i = index + 1 + offset / ENTRY_SIZE; size > 0; ++i) {
+        Item ditem;
+        rc = readEntry(i, ditem);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        size_t willCopy = ENTRY_SIZE - entryOffset;
+        willCopy = (size < willCopy)?size:willCopy;
+        memcpy(dst, ditem.rawData + entryOffset, willCopy);
+        entryOffset = 0;
+        size -= willCopy;
+        dst += willCopy;
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -311,8 +353,13 @@ esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, con
         return rc;
     }
 
-    if (!isVariableLengthType(datatype)) {
-        if (dataSize != getAlignmentForType(datatype)) {
+    return cmpItemData(index, item, data, dataSize);
+}
+
+esp_err_t Page::cmpItemData(size_t index, const Item& item, const void* data, size_t dataSize)
+{
+    if (!isVariableLengthType(item.datatype)) {
+        if (dataSize != getAlignmentForType(item.datatype)) {
             return ESP_ERR_NVS_TYPE_MISMATCH;
         }
 
@@ -330,7 +377,7 @@ esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, con
     size_t left = item.varLength.dataSize;
     for (size_t i = index + 1; i < index + item.span; ++i) {
         Item ditem;
-        rc = readEntry(i, ditem);
+        esp_err_t rc = readEntry(i, ditem);
         if (rc != ESP_OK) {
             return rc;
         }
@@ -367,6 +414,105 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, ui
     return findItem(nsIndex, datatype, key, index, item, chunkIdx, chunkStart);
 }
 
+esp_err_t Page::writeItems(const Item* items, size_t& count)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL || mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry >= ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    if (count > ENTRY_COUNT - mNextFreeEntry) {
+        count = ENTRY_COUNT - mNextFreeEntry;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        NVS_ASSERT_OR_RETURN(items[i].span == 1 && !isVariableLengthType(items[i].datatype), ESP_FAIL);
+        err = mHashList.insert(items[i], mNextFreeEntry + i);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    uint32_t phyAddr;
+    err = getEntryAddress(mNextFreeEntry, &phyAddr);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = mPartition->write(phyAddr, items, count * ENTRY_SIZE);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    err = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + count, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = mNextFreeEntry;
+    }
+    mUsedEntryCount += count;
+    mNextFreeEntry += count;
+    return ESP_OK;
+}
+
+esp_err_t Page::eraseItemDuplicates(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, bool& kept)
+{
+    size_t index = 0;
+    Item item;
+    while (findItem(nsIndex, datatype, key, index, item) == ESP_OK) {
+        auto rc = cmpItemData(index, item, data, dataSize);
+        if (rc == ESP_OK && !kept) {
+            kept = true;
+            index += item.span;
+            continue;
+        }
+        if (rc != ESP_OK && rc != ESP_ERR_NVS_CONTENT_DIFFERS && rc != ESP_ERR_NVS_TYPE_MISMATCH &&
+                rc != ESP_ERR_NVS_INVALID_LENGTH && rc != ESP_ERR_NVS_NOT_FOUND) {
+            return rc;
+        }
+        rc = eraseEntryAndSpan(index);
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        index += item.span;
+    }
+    return ESP_OK;
+}
+
+esp_err_t Page::eraseItemsWithData(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    size_t index = 0;
+    Item item;
+    while (findItem(nsIndex, datatype, key, index, item) == ESP_OK) {
+        auto rc = cmpItemData(index, item, data, dataSize);
+        if (rc == ESP_OK) {
+            rc = eraseEntryAndSpan(index);
+        } else if (rc == ESP_ERR_NVS_CONTENT_DIFFERS || rc == ESP_ERR_NVS_TYPE_MISMATCH ||
+                rc == ESP_ERR_NVS_INVALID_LENGTH || rc == ESP_ERR_NVS_NOT_FOUND) {
+            rc = ESP_OK;
+        }
+        if (rc != ESP_OK) {
+            return rc;
+        }
+        index += item.span;
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::eraseEntryAndSpan(size_t index)
 {
     uint32_t seq_num;
@@ -386,7 +532,7 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
             return rc;
         }
         if (item.calculateCrc32() != item.crc32) {
-            mHashList.erase(index);
+            mHashList.erase(item, index);
             rc = alterEntryState(index, EntryState::ERASED);
             --mUsedEntryCount;
             ++mErasedEntryCount;
@@ -394,7 +540,7 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
                 return rc;
             }
         } else {
-            mHashList.erase(index);
+            mHashList.erase(item, index);
             span = item.span;
             for (ptrdiff_t i = index + span - 1; i >= static_cast<ptrdiff_t>(index); --i) {
                 rc = mEntryTable.get(i, &state);
@@ -461,6 +607,12 @@ esp_err_t Page::updateFirstUsedEntry(size_t index, size_t span)
 
 esp_err_t Page::copyItems(Page& other)
 {
+    // items with a broken CRC are erased while loading, they mustn't be copied
+    auto rc = loadItems();
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
     if (mFirstUsedEntry == INVALID_ENTRY) {
         return ESP_ERR_NVS_NOT_FOUND;
     }
@@ -519,7 +671,7 @@ esp_err_t Page::copyItems(Page& other)
     return ESP_OK;
 }
 
-esp_err_t Page::mLoadEntryTable()
+esp_err_t Page::mLoadEntryTable(bool lazy)
 {
     // for states where we actually care about data in the page, read entry state table
     if (mState == PageState::ACTIVE ||
@@ -702,66 +854,97 @@ esp_err_t Page::mLoadEntryTable()
                 }
             }
         }
+    } else if (mState == PageState::FULL && lazy) {
+        // Nothing is written to a full page any more, its items are only needed once it is accessed
+        mItemsPending = true;
     } else if (mState == PageState::FULL || mState == PageState::FREEING) {
-        // We have already filled mHashList for page in active state.
-        // Do the same for the case when page is in full or freeing state.
-        Item item;
-        for (size_t i = mFirstUsedEntry; i < ENTRY_COUNT; ++i) {
-            auto err = mEntryTable.get(i, &state);
-            if (err != ESP_OK) {
-                return err;
-            }
-            if (state != EntryState::WRITTEN) {
-                continue;
-            }
+        return mLoadItems();
+    }
 
-            err = readEntry(i, item);
-            if (err != ESP_OK) {
-                mState = PageState::INVALID;
-                return err;
-            }
+    return ESP_OK;
+}
 
-            if (item.crc32 != item.calculateCrc32()) {
-                err = eraseEntryAndSpan(i);
-                if (err != ESP_OK) {
-                    mState = PageState::INVALID;
-                    return err;
-                }
-                continue;
-            }
+esp_err_t Page::loadItems()
+{
+    if (!mItemsPending) {
+        return ESP_OK;
+    }
+    mItemsPending = false;
 
-            NVS_ASSERT_OR_RETURN(item.span > 0, ESP_FAIL);
+    auto err = mLoadItems();
+    if (err != ESP_OK) {
+        return err;
+    }
 
-            err = mHashList.insert(item, i);
+    if (mPendingErase != nullptr && mPendingErase->mPending) {
+        const Item& item = mPendingErase->mItem;
+        if (eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex) == ESP_OK) {
+            mPendingErase->mPending = false;
+        }
+    }
+    mPendingErase = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t Page::mLoadItems()
+{
+    // We have already filled mHashList for page in active state.
+    // Do the same for the case when page is in full or freeing state.
+    EntryState state;
+    Item item;
+    for (size_t i = mFirstUsedEntry; i < ENTRY_COUNT; ++i) {
+        auto err = mEntryTable.get(i, &state);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (state != EntryState::WRITTEN) {
+            continue;
+        }
+
+        err = readEntry(i, item);
+        if (err != ESP_OK) {
+            mState = PageState::INVALID;
+            return err;
+        }
+
+        if (item.crc32 != item.calculateCrc32()) {
+            err = eraseEntryAndSpan(i);
             if (err != ESP_OK) {
                 mState = PageState::INVALID;
                 return err;
             }
+            continue;
+        }
 
-            size_t span = item.span;
+        NVS_ASSERT_OR_RETURN(item.span > 0, ESP_FAIL);
 
-            if (isVariableLengthType(item.datatype)) {
-                for (size_t j = i + 1; j < i + span; ++j) {
-                    err = mEntryTable.get(j, &state);
-                    if (err != ESP_OK) {
-                        return err;
-                    }
-                    if (state != EntryState::WRITTEN) {
-                        eraseEntryAndSpan(i);
-                        break;
-                    }
+        err = mHashList.insert(item, i);
+        if (err != ESP_OK) {
+            mState = PageState::INVALID;
+            return err;
+        }
+
+        size_t span = item.span;
+
+        if (isVariableLengthType(item.datatype)) {
+            for (size_t j = i + 1; j < i + span; ++j) {
+                err = mEntryTable.get(j, &state);
+                if (err != ESP_OK) {
+                    return err;
+                }
+                if (state != EntryState::WRITTEN) {
+                    eraseEntryAndSpan(i);
+                    break;
                 }
             }
-
-            i += span - 1;
         }
 
+        i += span - 1;
     }
 
     return ESP_OK;
 }
 
-
 esp_err_t Page::initialize()
 {
     NVS_ASSERT_OR_RETURN(mState == PageState::UNINITIALIZED, ESP_FAIL);
@@ -863,6 +1046,11 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, si
         return ESP_ERR_NVS_NOT_FOUND;
     }
 
+    esp_err_t rc = loadItems();
+    if (rc != ESP_OK) {
+        return rc;
+    }
+
     size_t findBeginIndex = itemIndex;
     if (findBeginIndex >= ENTRY_COUNT) {
         return ESP_ERR_NVS_NOT_FOUND;
@@ -889,7 +1077,6 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, si
 
     size_t next;
     EntryState state;
-    esp_err_t rc;
     for (size_t i = start; i < end; i = next) {
         next = i + 1;
         rc = mEntryTable.get(i, &state);
@@ -1003,6 +1190,8 @@ esp_err_t Page::erase()
     mFirstUsedEntry = INVALID_ENTRY;
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
+    mItemsPending = false;
+    mPendingErase = nullptr;
     mHashList.clear();
     return ESP_OK;
 }
@@ -7,6 +7,7 @@
 #define nvs_page_hpp
 
 #include "nvs.h"
+#include "sdkconfig.h"
 #include "nvs_types.hpp"
 #include <cstdint>
 #include <type_traits>
@@ -71,6 +72,14 @@ public:
         INVALID       = 0
     };
 
+    /**
+     * Item to be erased from the pages whose items are loaded later, see PageManager::load().
+     */
+    struct PendingErase {
+        bool mPending = false;
+        Item mItem;
+    };
+
     Page();
 
     PageState state() const
@@ -78,7 +87,27 @@ public:
         return mState;
     }
 
-    esp_err_t load(Partition *partition, uint32_t sectorNumber);
+    /**
+     * Load the page from flash. If lazy is true and the page is full, only the header and the entry state table
+     * are read. The items are read (and their hashes added to the hash list) on first access, see loadItems().
+     */
+    esp_err_t load(Partition *partition, uint32_t sectorNumber, bool lazy = false);
+
+    /**
+     * Read the items of a page which was loaded lazily. Does nothing if the items have been read already.
+     * If pendingErase is set (see setPendingErase()), that item is erased from the page once it is loaded.
+     */
+    esp_err_t loadItems();
+
+    bool isLoaded() const
+    {
+        return !mItemsPending;
+    }
+
+    void setPendingErase(PendingErase* pendingErase)
+    {
+        mPendingErase = pendingErase;
+    }
 
     esp_err_t getSeqNumber(uint32_t& seqNumber) const;
 
@@ -90,6 +119,12 @@ public:
 
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Read size bytes starting at offset from the data of a variable length item. Unlike readItem(), the data CRC
+     * isn't checked, the caller has to check it once all data of the item has been read.
+     */
+    esp_err_t readItemData(uint8_t nsIndex, ItemType datatype, const char* key, size_t offset, void* data, size_t size, uint8_t chunkIdx = CHUNK_ANY);
+
     esp_err_t cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
@@ -98,6 +133,24 @@ public:
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Write single-entry items (including their CRC) with one flash write, as many as fit into this page.
+     * On return, count holds the number of items which have been written.
+     */
+    esp_err_t writeItems(const Item* items, size_t& count);
+
+    /**
+     * Erase all items with the given <nsIndex, datatype, key> on this page, except for the first one holding exactly
+     * the given data if kept is false. kept is set once such an item has been kept, so that the function can be
+     * called for several pages in a row.
+     */
+    esp_err_t eraseItemDuplicates(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, bool& kept);
+
+    /**
+     * Erase all items with the given <nsIndex, datatype, key> on this page which hold exactly the given data.
+     */
+    esp_err_t eraseItemsWithData(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -145,6 +198,20 @@ public:
 
     esp_err_t calcEntries(nvs_stats_t &nvsStats);
 
+    /**
+     * Call visitor with the 24-bit hash of each item stored on this page, see HashList.
+     */
+    template<typename T>
+    esp_err_t forEachItemHash(T visitor)
+    {
+        auto err = loadItems();
+        if (err != ESP_OK) {
+            return err;
+        }
+        mHashList.forEach(visitor);
+        return ESP_OK;
+    }
+
 protected:
 
     class Header
@@ -172,7 +239,9 @@ protected:
         INVALID = 0x4 // entry is in inconsistent state (write started but ESB_WRITTEN has not been set yet)
     };
 
-    esp_err_t mLoadEntryTable();
+    esp_err_t mLoadEntryTable(bool lazy);
+
+    esp_err_t mLoadItems();
 
     esp_err_t initialize();
 
@@ -190,6 +259,8 @@ protected:
 
     esp_err_t eraseEntryAndSpan(size_t index);
 
+    esp_err_t cmpItemData(size_t index, const Item& item, const void* data, size_t dataSize);
+
     esp_err_t updateFirstUsedEntry(size_t index, size_t span);
 
     static constexpr size_t getAlignmentForType(ItemType type)
@@ -218,11 +289,18 @@ protected:
     size_t mFirstUsedEntry = INVALID_ENTRY;
     uint16_t mUsedEntryCount = 0;
     uint16_t mErasedEntryCount = 0;
+    bool mItemsPending = false;
+    PendingErase* mPendingErase = nullptr;
 
     /**
      * This hash list stores hashes of namespace index, key, and ChunkIndex for quick lookup when searching items.
      */
-    HashList mHashList;
+#if CONFIG_NVS_HASH_LIST_FLAT
+    typedef FlatHashList TItemHashList;
+#else
+    typedef HashList TItemHashList;
+#endif
+    TItemHashList mHashList;
 
     Partition *mPartition;
 
@@ -7,7 +7,7 @@
 
 namespace nvs
 {
-esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount)
+esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, bool lazy)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -17,12 +17,13 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     mPageCount = sectorCount;
     mPageList.clear();
     mFreePageList.clear();
+    mPendingErase.mPending = false;
     mPages.reset(new (nothrow) Page[sectorCount]);
 
     if (!mPages) return ESP_ERR_NO_MEM;
 
     for (uint32_t i = 0; i < sectorCount; ++i) {
-        auto err = mPages[i].load(partition, baseSector + i);
+        auto err = mPages[i].load(partition, baseSector + i, lazy);
         if (err != ESP_OK) {
             return err;
         }
@@ -54,6 +55,16 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
         mSeqNumber = lastSeqNo + 1;
     }
 
+    // The newest two pages are always loaded: if a write batch was interrupted, its journal is on one of them
+    // (see Storage::moveBatchJournalIndex())
+    TPageListIterator newest = mPageList.empty() ? nullptr : &mPageList.back();
+    for (int i = 0; i < 2 && newest != end(); ++i, --newest) {
+        auto err = newest->loadItems();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
     // if power went out after a new item for the given key was written,
     // but before the old one was erased, we end up with a duplicate item
     Page& lastPage = back();
@@ -71,12 +82,21 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
 
         for (it = begin(); it != last; ++it) {
 
-            if ((it->state() != Page::PageState::FREEING) &&
+            if ((it->state() != Page::PageState::FREEING) && it->isLoaded() &&
                     (it->eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex) == ESP_OK)) {
                 break;
             }
         }
-        if ((it == last) && (item.datatype == ItemType::BLOB_IDX)) {
+        if (it == last && getPendingPageCount() > 0) {
+            // The older version may be on a page which hasn't been loaded yet, erase it once that page is loaded
+            mPendingErase.mPending = true;
+            mPendingErase.mItem = item;
+            for (it = begin(); it != last; ++it) {
+                if (!it->isLoaded()) {
+                    it->setPendingErase(&mPendingErase);
+                }
+            }
+        } else if ((it == last) && (item.datatype == ItemType::BLOB_IDX)) {
             /* Rare case in which the blob was stored using old format, but power went just after writing
              * blob index during modification. Loop again and delete the old version blob*/
             for (it = begin(); it != last; ++it) {
@@ -132,6 +152,48 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     return ESP_OK;
 }
 
+size_t PageManager::getPendingPageCount()
+{
+    size_t count = 0;
+    for (auto it = begin(); it != end(); ++it) {
+        if (!it->isLoaded()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+esp_err_t PageManager::loadPendingPages(size_t maxPages)
+{
+    for (auto it = begin(); it != end() && maxPages > 0; ++it) {
+        if (!it->isLoaded()) {
+            auto err = it->loadItems();
+            if (err != ESP_OK) {
+                return err;
+            }
+            --maxPages;
+        }
+    }
+
+    if (getPendingPageCount() > 0) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    if (mPendingErase.mPending) {
+        mPendingErase.mPending = false;
+        const Item& item = mPendingErase.mItem;
+        if (item.datatype == ItemType::BLOB_IDX) {
+            /* Same as in load(): the older version may have been stored using the old blob format */
+            for (auto it = begin(); it != end(); ++it) {
+                if (it->eraseItem(item.nsIndex, ItemType::BLOB, item.key, item.chunkIndex) == ESP_OK) {
+                    break;
+                }
+            }
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t PageManager::requestNewPage()
 {
     if (mFreePageList.empty()) {
@@ -168,6 +230,11 @@ esp_err_t PageManager::requestNewPage()
 
     Page* erasedPage = maxUnusedItemsPageIt;
 
+    err = erasedPage->loadItems();
+    if (err != ESP_OK) {
+        return err;
+    }
+
 #ifndef NDEBUG
     size_t usedEntries = erasedPage->getUsedEntryCount();
 #endif
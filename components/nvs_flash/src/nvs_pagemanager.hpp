@@ -31,7 +31,22 @@ public:
 
     PageManager() {}
 
-    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount);
+    /**
+     * Load the pages of a partition. If lazy is true, the items of full pages (except for the newest ones) are
+     * only read on first access or by loadPendingPages().
+     */
+    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, bool lazy = false);
+
+    /**
+     * Number of pages whose items haven't been read yet.
+     */
+    size_t getPendingPageCount();
+
+    /**
+     * Read the items of up to maxPages pages which were loaded lazily.
+     * Returns ESP_ERR_NOT_FINISHED if there are pages left.
+     */
+    esp_err_t loadPendingPages(size_t maxPages);
 
     TPageListIterator begin()
     {
@@ -69,6 +84,7 @@ protected:
     TPageList mPageList;
     TPageList mFreePageList;
     std::unique_ptr<Page[]> mPages;
+    Page::PendingErase mPendingErase;
     uint32_t mBaseSector;
     uint32_t mPageCount;
     uint32_t mSeqNumber;
@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstring>
+#include "nvs_read_cache.hpp"
+#include "esp_rom_crc.h"
+
+namespace nvs
+{
+
+ReadCache::ReadCache()
+{
+}
+
+ReadCache::~ReadCache()
+{
+    mEntries.clearAndFreeNodes();
+}
+
+void ReadCache::setCapacity(size_t capacity)
+{
+    clear();
+    mCapacity = capacity;
+}
+
+void ReadCache::clear()
+{
+    mEntries.clearAndFreeNodes();
+    memset(mBuckets, 0, sizeof(mBuckets));
+    mUsed = 0;
+}
+
+uint32_t ReadCache::hashOf(uint8_t nsIndex, const char* key)
+{
+    // the type isn't hashed, invalidate() drops the values of a key of any type
+    uint32_t hash = esp_rom_crc32_le(0xffffffff, &nsIndex, sizeof(nsIndex));
+    return esp_rom_crc32_le(hash, reinterpret_cast<const uint8_t*>(key), strnlen(key, Item::MAX_KEY_LENGTH));
+}
+
+ReadCache::Entry* ReadCache::find(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    const uint32_t hash = hashOf(nsIndex, key);
+    for (Entry* entry = mBuckets[hash % BUCKET_COUNT]; entry != nullptr; entry = entry->mBucketNext) {
+        if (entry->mHash == hash && entry->mNsIndex == nsIndex && entry->mDatatype == datatype
+                && strncmp(entry->mKey, key, sizeof(entry->mKey) - 1) == 0) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void ReadCache::remove(Entry* entry)
+{
+    Entry** link = &mBuckets[entry->mHash % BUCKET_COUNT];
+    while (*link != entry) {
+        link = &(*link)->mBucketNext;
+    }
+    *link = entry->mBucketNext;
+    mUsed -= footprintOf(entry->mDataSize);
+    mEntries.erase(entry);
+    delete entry;
+}
+
+bool ReadCache::read(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize)
+{
+    Entry* entry = find(nsIndex, datatype, key);
+    if (entry == nullptr || entry->mDataSize != dataSize) {
+        ++mMisses;
+        return false;
+    }
+
+    memcpy(data, entry->data(), dataSize);
+    if (entry != &mEntries.front()) {
+        mEntries.erase(entry);
+        mEntries.push_front(entry);
+    }
+    ++mHits;
+    return true;
+}
+
+bool ReadCache::getDataSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize)
+{
+    Entry* entry = find(nsIndex, datatype, key);
+    if (entry == nullptr) {
+        return false;
+    }
+    dataSize = entry->mDataSize;
+    return true;
+}
+
+void ReadCache::insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    Entry* old = find(nsIndex, datatype, key);
+    if (old != nullptr) {
+        remove(old);
+    }
+
+    const size_t footprint = footprintOf(dataSize);
+    if (footprint > mCapacity) {
+        return;
+    }
+
+    Entry* entry = new (std::nothrow) Entry;
+    if (entry == nullptr) {
+        return;
+    }
+    if (dataSize > sizeof(entry->mInline)) {
+        entry->mData.reset(new (std::nothrow) uint8_t[dataSize]);
+        if (!entry->mData) {
+            delete entry;
+            return;
+        }
+    }
+    entry->mHash = hashOf(nsIndex, key);
+    entry->mNsIndex = nsIndex;
+    entry->mDatatype = datatype;
+    strncpy(entry->mKey, key, sizeof(entry->mKey) - 1);
+    entry->mKey[sizeof(entry->mKey) - 1] = 0;
+    entry->mDataSize = dataSize;
+    memcpy(entry->mData ? entry->mData.get() : entry->mInline, data, dataSize);
+
+    while (mUsed + footprint > mCapacity) {
+        remove(&mEntries.back());
+        ++mEvictions;
+    }
+    mEntries.push_front(entry);
+    entry->mBucketNext = mBuckets[entry->mHash % BUCKET_COUNT];
+    mBuckets[entry->mHash % BUCKET_COUNT] = entry;
+    mUsed += footprint;
+}
+
+void ReadCache::invalidate(uint8_t nsIndex, const char* key)
+{
+    const uint32_t hash = hashOf(nsIndex, key);
+    for (Entry* entry = mBuckets[hash % BUCKET_COUNT]; entry != nullptr;) {
+        Entry* next = entry->mBucketNext;
+        if (entry->mHash == hash && entry->mNsIndex == nsIndex
+                && strncmp(entry->mKey, key, sizeof(entry->mKey) - 1) == 0) {
+            remove(entry);
+        }
+        entry = next;
+    }
+}
+
+void ReadCache::invalidateNamespace(uint8_t nsIndex)
+{
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        Entry* entry = it++;
+        if (entry->mNsIndex == nsIndex) {
+            remove(entry);
+        }
+    }
+}
+
+void ReadCache::fillStats(nvs_read_cache_stats_t& stats) const
+{
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    stats.used_bytes = mUsed;
+    stats.total_bytes = mCapacity;
+}
+
+} // namespace nvs
@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_read_cache_hpp
+#define nvs_read_cache_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+#include "nvs_memory_management.hpp"
+
+namespace nvs
+{
+
+/**
+ * Size-bounded cache of recently read values, kept in least recently used order.
+ *
+ * Entries are looked up by <namespace, type, key> through a table of chains indexed by the hash of namespace and
+ * key. The cache doesn't know about flash: the owner has to insert
+ * values after reading them and to invalidate them before the stored value is changed or erased.
+ *
+ * Each entry is accounted with its data size plus the size of the entry itself. When inserting a value would
+ * exceed the capacity, the least recently used entries are evicted. Values larger than the capacity are not cached.
+ */
+class ReadCache
+{
+public:
+    ReadCache();
+
+    ~ReadCache();
+
+    /**
+     * Set the capacity in bytes, zero disables the cache. All cached values are dropped.
+     */
+    void setCapacity(size_t capacity);
+
+    size_t getCapacity() const
+    {
+        return mCapacity;
+    }
+
+    bool isEnabled() const
+    {
+        return mCapacity > 0;
+    }
+
+    /**
+     * Copy the cached value to data if there is one of exactly dataSize bytes. Counts a hit or a miss.
+     */
+    bool read(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize);
+
+    /**
+     * Get the size of the cached value, if there is one. Doesn't count as a hit or a miss.
+     */
+    bool getDataSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize);
+
+    /**
+     * Cache a value which has just been read, replacing a cached value of the same item.
+     * Running out of memory is not an error, the value just isn't cached.
+     */
+    void insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Drop the cached values of key, of any type.
+     */
+    void invalidate(uint8_t nsIndex, const char* key);
+
+    /**
+     * Drop the cached values of all keys in a namespace.
+     */
+    void invalidateNamespace(uint8_t nsIndex);
+
+    /**
+     * Drop all cached values, the counters are kept.
+     */
+    void clear();
+
+    void fillStats(nvs_read_cache_stats_t& stats) const;
+
+private:
+    ReadCache(const ReadCache& other);
+    const ReadCache& operator= (const ReadCache& rhs);
+
+    struct Entry : public intrusive_list_node<Entry>, public ExceptionlessAllocatable {
+        Entry* mBucketNext; // next entry in the same hash bucket
+        uint32_t mHash;
+        uint8_t mNsIndex;
+        ItemType mDatatype;
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+        size_t mDataSize;
+        uint8_t mInline[8]; // primitive values are stored here, larger values in mData
+        std::unique_ptr<uint8_t[]> mData;
+
+        const uint8_t* data() const
+        {
+            return mData ? mData.get() : mInline;
+        }
+    };
+
+    typedef intrusive_list<Entry> TEntryList;
+
+    static const size_t BUCKET_COUNT = 16;
+
+    static uint32_t hashOf(uint8_t nsIndex, const char* key);
+
+    Entry* find(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    void remove(Entry* entry);
+
+    static size_t footprintOf(size_t dataSize)
+    {
+        return sizeof(Entry) + ((dataSize > sizeof(Entry::mInline)) ? dataSize : 0);
+    }
+
+    TEntryList mEntries; // most recently used first
+    Entry* mBuckets[BUCKET_COUNT] = {};
+    size_t mCapacity = 0;
+    size_t mUsed = 0;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+    size_t mEvictions = 0;
+}; // class ReadCache
+
+} // namespace nvs
+
+#endif /* nvs_read_cache_hpp */
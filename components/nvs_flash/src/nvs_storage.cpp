@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "nvs_storage.hpp"
+#include "esp_rom_crc.h"
 #if __has_include(<bsd/string.h>)
 // for strlcpy
 #include <bsd/string.h>
@@ -23,8 +24,16 @@
 namespace nvs
 {
 
+/**
+ * Key of the journal blob (stored in the namespace index) holding a write batch while it is applied.
+ */
+static const char BATCH_JOURNAL_KEY[] = "nvs.batch";
+
 Storage::~Storage()
 {
+    while (!mBlobStreams.empty()) {
+        detachBlobStream(mBlobStreams.front());
+    }
     clearNamespaces();
 }
 
@@ -33,6 +42,77 @@ void Storage::clearNamespaces()
     mNamespaces.clearAndFreeNodes();
 }
 
+void Storage::rebuildKeyIndex()
+{
+    if (!mLoadComplete) {
+        // the index has to hold all items, it is built once all pages are loaded
+        mKeyIndex.invalidate();
+        return;
+    }
+
+    mKeyIndex.reset();
+    for (auto it = mPageManager.begin(); it != mPageManager.end() && mKeyIndex.isValid(); ++it) {
+        Page* page = it;
+        auto err = page->forEachItemHash([this, page](uint32_t hash) {
+            mKeyIndex.insert(hash, page);
+        });
+        if (err != ESP_OK) {
+            mKeyIndex.invalidate();
+        }
+    }
+}
+
+esp_err_t Storage::requestNewPage()
+{
+    auto err = mPageManager.requestNewPage();
+    // Items of a reclaimed page have been moved to the new page, so the page index of the entries is outdated
+    rebuildKeyIndex();
+    if (err == ESP_OK && mBatchJournalActive) {
+        err = moveBatchJournalIndex();
+    }
+    return err;
+}
+
+bool Storage::hasBatchJournal()
+{
+    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
+        if (it->isLoaded() && it->findItem(Page::NS_INDEX, ItemType::BLOB_IDX, BATCH_JOURNAL_KEY) == ESP_OK) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t Storage::moveBatchJournalIndex()
+{
+    Page* findPage = nullptr;
+    Item item;
+    auto err = findItem(Page::NS_INDEX, ItemType::BLOB_IDX, BATCH_JOURNAL_KEY, findPage, item);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    Page& page = getCurrentPage();
+    if (findPage == &page) {
+        return ESP_OK;
+    }
+
+    // if the power goes off before the old index is erased, PageManager::load() erases it
+    err = page.writeItem(Page::NS_INDEX, ItemType::BLOB_IDX, BATCH_JOURNAL_KEY, item.data, sizeof(item.data));
+    if (err != ESP_OK) {
+        return err;
+    }
+    const uint32_t hash = KeyIndex::hashOf(Page::NS_INDEX, BATCH_JOURNAL_KEY, Page::CHUNK_ANY);
+    mKeyIndex.insert(hash, &page);
+
+    err = findPage->eraseItem(Page::NS_INDEX, ItemType::BLOB_IDX, BATCH_JOURNAL_KEY);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mKeyIndex.erase(hash, findPage);
+    return ESP_OK;
+}
+
 esp_err_t Storage::populateBlobIndices(TBlobIndexList& blobIdxList)
 {
     for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
@@ -90,31 +170,27 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
     }
 }
 
-esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
+esp_err_t Storage::loadNamespaces()
 {
-    auto err = mPageManager.load(mPartition, baseSector, sectorCount);
-    if (err != ESP_OK) {
-        mState = StorageState::INVALID;
-        return err;
-    }
-
-    // load namespaces list
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
     for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
         Page& p = *it;
+        if (!p.isLoaded()) {
+            // namespaces on this page are looked up on demand, see createOrOpenNamespace()
+            continue;
+        }
         size_t itemIndex = 0;
         Item item;
         while (p.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item) == ESP_OK) {
             NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
 
             if (!entry) {
-                mState = StorageState::INVALID;
                 return ESP_ERR_NO_MEM;
             }
 
             item.getKey(entry->mName, sizeof(entry->mName));
-            err = item.getValue(entry->mIndex);
+            auto err = item.getValue(entry->mIndex);
             if (err != ESP_OK) {
                 delete entry;
                 return err;
@@ -133,13 +209,26 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
     if (mNamespaceUsage.set(255, true) != ESP_OK) {
         return ESP_FAIL;
     }
-    mState = StorageState::ACTIVE;
+    return ESP_OK;
+}
+
+esp_err_t Storage::completeLoad()
+{
+    auto err = mPageManager.loadPendingPages(SIZE_MAX);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = loadNamespaces();
+    if (err != ESP_OK) {
+        return err;
+    }
 
     // Populate list of multi-page index entries.
     TBlobIndexList blobIdxList;
     err = populateBlobIndices(blobIdxList);
     if (err != ESP_OK) {
-        mState = StorageState::INVALID;
+        blobIdxList.clearAndFreeNodes();
         return ESP_ERR_NO_MEM;
     }
 
@@ -149,12 +238,77 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
     // Purge the blob index list
     blobIdxList.clearAndFreeNodes();
 
+    mLoadComplete = true;
+    rebuildKeyIndex();
+
+    // Finish a batch which was interrupted by a power loss
+    return recoverBatch();
+}
+
+esp_err_t Storage::ensureLoadComplete()
+{
+    if (mLoadComplete) {
+        return ESP_OK;
+    }
+    auto err = completeLoad();
+    if (err != ESP_OK) {
+        mState = StorageState::INVALID;
+    }
+    return err;
+}
+
+esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
+{
+    mKeyIndex.invalidate();
+    mReadCache.clear();
+    mLoadComplete = false;
+    auto err = mPageManager.load(mPartition, baseSector, sectorCount, mLazyLoad);
+    if (err != ESP_OK) {
+        mState = StorageState::INVALID;
+        return err;
+    }
+
+    // load namespaces list
+    err = loadNamespaces();
+    if (err != ESP_OK) {
+        mState = StorageState::INVALID;
+        return err;
+    }
+    mState = StorageState::ACTIVE;
+
+    // With lazy loading, the remaining pages are loaded on demand or by loadPendingPages(). An interrupted write
+    // batch has to be finished before anything is read, though.
+    if (mPageManager.getPendingPageCount() == 0 || hasBatchJournal()) {
+        err = ensureLoadComplete();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
 #ifdef DEBUG_STORAGE
-    debugCheck();
+    if (mLoadComplete) {
+        debugCheck();
+    }
 #endif
     return ESP_OK;
 }
 
+esp_err_t Storage::loadPendingPages(size_t maxPages)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (mLoadComplete) {
+        return ESP_OK;
+    }
+
+    auto err = mPageManager.loadPendingPages(maxPages);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return ensureLoadComplete();
+}
+
 bool Storage::isValid() const
 {
     return mState == StorageState::ACTIVE;
@@ -162,6 +316,34 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    if (mKeyIndex.isValid() && nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr) {
+        // The index holds every item of the partition, so only the pages it points to need to be searched.
+        // If the item is present on more than one page (i.e. power was lost before the old one was erased),
+        // return the one from the oldest page, same as a linear search would do.
+        const uint32_t hash = KeyIndex::hashOf(nsIndex, key, chunkIdx);
+        Page* found = nullptr;
+        uint32_t foundSeqNumber = UINT32_MAX;
+        size_t cursor = 0;
+        for (Page* candidate = mKeyIndex.find(hash, cursor); candidate != nullptr; candidate = mKeyIndex.find(hash, cursor)) {
+            uint32_t seqNumber;
+            if (candidate == found || candidate->getSeqNumber(seqNumber) != ESP_OK || seqNumber > foundSeqNumber) {
+                continue;
+            }
+            size_t itemIndex = 0;
+            Item candidateItem;
+            if (candidate->findItem(nsIndex, datatype, key, itemIndex, candidateItem, chunkIdx, chunkStart) == ESP_OK) {
+                found = candidate;
+                foundSeqNumber = seqNumber;
+                item = candidateItem;
+            }
+        }
+        if (found == nullptr) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        page = found;
+        return ESP_OK;
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -173,6 +355,18 @@ esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key,
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
+size_t Storage::getMaxBlobSize()
+{
+    /* Check how much maximum data can be accommodated**/
+    uint32_t max_pages = mPageManager.getPageCount() - 1;
+
+    if(max_pages > MAX_BLOB_CHUNKS) {
+       max_pages = MAX_BLOB_CHUNKS;
+    }
+
+    return max_pages * Page::CHUNK_MAX_SIZE;
+}
+
 esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
 {
     uint8_t chunkCount = 0;
@@ -181,14 +375,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
     size_t offset = 0;
     esp_err_t err = ESP_OK;
 
-    /* Check how much maximum data can be accommodated**/
-    uint32_t max_pages = mPageManager.getPageCount() - 1;
-
-    if(max_pages > (Page::CHUNK_ANY-1)/2) {
-       max_pages = (Page::CHUNK_ANY-1)/2;
-    }
-
-    if (dataSize > max_pages * Page::CHUNK_MAX_SIZE) {
+    if (dataSize > getMaxBlobSize()) {
         return ESP_ERR_NVS_VALUE_TOO_LONG;
     }
 
@@ -204,7 +391,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
                     return err;
                 }
             }
-            err = mPageManager.requestNewPage();
+            err = requestNewPage();
             if (err != ESP_OK) {
                 return err;
             } else if(getCurrentPage().getVarDataTailroom() == tailroom) {
@@ -232,6 +419,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
             NVS_ASSERT_OR_RETURN(err != ESP_ERR_NVS_PAGE_FULL, err);
             break;
         } else {
+            mKeyIndex.insert(KeyIndex::hashOf(nsIndex, key, static_cast<uint8_t> (chunkStart) + chunkCount - 1), &page);
             UsedPageNode* node = new (std::nothrow) UsedPageNode();
             if (!node) {
                 err = ESP_ERR_NO_MEM;
@@ -246,7 +434,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
                         break;
                     }
                 }
-                err = mPageManager.requestNewPage();
+                err = requestNewPage();
                 if (err != ESP_OK) {
                     break;
                 }
@@ -263,6 +451,9 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
 
             err = getCurrentPage().writeItem(nsIndex, ItemType::BLOB_IDX, key, item.data, sizeof(item.data));
             NVS_ASSERT_OR_RETURN(err != ESP_ERR_NVS_PAGE_FULL, err);
+            if (err == ESP_OK) {
+                mKeyIndex.insert(KeyIndex::hashOf(nsIndex, key, Page::CHUNK_ANY), &getCurrentPage());
+            }
             break;
         }
     } while (1);
@@ -278,12 +469,55 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
     return err;
 }
 
+esp_err_t Storage::writeItemToCurrentPage(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    Page& page = getCurrentPage();
+    esp_err_t err = page.writeItem(nsIndex, datatype, key, data, dataSize);
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        err = getCurrentPage().writeItem(nsIndex, datatype, key, data, dataSize);
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    } else if (err != ESP_OK) {
+        return err;
+    }
+    mKeyIndex.insert(KeyIndex::hashOf(nsIndex, key, Page::CHUNK_ANY), &getCurrentPage());
+    return ESP_OK;
+}
+
 esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
 {
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    // Drop the cached value even if the write fails below, flash may hold either value then
+    mReadCache.invalidate(nsIndex, key);
+
+    // Blob versions are toggled, so orphaned chunks of the previous writes have to be cleaned up first
+    if (datatype == ItemType::BLOB) {
+        auto err = ensureLoadComplete();
+        if (err != ESP_OK) {
+            return err;
+        }
+        // a stream writing this blob would use the same version offset
+        closeBlobStreams(nsIndex, key);
+    }
+
     Page* findPage = nullptr;
     Item item;
 
@@ -363,52 +597,322 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
             return ESP_OK;
         }
 
-        Page& page = getCurrentPage();
-        err = page.writeItem(nsIndex, datatype, key, data, dataSize);
-        if (err == ESP_ERR_NVS_PAGE_FULL) {
-            if (page.state() != Page::PageState::FULL) {
-                err = page.markFull();
+        err = writeItemToCurrentPage(nsIndex, datatype, key, data, dataSize);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (findPage) {
+        if (findPage->state() == Page::PageState::UNINITIALIZED ||
+                findPage->state() == Page::PageState::INVALID) {
+            err = findItem(nsIndex, datatype, key, findPage, item);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = findPage->eraseItem(nsIndex, datatype, key);
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        mKeyIndex.erase(KeyIndex::hashOf(nsIndex, key, Page::CHUNK_ANY), findPage);
+    }
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t Storage::findModifiedBatchItems(const BatchJournal& batch, std::unique_ptr<bool[]>& modified, size_t& entryCount)
+{
+    modified.reset(new (std::nothrow) bool[batch.count()]);
+    if (!modified) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    entryCount = 0;
+    size_t offset = 0;
+    BatchJournal::Record record;
+    for (size_t i = 0; batch.next(offset, record); ++i) {
+        Page* findPage = nullptr;
+        Item item;
+        auto err = findItem(batch.nsIndex(), record.datatype, record.key, findPage, item);
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+        modified[i] = (findPage == nullptr ||
+                findPage->cmpItem(batch.nsIndex(), record.datatype, record.key, record.data, record.dataSize) != ESP_OK);
+        if (modified[i]) {
+            entryCount += 1;
+            if (record.datatype == ItemType::SZ) {
+                entryCount += (record.dataSize + Page::ENTRY_SIZE - 1) / Page::ENTRY_SIZE;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBatchItems(const BatchJournal& batch, const bool* modified)
+{
+    size_t primitiveCount = 0;
+    size_t offset = 0;
+    BatchJournal::Record record;
+    for (size_t i = 0; batch.next(offset, record); ++i) {
+        if (modified[i] && record.datatype != ItemType::SZ) {
+            ++primitiveCount;
+        }
+    }
+
+    // Primitive values take one entry each, so they are laid out back to back, using one flash write per page
+    if (primitiveCount > 0) {
+        const size_t bufferCount = std::min(primitiveCount, static_cast<size_t>(Page::ENTRY_COUNT));
+        std::unique_ptr<Item[]> items(new (std::nothrow) Item[bufferCount]);
+        if (!items) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        size_t fill = 0;
+        size_t left = primitiveCount;
+        offset = 0;
+        for (size_t i = 0; batch.next(offset, record); ++i) {
+            if (!modified[i] || record.datatype == ItemType::SZ) {
+                continue;
+            }
+            Item& item = items[fill++];
+            item = Item(batch.nsIndex(), record.datatype, 1, record.key);
+            memcpy(item.data, record.data, record.dataSize);
+            item.crc32 = item.calculateCrc32();
+            --left;
+            if (fill < bufferCount && left > 0) {
+                continue;
+            }
+
+            for (size_t done = 0; done < fill;) {
+                Page& page = getCurrentPage();
+                size_t count = fill - done;
+                auto err = page.writeItems(items.get() + done, count);
+                if (err == ESP_ERR_NVS_PAGE_FULL) {
+                    if (page.state() != Page::PageState::FULL) {
+                        err = page.markFull();
+                        if (err != ESP_OK) {
+                            return err;
+                        }
+                    }
+                    err = requestNewPage();
+                    if (err != ESP_OK) {
+                        return err;
+                    }
+                    count = fill - done;
+                    err = getCurrentPage().writeItems(items.get() + done, count);
+                    if (err == ESP_ERR_NVS_PAGE_FULL) {
+                        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+                    }
+                }
                 if (err != ESP_OK) {
                     return err;
                 }
+                for (size_t j = done; j < done + count; ++j) {
+                    mKeyIndex.insert(KeyIndex::hashOf(items[j].nsIndex, items[j].key, Page::CHUNK_ANY), &getCurrentPage());
+                }
+                done += count;
+            }
+            fill = 0;
+        }
+    }
+
+    offset = 0;
+    for (size_t i = 0; batch.next(offset, record); ++i) {
+        if (!modified[i] || record.datatype != ItemType::SZ) {
+            continue;
+        }
+        auto err = writeItemToCurrentPage(batch.nsIndex(), record.datatype, record.key, record.data, record.dataSize);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::eraseBatchItems(const BatchJournal& batch, const bool* modified)
+{
+    size_t offset = 0;
+    BatchJournal::Record record;
+    for (size_t i = 0; batch.next(offset, record); ++i) {
+        if (!modified[i]) {
+            continue;
+        }
+        for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
+            auto err = it->eraseItemsWithData(batch.nsIndex(), record.datatype, record.key, record.data, record.dataSize);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::eraseBatchDuplicates(const BatchJournal& batch, const bool* modified)
+{
+    size_t offset = 0;
+    BatchJournal::Record record;
+    for (size_t i = 0; batch.next(offset, record); ++i) {
+        if (modified != nullptr && !modified[i]) {
+            continue;
+        }
+        // pages are visited from the oldest to the newest one, so the first item holding the new value is kept
+        bool kept = false;
+        for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
+            auto err = it->eraseItemDuplicates(batch.nsIndex(), record.datatype, record.key, record.data, record.dataSize, kept);
+            if (err == ESP_ERR_FLASH_OP_FAIL) {
+                return ESP_ERR_NVS_REMOVE_FAILED;
             }
-            err = mPageManager.requestNewPage();
             if (err != ESP_OK) {
                 return err;
             }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBatch(const BatchJournal& batch)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    if (batch.empty()) {
+        return ESP_OK;
+    }
+
+    std::unique_ptr<bool[]> modified;
+    size_t entryCount;
+    auto err = findModifiedBatchItems(batch, modified, entryCount);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (entryCount == 0) {
+        return ESP_OK;
+    }
+
+    size_t offset = 0;
+    BatchJournal::Record record;
+    while (batch.next(offset, record)) {
+        mReadCache.invalidate(batch.nsIndex(), record.key);
+    }
+
+    // The journal and the new values are stored next to the old values, without using the reserved free page.
+    // Checking this up front avoids writing a journal which can't be applied.
+    nvs_stats_t stats;
+    err = mPageManager.fillStats(stats);
+    if (err != ESP_OK) {
+        return err;
+    }
+    const size_t journalEntryCount = (batch.size() + Page::ENTRY_SIZE - 1) / Page::ENTRY_SIZE
+            + batch.size() / Page::CHUNK_MAX_SIZE + 3;
+    if (stats.free_entries < Page::ENTRY_COUNT + journalEntryCount + entryCount) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    // Writing the journal's blob index is the commit point of the batch
+    err = writeItem(Page::NS_INDEX, ItemType::BLOB, BATCH_JOURNAL_KEY, batch.data(), batch.size());
+    if (err != ESP_OK) {
+        return err;
+    }
 
-            err = getCurrentPage().writeItem(nsIndex, datatype, key, data, dataSize);
-            if (err == ESP_ERR_NVS_PAGE_FULL) {
-                return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
-            }
-            if (err != ESP_OK) {
-                return err;
-            }
-        } else if (err != ESP_OK) {
-            return err;
+    mBatchJournalActive = true;
+    err = writeBatchItems(batch, modified.get());
+    mBatchJournalActive = false;
+    if (err != ESP_OK) {
+        // Take the new values back, so that the old ones stay valid. If this fails, too,
+        // the journal is kept and the batch is completed by the next init().
+        if (eraseBatchItems(batch, modified.get()) == ESP_OK) {
+            eraseItem(Page::NS_INDEX, ItemType::BLOB, BATCH_JOURNAL_KEY);
         }
+        rebuildKeyIndex();
+        return err;
     }
 
-    if (findPage) {
-        if (findPage->state() == Page::PageState::UNINITIALIZED ||
-                findPage->state() == Page::PageState::INVALID) {
-            err = findItem(nsIndex, datatype, key, findPage, item);
-            if (err != ESP_OK) {
-                return err;
-            }
+    err = eraseBatchDuplicates(batch, modified.get());
+    if (err == ESP_OK) {
+        err = eraseItem(Page::NS_INDEX, ItemType::BLOB, BATCH_JOURNAL_KEY);
+    }
+    rebuildKeyIndex();
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return err;
+}
+
+esp_err_t Storage::recoverBatch()
+{
+    size_t size;
+    auto err = getItemDataSize(Page::NS_INDEX, ItemType::BLOB, BATCH_JOURNAL_KEY, size);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[size]);
+    if (!buffer) {
+        return ESP_ERR_NO_MEM;
+    }
+    err = readItem(Page::NS_INDEX, ItemType::BLOB, BATCH_JOURNAL_KEY, buffer.get(), size);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        return err;
+    }
+
+    // The power went off while a batch was applied. The journal is complete, so finish the batch: write the values
+    // which didn't make it to flash and erase all other versions of the items, whichever phase was interrupted.
+    BatchJournal batch;
+    if (err == ESP_OK && batch.assign(buffer.get(), size) == ESP_OK) {
+        buffer.reset();
+
+        std::unique_ptr<bool[]> modified;
+        size_t entryCount;
+        err = findModifiedBatchItems(batch, modified, entryCount);
+        if (err == ESP_OK) {
+            mBatchJournalActive = true;
+            err = writeBatchItems(batch, modified.get());
+            mBatchJournalActive = false;
         }
-        err = findPage->eraseItem(nsIndex, datatype, key);
-        if (err == ESP_ERR_FLASH_OP_FAIL) {
-            return ESP_ERR_NVS_REMOVE_FAILED;
+        if (err == ESP_OK) {
+            err = eraseBatchDuplicates(batch, nullptr);
         }
+        rebuildKeyIndex();
         if (err != ESP_OK) {
             return err;
         }
     }
-#ifdef DEBUG_STORAGE
-    debugCheck();
-#endif
-    return ESP_OK;
+
+    return eraseItem(Page::NS_INDEX, ItemType::BLOB, BATCH_JOURNAL_KEY);
+}
+
+esp_err_t Storage::findNamespace(const char* nsName, uint8_t& nsIndex)
+{
+    Page* findPage = nullptr;
+    Item item;
+    auto err = findItem(Page::NS_INDEX, ItemType::U8, nsName, findPage, item);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = item.getValue(nsIndex);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
+    if (!entry) {
+        return ESP_ERR_NO_MEM;
+    }
+    item.getKey(entry->mName, sizeof(entry->mName));
+    entry->mIndex = nsIndex;
+    mNamespaces.push_back(entry);
+    return mNamespaceUsage.set(nsIndex, true);
 }
 
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
@@ -419,6 +923,24 @@ esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uin
     auto it = std::find_if(mNamespaces.begin(), mNamespaces.end(), [=] (const NamespaceEntry& e) -> bool {
         return strncmp(nsName, e.mName, sizeof(e.mName) - 1) == 0;
     });
+    if (it == std::end(mNamespaces) && !mLoadComplete) {
+        // The namespace may be stored on a page which hasn't been loaded yet. Look it up, which loads pages
+        // as needed. Creating a namespace needs the complete list of used namespace indices, though.
+        auto err = findNamespace(nsName, nsIndex);
+        if (err == ESP_OK) {
+            return ESP_OK;
+        }
+        if (err != ESP_ERR_NVS_NOT_FOUND || !canCreate) {
+            return err;
+        }
+        err = ensureLoadComplete();
+        if (err != ESP_OK) {
+            return err;
+        }
+        it = std::find_if(mNamespaces.begin(), mNamespaces.end(), [=] (const NamespaceEntry& e) -> bool {
+            return strncmp(nsName, e.mName, sizeof(e.mName) - 1) == 0;
+        });
+    }
     if (it == std::end(mNamespaces)) {
         if (!canCreate) {
             return ESP_ERR_NVS_NOT_FOUND;
@@ -554,8 +1076,24 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    const bool cacheable = mReadCache.isEnabled() && datatype != ItemType::ANY && key != nullptr;
+    if (cacheable && mReadCache.read(nsIndex, datatype, key, data, dataSize)) {
+        return ESP_OK;
+    }
+
+    size_t readSize;
+    auto err = readItemFromFlash(nsIndex, datatype, key, data, dataSize, readSize);
+    if (cacheable && err == ESP_OK) {
+        mReadCache.insert(nsIndex, datatype, key, data, readSize);
+    }
+    return err;
+}
+
+esp_err_t Storage::readItemFromFlash(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, size_t& readSize)
+{
     Item item;
     Page* findPage = nullptr;
+    readSize = dataSize;
     if (datatype == ItemType::BLOB) {
         auto err = readMultiPageBlob(nsIndex, key, data, dataSize);
         if (err != ESP_ERR_NVS_NOT_FOUND) {
@@ -567,6 +1105,9 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
     if (err != ESP_OK) {
         return err;
     }
+    if (isVariableLengthType(datatype)) {
+        readSize = item.varLength.dataSize;
+    }
     return findPage->readItem(nsIndex, datatype, key, data, dataSize);
 
 }
@@ -576,6 +1117,8 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
+    mReadCache.invalidate(nsIndex, key);
+
     Item item;
     Page* findPage = nullptr;
 
@@ -588,6 +1131,7 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
     if (err != ESP_OK) {
         return err;
     }
+    mKeyIndex.erase(KeyIndex::hashOf(nsIndex, key, Page::CHUNK_ANY), findPage);
 
     uint8_t chunkCount = item.blobIndex.chunkCount;
 
@@ -610,18 +1154,364 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
         if (err != ESP_OK) {
             return err;
         }
+        mKeyIndex.erase(KeyIndex::hashOf(nsIndex, key, static_cast<uint8_t> (chunkStart) + chunkNum), findPage);
+
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t Storage::openBlobStream(BlobStream& stream, uint8_t nsIndex, const char* key, BlobStream::Mode mode)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (stream.isOpen()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+
+    esp_err_t err;
+    if (mode == BlobStream::Mode::WRITE) {
+        // Blob versions are toggled, so orphaned chunks of the previous writes have to be cleaned up first
+        err = ensureLoadComplete();
+        if (err != ESP_OK) {
+            return err;
+        }
+        // another stream writing this blob would use the same version offset
+        closeBlobStreams(nsIndex, key, true);
+    }
+
+    stream.mMode = mode;
+    stream.mNsIndex = nsIndex;
+    strlcpy(stream.mKey, key, sizeof(stream.mKey));
+    stream.mChunkCount = 0;
+    stream.mDataSize = 0;
+    stream.mReplace = false;
+    stream.mLegacyFormat = false;
+    stream.mOffset = 0;
+    stream.mChunkNum = 0;
+    stream.mChunkOffset = 0;
+    stream.mChunkSize = 0;
+
+    Page* findPage = nullptr;
+    Item item;
+    err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        return err;
+    }
+
+    if (mode == BlobStream::Mode::WRITE) {
+        stream.mChunkStart = VerOffset::VER_0_OFFSET;
+        if (err == ESP_OK) {
+            /* The new version is written next to the current one, which is erased when the stream is committed */
+            stream.mReplace = true;
+            stream.mPrevChunkStart = item.blobIndex.chunkStart;
+            NVS_ASSERT_OR_RETURN(stream.mPrevChunkStart == VerOffset::VER_0_OFFSET ||
+                                 stream.mPrevChunkStart == VerOffset::VER_1_OFFSET, ESP_FAIL);
+            stream.mChunkStart = (stream.mPrevChunkStart == VerOffset::VER_1_OFFSET) ?
+                                 VerOffset::VER_0_OFFSET : VerOffset::VER_1_OFFSET;
+        }
+        err = stream.allocateBuffer();
+        if (err != ESP_OK) {
+            return err;
+        }
+    } else if (err == ESP_OK) {
+        stream.mChunkStart = item.blobIndex.chunkStart;
+        stream.mChunkCount = item.blobIndex.chunkCount;
+        stream.mDataSize = item.blobIndex.dataSize;
+    } else {
+        /* Support for earlier versions where BLOBS were stored without index */
+        err = findItem(nsIndex, ItemType::BLOB, key, findPage, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        stream.mLegacyFormat = true;
+        stream.mChunkCount = 1;
+        stream.mDataSize = item.varLength.dataSize;
+    }
+
+    stream.mStorage = this;
+    mBlobStreams.push_back(&stream);
+    return ESP_OK;
+}
+
+esp_err_t Storage::readBlobStream(BlobStream& stream, void* data, size_t& length)
+{
+    const size_t maxLength = length;
+    length = 0;
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (stream.mStorage != this || stream.mMode != BlobStream::Mode::READ) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const ItemType datatype = stream.mLegacyFormat ? ItemType::BLOB : ItemType::BLOB_DATA;
+    uint8_t* dst = static_cast<uint8_t*>(data);
+    while (length < maxLength && stream.mOffset < stream.mDataSize) {
+        Page* findPage = nullptr;
+        Item item;
+        if (stream.mChunkOffset == stream.mChunkSize) {
+            /* Continue with the next chunk */
+            if (stream.mChunkNum == stream.mChunkCount) {
+                detachBlobStream(stream);
+                return ESP_ERR_NVS_NOT_FOUND;
+            }
+            const uint8_t chunkIdx = stream.mLegacyFormat ?
+                                     Page::CHUNK_ANY : static_cast<uint8_t>(stream.mChunkStart) + stream.mChunkNum;
+            auto err = findItem(stream.mNsIndex, datatype, stream.mKey, findPage, item, chunkIdx);
+            if (err != ESP_OK) {
+                detachBlobStream(stream);
+                return err;
+            }
+            stream.mChunkNum++;
+            stream.mChunkOffset = 0;
+            stream.mChunkSize = item.varLength.dataSize;
+            stream.mChunkCrc32 = 0xffffffff;
+            stream.mExpectedCrc32 = item.varLength.dataCrc32;
+            continue;
+        }
+
+        const uint8_t chunkIdx = stream.mLegacyFormat ?
+                                 Page::CHUNK_ANY : static_cast<uint8_t>(stream.mChunkStart) + stream.mChunkNum - 1;
+        size_t readSize = stream.mChunkSize - stream.mChunkOffset;
+        readSize = (readSize < maxLength - length) ? readSize : maxLength - length;
+        readSize = (readSize < stream.mDataSize - stream.mOffset) ? readSize : stream.mDataSize - stream.mOffset;
+
+        auto err = findItem(stream.mNsIndex, datatype, stream.mKey, findPage, item, chunkIdx);
+        if (err == ESP_OK) {
+            err = findPage->readItemData(stream.mNsIndex, datatype, stream.mKey, stream.mChunkOffset, dst + length, readSize, chunkIdx);
+        }
+        if (err != ESP_OK) {
+            detachBlobStream(stream);
+            return err;
+        }
+
+        stream.mChunkCrc32 = esp_rom_crc32_le(stream.mChunkCrc32, dst + length, readSize);
+        stream.mChunkOffset += readSize;
+        stream.mOffset += readSize;
+        length += readSize;
+
+        if (stream.mChunkOffset == stream.mChunkSize && stream.mChunkCrc32 != stream.mExpectedCrc32) {
+            /* Same as for readItem(), a corrupted chunk is reported as a missing one */
+            detachBlobStream(stream);
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBlobStream(BlobStream& stream, const void* data, size_t length)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (stream.mStorage != this || stream.mMode != BlobStream::Mode::WRITE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (length > getMaxBlobSize() - stream.mDataSize) {
+        abortBlobStream(stream);
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
 
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    while (length > 0) {
+        size_t copySize = Page::CHUNK_MAX_SIZE - stream.mBufferSize;
+        copySize = (length < copySize) ? length : copySize;
+        memcpy(stream.mBuffer.get() + stream.mBufferSize, src, copySize);
+        stream.mBufferSize += copySize;
+        stream.mDataSize += copySize;
+        src += copySize;
+        length -= copySize;
+
+        auto err = writeBlobStreamChunks(stream, false);
+        if (err != ESP_OK) {
+            abortBlobStream(stream);
+            return (err == ESP_ERR_NVS_PAGE_FULL) ? ESP_ERR_NVS_NOT_ENOUGH_SPACE : err;
+        }
     }
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBlobStreamChunks(BlobStream& stream, bool final)
+{
+    while (stream.mBufferSize > 0 || (final && stream.mChunkCount == 0)) {
+        Page& page = getCurrentPage();
+        size_t tailroom = page.getVarDataTailroom();
+        if (!final && stream.mBufferSize < tailroom) {
+            /* More data fits into the chunk on this page */
+            return ESP_OK;
+        }
+
+        esp_err_t err;
+        if (tailroom == 0 || (tailroom < stream.mBufferSize && tailroom < Page::CHUNK_MAX_SIZE / 10)) {
+            /* Tailroom is too small for a chunk, continue on a new page */
+            if (page.state() != Page::PageState::FULL) {
+                err = page.markFull();
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            err = requestNewPage();
+            if (err != ESP_OK) {
+                return err;
+            } else if (getCurrentPage().getVarDataTailroom() == tailroom) {
+                /* We got the same page or we are not improving.*/
+                return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+            }
+            continue;
+        }
+
+        if (stream.mChunkCount == MAX_BLOB_CHUNKS) {
+            return ESP_ERR_NVS_VALUE_TOO_LONG;
+        }
+
+        const size_t chunkSize = (stream.mBufferSize > tailroom) ? tailroom : stream.mBufferSize;
+        const uint8_t chunkIdx = static_cast<uint8_t>(stream.mChunkStart) + stream.mChunkCount;
+        err = page.writeItem(stream.mNsIndex, ItemType::BLOB_DATA, stream.mKey, stream.mBuffer.get(), chunkSize, chunkIdx);
+        if (err != ESP_OK) {
+            NVS_ASSERT_OR_RETURN(err != ESP_ERR_NVS_PAGE_FULL, err);
+            return err;
+        }
+        stream.mChunkCount++;
+        mKeyIndex.insert(KeyIndex::hashOf(stream.mNsIndex, stream.mKey, chunkIdx), &page);
 
+        stream.mBufferSize -= chunkSize;
+        memmove(stream.mBuffer.get(), stream.mBuffer.get() + chunkSize, stream.mBufferSize);
+
+        if (stream.mBufferSize > 0 || (tailroom - chunkSize) < Page::ENTRY_SIZE) {
+            if (page.state() != Page::PageState::FULL) {
+                err = page.markFull();
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            err = requestNewPage();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
     return ESP_OK;
 }
 
+esp_err_t Storage::commitBlobStream(BlobStream& stream)
+{
+    if (stream.mStorage != this) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (stream.mMode == BlobStream::Mode::READ) {
+        detachBlobStream(stream);
+        return ESP_OK;
+    }
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    /* Write the remaining data, then the index which makes the new version valid */
+    auto err = writeBlobStreamChunks(stream, true);
+    if (err == ESP_OK) {
+        Item item;
+        std::fill_n(item.data, sizeof(item.data), 0xff);
+        item.blobIndex.dataSize = stream.mDataSize;
+        item.blobIndex.chunkCount = stream.mChunkCount;
+        item.blobIndex.chunkStart = stream.mChunkStart;
+        err = writeItemToCurrentPage(stream.mNsIndex, ItemType::BLOB_IDX, stream.mKey, item.data, sizeof(item.data));
+    }
+    if (err != ESP_OK) {
+        abortBlobStream(stream);
+        return (err == ESP_ERR_NVS_PAGE_FULL) ? ESP_ERR_NVS_NOT_ENOUGH_SPACE : err;
+    }
+
+    const uint8_t nsIndex = stream.mNsIndex;
+    const char* key = stream.mKey;
+    detachBlobStream(stream);
+    // streams reading the previous version can't continue
+    closeBlobStreams(nsIndex, key);
+    mReadCache.invalidate(nsIndex, key);
+
+    if (stream.mReplace) {
+        /* Erase the blob with earlier version*/
+        err = eraseMultiPageBlob(nsIndex, key, stream.mPrevChunkStart);
+    } else {
+        /* Support for earlier versions where BLOBS were stored without index */
+        Page* findPage = nullptr;
+        Item item;
+        err = findItem(nsIndex, ItemType::BLOB, key, findPage, item);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            return ESP_OK;
+        }
+        if (err == ESP_OK) {
+            err = findPage->eraseItem(nsIndex, ItemType::BLOB, key);
+        }
+        if (err == ESP_OK) {
+            mKeyIndex.erase(KeyIndex::hashOf(nsIndex, key, Page::CHUNK_ANY), findPage);
+        }
+    }
+    if (err == ESP_ERR_FLASH_OP_FAIL) {
+        return ESP_ERR_NVS_REMOVE_FAILED;
+    }
+    return err;
+}
+
+void Storage::abortBlobStream(BlobStream& stream)
+{
+    if (stream.mStorage != this) {
+        return;
+    }
+
+    if (stream.mMode == BlobStream::Mode::WRITE) {
+        /* Erase the chunks written so far. Chunks which can't be erased are orphans and erased by the next init() */
+        for (uint8_t chunkNum = 0; chunkNum < stream.mChunkCount; chunkNum++) {
+            const uint8_t chunkIdx = static_cast<uint8_t>(stream.mChunkStart) + chunkNum;
+            Page* findPage = nullptr;
+            Item item;
+            if (findItem(stream.mNsIndex, ItemType::BLOB_DATA, stream.mKey, findPage, item, chunkIdx) == ESP_OK &&
+                    findPage->eraseItem(stream.mNsIndex, ItemType::BLOB_DATA, stream.mKey, chunkIdx) == ESP_OK) {
+                mKeyIndex.erase(KeyIndex::hashOf(stream.mNsIndex, stream.mKey, chunkIdx), findPage);
+            }
+        }
+    }
+    detachBlobStream(stream);
+}
+
+void Storage::detachBlobStream(BlobStream& stream)
+{
+    mBlobStreams.erase(&stream);
+    stream.mStorage = nullptr;
+    stream.mBuffer.reset();
+    stream.mBufferSize = 0;
+}
+
+void Storage::closeBlobStreams(uint8_t nsIndex, const char* key, bool writersOnly)
+{
+    for (auto it = mBlobStreams.begin(); it != mBlobStreams.end();) {
+        BlobStream& stream = *it;
+        ++it;
+        if (stream.mNsIndex != nsIndex || (writersOnly && stream.mMode != BlobStream::Mode::WRITE)) {
+            continue;
+        }
+        if (key == nullptr || strncmp(stream.mKey, key, sizeof(stream.mKey) - 1) == 0) {
+            abortBlobStream(stream);
+        }
+    }
+}
+
 esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key)
 {
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mReadCache.invalidate(nsIndex, key);
+
+    if (datatype == ItemType::BLOB || datatype == ItemType::ANY) {
+        closeBlobStreams(nsIndex, key);
+    }
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
@@ -637,7 +1527,11 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
         return eraseMultiPageBlob(nsIndex, key);
     }
 
-    return findPage->eraseItem(nsIndex, datatype, key);
+    err = findPage->eraseItem(nsIndex, datatype, key);
+    if (err == ESP_OK) {
+        mKeyIndex.erase(KeyIndex::hashOf(item.nsIndex, item.key, item.chunkIndex), findPage);
+    }
+    return err;
 }
 
 esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
@@ -645,6 +1539,8 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
+    mReadCache.invalidateNamespace(nsIndex);
+    closeBlobStreams(nsIndex, nullptr);
 
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
@@ -653,10 +1549,12 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
                 break;
             }
             else if (err != ESP_OK) {
+                rebuildKeyIndex();
                 return err;
             }
         }
     }
+    rebuildKeyIndex();
     return ESP_OK;
 
 }
@@ -667,6 +1565,12 @@ esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const cha
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    // nvs_get_str() and nvs_get_blob() ask for the size before reading the value
+    if (mReadCache.isEnabled() && (datatype == ItemType::SZ || datatype == ItemType::BLOB)
+            && mReadCache.getDataSize(nsIndex, datatype, key, dataSize)) {
+        return ESP_OK;
+    }
+
     Item item;
     Page* findPage = nullptr;
     auto err = findItem(nsIndex, datatype, key, findPage, item);
@@ -722,6 +1626,13 @@ void Storage::debugCheck()
 
 esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
 {
+    if (mState == StorageState::ACTIVE) {
+        auto err = ensureLoadComplete();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
     nvsStats.namespace_count = mNamespaces.size();
     return mPageManager.fillStats(nvsStats);
 }
@@ -769,6 +1680,11 @@ void Storage::fillEntryInfo(Item &item, nvs_entry_info_t &info)
 
 bool Storage::findEntry(nvs_opaque_iterator_t* it, const char* namespace_name)
 {
+    // entries are reported with their namespace names, so all namespaces have to be known
+    if (mState == StorageState::ACTIVE && ensureLoadComplete() != ESP_OK) {
+        return false;
+    }
+
     it->entryIndex = 0;
     it->nsIndex = Page::NS_ANY;
     it->page = mPageManager.begin();
@@ -9,10 +9,15 @@
 #include <memory>
 #include <cstdlib>
 #include <unordered_map>
+#include "sdkconfig.h"
 #include "nvs.hpp"
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_key_index.hpp"
+#include "nvs_read_cache.hpp"
+#include "nvs_batch_journal.hpp"
+#include "nvs_blob_stream.hpp"
 #include "nvs_memory_management.hpp"
 #include "partition.hpp"
 
@@ -59,12 +64,62 @@ public:
         if (partition == nullptr) {
             abort();
         }
+        mKeyIndex.setMaxEntries(KEY_INDEX_MAX_ENTRIES);
+        mReadCache.setCapacity(READ_CACHE_SIZE);
     };
 
     esp_err_t init(uint32_t baseSector, uint32_t sectorCount);
 
     bool isValid() const;
 
+    /**
+     * Set the RAM budget (number of entries) of the partition-wide key index, zero disables the index.
+     * Takes effect with the next call to init().
+     */
+    void setKeyIndexMaxEntries(size_t maxEntries)
+    {
+        mKeyIndex.setMaxEntries(maxEntries);
+    }
+
+    bool isKeyIndexValid() const
+    {
+        return mKeyIndex.isValid();
+    }
+
+    /**
+     * Set the size in bytes of the read cache, zero disables the cache. Cached values are dropped.
+     */
+    void setReadCacheSize(size_t size)
+    {
+        mReadCache.setCapacity(size);
+    }
+
+    void fillReadCacheStats(nvs_read_cache_stats_t& stats) const
+    {
+        mReadCache.fillStats(stats);
+    }
+
+    /**
+     * Only read the page headers in init(), the items of full pages are read on first access.
+     * Takes effect with the next call to init().
+     */
+    void setLazyLoad(bool lazy)
+    {
+        mLazyLoad = lazy;
+    }
+
+    bool isLoadComplete() const
+    {
+        return mLoadComplete;
+    }
+
+    /**
+     * Read the items of up to maxPages pages which haven't been accessed since init() yet. Once all pages are
+     * loaded, the cleanup done by init() for a complete load is run (e.g. orphaned blob chunks are erased).
+     * Returns ESP_ERR_NOT_FINISHED if there are pages left.
+     */
+    esp_err_t loadPendingPages(size_t maxPages);
+
     esp_err_t createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex);
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
@@ -94,6 +149,44 @@ public:
 
     esp_err_t eraseNamespace(uint8_t nsIndex);
 
+    /**
+     * Write all values staged in batch, all-or-nothing.
+     *
+     * The batch is stored as a journal blob first. If the power goes off afterwards, init() finishes applying it.
+     * Values which are not modified by the batch are not written. New primitive values are written with one flash
+     * write per page, and the old values are erased only after all new values have been written.
+     */
+    esp_err_t writeBatch(const BatchJournal& batch);
+
+    /**
+     * Open stream to read or write the blob key piece by piece, see BlobStream. A stream which is open for writing
+     * the same blob is aborted.
+     */
+    esp_err_t openBlobStream(BlobStream& stream, uint8_t nsIndex, const char* key, BlobStream::Mode mode);
+
+    /**
+     * Read up to length bytes at the current position of stream. On return, length holds the number of bytes read,
+     * which is less than requested only at the end of the blob.
+     */
+    esp_err_t readBlobStream(BlobStream& stream, void* data, size_t& length);
+
+    /**
+     * Append data to the blob written by stream. Data is written to flash once a chunk is complete.
+     * If this fails, the stream is aborted.
+     */
+    esp_err_t writeBlobStream(BlobStream& stream, const void* data, size_t length);
+
+    /**
+     * Close stream. For a write stream, the remaining data and the blob index are written, which replaces the
+     * previous version of the blob.
+     */
+    esp_err_t commitBlobStream(BlobStream& stream);
+
+    /**
+     * Close stream. For a write stream, the chunks written so far are erased.
+     */
+    void abortBlobStream(BlobStream& stream);
+
     const Partition *getPart() const
     {
         return mPartition;
@@ -138,6 +231,42 @@ protected:
 
     void clearNamespaces();
 
+    void rebuildKeyIndex();
+
+    esp_err_t loadNamespaces();
+
+    esp_err_t findNamespace(const char* nsName, uint8_t& nsIndex);
+
+    esp_err_t completeLoad();
+
+    esp_err_t ensureLoadComplete();
+
+    bool hasBatchJournal();
+
+    esp_err_t moveBatchJournalIndex();
+
+    esp_err_t requestNewPage();
+
+    size_t getMaxBlobSize();
+
+    esp_err_t writeBlobStreamChunks(BlobStream& stream, bool final);
+
+    void detachBlobStream(BlobStream& stream);
+
+    void closeBlobStreams(uint8_t nsIndex, const char* key, bool writersOnly = false);
+
+    esp_err_t writeItemToCurrentPage(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    esp_err_t findModifiedBatchItems(const BatchJournal& batch, std::unique_ptr<bool[]>& modified, size_t& entryCount);
+
+    esp_err_t writeBatchItems(const BatchJournal& batch, const bool* modified);
+
+    esp_err_t eraseBatchItems(const BatchJournal& batch, const bool* modified);
+
+    esp_err_t eraseBatchDuplicates(const BatchJournal& batch, const bool* modified);
+
+    esp_err_t recoverBatch();
+
     esp_err_t populateBlobIndices(TBlobIndexList&);
 
     void eraseOrphanDataBlobs(TBlobIndexList&);
@@ -146,13 +275,43 @@ protected:
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Same as readItem() without the read cache. On success, readSize is the size of the stored value, which is
+     * smaller than dataSize if a string or an old format blob is read into a larger buffer.
+     */
+    esp_err_t readItemFromFlash(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, size_t& readSize);
+
 protected:
+    static const uint8_t MAX_BLOB_CHUNKS = (Page::CHUNK_ANY - 1) / 2;
+
+#if CONFIG_NVS_KEY_INDEX
+    static const size_t KEY_INDEX_MAX_ENTRIES = CONFIG_NVS_KEY_INDEX_MAX_ENTRIES;
+#else
+    static const size_t KEY_INDEX_MAX_ENTRIES = 0;
+#endif
+#if CONFIG_NVS_LAZY_LOAD
+    static const bool LAZY_LOAD = true;
+#else
+    static const bool LAZY_LOAD = false;
+#endif
+#ifdef CONFIG_NVS_READ_CACHE_SIZE
+    static const size_t READ_CACHE_SIZE = CONFIG_NVS_READ_CACHE_SIZE;
+#else
+    static const size_t READ_CACHE_SIZE = 0;
+#endif
+
     Partition *mPartition;
     size_t mPageCount;
     PageManager mPageManager;
+    KeyIndex mKeyIndex;
+    ReadCache mReadCache;
     TNamespaces mNamespaces;
+    intrusive_list<BlobStream> mBlobStreams;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
+    bool mLazyLoad = LAZY_LOAD;
+    bool mLoadComplete = false;
+    bool mBatchJournalActive = false;
 };
 
 } // namespace nvs
@@ -9,6 +9,7 @@
 
 #include "esp_transport.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,6 +40,18 @@ typedef struct {
                                              *   If false, only user frames are propagated, control frames are handled
                                              *   automatically during read operations
                                              */
+    bool        permessage_deflate;         /*!< Offer the permessage-deflate extension (RFC 7692) to compress the messages
+                                             *   in both directions, if the server accepts it. Requires CONFIG_WS_PERMESSAGE_DEFLATE.
+                                             *   The received data is decompressed on reading, esp_transport_ws_is_frame_complete()
+                                             *   tells when a frame has been read completely
+                                             */
+    uint8_t     deflate_window_bits;        /*!< Base-2 logarithm of the largest compression window used in either direction,
+                                             *   9 to 15, 0 for the default of 11. Compressing takes about 4 times the window size
+                                             *   of heap, and decompressing the window size, for the lifetime of the connection
+                                             */
+    bool        deflate_no_context_takeover; /*!< Compress each message on its own, and ask the server to do the same,
+                                              *   instead of referring to the previous messages. Lowers the compression ratio
+                                              */
 } esp_transport_ws_config_t;
 
 /**
@@ -175,6 +188,9 @@ ws_transport_opcodes_t esp_transport_ws_get_read_opcode(esp_transport_handle_t t
 /**
  * @brief               Returns payload length of the last received data
  *
+ * For frames of compressed messages (permessage-deflate), this is the length of the compressed payload,
+ * as received. Use esp_transport_ws_is_frame_complete() to find out when the frame has been read.
+ *
  * @param t             websocket transport handle
  *
  * @return
@@ -182,6 +198,21 @@ ws_transport_opcodes_t esp_transport_ws_get_read_opcode(esp_transport_handle_t t
  */
 int esp_transport_ws_get_read_payload_len(esp_transport_handle_t t);
 
+/**
+ * @brief               Checks whether the last received frame has been read completely
+ *
+ * For frames of compressed messages (permessage-deflate), the length of the data read differs from
+ * the payload length, and isn't known before the frame has been read completely. The next read
+ * after a complete frame returns data of the next frame.
+ *
+ * @param t             websocket transport handle
+ *
+ * @return
+ *      - true if all the data of the frame has been read
+ *      - false if data of the frame may be left to read
+ */
+bool esp_transport_ws_is_frame_complete(esp_transport_handle_t t);
+
 /**
  * @brief               Polls the active connection for termination
  *
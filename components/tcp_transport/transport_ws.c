@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -9,6 +9,7 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <sys/random.h>
+#include <sys/param.h>
 #include <sys/socket.h>
 #include "esp_log.h"
 #include "esp_transport.h"
@@ -17,12 +18,17 @@
 #include "esp_transport_internal.h"
 #include "errno.h"
 #include "esp_tls_crypto.h"
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+#include "esp_deflate.h"
+#endif
+#include "esp_ws_mask.h"
 #include <arpa/inet.h>
 
 static const char *TAG = "transport_ws";
 
 #define WS_BUFFER_SIZE              CONFIG_WS_BUFFER_SIZE
 #define WS_FIN                      0x80
+#define WS_RSV1                     0x40
 #define WS_OPCODE_CONT              0x00
 #define WS_OPCODE_TEXT              0x01
 #define WS_OPCODE_BINARY            0x02
@@ -38,6 +44,9 @@ static const char *TAG = "transport_ws";
 #define MAX_WEBSOCKET_HEADER_SIZE   16
 #define WS_RESPONSE_OK              101
 #define WS_TRANSPORT_MAX_CONTROL_FRAME_BUFFER_LEN 125
+#define WS_DEFLATE_DEFAULT_WINDOW_BITS  11
+#define WS_DEFLATE_MIN_WINDOW_BITS      9
+#define WS_INFLATE_STAGING_LEN          128
 
 
 typedef struct {
@@ -47,8 +56,28 @@ typedef struct {
     int payload_len;                    /*!< Total length of the payload */
     int bytes_remaining;                /*!< Bytes left to read of the payload  */
     bool header_received;               /*!< Flag to indicate that a new message header was received */
+    bool compressed;                    /*!< Payload is a part of a compressed message */
 } ws_transport_frame_state_t;
 
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+typedef struct {
+    bool enabled;                       /*!< Offer the permessage-deflate extension when connecting */
+    uint8_t window_bits;                /*!< Window size requested for both directions */
+    bool no_context_takeover;           /*!< Compress each message independently */
+    bool negotiated;                    /*!< The server has accepted the extension */
+    uint8_t tx_window_bits;             /*!< Negotiated window sizes and context takeover */
+    uint8_t rx_window_bits;
+    bool tx_no_context_takeover;
+    esp_deflate_handle_t deflate;       /*!< Created on the first sent message */
+    esp_inflate_handle_t inflate;       /*!< Created on the first received message */
+    bool rx_message_compressed;         /*!< The message being received is compressed */
+    bool rx_pending;                    /*!< Decompressed data of the current frame is left to read */
+    const uint8_t *rx_in;               /*!< Compressed data read from the frame but not decompressed yet */
+    size_t rx_in_len;
+    uint8_t rx_staging[WS_INFLATE_STAGING_LEN];
+} ws_compression_t;
+#endif
+
 typedef struct {
     char *path;
     char *buffer;
@@ -60,6 +89,9 @@ typedef struct {
     bool propagate_control_frames;
     ws_transport_frame_state_t frame_state;
     esp_transport_handle_t parent;
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    ws_compression_t compression;
+#endif
 } transport_ws_t;
 
 /**
@@ -160,9 +192,76 @@ static char *get_http_header(const char *buffer, const char *key)
     return NULL;
 }
 
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+static void ws_compression_reset(transport_ws_t *ws)
+{
+    ws_compression_t *c = &ws->compression;
+    esp_deflate_destroy(c->deflate);
+    esp_inflate_destroy(c->inflate);
+    c->deflate = NULL;
+    c->inflate = NULL;
+    c->negotiated = false;
+    c->rx_message_compressed = false;
+    c->rx_pending = false;
+    c->rx_in_len = 0;
+}
+
+static int ws_offer_compression(transport_ws_t *ws, char *buffer, int size)
+{
+    ws_compression_t *c = &ws->compression;
+    // the server may limit our window, and is asked to limit its own
+    return snprintf(buffer, size, "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits; server_max_window_bits=%d%s\r\n",
+                    c->window_bits, c->no_context_takeover ? "; server_no_context_takeover; client_no_context_takeover" : "");
+}
+
+/* Applies the permessage-deflate parameters accepted by the server, without modifying the response */
+static int ws_negotiate_compression(transport_ws_t *ws, const char *response)
+{
+    ws_compression_t *c = &ws->compression;
+    const char key[] = "\r\nSec-WebSocket-Extensions:";
+    const char *found = strcasestr(response, key);
+    if (found == NULL) {
+        return 0;
+    }
+    found += sizeof(key) - 1;
+    const char *found_end = strstr(found, "\r\n");
+    char value[160];
+    if (found_end == NULL || found_end - found >= sizeof(value)) {
+        ESP_LOGE(TAG, "Sec-WebSocket-Extensions header is too long");
+        return -1;
+    }
+    memcpy(value, found, found_end - found);
+    value[found_end - found] = '\0';
+
+    const char *ext = value;
+    esp_ws_deflate_params_t params, other;
+    esp_err_t err = esp_ws_deflate_parse_extension(&ext, &params);
+    if (err == ESP_ERR_NOT_FOUND) {
+        return 0;
+    }
+    if (err != ESP_OK || !c->enabled || esp_ws_deflate_parse_extension(&ext, &other) != ESP_ERR_NOT_FOUND) {
+        ESP_LOGE(TAG, "Unexpected permessage-deflate response: %s", value);
+        return -1;
+    }
+    c->rx_window_bits = params.server_max_window_bits ? params.server_max_window_bits : ESP_DEFLATE_MAX_WINDOW_BITS;
+    if (c->rx_window_bits > c->window_bits) {
+        ESP_LOGE(TAG, "Server window of %d bits exceeds the requested %d bits", c->rx_window_bits, c->window_bits);
+        return -1;
+    }
+    c->tx_window_bits = params.client_max_window_bits ? MIN(params.client_max_window_bits, c->window_bits) : c->window_bits;
+    c->tx_no_context_takeover = c->no_context_takeover || params.client_no_context_takeover;
+    c->negotiated = true;
+    ESP_LOGD(TAG, "permessage-deflate negotiated, window bits sent %d received %d", c->tx_window_bits, c->rx_window_bits);
+    return 0;
+}
+#endif
+
 static int ws_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
 {
     transport_ws_t *ws = esp_transport_get_context_data(t);
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    ws_compression_reset(ws);
+#endif
     if (esp_transport_connect(ws->parent, host, port, timeout_ms) < 0) {
         ESP_LOGE(TAG, "Error connecting to host %s:%d", host, port);
         return -1;
@@ -226,6 +325,17 @@ static int ws_connect(esp_transport_handle_t t, const char *host, int port, int
             return -1;
         }
     }
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    if (ws->compression.enabled) {
+        int r = ws_offer_compression(ws, ws->buffer + len, WS_BUFFER_SIZE - len);
+        len += r;
+        if (r <= 0 || len >= WS_BUFFER_SIZE) {
+            ESP_LOGE(TAG, "Error in request generation"
+                     "(snprintf of extensions returned %d, desired request len: %d, buffer size: %d", r, len, WS_BUFFER_SIZE);
+            return -1;
+        }
+    }
+#endif
     if (ws->headers) {
         ESP_LOGD(TAG, "headers: %s", ws->headers);
         int r = snprintf(ws->buffer + len, WS_BUFFER_SIZE - len, "%s", ws->headers);
@@ -264,6 +374,12 @@ static int ws_connect(esp_transport_handle_t t, const char *host, int port, int
         ESP_LOGE(TAG, "HTTP upgrade failed");
         return -1;
     }
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    // parsed first, as reading Sec-WebSocket-Accept below modifies the response
+    if (ws_negotiate_compression(ws, ws->buffer) < 0) {
+        return -1;
+    }
+#endif
 
     char *server_key = get_http_header(ws->buffer, "Sec-WebSocket-Accept:");
     if (server_key == NULL) {
@@ -297,13 +413,25 @@ static int ws_connect(esp_transport_handle_t t, const char *host, int port, int
     return 0;
 }
 
+static int ws_write_all(esp_transport_handle_t parent, const char *buffer, int len, int timeout_ms)
+{
+    int written = 0;
+    while (written < len) {
+        int ret = esp_transport_write(parent, buffer + written, len - written, timeout_ms);
+        if (ret <= 0) {
+            return -1;
+        }
+        written += ret;
+    }
+    return written;
+}
+
 static int _ws_write(esp_transport_handle_t t, int opcode, int mask_flag, const char *b, int len, int timeout_ms)
 {
     transport_ws_t *ws = esp_transport_get_context_data(t);
-    char *buffer = (char *)b;
     char ws_header[MAX_WEBSOCKET_HEADER_SIZE];
-    char *mask;
-    int header_len = 0, i;
+    const uint8_t *mask = NULL;
+    int header_len = 0;
 
     int poll_write;
     if ((poll_write = esp_transport_poll_write(ws->parent, timeout_ms)) <= 0) {
@@ -332,37 +460,103 @@ static int _ws_write(esp_transport_handle_t t, int opcode, int mask_flag, const
     }
 
     if (mask_flag) {
-        mask = &ws_header[header_len];
+        mask = (const uint8_t *)&ws_header[header_len];
         ssize_t rc;
         if ((rc = getrandom(ws_header + header_len, 4, 0)) < 0) {
             ESP_LOGD(TAG, "getrandom() returned %zd", rc);
             return -1;
         }
         header_len += 4;
+    }
 
-        for (i = 0; i < len; ++i) {
-            buffer[i] = (buffer[i] ^ mask[i % 4]);
+    char *frame_buffer = ws->buffer;
+#ifdef CONFIG_WS_DYNAMIC_BUFFER
+    if (!frame_buffer) {
+        frame_buffer = malloc(WS_BUFFER_SIZE);
+        if (!frame_buffer) {
+            ESP_LOGE(TAG, "Cannot allocate buffer for frame, need-%d", WS_BUFFER_SIZE);
+            return -1;
         }
     }
+#endif
 
-    if (esp_transport_write(ws->parent, ws_header, header_len, timeout_ms) != header_len) {
-        ESP_LOGE(TAG, "Error write header");
-        return -1;
-    }
-    if (len == 0) {
-        return 0;
+    // The frame is masked into the transport buffer, leaving the caller's data untouched, and sent
+    // with the header in one write. Longer payloads are sent in chunks of the buffer size.
+    int ret = len;
+    int sent = 0;
+    int chunk_header_len = header_len;
+    do {
+        // Place the payload at the same word alignment as the source data, so it can be masked a word at a time
+        size_t pad = ((uintptr_t)b + sent - (uintptr_t)(frame_buffer + chunk_header_len)) % sizeof(uintptr_t);
+        char *chunk = frame_buffer + pad;
+        int chunk_len = MIN(len - sent, WS_BUFFER_SIZE - (int)pad - chunk_header_len);
+        memcpy(chunk, ws_header, chunk_header_len);
+        if (chunk_len > 0) {
+            if (mask) {
+                esp_ws_mask((uint8_t *)chunk + chunk_header_len, (const uint8_t *)b + sent, chunk_len, mask, sent);
+            } else {
+                memcpy(chunk + chunk_header_len, b + sent, chunk_len);
+            }
+        }
+        if (ws_write_all(ws->parent, chunk, chunk_header_len + chunk_len, timeout_ms) < 0) {
+            ESP_LOGE(TAG, "Error write frame");
+            ret = -1;
+            break;
+        }
+        sent += chunk_len;
+        chunk_header_len = 0;
+    } while (sent < len);
+
+#ifdef CONFIG_WS_DYNAMIC_BUFFER
+    if (frame_buffer != ws->buffer) {
+        free(frame_buffer);
     }
+#endif
+    return ret;
+}
 
-    int ret = esp_transport_write(ws->parent, buffer, len, timeout_ms);
-    // in case of masked transport we have to revert back to the original data, as ws layer
-    // does not create its own copy of data to be sent
-    if (mask_flag) {
-        mask = &ws_header[header_len - 4];
-        for (i = 0; i < len; ++i) {
-            buffer[i] = (buffer[i] ^ mask[i % 4]);
+/* Writes a message frame, compressing data frames if the extension has been negotiated */
+static int ws_write_message(esp_transport_handle_t t, int opcode, const char *b, int len, int timeout_ms)
+{
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    transport_ws_t *ws = esp_transport_get_context_data(t);
+    ws_compression_t *c = &ws->compression;
+    const int frame_opcode = opcode & 0x0F;
+    if (c->negotiated && !(frame_opcode & WS_OPCODE_CONTROL_FRAME)) {
+        int poll_write;
+        if ((poll_write = esp_transport_poll_write(ws->parent, timeout_ms)) <= 0) {
+            ESP_LOGE(TAG, "Error transport_poll_write");
+            return poll_write;
+        }
+        if (!c->deflate && !(c->deflate = esp_deflate_create(c->tx_window_bits))) {
+            ESP_LOGE(TAG, "Cannot allocate compressor, window bits %d", c->tx_window_bits);
+            return -1;
+        }
+        const bool fin = (opcode & WS_FIN) != 0;
+        const size_t out_size = esp_deflate_bound(len);
+        char *out = malloc(out_size);
+        if (!out) {
+            ESP_LOGE(TAG, "Cannot allocate buffer for compressed frame, need-%d", (int)out_size);
+            return -1;
+        }
+        size_t out_len = 0;
+        esp_err_t err = esp_deflate_message(c->deflate, (const uint8_t *)b, len, (uint8_t *)out, out_size, &out_len, fin);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot compress frame: %s", esp_err_to_name(err));
+            free(out);
+            return -1;
+        }
+        if (fin && c->tx_no_context_takeover) {
+            esp_deflate_reset(c->deflate);
         }
+        // RSV1 marks the first frame of a compressed message
+        int ret = _ws_write(t, opcode | (frame_opcode != WS_OPCODE_CONT ? WS_RSV1 : 0), WS_MASK, out, out_len, timeout_ms);
+        free(out);
+        // the data is already in the compression context, so the connection is unusable if it wasn't sent
+        return ret > 0 ? len : -1;
     }
-    return ret;
+#endif
+    return _ws_write(t, opcode, WS_MASK, b, len, timeout_ms);
 }
 
 int esp_transport_ws_send_raw(esp_transport_handle_t t, ws_transport_opcodes_t opcode, const char *b, int len, int timeout_ms)
@@ -373,7 +567,7 @@ int esp_transport_ws_send_raw(esp_transport_handle_t t, ws_transport_opcodes_t o
         return ESP_ERR_INVALID_ARG;
     }
     ESP_LOGD(TAG, "Sending raw ws message with opcode %d", op_code);
-    return _ws_write(t, op_code, WS_MASK, b, len, timeout_ms);
+    return ws_write_message(t, op_code, b, len, timeout_ms);
 }
 
 static int ws_write(esp_transport_handle_t t, const char *b, int len, int timeout_ms)
@@ -385,7 +579,7 @@ static int ws_write(esp_transport_handle_t t, const char *b, int len, int timeou
         ESP_LOGD(TAG, "Write PING message");
         return _ws_write(t, WS_OPCODE_PING | WS_FIN, WS_MASK, NULL, 0, timeout_ms);
     }
-    return _ws_write(t, WS_OPCODE_BINARY | WS_FIN, WS_MASK, b, len, timeout_ms);
+    return ws_write_message(t, WS_OPCODE_BINARY | WS_FIN, b, len, timeout_ms);
 }
 
 
@@ -409,11 +603,11 @@ static int ws_read_payload(esp_transport_handle_t t, char *buffer, int len, int
         ESP_LOGE(TAG, "Error read data");
         return rlen;
     }
+    // Position of the received data in the payload, the mask key continues from there
+    int offset = ws->frame_state.payload_len - ws->frame_state.bytes_remaining;
     ws->frame_state.bytes_remaining -= rlen;
 
-    for (int i = 0; i < bytes_to_read; i++) {
-        buffer[i] = (buffer[i] ^ ws->frame_state.mask_key[i % 4]);
-    }
+    esp_ws_mask((uint8_t *)buffer, (const uint8_t *)buffer, rlen, (const uint8_t *)ws->frame_state.mask_key, offset);
     return rlen;
 }
 
@@ -443,6 +637,18 @@ static int ws_read_header(esp_transport_handle_t t, char *buffer, int len, int t
     ws->frame_state.header_received = true;
     ws->frame_state.fin = (*data_ptr & 0x80) != 0;
     ws->frame_state.opcode = (*data_ptr & 0x0F);
+    ws->frame_state.compressed = false;
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    ws_compression_t *c = &ws->compression;
+    if (c->negotiated && !(ws->frame_state.opcode & WS_OPCODE_CONTROL_FRAME)) {
+        // RSV1 is set on the first frame of a compressed message
+        if (ws->frame_state.opcode != WS_OPCODE_CONT) {
+            c->rx_message_compressed = (*data_ptr & WS_RSV1) != 0;
+        }
+        ws->frame_state.compressed = c->rx_message_compressed;
+        c->rx_in_len = 0;
+    }
+#endif
     data_ptr ++;
     mask = ((*data_ptr >> 7) & 0x01);
     payload_len = (*data_ptr & 0x7F);
@@ -538,13 +744,75 @@ free_payload_buffer:
 
 }
 
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+/* Reads and decompresses the payload of a compressed frame, as much as fits in the buffer */
+static int ws_read_inflate(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    transport_ws_t *ws = esp_transport_get_context_data(t);
+    ws_compression_t *c = &ws->compression;
+    if (!c->inflate && !(c->inflate = esp_inflate_create(c->rx_window_bits))) {
+        ESP_LOGE(TAG, "Cannot allocate decompressor, window bits %d", c->rx_window_bits);
+        ws->frame_state.bytes_remaining = 0;
+        return -1;
+    }
+
+    uint8_t *out = (uint8_t *)buffer;
+    size_t out_size = len;
+    esp_err_t err = ESP_ERR_NOT_FINISHED;
+    do {
+        if (c->rx_in_len == 0 && ws->frame_state.bytes_remaining > 0) {
+            int rlen = ws_read_payload(t, (char *)c->rx_staging, sizeof(c->rx_staging), timeout_ms);
+            if (rlen <= 0) {
+                if (out != (uint8_t *)buffer) {
+                    break;  // return what has been decompressed, the read is retried next time
+                }
+                ESP_LOGE(TAG, "Error reading payload data");
+                ws->frame_state.bytes_remaining = 0;
+                c->rx_pending = false;
+                esp_inflate_reset(c->inflate);
+                return rlen;
+            }
+            c->rx_in = c->rx_staging;
+            c->rx_in_len = rlen;
+        }
+        const bool end_of_message = ws->frame_state.fin && ws->frame_state.bytes_remaining == 0;
+        err = esp_inflate(c->inflate, &c->rx_in, &c->rx_in_len, &out, &out_size, end_of_message);
+        if (err == ESP_OK) {
+            c->rx_in_len = 0;
+            break;
+        } else if (err != ESP_ERR_NOT_FINISHED) {
+            ESP_LOGE(TAG, "Invalid compressed data");
+            ws->frame_state.bytes_remaining = 0;
+            c->rx_pending = false;
+            esp_inflate_reset(c->inflate);
+            return -1;
+        }
+        // a full buffer is still passed to the decompressor, which consumes the end of a message
+        // that fits exactly, and stops with input left over if there is more output
+    } while ((out_size > 0 || c->rx_in_len == 0) && (c->rx_in_len > 0 || ws->frame_state.bytes_remaining > 0));
+
+    // with a full buffer, more data can come out of the decompressor even if the frame has been read
+    c->rx_pending = err != ESP_OK && (out_size == 0 || c->rx_in_len > 0);
+    return len - out_size;
+}
+#endif
+
+static inline bool ws_read_pending(transport_ws_t *ws)
+{
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    return ws->frame_state.compressed && ws->compression.rx_pending;
+#else
+    return false;
+#endif
+}
+
 static int ws_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
 {
     int rlen = 0;
     transport_ws_t *ws = esp_transport_get_context_data(t);
 
     // If message exceeds buffer len then subsequent reads will skip reading header and read whatever is left of the payload
-    if (ws->frame_state.bytes_remaining <= 0) {
+    if (ws->frame_state.bytes_remaining <= 0 && !ws_read_pending(ws)) {
 
         if ( (rlen = ws_read_header(t, buffer, len, timeout_ms)) < 0) {
             // If something when wrong then we prepare for reading a new header
@@ -561,12 +829,23 @@ static int ws_read(esp_transport_handle_t t, char *buffer, int len, int timeout_
             return ws_handle_control_frame_internal(t, timeout_ms);
         }
 
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+        // an empty compressed frame can still end the message
+        if (ws->frame_state.compressed && ws->frame_state.header_received) {
+            return ws_read_inflate(t, buffer, len, timeout_ms);
+        }
+#endif
         if (rlen == 0) {
             ws->frame_state.bytes_remaining = 0;
             return 0; // timeout
         }
     }
 
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    if (ws->frame_state.compressed) {
+        return ws_read_inflate(t, buffer, len, timeout_ms);
+    }
+#endif
     if (ws->frame_state.payload_len) {
         if ( (rlen = ws_read_payload(t, buffer, len, timeout_ms)) <= 0) {
             ESP_LOGE(TAG, "Error reading payload data");
@@ -594,6 +873,9 @@ static int ws_poll_write(esp_transport_handle_t t, int timeout_ms)
 static int ws_close(esp_transport_handle_t t)
 {
     transport_ws_t *ws = esp_transport_get_context_data(t);
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    ws_compression_reset(ws);
+#endif
     return esp_transport_close(ws->parent);
 }
 
@@ -606,6 +888,9 @@ static esp_err_t ws_destroy(esp_transport_handle_t t)
     free(ws->user_agent);
     free(ws->headers);
     free(ws->auth);
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    ws_compression_reset(ws);
+#endif
     free(ws);
     return 0;
 }
@@ -777,6 +1062,21 @@ esp_err_t esp_transport_ws_set_config(esp_transport_handle_t t, const esp_transp
     }
     esp_err_t err = ESP_OK;
     transport_ws_t *ws = esp_transport_get_context_data(t);
+#ifdef CONFIG_WS_PERMESSAGE_DEFLATE
+    if (config->deflate_window_bits != 0 &&
+            (config->deflate_window_bits < WS_DEFLATE_MIN_WINDOW_BITS || config->deflate_window_bits > ESP_DEFLATE_MAX_WINDOW_BITS)) {
+        ESP_LOGE(TAG, "deflate_window_bits should be between %d and %d", WS_DEFLATE_MIN_WINDOW_BITS, ESP_DEFLATE_MAX_WINDOW_BITS);
+        return ESP_ERR_INVALID_ARG;
+    }
+    ws->compression.enabled = config->permessage_deflate;
+    ws->compression.window_bits = config->deflate_window_bits ? config->deflate_window_bits : WS_DEFLATE_DEFAULT_WINDOW_BITS;
+    ws->compression.no_context_takeover = config->deflate_no_context_takeover;
+#else
+    if (config->permessage_deflate) {
+        ESP_LOGE(TAG, "permessage-deflate requires CONFIG_WS_PERMESSAGE_DEFLATE");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
     if (config->ws_path) {
         err = internal_esp_transport_ws_set_path(t, config->ws_path);
         ESP_TRANSPORT_ERR_OK_CHECK(TAG, err, return err;)
@@ -830,6 +1130,12 @@ int esp_transport_ws_get_read_payload_len(esp_transport_handle_t t)
     return ws->frame_state.payload_len;
 }
 
+bool esp_transport_ws_is_frame_complete(esp_transport_handle_t t)
+{
+    transport_ws_t *ws = esp_transport_get_context_data(t);
+    return ws->frame_state.bytes_remaining <= 0 && !ws_read_pending(ws);
+}
+
 static int esp_transport_ws_handle_control_frames(esp_transport_handle_t t, char *buffer, int len, int timeout_ms, bool client_closed)
 {
     transport_ws_t *ws = esp_transport_get_context_data(t);
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -21,6 +21,7 @@
 #include <sys/time.h>
 #include <sys/termios.h>
 #include <sys/poll.h>
+#include <sys/uio.h>
 #include <sys/dirent.h>
 #include <string.h>
 #include "sdkconfig.h"
@@ -66,8 +67,40 @@ typedef struct
 {
     bool is_sem_local;      /*!< type of "sem" is SemaphoreHandle_t when true, defined by socket driver otherwise */
     void *sem;              /*!< semaphore instance */
+    void *epoll_src;        /*!< set when the driver is armed by an epoll instance instead of a select() call */
 } esp_vfs_select_sem_t;
 
+/**
+ * @brief Handle of an epoll instance created by esp_vfs_epoll_create()
+ */
+typedef struct esp_vfs_epoll *esp_vfs_epoll_handle_t;
+
+#define ESP_VFS_EPOLLIN     (1 << 0)    /*!< File descriptor is ready for reading */
+#define ESP_VFS_EPOLLOUT    (1 << 1)    /*!< File descriptor is ready for writing */
+#define ESP_VFS_EPOLLERR    (1 << 2)    /*!< Error condition on the file descriptor, always reported */
+#define ESP_VFS_EPOLLET     (1u << 31)  /*!< Edge-triggered notification, not supported: esp_vfs_epoll_ctl() fails with EINVAL */
+
+#define ESP_VFS_EPOLL_CTL_ADD   1       /*!< Add a file descriptor to the interest set */
+#define ESP_VFS_EPOLL_CTL_DEL   2       /*!< Remove a file descriptor from the interest set */
+#define ESP_VFS_EPOLL_CTL_MOD   3       /*!< Change the events or user data of a file descriptor in the interest set */
+
+/**
+ * @brief User data stored together with a file descriptor in an epoll instance
+ */
+typedef union {
+    void *ptr;
+    int fd;
+    uint32_t u32;
+} esp_vfs_epoll_data_t;
+
+/**
+ * @brief Event registered with esp_vfs_epoll_ctl() and returned by esp_vfs_epoll_wait()
+ */
+typedef struct {
+    uint32_t events;            /*!< ESP_VFS_EPOLLIN, ESP_VFS_EPOLLOUT and ESP_VFS_EPOLLERR flags */
+    esp_vfs_epoll_data_t data;  /*!< user data, returned unchanged by esp_vfs_epoll_wait() */
+} esp_vfs_epoll_event_t;
+
 /**
  * @brief VFS definition structure
  *
@@ -88,6 +121,11 @@ typedef struct
  *
  * If the FS driver doesn't provide some of the functions, set corresponding
  * members to NULL.
+ *
+ * readv, writev, preadv and pwritev are optional even if the driver supports
+ * reading and writing. If they are not provided, VFS calls read, write, pread
+ * or pwrite for each buffer, and stops at the first buffer which was not
+ * transferred completely.
  */
 typedef struct
 {
@@ -248,6 +286,22 @@ typedef struct
     /** get_socket_select_semaphore returns semaphore allocated in the socket driver; set only for the socket driver */
     esp_err_t (*end_select)(void *end_select_args);
 #endif // CONFIG_VFS_SUPPORT_SELECT || defined __DOXYGEN__
+    union {
+        ssize_t (*readv_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt);                  /*!< readv with context pointer */
+        ssize_t (*readv)(int fd, const struct iovec *iov, int iovcnt);                               /*!< readv without context pointer */
+    };
+    union {
+        ssize_t (*writev_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt);                 /*!< writev with context pointer */
+        ssize_t (*writev)(int fd, const struct iovec *iov, int iovcnt);                              /*!< writev without context pointer */
+    };
+    union {
+        ssize_t (*preadv_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);   /*!< preadv with context pointer */
+        ssize_t (*preadv)(int fd, const struct iovec *iov, int iovcnt, off_t offset);                /*!< preadv without context pointer */
+    };
+    union {
+        ssize_t (*pwritev_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);  /*!< pwritev with context pointer */
+        ssize_t (*pwritev)(int fd, const struct iovec *iov, int iovcnt, off_t offset);               /*!< pwritev without context pointer */
+    };
 } esp_vfs_t;
 
 /**
@@ -435,6 +489,73 @@ void esp_vfs_select_triggered(esp_vfs_select_sem_t sem);
  */
 void esp_vfs_select_triggered_isr(esp_vfs_select_sem_t sem, BaseType_t *woken);
 
+/**
+ * @brief Create an epoll instance
+ *
+ * An epoll instance keeps a set of file descriptors registered once by esp_vfs_epoll_ctl(),
+ * and esp_vfs_epoll_wait() returns only the descriptors which are ready. Unlike esp_vfs_select(),
+ * the non-socket VFS drivers stay armed between the calls to esp_vfs_epoll_wait(), and only
+ * the drivers which have signalled an event by esp_vfs_select_triggered() are queried again.
+ *
+ * Readiness is level-triggered: a descriptor is reported again by the next esp_vfs_epoll_wait()
+ * call for as long as it stays ready.
+ *
+ * @note Requires CONFIG_VFS_SUPPORT_SELECT
+ *
+ * @return handle of the epoll instance, or NULL when out of memory (errno is set to ENOMEM)
+ */
+esp_vfs_epoll_handle_t esp_vfs_epoll_create(void);
+
+/**
+ * @brief Add, modify or remove a file descriptor in the interest set of an epoll instance
+ *
+ * Can be called while another task waits in esp_vfs_epoll_wait() for the same instance.
+ * File descriptors should be removed from the interest set before they are closed.
+ *
+ * @param ep     epoll instance
+ * @param op     ESP_VFS_EPOLL_CTL_ADD, ESP_VFS_EPOLL_CTL_MOD or ESP_VFS_EPOLL_CTL_DEL
+ * @param fd     file descriptor
+ * @param event  events to wait for and the user data; ignored for ESP_VFS_EPOLL_CTL_DEL
+ *
+ * @return 0 on success, -1 on failure with errno set to:
+ *         - EINVAL if the arguments are invalid, or events has other flags than ESP_VFS_EPOLLIN, ESP_VFS_EPOLLOUT
+ *           and ESP_VFS_EPOLLERR (e.g. ESP_VFS_EPOLLET)
+ *         - EBADF if fd is not an open file descriptor
+ *         - EPERM if the VFS driver of fd doesn't support select()
+ *         - EEXIST if fd is already in the interest set (ESP_VFS_EPOLL_CTL_ADD)
+ *         - ENOENT if fd is not in the interest set (ESP_VFS_EPOLL_CTL_MOD, ESP_VFS_EPOLL_CTL_DEL)
+ *         - ENOMEM if out of memory
+ */
+int esp_vfs_epoll_ctl(esp_vfs_epoll_handle_t ep, int op, int fd, const esp_vfs_epoll_event_t *event);
+
+/**
+ * @brief Wait for events on the file descriptors in the interest set of an epoll instance
+ *
+ * Only one task can wait on an epoll instance at a time.
+ *
+ * @param ep         epoll instance
+ * @param events     array filled with the ready file descriptors, at most maxevents entries
+ * @param maxevents  size of the events array, has to be greater than zero
+ * @param timeout_ms maximum time to wait in milliseconds, rounded up to the system tick and
+ *                   incremented by one the same way as in esp_vfs_select(); -1 to wait forever,
+ *                   0 to return immediately
+ *
+ * @return the number of entries filled in events, 0 if the timeout expired,
+ *         or -1 on failure with errno set (EINVAL, EBUSY if another task is waiting)
+ */
+int esp_vfs_epoll_wait(esp_vfs_epoll_handle_t ep, esp_vfs_epoll_event_t *events, int maxevents, int timeout_ms);
+
+/**
+ * @brief Destroy an epoll instance
+ *
+ * The file descriptors in the interest set are not closed.
+ *
+ * @param ep epoll instance
+ *
+ * @return 0 on success, -1 with errno set to EINVAL or EBUSY if a task waits on the instance
+ */
+int esp_vfs_epoll_destroy(esp_vfs_epoll_handle_t ep);
+
 /**
  *
  * @brief Implements the VFS layer of POSIX pread()
@@ -463,6 +584,68 @@ ssize_t esp_vfs_pread(int fd, void *dst, size_t size, off_t offset);
  */
 ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset);
 
+/**
+ *
+ * @brief Implements the VFS layer of POSIX readv()
+ *
+ * If the driver doesn't implement readv, the buffers are filled one by one using its read function.
+ *
+ * @param fd         File descriptor used for read
+ * @param iov        Array of buffers to be filled, in order
+ * @param iovcnt     Number of elements in iov
+ *
+ * @return           A positive return value indicates the number of bytes read. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ *
+ * @brief Implements the VFS layer of POSIX writev()
+ *
+ * If the driver doesn't implement writev, the buffers are written one by one using its write function.
+ *
+ * @param fd         File descriptor used for write
+ * @param iov        Array of buffers to be written, in order
+ * @param iovcnt     Number of elements in iov
+ *
+ * @return           A positive return value indicates the number of bytes written. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ *
+ * @brief Implements the VFS layer of POSIX preadv()
+ *
+ * If the driver doesn't implement preadv, the buffers are filled one by one using its pread function.
+ *
+ * @param fd         File descriptor used for read
+ * @param iov        Array of buffers to be filled, in order
+ * @param iovcnt     Number of elements in iov
+ * @param offset     Starting offset of the read
+ *
+ * @return           A positive return value indicates the number of bytes read. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+/**
+ *
+ * @brief Implements the VFS layer of POSIX pwritev()
+ *
+ * If the driver doesn't implement pwritev, the buffers are written one by one using its pwrite function.
+ *
+ * @param fd         File descriptor used for write
+ * @param iov        Array of buffers to be written, in order
+ * @param iovcnt     Number of elements in iov
+ * @param offset     Starting offset of the write
+ *
+ * @return           A positive return value indicates the number of bytes written. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,155 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "esp_timer.h"
+#include "esp_vfs.h"
+#include "esp_vfs_eventfd.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "test_utils.h"
+
+typedef struct {
+    int fd;
+    int delay_ms;
+} epoll_test_task_param_t;
+
+static void epoll_test_write_task(void *param)
+{
+    const epoll_test_task_param_t *p = param;
+    vTaskDelay(pdMS_TO_TICKS(p->delay_ms));
+    const uint64_t val = 1;
+    TEST_ASSERT_EQUAL(sizeof(val), write(p->fd, &val, sizeof(val)));
+    vTaskDelete(NULL);
+}
+
+static int epoll_test_socket_init(void)
+{
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res;
+    TEST_ASSERT_EQUAL(0, getaddrinfo("localhost", "80", &hints, &res));
+
+    const int socket_fd = socket(res->ai_family, res->ai_socktype, 0);
+    TEST_ASSERT(socket_fd >= 0);
+    struct sockaddr_in saddr = {
+        .sin_family = PF_INET,
+        .sin_port = htons(80),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    TEST_ASSERT(bind(socket_fd, (struct sockaddr *) &saddr, sizeof(saddr)) >= 0);
+    TEST_ASSERT_EQUAL(0, connect(socket_fd, res->ai_addr, res->ai_addrlen));
+    freeaddrinfo(res);
+    return socket_fd;
+}
+
+TEST_CASE("epoll reports only the ready eventfds", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&config));
+    int fds[3];
+    for (int i = 0; i < 3; ++i) {
+        fds[i] = eventfd(0, 0);
+        TEST_ASSERT_GREATER_OR_EQUAL(0, fds[i]);
+    }
+
+    esp_vfs_epoll_handle_t ep = esp_vfs_epoll_create();
+    TEST_ASSERT_NOT_NULL(ep);
+    esp_vfs_epoll_event_t event = { .events = ESP_VFS_EPOLLIN };
+    for (int i = 0; i < 3; ++i) {
+        event.data.u32 = i;
+        TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fds[i], &event));
+    }
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fds[0], &event));
+    TEST_ASSERT_EQUAL(EEXIST, errno);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_MOD, MAX_FDS - 1, &event));
+    TEST_ASSERT_EQUAL(ENOENT, errno);
+    // Only level-triggered readiness is supported
+    event.events = ESP_VFS_EPOLLIN | ESP_VFS_EPOLLET;
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_MOD, fds[0], &event));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    event.events = ESP_VFS_EPOLLIN;
+
+    esp_vfs_epoll_event_t events[4];
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(ep, events, 4, 50));
+    TEST_ASSERT_GREATER_OR_EQUAL(50 * 1000, esp_timer_get_time() - start);
+
+    epoll_test_task_param_t param = { .fd = fds[1], .delay_ms = 20 };
+    xTaskCreate(epoll_test_write_task, "epoll_write", 4096, &param, 5, NULL);
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(ep, events, 4, 1000));
+    TEST_ASSERT_EQUAL(1, events[0].data.u32);
+    TEST_ASSERT_EQUAL(ESP_VFS_EPOLLIN, events[0].events);
+
+    // Level-triggered, reported until it is read
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(ep, events, 4, 0));
+    uint64_t val;
+    TEST_ASSERT_EQUAL(sizeof(val), read(fds[1], &val, sizeof(val)));
+    esp_vfs_epoll_wait(ep, events, 4, 0);
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(ep, events, 4, 0));
+
+    // Event fds are always writable
+    event = (esp_vfs_epoll_event_t) { .events = ESP_VFS_EPOLLOUT, .data.u32 = 2 };
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_MOD, fds[2], &event));
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(ep, events, 4, 0));
+    TEST_ASSERT_EQUAL(2, events[0].data.u32);
+    TEST_ASSERT_EQUAL(ESP_VFS_EPOLLOUT, events[0].events);
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_DEL, fds[2], NULL));
+    esp_vfs_epoll_wait(ep, events, 4, 0);
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(ep, events, 4, 0));
+
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_destroy(ep));
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL(0, close(fds[i]));
+    }
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+TEST_CASE("epoll waits for sockets and eventfds together", "[vfs][epoll]")
+{
+    test_case_uses_tcpip();
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&config));
+    const int event_fd = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, event_fd);
+    const int socket_fd = epoll_test_socket_init();
+
+    esp_vfs_epoll_handle_t ep = esp_vfs_epoll_create();
+    TEST_ASSERT_NOT_NULL(ep);
+    esp_vfs_epoll_event_t event = { .events = ESP_VFS_EPOLLIN, .data.fd = event_fd };
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, event_fd, &event));
+    event.data.fd = socket_fd;
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, socket_fd, &event));
+
+    esp_vfs_epoll_event_t events[4];
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(ep, events, 4, 50));
+
+    // The eventfd wakes up the task waiting for the socket
+    epoll_test_task_param_t param = { .fd = event_fd, .delay_ms = 20 };
+    xTaskCreate(epoll_test_write_task, "epoll_write", 4096, &param, 5, NULL);
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(ep, events, 4, 1000));
+    TEST_ASSERT_EQUAL(event_fd, events[0].data.fd);
+    uint64_t val;
+    TEST_ASSERT_EQUAL(sizeof(val), read(event_fd, &val, sizeof(val)));
+    esp_vfs_epoll_wait(ep, events, 4, 0);
+
+    const char message[] = "Hello";
+    TEST_ASSERT_EQUAL(sizeof(message), send(socket_fd, message, sizeof(message), 0));
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(ep, events, 4, 1000));
+    TEST_ASSERT_EQUAL(socket_fd, events[0].data.fd);
+    TEST_ASSERT_EQUAL(ESP_VFS_EPOLLIN, events[0].events);
+
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_destroy(ep));
+    TEST_ASSERT_EQUAL(0, close(socket_fd));
+    TEST_ASSERT_EQUAL(0, close(event_fd));
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
@@ -0,0 +1,229 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/param.h>
+#include "esp_vfs.h"
+#include "unity.h"
+
+#define IOV_VFS_PATH    "/iov"
+#define IOV_FILE        "/file"
+
+/* Memory backed file, every read() or write() call transfers at most max_chunk bytes */
+typedef struct {
+    char data[64];
+    size_t size;
+    off_t pos;
+    size_t max_chunk;
+    int write_calls;
+    int writev_calls;
+} iov_test_vfs_ctx_t;
+
+static int iov_test_open(void *ctx, const char *path, int flags, int mode)
+{
+    iov_test_vfs_ctx_t *p = (iov_test_vfs_ctx_t *) ctx;
+    p->pos = 0;
+    return 0;
+}
+
+static int iov_test_close(void *ctx, int fd)
+{
+    return 0;
+}
+
+static ssize_t iov_test_pread(void *ctx, int fd, void *dst, size_t size, off_t offset)
+{
+    iov_test_vfs_ctx_t *p = (iov_test_vfs_ctx_t *) ctx;
+    if (offset >= p->size) {
+        return 0;
+    }
+    size = MIN(MIN(size, p->max_chunk), p->size - offset);
+    memcpy(dst, p->data + offset, size);
+    return size;
+}
+
+static ssize_t iov_test_pwrite(void *ctx, int fd, const void *src, size_t size, off_t offset)
+{
+    iov_test_vfs_ctx_t *p = (iov_test_vfs_ctx_t *) ctx;
+    ++p->write_calls;
+    if (offset >= sizeof(p->data)) {
+        errno = ENOSPC;
+        return -1;
+    }
+    size = MIN(MIN(size, p->max_chunk), sizeof(p->data) - offset);
+    memcpy(p->data + offset, src, size);
+    p->size = MAX(p->size, offset + size);
+    return size;
+}
+
+static ssize_t iov_test_read(void *ctx, int fd, void *dst, size_t size)
+{
+    iov_test_vfs_ctx_t *p = (iov_test_vfs_ctx_t *) ctx;
+    ssize_t ret = iov_test_pread(ctx, fd, dst, size, p->pos);
+    p->pos += ret;
+    return ret;
+}
+
+static ssize_t iov_test_write(void *ctx, int fd, const void *src, size_t size)
+{
+    iov_test_vfs_ctx_t *p = (iov_test_vfs_ctx_t *) ctx;
+    ssize_t ret = iov_test_pwrite(ctx, fd, src, size, p->pos);
+    if (ret > 0) {
+        p->pos += ret;
+    }
+    return ret;
+}
+
+static ssize_t iov_test_writev(void *ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    iov_test_vfs_ctx_t *p = (iov_test_vfs_ctx_t *) ctx;
+    ++p->writev_calls;
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        total += iov_test_write(ctx, fd, iov[i].iov_base, iov[i].iov_len);
+    }
+    return total;
+}
+
+static int iov_test_setup(iov_test_vfs_ctx_t *ctx, bool native_writev)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->max_chunk = SIZE_MAX;
+    esp_vfs_t desc = {
+        .flags = ESP_VFS_FLAG_CONTEXT_PTR,
+        .open_p = iov_test_open,
+        .close_p = iov_test_close,
+        .read_p = iov_test_read,
+        .write_p = iov_test_write,
+        .pread_p = iov_test_pread,
+        .pwrite_p = iov_test_pwrite,
+        .writev_p = native_writev ? iov_test_writev : NULL,
+    };
+    TEST_ESP_OK(esp_vfs_register(IOV_VFS_PATH, &desc, ctx));
+    int fd = open(IOV_VFS_PATH IOV_FILE, O_RDWR);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+    return fd;
+}
+
+static void iov_test_teardown(int fd)
+{
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ESP_OK(esp_vfs_unregister(IOV_VFS_PATH));
+}
+
+TEST_CASE("readv and writev fall back to read and write", "[vfs]")
+{
+    iov_test_vfs_ctx_t ctx;
+    int fd = iov_test_setup(&ctx, false);
+
+    char a[] = "abc";
+    char b[] = "defgh";
+    const struct iovec wr_iov[] = {
+        { .iov_base = a, .iov_len = 3 },
+        { .iov_base = NULL, .iov_len = 0 },
+        { .iov_base = b, .iov_len = 5 },
+    };
+    TEST_ASSERT_EQUAL(8, writev(fd, wr_iov, 3));
+    // Zero length buffers are not passed to the driver
+    TEST_ASSERT_EQUAL(2, ctx.write_calls);
+    TEST_ASSERT_EQUAL(8, ctx.size);
+    TEST_ASSERT_EQUAL_MEMORY("abcdefgh", ctx.data, 8);
+
+    char buf1[2];
+    char buf2[8] = { 0 };
+    const struct iovec rd_iov[] = {
+        { .iov_base = buf1, .iov_len = sizeof(buf1) },
+        { .iov_base = buf2, .iov_len = sizeof(buf2) },
+    };
+    ctx.pos = 0;
+    TEST_ASSERT_EQUAL(8, readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL_MEMORY("ab", buf1, 2);
+    TEST_ASSERT_EQUAL_MEMORY("cdefgh", buf2, 6);
+    // End of file
+    TEST_ASSERT_EQUAL(0, readv(fd, rd_iov, 2));
+
+    // Transfer stops at the first short read, same as a short read() would
+    ctx.pos = 0;
+    ctx.max_chunk = 1;
+    TEST_ASSERT_EQUAL(1, readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL(1, ctx.pos);
+
+    TEST_ASSERT_EQUAL(0, readv(fd, rd_iov, 0));
+    TEST_ASSERT_EQUAL(-1, readv(fd, rd_iov, -1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    TEST_ASSERT_EQUAL(-1, writev(fd, NULL, 1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+
+    iov_test_teardown(fd);
+
+    TEST_ASSERT_EQUAL(-1, writev(fd, wr_iov, 3));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+}
+
+TEST_CASE("preadv and pwritev fall back to pread and pwrite", "[vfs]")
+{
+    iov_test_vfs_ctx_t ctx;
+    int fd = iov_test_setup(&ctx, false);
+
+    char a[] = "0123";
+    char b[] = "4567";
+    const struct iovec wr_iov[] = {
+        { .iov_base = a, .iov_len = 4 },
+        { .iov_base = b, .iov_len = 4 },
+    };
+    TEST_ASSERT_EQUAL(8, pwritev(fd, wr_iov, 2, 4));
+    TEST_ASSERT_EQUAL(12, ctx.size);
+    TEST_ASSERT_EQUAL_MEMORY("01234567", ctx.data + 4, 8);
+    // File position is not changed
+    TEST_ASSERT_EQUAL(0, ctx.pos);
+
+    char buf1[3];
+    char buf2[3];
+    const struct iovec rd_iov[] = {
+        { .iov_base = buf1, .iov_len = sizeof(buf1) },
+        { .iov_base = buf2, .iov_len = sizeof(buf2) },
+    };
+    TEST_ASSERT_EQUAL(6, preadv(fd, rd_iov, 2, 5));
+    TEST_ASSERT_EQUAL_MEMORY("123", buf1, 3);
+    TEST_ASSERT_EQUAL_MEMORY("456", buf2, 3);
+    TEST_ASSERT_EQUAL(4, preadv(fd, rd_iov, 2, 8));
+    TEST_ASSERT_EQUAL_MEMORY("456", buf1, 3);
+    TEST_ASSERT_EQUAL_MEMORY("7", buf2, 1);
+    TEST_ASSERT_EQUAL(0, ctx.pos);
+
+    // Data written before an error is reported, the error is returned only if nothing was written
+    TEST_ASSERT_EQUAL(4, pwritev(fd, wr_iov, 2, sizeof(ctx.data) - 4));
+    TEST_ASSERT_EQUAL(-1, pwritev(fd, wr_iov, 2, sizeof(ctx.data)));
+    TEST_ASSERT_EQUAL(ENOSPC, errno);
+
+    TEST_ASSERT_EQUAL(-1, preadv(fd, rd_iov, 2, -1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+
+    iov_test_teardown(fd);
+}
+
+TEST_CASE("writev calls the driver's writev when provided", "[vfs]")
+{
+    iov_test_vfs_ctx_t ctx;
+    int fd = iov_test_setup(&ctx, true);
+
+    char a[] = "head";
+    char b[] = "body";
+    const struct iovec wr_iov[] = {
+        { .iov_base = a, .iov_len = 4 },
+        { .iov_base = b, .iov_len = 4 },
+    };
+    TEST_ASSERT_EQUAL(8, writev(fd, wr_iov, 2));
+    TEST_ASSERT_EQUAL(1, ctx.writev_calls);
+    TEST_ASSERT_EQUAL_MEMORY("headbody", ctx.data, 8);
+
+    iov_test_teardown(fd);
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -14,9 +14,11 @@
 #include <sys/unistd.h>
 #include <sys/lock.h>
 #include <sys/param.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_vfs.h"
 #include "esp_vfs_private.h"
 #include "sdkconfig.h"
@@ -491,6 +493,153 @@ ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset)
     return ret;
 }
 
+static bool check_iov(struct _reent *r, const struct iovec *iov, int iovcnt)
+{
+    if (iovcnt < 0 || (iovcnt > 0 && iov == NULL)) {
+        __errno_r(r) = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+/* Fallback for drivers without readv/preadv: reads the buffers one by one
+ * and stops at the first one which isn't filled completely.
+ * A negative offset means reading from the current file position.
+ */
+static ssize_t read_iov_fallback(struct _reent *r, const vfs_entry_t *vfs, int local_fd,
+                                 const struct iovec *iov, int iovcnt, off_t offset)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        ssize_t ret;
+        if (offset < 0) {
+            CHECK_AND_CALL(ret, r, vfs, read, local_fd, iov[i].iov_base, iov[i].iov_len);
+        } else {
+            CHECK_AND_CALL(ret, r, vfs, pread, local_fd, iov[i].iov_base, iov[i].iov_len, offset + total);
+        }
+        if (ret < 0) {
+            // Report the data which has been read already, the error will be seen by the next call
+            return (total > 0) ? total : ret;
+        }
+        total += ret;
+        if ((size_t) ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+/* Same as read_iov_fallback, for drivers without writev/pwritev */
+static ssize_t write_iov_fallback(struct _reent *r, const vfs_entry_t *vfs, int local_fd,
+                                  const struct iovec *iov, int iovcnt, off_t offset)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        ssize_t ret;
+        if (offset < 0) {
+            CHECK_AND_CALL(ret, r, vfs, write, local_fd, iov[i].iov_base, iov[i].iov_len);
+        } else {
+            CHECK_AND_CALL(ret, r, vfs, pwrite, local_fd, iov[i].iov_base, iov[i].iov_len, offset + total);
+        }
+        if (ret < 0) {
+            return (total > 0) ? total : ret;
+        }
+        total += ret;
+        if ((size_t) ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!check_iov(r, iov, iovcnt)) {
+        return -1;
+    }
+    if (vfs->vfs.readv == NULL) {
+        return read_iov_fallback(r, vfs, local_fd, iov, iovcnt, -1);
+    }
+    ssize_t ret;
+    CHECK_AND_CALL(ret, r, vfs, readv, local_fd, iov, iovcnt);
+    return ret;
+}
+
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!check_iov(r, iov, iovcnt)) {
+        return -1;
+    }
+    if (vfs->vfs.writev == NULL) {
+        return write_iov_fallback(r, vfs, local_fd, iov, iovcnt, -1);
+    }
+    ssize_t ret;
+    CHECK_AND_CALL(ret, r, vfs, writev, local_fd, iov, iovcnt);
+    return ret;
+}
+
+ssize_t esp_vfs_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!check_iov(r, iov, iovcnt) || offset < 0) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (vfs->vfs.preadv == NULL) {
+        return read_iov_fallback(r, vfs, local_fd, iov, iovcnt, offset);
+    }
+    ssize_t ret;
+    CHECK_AND_CALL(ret, r, vfs, preadv, local_fd, iov, iovcnt, offset);
+    return ret;
+}
+
+ssize_t esp_vfs_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!check_iov(r, iov, iovcnt) || offset < 0) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (vfs->vfs.pwritev == NULL) {
+        return write_iov_fallback(r, vfs, local_fd, iov, iovcnt, offset);
+    }
+    ssize_t ret;
+    CHECK_AND_CALL(ret, r, vfs, pwritev, local_fd, iov, iovcnt, offset);
+    return ret;
+}
+
 int esp_vfs_close(struct _reent *r, int fd)
 {
     const vfs_entry_t* vfs = get_vfs_for_fd(fd);
@@ -1087,9 +1236,549 @@ int esp_vfs_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *errorfds
     return ret;
 }
 
+/*
+ * epoll
+ *
+ * Every non-socket VFS driver with file descriptors in the interest set of an epoll instance gets its own
+ * epoll source. The source stays armed (start_select has been called for it) between esp_vfs_epoll_wait()
+ * calls. When the driver calls esp_vfs_select_triggered(), the source is marked as triggered and the waiting
+ * task is woken up. Only the triggered sources are stopped by end_select, reported and armed again.
+ *
+ * Socket file descriptors are kept in fd sets which are copied and handed over to socket_select. Non-socket
+ * drivers stop the waiting in socket_select the same way as in esp_vfs_select().
+ */
+
+typedef struct epoll_item {
+    struct epoll_item *next;        // next item of the same epoll source
+    esp_vfs_epoll_event_t event;
+    int fd;
+    vfs_index_t vfs_index;
+    local_fd_t local_fd;
+    bool is_socket;
+} epoll_item_t;
+
+typedef struct {
+    esp_vfs_epoll_handle_t ep;
+    int vfs_index;
+    epoll_item_t *items;            // items of this VFS driver in the interest set
+    int nfds;                       // highest local FD ever added + 1
+    fds_triple_t interest;          // local FDs passed to start_select
+    fds_triple_t ready;             // filled in by the driver, contains the ready local FDs after end_select
+    void *driver_args;
+    bool armed;                     // start_select has been called
+    bool collected;                 // end_select has been called, ready FDs are waiting to be reported
+    bool triggered;                 // the driver has signalled an event, protected by trigger_lock
+} epoll_source_t;
+
+struct esp_vfs_epoll {
+    _lock_t lock;                   // protects everything except the fields protected by trigger_lock
+    portMUX_TYPE trigger_lock;      // taken by the drivers, possibly from ISRs
+    bool pending;                   // an event has been signalled since the last scan of the sources
+    void *socket_sem;               // semaphore of the socket driver while waiting in socket_select
+    SemaphoreHandle_t sem;          // signalled when not waiting in socket_select
+    bool waiting;
+    epoll_item_t *items[MAX_FDS];
+    epoll_source_t *sources[VFS_MAX_COUNT];
+    const vfs_entry_t *socket_vfs;
+    int socket_count;
+    int socket_nfds;
+    fd_set socket_readfds;
+    fd_set socket_writefds;
+    fd_set socket_errorfds;
+};
+
+static void epoll_notify(esp_vfs_epoll_handle_t ep, epoll_source_t *src, bool from_isr, BaseType_t *woken)
+{
+    if (from_isr) {
+        portENTER_CRITICAL_ISR(&ep->trigger_lock);
+    } else {
+        portENTER_CRITICAL(&ep->trigger_lock);
+    }
+    if (src) {
+        src->triggered = true;
+    }
+    ep->pending = true;
+    // Signalled with the lock taken so that the socket semaphore isn't given after socket_select has ended
+    if (ep->socket_sem) {
+        if (from_isr) {
+            ep->socket_vfs->vfs.stop_socket_select_isr(ep->socket_sem, woken);
+        } else {
+            ep->socket_vfs->vfs.stop_socket_select(ep->socket_sem);
+        }
+    } else if (from_isr) {
+        xSemaphoreGiveFromISR(ep->sem, woken);
+    } else {
+        xSemaphoreGive(ep->sem);
+    }
+    if (from_isr) {
+        portEXIT_CRITICAL_ISR(&ep->trigger_lock);
+    } else {
+        portEXIT_CRITICAL(&ep->trigger_lock);
+    }
+}
+
+static void epoll_source_arm(epoll_source_t *src)
+{
+    const vfs_entry_t *vfs = get_vfs_for_index(src->vfs_index);
+    if (vfs == NULL || src->items == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&src->ep->trigger_lock);
+    src->triggered = false;
+    portEXIT_CRITICAL(&src->ep->trigger_lock);
+
+    src->ready = src->interest;
+    esp_vfs_select_sem_t sem = {
+        .is_sem_local = true,
+        .sem = src->ep->sem,
+        .epoll_src = src,
+    };
+    esp_err_t err = vfs->vfs.start_select(src->nfds, &src->ready.readfds, &src->ready.writefds, &src->ready.errorfds,
+                                          sem, &src->driver_args);
+    if (err != ESP_OK) {
+        ESP_LOGD(TAG, "start_select failed for VFS ID %d: %s", src->vfs_index, esp_err_to_name(err));
+        // Report an error for all the FDs of the driver, the driver is armed again by the next wait
+        FD_ZERO(&src->ready.readfds);
+        FD_ZERO(&src->ready.writefds);
+        src->ready.errorfds = src->interest.errorfds;
+        src->collected = true;
+        return;
+    }
+    src->armed = true;
+}
+
+static void epoll_source_disarm(epoll_source_t *src)
+{
+    const vfs_entry_t *vfs = get_vfs_for_index(src->vfs_index);
+    if (vfs) {
+        esp_err_t err = vfs->vfs.end_select(src->driver_args);
+        if (err != ESP_OK) {
+            ESP_LOGD(TAG, "end_select failed for VFS ID %d: %s", src->vfs_index, esp_err_to_name(err));
+        }
+    }
+    src->driver_args = NULL;
+    src->armed = false;
+    src->collected = true;
+}
+
+static uint32_t epoll_ready_events(const epoll_item_t *item, int fd, fd_set *readfds, fd_set *writefds, fd_set *errorfds)
+{
+    uint32_t events = 0;
+    if (FD_ISSET(fd, readfds)) {
+        FD_CLR(fd, readfds);
+        events |= ESP_VFS_EPOLLIN;
+    }
+    if (FD_ISSET(fd, writefds)) {
+        FD_CLR(fd, writefds);
+        events |= ESP_VFS_EPOLLOUT;
+    }
+    if (FD_ISSET(fd, errorfds)) {
+        FD_CLR(fd, errorfds);
+        events |= ESP_VFS_EPOLLERR;
+    }
+    return events & (item->event.events | ESP_VFS_EPOLLERR);
+}
+
+/* Reports the ready FDs of a collected source. The source stays collected if not all of them fit in events. */
+static int epoll_source_report(epoll_source_t *src, esp_vfs_epoll_event_t *events, int maxevents)
+{
+    int n = 0;
+    epoll_item_t *item = src->items;
+    for (; item != NULL && n < maxevents; item = item->next) {
+        const uint32_t ready = epoll_ready_events(item, item->local_fd,
+                               &src->ready.readfds, &src->ready.writefds, &src->ready.errorfds);
+        if (ready) {
+            events[n].events = ready;
+            events[n].data = item->event.data;
+            ++n;
+        }
+    }
+    src->collected = (item != NULL);
+    return n;
+}
+
+static int epoll_collect(esp_vfs_epoll_handle_t ep, esp_vfs_epoll_event_t *events, int maxevents)
+{
+    int n = 0;
+
+    portENTER_CRITICAL(&ep->trigger_lock);
+    ep->pending = false;
+    portEXIT_CRITICAL(&ep->trigger_lock);
+
+    for (int i = 0; i < VFS_MAX_COUNT && n < maxevents; ++i) {
+        epoll_source_t *src = ep->sources[i];
+        if (src == NULL) {
+            continue;
+        }
+        if (src->armed) {
+            portENTER_CRITICAL(&ep->trigger_lock);
+            const bool triggered = src->triggered;
+            portEXIT_CRITICAL(&ep->trigger_lock);
+            if (!triggered) {
+                continue;
+            }
+            epoll_source_disarm(src);
+        }
+        if (src->collected) {
+            n += epoll_source_report(src, events + n, maxevents - n);
+        }
+        if (!src->collected) {
+            epoll_source_arm(src);
+        }
+    }
+    return n;
+}
+
+static int epoll_socket_select(esp_vfs_epoll_handle_t ep, esp_vfs_epoll_event_t *events, int maxevents,
+                               TickType_t ticks_to_wait)
+{
+    const vfs_entry_t *vfs = ep->socket_vfs;
+    fd_set readfds = ep->socket_readfds;
+    fd_set writefds = ep->socket_writefds;
+    fd_set errorfds = ep->socket_errorfds;
+    const int nfds = ep->socket_nfds;
+    struct timeval tv = { 0 };
+    struct timeval *timeout = &tv;
+    void *sem = NULL;
+
+    if (ticks_to_wait > 0) {
+        sem = vfs->vfs.get_socket_select_semaphore();
+        portENTER_CRITICAL(&ep->trigger_lock);
+        if (ep->pending) {
+            sem = NULL; // don't wait, something has happened since the sources were scanned
+        } else {
+            ep->socket_sem = sem;
+        }
+        portEXIT_CRITICAL(&ep->trigger_lock);
+    }
+    if (sem) {
+        if (ticks_to_wait == portMAX_DELAY) {
+            timeout = NULL;
+        } else {
+            const uint32_t timeout_ms = ticks_to_wait * portTICK_PERIOD_MS;
+            tv.tv_sec = timeout_ms / 1000;
+            tv.tv_usec = (timeout_ms % 1000) * 1000;
+        }
+    }
+
+    _lock_release(&ep->lock);
+    int ret = vfs->vfs.socket_select(nfds, &readfds, &writefds, &errorfds, timeout);
+    _lock_acquire(&ep->lock);
+
+    if (sem) {
+        portENTER_CRITICAL(&ep->trigger_lock);
+        ep->socket_sem = NULL;
+        portEXIT_CRITICAL(&ep->trigger_lock);
+        // The semaphore could have been given by a driver after socket_select has returned for another reason.
+        // It is safe to take it, as the semaphore belongs to the calling thread.
+        SemaphoreHandle_t *s = sem;
+        xSemaphoreTake(*s, 0);
+    }
+    if (ret < 0) {
+        portENTER_CRITICAL(&ep->trigger_lock);
+        const bool pending = ep->pending;
+        portEXIT_CRITICAL(&ep->trigger_lock);
+        // A socket could have been removed from the interest set and closed while waiting
+        return pending ? 0 : -1;
+    }
+
+    int n = 0;
+    for (int fd = 0; fd < nfds && ret > 0 && n < maxevents; ++fd) {
+        const epoll_item_t *item = ep->items[fd];
+        if (item == NULL || !item->is_socket) {
+            continue;
+        }
+        const uint32_t ready = epoll_ready_events(item, fd, &readfds, &writefds, &errorfds);
+        if (ready) {
+            events[n].events = ready;
+            events[n].data = item->event.data;
+            ++n;
+        }
+    }
+    return n;
+}
+
+/* Adds (set == true) or removes the FD of an item from the FD sets of its epoll source or from the socket FD sets */
+static void epoll_item_set_interest(esp_vfs_epoll_handle_t ep, const epoll_item_t *item, bool set)
+{
+    fd_set *readfds;
+    fd_set *writefds;
+    fd_set *errorfds;
+    int fd;
+    epoll_source_t *src = NULL;
+
+    if (item->is_socket) {
+        fd = item->fd;
+        readfds = &ep->socket_readfds;
+        writefds = &ep->socket_writefds;
+        errorfds = &ep->socket_errorfds;
+    } else {
+        src = ep->sources[item->vfs_index];
+        fd = item->local_fd;
+        readfds = &src->interest.readfds;
+        writefds = &src->interest.writefds;
+        errorfds = &src->interest.errorfds;
+        if (!set && !src->armed) {
+            // the driver isn't using the ready FD sets now, so stale results can be dropped
+            FD_CLR(fd, &src->ready.readfds);
+            FD_CLR(fd, &src->ready.writefds);
+            FD_CLR(fd, &src->ready.errorfds);
+        }
+    }
+
+    FD_CLR(fd, readfds);
+    FD_CLR(fd, writefds);
+    FD_CLR(fd, errorfds);
+    if (set) {
+        if (item->event.events & ESP_VFS_EPOLLIN) {
+            FD_SET(fd, readfds);
+        }
+        if (item->event.events & ESP_VFS_EPOLLOUT) {
+            FD_SET(fd, writefds);
+        }
+        FD_SET(fd, errorfds); // errors are always reported
+    }
+
+    // Wake up the waiting task, which re-arms the driver with the new FD sets or calls socket_select again
+    epoll_notify(ep, src, false, NULL);
+}
+
+static int epoll_add(esp_vfs_epoll_handle_t ep, int fd, const esp_vfs_epoll_event_t *event)
+{
+    struct _reent* r = __getreent();
+
+    _lock_acquire(&s_fd_table_lock);
+    const bool is_socket_fd = s_fd_table[fd].permanent;
+    const int vfs_index = s_fd_table[fd].vfs_index;
+    const int local_fd = s_fd_table[fd].local_fd;
+    _lock_release(&s_fd_table_lock);
+
+    const vfs_entry_t *vfs = get_vfs_for_index(vfs_index);
+    if (vfs == NULL) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (is_socket_fd ? (vfs->vfs.socket_select == NULL) : (vfs->vfs.start_select == NULL || vfs->vfs.end_select == NULL)) {
+        __errno_r(r) = EPERM;
+        return -1;
+    }
+
+    epoll_item_t *item = calloc(1, sizeof(epoll_item_t));
+    if (item == NULL) {
+        __errno_r(r) = ENOMEM;
+        return -1;
+    }
+    item->event = *event;
+    item->fd = fd;
+    item->vfs_index = vfs_index;
+    item->local_fd = local_fd;
+    item->is_socket = is_socket_fd;
+
+    if (is_socket_fd) {
+        ep->socket_vfs = vfs;
+        ep->socket_nfds = MAX(ep->socket_nfds, fd + 1);
+        ++ep->socket_count;
+    } else {
+        epoll_source_t *src = ep->sources[vfs_index];
+        if (src == NULL) {
+            src = calloc(1, sizeof(epoll_source_t));
+            if (src == NULL) {
+                free(item);
+                __errno_r(r) = ENOMEM;
+                return -1;
+            }
+            src->ep = ep;
+            src->vfs_index = vfs_index;
+            ep->sources[vfs_index] = src;
+        }
+        item->next = src->items;
+        src->items = item;
+        src->nfds = MAX(src->nfds, local_fd + 1);
+    }
+    ep->items[fd] = item;
+    epoll_item_set_interest(ep, item, true);
+    return 0;
+}
+
+static void epoll_remove(esp_vfs_epoll_handle_t ep, epoll_item_t *item)
+{
+    epoll_item_set_interest(ep, item, false);
+    if (item->is_socket) {
+        if (--ep->socket_count == 0) {
+            ep->socket_nfds = 0;
+        }
+    } else {
+        epoll_source_t *src = ep->sources[item->vfs_index];
+        for (epoll_item_t **it = &src->items; *it != NULL; it = &(*it)->next) {
+            if (*it == item) {
+                *it = item->next;
+                break;
+            }
+        }
+    }
+    ep->items[item->fd] = NULL;
+    free(item);
+}
+
+esp_vfs_epoll_handle_t esp_vfs_epoll_create(void)
+{
+    esp_vfs_epoll_handle_t ep = calloc(1, sizeof(struct esp_vfs_epoll));
+    if (ep != NULL && (ep->sem = xSemaphoreCreateBinary()) == NULL) {
+        free(ep);
+        ep = NULL;
+    }
+    if (ep == NULL) {
+        __errno_r(__getreent()) = ENOMEM;
+        return NULL;
+    }
+    _lock_init(&ep->lock);
+    portMUX_INITIALIZE(&ep->trigger_lock);
+    return ep;
+}
+
+int esp_vfs_epoll_ctl(esp_vfs_epoll_handle_t ep, int op, int fd, const esp_vfs_epoll_event_t *event)
+{
+    struct _reent* r = __getreent();
+    if (ep == NULL || (op != ESP_VFS_EPOLL_CTL_DEL && event == NULL)) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    // Readiness is only level-triggered, an edge-triggered request mustn't silently behave differently
+    if (op != ESP_VFS_EPOLL_CTL_DEL && (event->events & ~(ESP_VFS_EPOLLIN | ESP_VFS_EPOLLOUT | ESP_VFS_EPOLLERR)) != 0) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (!fd_valid(fd)) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+
+    int ret = 0;
+    _lock_acquire(&ep->lock);
+    epoll_item_t *item = ep->items[fd];
+    switch (op) {
+    case ESP_VFS_EPOLL_CTL_ADD:
+        if (item != NULL) {
+            __errno_r(r) = EEXIST;
+            ret = -1;
+        } else {
+            ret = epoll_add(ep, fd, event);
+        }
+        break;
+    case ESP_VFS_EPOLL_CTL_MOD:
+        if (item == NULL) {
+            __errno_r(r) = ENOENT;
+            ret = -1;
+        } else {
+            item->event = *event;
+            epoll_item_set_interest(ep, item, true);
+        }
+        break;
+    case ESP_VFS_EPOLL_CTL_DEL:
+        if (item == NULL) {
+            __errno_r(r) = ENOENT;
+            ret = -1;
+        } else {
+            epoll_remove(ep, item);
+        }
+        break;
+    default:
+        __errno_r(r) = EINVAL;
+        ret = -1;
+        break;
+    }
+    _lock_release(&ep->lock);
+    return ret;
+}
+
+int esp_vfs_epoll_wait(esp_vfs_epoll_handle_t ep, esp_vfs_epoll_event_t *events, int maxevents, int timeout_ms)
+{
+    struct _reent* r = __getreent();
+    if (ep == NULL || events == NULL || maxevents <= 0) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+
+    _lock_acquire(&ep->lock);
+    if (ep->waiting) {
+        _lock_release(&ep->lock);
+        __errno_r(r) = EBUSY;
+        return -1;
+    }
+    ep->waiting = true;
+
+    TickType_t ticks_to_wait = portMAX_DELAY;
+    if (timeout_ms == 0) {
+        ticks_to_wait = 0;
+    } else if (timeout_ms > 0) {
+        // Rounded up and incremented by one, see esp_vfs_select()
+        ticks_to_wait = ((timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS) + 1;
+    }
+    TimeOut_t time_out;
+    vTaskSetTimeOutState(&time_out);
+
+    int ret;
+    while (true) {
+        ret = epoll_collect(ep, events, maxevents);
+        if (ep->socket_count > 0 && ret < maxevents) {
+            const int socket_ret = epoll_socket_select(ep, events + ret, maxevents - ret, (ret > 0) ? 0 : ticks_to_wait);
+            if (socket_ret < 0) {
+                // errno is set by socket_select, events of non-socket drivers are reported first
+                ret = (ret > 0) ? ret : -1;
+                break;
+            }
+            ret += socket_ret;
+        } else if (ret == 0 && ticks_to_wait > 0) {
+            _lock_release(&ep->lock);
+            xSemaphoreTake(ep->sem, ticks_to_wait);
+            _lock_acquire(&ep->lock);
+        }
+        if (ret != 0 || xTaskCheckForTimeOut(&time_out, &ticks_to_wait) == pdTRUE) {
+            break;
+        }
+    }
+
+    ep->waiting = false;
+    _lock_release(&ep->lock);
+    return ret;
+}
+
+int esp_vfs_epoll_destroy(esp_vfs_epoll_handle_t ep)
+{
+    if (ep == NULL) {
+        __errno_r(__getreent()) = EINVAL;
+        return -1;
+    }
+
+    _lock_acquire(&ep->lock);
+    if (ep->waiting) {
+        _lock_release(&ep->lock);
+        __errno_r(__getreent()) = EBUSY;
+        return -1;
+    }
+    for (int i = 0; i < VFS_MAX_COUNT; ++i) {
+        epoll_source_t *src = ep->sources[i];
+        if (src && src->armed) {
+            epoll_source_disarm(src);
+        }
+        free(src);
+    }
+    for (int fd = 0; fd < MAX_FDS; ++fd) {
+        free(ep->items[fd]);
+    }
+    _lock_release(&ep->lock);
+    _lock_close(&ep->lock);
+    vSemaphoreDelete(ep->sem);
+    free(ep);
+    return 0;
+}
+
 void esp_vfs_select_triggered(esp_vfs_select_sem_t sem)
 {
-    if (sem.is_sem_local) {
+    if (sem.epoll_src) {
+        epoll_notify(((epoll_source_t *) sem.epoll_src)->ep, sem.epoll_src, false, NULL);
+    } else if (sem.is_sem_local) {
         xSemaphoreGive(sem.sem);
     } else {
         // Another way would be to go through s_fd_table and find the VFS
@@ -1109,7 +1798,9 @@ void esp_vfs_select_triggered(esp_vfs_select_sem_t sem)
 
 void esp_vfs_select_triggered_isr(esp_vfs_select_sem_t sem, BaseType_t *woken)
 {
-    if (sem.is_sem_local) {
+    if (sem.epoll_src) {
+        epoll_notify(((epoll_source_t *) sem.epoll_src)->ep, sem.epoll_src, true, woken);
+    } else if (sem.is_sem_local) {
         xSemaphoreGiveFromISR(sem.sem, woken);
     } else {
         // Another way would be to go through s_fd_table and find the VFS
@@ -1250,6 +1941,14 @@ ssize_t pread(int fd, void *dst, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pread")));
 ssize_t pwrite(int fd, const void *src, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pwrite")));
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_readv")));
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_writev")));
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+    __attribute__((alias("esp_vfs_preadv")));
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+    __attribute__((alias("esp_vfs_pwritev")));
 off_t _lseek_r(struct _reent *r, int fd, off_t size, int mode)
     __attribute__((alias("esp_vfs_lseek")));
 int _fcntl_r(struct _reent *r, int fd, int cmd, int arg)
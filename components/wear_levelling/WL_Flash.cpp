@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -11,6 +11,7 @@
 #include "crc32.h"
 #include <string.h>
 #include <stddef.h>
+#include "sdkconfig.h"
 
 static const char *TAG = "wl_flash";
 #ifndef WL_CFG_CRC_CONST
@@ -35,6 +36,8 @@ WL_Flash::WL_Flash()
 WL_Flash::~WL_Flash()
 {
     free(this->temp_buff);
+    free(this->discarded_map);
+    free(this->erased_map);
 }
 
 esp_err_t WL_Flash::config(wl_config_t *cfg, Flash_Access *flash_drv)
@@ -104,6 +107,16 @@ esp_err_t WL_Flash::config(wl_config_t *cfg, Flash_Access *flash_drv)
         result = ESP_ERR_NO_MEM;
     }
     WL_RESULT_CHECK(result);
+
+    size_t map_size = (this->flash_size / this->cfg.sector_size + 31) / 32 * sizeof(uint32_t);
+    free(this->discarded_map);
+    free(this->erased_map);
+    this->discarded_map = (uint32_t *)calloc(1, map_size);
+    this->erased_map = (uint32_t *)calloc(1, map_size);
+    if ((this->discarded_map == NULL) || (this->erased_map == NULL)) {
+        result = ESP_ERR_NO_MEM;
+    }
+    WL_RESULT_CHECK(result);
     this->configured = true;
     return ESP_OK;
 }
@@ -432,6 +445,7 @@ esp_err_t WL_Flash::updateWL()
     if (data_addr >= this->state.max_pos) {
         data_addr = 0;
     }
+    size_t data_logical_addr = this->calcLogicalAddr(data_addr * this->cfg.page_size);
     data_addr = this->cfg.start_addr + data_addr * this->cfg.page_size;
     this->dummy_addr = this->cfg.start_addr + this->state.pos * this->cfg.page_size;
     result = this->flash_drv->erase_range(this->dummy_addr, this->cfg.page_size);
@@ -443,6 +457,10 @@ esp_err_t WL_Flash::updateWL()
 
     size_t copy_count = this->cfg.page_size / this->cfg.temp_buff_size;
     for (size_t i = 0; i < copy_count; i++) {
+        if (this->sectorUnused((data_logical_addr + i * this->cfg.temp_buff_size) / this->cfg.sector_size)) {
+            // Nothing to keep, this part of the dummy block stays erased
+            continue;
+        }
         result = this->flash_drv->read(data_addr + i * this->cfg.temp_buff_size, this->temp_buff, this->cfg.temp_buff_size);
         if (result != ESP_OK) {
             ESP_LOGE(TAG, "%s - not possible to read buffer, will try next time, result= 0x%08x", __func__, result);
@@ -475,6 +493,13 @@ esp_err_t WL_Flash::updateWL()
         this->state.access_count = this->state.max_count - 1; // we will update next time
         return result;
     }
+    // Unused sectors of the moved block are erased now
+    for (size_t i = 0; i < this->cfg.page_size / this->cfg.sector_size; i++) {
+        size_t sector = data_logical_addr / this->cfg.sector_size + i;
+        if (this->sectorUnused(sector)) {
+            this->updateSectorMap(this->erased_map, sector, 1, true);
+        }
+    }
 
     this->state.pos++;
     if (this->state.pos >= this->state.max_pos) {
@@ -518,6 +543,44 @@ size_t WL_Flash::calcAddr(size_t addr)
     return result;
 }
 
+// Inverse of calcAddr, phys_addr must not point to the dummy block
+size_t WL_Flash::calcLogicalAddr(size_t phys_addr)
+{
+    size_t dummy_addr = this->state.pos * this->cfg.page_size;
+    if (phys_addr > dummy_addr) {
+        phys_addr -= this->cfg.page_size;
+    }
+    return (phys_addr + this->state.move_count * this->cfg.page_size) % this->flash_size;
+}
+
+bool WL_Flash::testSectorMap(const uint32_t *map, size_t sector)
+{
+    if (sector >= this->flash_size / this->cfg.sector_size) {
+        return false;
+    }
+    return (map[sector / 32] & ((uint32_t)1 << (sector % 32))) != 0;
+}
+
+bool WL_Flash::sectorUnused(size_t sector)
+{
+    return this->testSectorMap(this->discarded_map, sector) || this->testSectorMap(this->erased_map, sector);
+}
+
+void WL_Flash::updateSectorMap(uint32_t *map, size_t start_sector, size_t count, bool value)
+{
+    size_t end_sector = start_sector + count;
+    if (end_sector > this->flash_size / this->cfg.sector_size) {
+        end_sector = this->flash_size / this->cfg.sector_size;
+    }
+    for (size_t sector = start_sector; sector < end_sector; sector++) {
+        if (value) {
+            map[sector / 32] |= (uint32_t)1 << (sector % 32);
+        } else {
+            map[sector / 32] &= ~((uint32_t)1 << (sector % 32));
+        }
+    }
+}
+
 
 size_t WL_Flash::chip_size()
 {
@@ -542,11 +605,16 @@ esp_err_t WL_Flash::erase_sector(size_t sector)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - sector= 0x%08x", __func__, (uint32_t) sector);
+    if (this->testSectorMap(this->erased_map, sector)) {
+        ESP_LOGV(TAG, "%s - sector= 0x%08x is already erased", __func__, (uint32_t) sector);
+        return result;
+    }
     result = this->updateWL();
     WL_RESULT_CHECK(result);
     size_t virt_addr = this->calcAddr(sector * this->cfg.sector_size);
     result = this->flash_drv->erase_sector((this->cfg.start_addr + virt_addr) / this->cfg.sector_size);
     WL_RESULT_CHECK(result);
+    this->updateSectorMap(this->erased_map, sector, 1, true);
     return result;
 }
 esp_err_t WL_Flash::erase_range(size_t start_address, size_t size)
@@ -573,6 +641,12 @@ esp_err_t WL_Flash::write(size_t dest_addr, const void *src, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - dest_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) dest_addr, (uint32_t) size);
+    if (size > 0) {
+        size_t start_sector = dest_addr / this->cfg.sector_size;
+        size_t end_sector = (dest_addr + size - 1) / this->cfg.sector_size + 1;
+        this->updateSectorMap(this->discarded_map, start_sector, end_sector - start_sector, false);
+        this->updateSectorMap(this->erased_map, start_sector, end_sector - start_sector, false);
+    }
     uint32_t count = (size - 1) / this->cfg.page_size;
     for (size_t i = 0; i < count; i++) {
         size_t virt_addr = this->calcAddr(dest_addr + i * this->cfg.page_size);
@@ -605,6 +679,29 @@ esp_err_t WL_Flash::read(size_t src_addr, void *dest, size_t size)
     return result;
 }
 
+esp_err_t WL_Flash::discard_range(size_t start_address, size_t size)
+{
+    esp_err_t result = ESP_OK;
+    if (!this->initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if ((start_address > this->chip_size()) || (size > this->chip_size() - start_address)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    ESP_LOGD(TAG, "%s - start_address= 0x%08x, size= 0x%08x", __func__, (uint32_t) start_address, (uint32_t) size);
+    // Only the sectors which are completely inside of the range
+    size_t start_sector = (start_address + this->cfg.sector_size - 1) / this->cfg.sector_size;
+    size_t end_sector = (start_address + size) / this->cfg.sector_size;
+    for (size_t sector = start_sector; sector < end_sector; sector++) {
+        this->updateSectorMap(this->discarded_map, sector, 1, true);
+#if CONFIG_WL_ERASE_DISCARDED_SECTORS
+        result = WL_Flash::erase_sector(sector);
+        WL_RESULT_CHECK(result);
+#endif // CONFIG_WL_ERASE_DISCARDED_SECTORS
+    }
+    return result;
+}
+
 Flash_Access *WL_Flash::get_drv()
 {
     return this->flash_drv;
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -62,6 +62,32 @@ esp_err_t wl_unmount(wl_handle_t handle);
 */
 esp_err_t wl_erase_range(wl_handle_t handle, size_t start_addr, size_t size);
 
+/**
+* @brief Mark part of the WL storage as unused
+*
+* Tells the WL layer that the data in the range is not needed anymore, for example
+* because it belonged to a deleted file. Discarded sectors are not copied when
+* the WL layer moves the block they belong to, and a sector which became erased
+* this way is not erased again by the next wl_erase_range call.
+*
+* Only the flash sectors which are completely inside the range are discarded.
+* The information is kept in RAM and is lost when the partition is unmounted.
+*
+* @param handle WL handle that are related to the partition
+* @param start_addr Address where the discarded range starts, relative to the
+*                   beginning of the partition.
+* @param size Size of the range, in bytes.
+*
+* @note Contents of the range are undefined after this call. The range has to be
+*       erased with wl_erase_range before it is written again.
+*
+* @return
+*       - ESP_OK, if the range was discarded successfully;
+*       - ESP_ERR_INVALID_SIZE, if the range goes out of bounds of the partition;
+*       - or one of error codes from lower-level flash driver.
+*/
+esp_err_t wl_discard_range(wl_handle_t handle, size_t start_addr, size_t size);
+
 /**
 * @brief Write data to the WL storage
 *
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -34,6 +34,8 @@ public :
     esp_err_t write(size_t dest_addr, const void *src, size_t size) override;
     esp_err_t read(size_t src_addr, void *dest, size_t size) override;
 
+    virtual esp_err_t discard_range(size_t start_address, size_t size);
+
     esp_err_t flush() override;
 
     Flash_Access *get_drv();
@@ -58,11 +60,18 @@ protected:
     uint8_t *temp_buff = NULL;
     size_t dummy_addr;
     uint32_t pos_data[4];
+    // One bit per sector: data is not needed anymore / sector is known to be erased
+    uint32_t *discarded_map = NULL;
+    uint32_t *erased_map = NULL;
 
     esp_err_t initSections();
     esp_err_t updateWL();
     esp_err_t recoverPos();
     size_t calcAddr(size_t addr);
+    size_t calcLogicalAddr(size_t phys_addr);
+    bool testSectorMap(const uint32_t *map, size_t sector);
+    bool sectorUnused(size_t sector);
+    void updateSectorMap(uint32_t *map, size_t start_sector, size_t count, bool value);
 
     esp_err_t updateVersion();
     esp_err_t updateV1_V2();
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2021-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -266,6 +266,151 @@ TEST(wear_levelling, write_doesnt_touch_other_sectors)
     wl_unmount(handle);
 }
 
+static void check_discard_data(wl_handle_t handle, uint32_t init_val, uint32_t *buff, size_t blocks)
+{
+    // Only the blocks with even numbers hold data
+    for (int m = 0; m < blocks; m += 2) {
+        TEST_ESP_OK(wl_read(handle, SPI_FLASH_SEC_SIZE * m, buff, SPI_FLASH_SEC_SIZE));
+        for (int i = 0; i < SPI_FLASH_SEC_SIZE / sizeof(uint32_t); i++) {
+            TEST_ASSERT_EQUAL(init_val + i + m * SPI_FLASH_SEC_SIZE, buff[i]);
+        }
+    }
+}
+
+// We write complete memory, discard every second flash sector
+// and then write one sector many times, so that all blocks are moved several times.
+// The data which was not discarded should be the same, also after unmount.
+TEST(wear_levelling, discard_keeps_other_sectors)
+{
+    const esp_partition_t *partition = get_test_data_partition();
+    esp_partition_t fake_partition;
+    memcpy(&fake_partition, partition, sizeof(fake_partition));
+
+    fake_partition.size = SPI_FLASH_SEC_SIZE * (4 + TEST_SECTORS_COUNT);
+
+    wl_handle_t handle;
+    TEST_ESP_OK(wl_mount(&fake_partition, &handle));
+    size_t blocks = wl_size(handle) / SPI_FLASH_SEC_SIZE;
+    uint32_t init_val = rand();
+    uint32_t *buff = (uint32_t *)malloc(SPI_FLASH_SEC_SIZE);
+    TEST_ASSERT_NOT_NULL(buff);
+
+    for (int m = 0; m < blocks; m++) {
+        for (int i = 0; i < SPI_FLASH_SEC_SIZE / sizeof(uint32_t); i++) {
+            buff[i] = init_val + i + m * SPI_FLASH_SEC_SIZE;
+        }
+        TEST_ESP_OK(wl_erase_range(handle, SPI_FLASH_SEC_SIZE * m, SPI_FLASH_SEC_SIZE));
+        TEST_ESP_OK(wl_write(handle, SPI_FLASH_SEC_SIZE * m, buff, SPI_FLASH_SEC_SIZE));
+    }
+    for (int m = 1; m < blocks; m += 2) {
+        TEST_ESP_OK(wl_discard_range(handle, SPI_FLASH_SEC_SIZE * m, SPI_FLASH_SEC_SIZE));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, wl_discard_range(handle, 0, wl_size(handle) + SPI_FLASH_SEC_SIZE));
+    check_discard_data(handle, init_val, buff, blocks);
+
+    for (int n = 0; n < 2000; n++) {
+        for (int i = 0; i < SPI_FLASH_SEC_SIZE / sizeof(uint32_t); i++) {
+            buff[i] = init_val + i;
+        }
+        TEST_ESP_OK(wl_erase_range(handle, 0, SPI_FLASH_SEC_SIZE));
+        TEST_ESP_OK(wl_write(handle, 0, buff, SPI_FLASH_SEC_SIZE));
+        if (n % 100 == 0) {
+            check_discard_data(handle, init_val, buff, blocks);
+        }
+    }
+    check_discard_data(handle, init_val, buff, blocks);
+    wl_unmount(handle);
+
+    TEST_ESP_OK(wl_mount(&fake_partition, &handle));
+    check_discard_data(handle, init_val, buff, blocks);
+    free(buff);
+    wl_unmount(handle);
+}
+
+/* Flash operations on the partition under test, counted by wrapping the esp_partition functions
+ * (see CMakeLists.txt). Wear levelling only erases and writes its partition through these. */
+static const esp_partition_t *s_counted_partition;
+static uint32_t s_erase_count;
+static uint32_t s_write_bytes;
+
+esp_err_t __real_esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+esp_err_t __real_esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+
+esp_err_t __wrap_esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (partition == s_counted_partition) {
+        s_erase_count += size / SPI_FLASH_SEC_SIZE;
+    }
+    return __real_esp_partition_erase_range(partition, offset, size);
+}
+
+esp_err_t __wrap_esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    if (partition == s_counted_partition) {
+        s_write_bytes += size;
+    }
+    return __real_esp_partition_write(partition, dst_offset, src, size);
+}
+
+// Fill a freshly erased partition, discard all sectors but the first one if requested,
+// and count the flash sectors erased and bytes written while the first sector is rewritten
+// many times, so that all blocks are moved several times.
+static void count_rewrite_flash_ops(const esp_partition_t *partition, bool discard, uint32_t *erase_count, uint32_t *write_bytes)
+{
+    TEST_ESP_OK(esp_partition_erase_range(partition, 0, partition->size));
+    wl_handle_t handle;
+    TEST_ESP_OK(wl_mount(partition, &handle));
+    size_t blocks = wl_size(handle) / SPI_FLASH_SEC_SIZE;
+    uint32_t *buff = (uint32_t *)malloc(SPI_FLASH_SEC_SIZE);
+    TEST_ASSERT_NOT_NULL(buff);
+
+    for (int m = 0; m < blocks; m++) {
+        for (int i = 0; i < SPI_FLASH_SEC_SIZE / sizeof(uint32_t); i++) {
+            buff[i] = i + m * SPI_FLASH_SEC_SIZE;
+        }
+        TEST_ESP_OK(wl_erase_range(handle, SPI_FLASH_SEC_SIZE * m, SPI_FLASH_SEC_SIZE));
+        TEST_ESP_OK(wl_write(handle, SPI_FLASH_SEC_SIZE * m, buff, SPI_FLASH_SEC_SIZE));
+    }
+    if (discard) {
+        TEST_ESP_OK(wl_discard_range(handle, SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE * (blocks - 1)));
+    }
+
+    s_erase_count = 0;
+    s_write_bytes = 0;
+    s_counted_partition = partition;
+    for (int n = 0; n < 2000; n++) {
+        TEST_ESP_OK(wl_erase_range(handle, 0, SPI_FLASH_SEC_SIZE));
+        TEST_ESP_OK(wl_write(handle, 0, buff, SPI_FLASH_SEC_SIZE));
+    }
+    s_counted_partition = NULL;
+    *erase_count = s_erase_count;
+    *write_bytes = s_write_bytes;
+
+    free(buff);
+    wl_unmount(handle);
+}
+
+// Blocks which are moved by wear levelling should not copy the discarded sectors,
+// so rewriting the only sector in use costs less flash operations after the discard.
+TEST(wear_levelling, discard_reduces_flash_operations)
+{
+    const esp_partition_t *partition = get_test_data_partition();
+    esp_partition_t fake_partition;
+    memcpy(&fake_partition, partition, sizeof(fake_partition));
+
+    fake_partition.size = SPI_FLASH_SEC_SIZE * (4 + TEST_SECTORS_COUNT);
+
+    uint32_t erase_count, write_bytes;
+    uint32_t discard_erase_count, discard_write_bytes;
+    count_rewrite_flash_ops(&fake_partition, false, &erase_count, &write_bytes);
+    count_rewrite_flash_ops(&fake_partition, true, &discard_erase_count, &discard_write_bytes);
+    printf("Without discard: %u sectors erased, %u bytes written\n", erase_count, write_bytes);
+    printf("With discard:    %u sectors erased, %u bytes written\n", discard_erase_count, discard_write_bytes);
+
+    TEST_ASSERT_LESS_THAN(write_bytes, discard_write_bytes);
+    TEST_ASSERT_LESS_OR_EQUAL(erase_count, discard_erase_count);
+}
+
 
 #if CONFIG_WL_SECTOR_SIZE_4096
 // This test runs for 4k sector size only, since the original (version 1) partition binary is generated this way
@@ -325,6 +470,8 @@ TEST_GROUP_RUNNER(wear_levelling)
     RUN_TEST_CASE(wear_levelling, wl_mount_checks_partition_params)
     RUN_TEST_CASE(wear_levelling, multiple_tasks_single_handle)
     RUN_TEST_CASE(wear_levelling, write_doesnt_touch_other_sectors)
+    RUN_TEST_CASE(wear_levelling, discard_keeps_other_sectors)
+    RUN_TEST_CASE(wear_levelling, discard_reduces_flash_operations)
 
 #if CONFIG_WL_SECTOR_SIZE_4096
     RUN_TEST_CASE(wear_levelling, version_update)
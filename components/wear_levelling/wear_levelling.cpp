@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -193,6 +193,18 @@ esp_err_t wl_erase_range(wl_handle_t handle, size_t start_addr, size_t size)
     return result;
 }
 
+esp_err_t wl_discard_range(wl_handle_t handle, size_t start_addr, size_t size)
+{
+    esp_err_t result = check_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_instances[handle].lock);
+    result = s_instances[handle].instance->discard_range(start_addr, size);
+    _lock_release(&s_instances[handle].lock);
+    return result;
+}
+
 esp_err_t wl_write(wl_handle_t handle, size_t dest_addr, const void *src, size_t size)
 {
     esp_err_t result = check_handle(handle, __func__);
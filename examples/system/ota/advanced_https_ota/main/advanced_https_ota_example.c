@@ -155,6 +155,9 @@ void advanced_ota_example_task(void *pvParameter)
 #ifdef CONFIG_EXAMPLE_ENABLE_PARTIAL_HTTP_DOWNLOAD
         .partial_http_download = true,
         .max_http_request_size = CONFIG_EXAMPLE_HTTP_REQUEST_SIZE,
+#endif
+#ifdef CONFIG_EXAMPLE_PIPELINED_FLASH_WRITE
+        .pipelined_flash_write = true,
 #endif
     };
 